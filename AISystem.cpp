@@ -0,0 +1,532 @@
+#include "AISystem.h"
+#include "Transform.h"
+#include "JobSystem.h"
+#include "PathScheduler.h"
+#include <chrono>
+#include <cassert>
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+// Groups of 4 agents per job
+#define AI_TICK_CHUNK 256
+
+// Tick rates by distance to the player, chasing groups always tick every frame
+#define AI_LOD_EVERY_FRAME_DISTANCE 12.0f
+#define AI_LOD_HALF_RATE_DISTANCE 24.0f
+#define AI_LOD_QUARTER_RATE_DISTANCE 48.0f
+#define AI_LOD_MAX_INTERVAL 8
+
+#define AI_DEFAULT_TICK_BUDGET_MICROSECONDS 500
+
+// Grid cells are about as wide as the ghosts' dark sight range
+#define AI_GRID_CELL_SIZE 6.0f
+
+// How far a ghost can see the player, squared
+#define AI_SQ_LIGHT_RANGE (9.0f * 9.0f)
+#define AI_SQ_DARK_RANGE (6.0f * 6.0f)
+
+// Squared distance along the floor at which a path corner counts as reached
+#define AI_SQ_ARRIVE_DISTANCE (0.1f * 0.1f)
+
+// Chasing ghosts ask for a new path once the player is this far from where the old one ends, squared
+#define AI_SQ_REPATH_DISTANCE (1.0f * 1.0f)
+
+// Time the path searches can take each frame, the rest wait for the next one
+#define AI_PATH_BUDGET_SECONDS 0.001
+
+// Cells the path searches can expand each frame in deterministic mode, about a millisecond's worth
+#define AI_PATH_EXPANSION_BUDGET 8192
+
+// Yaw the ghosts spin by while they move, the 0.1 degrees a frame they used to at 60 fps
+#define AI_SPIN_RADIANS_PER_SECOND ((3.14f / 180) * 0.1f * 60)
+
+AISystem::AISystem()
+	: agentGrid(AI_GRID_CELL_SIZE)
+{
+	tickBudgetMicroseconds = AI_DEFAULT_TICK_BUDGET_MICROSECONDS;
+}
+
+AISystem::~AISystem()
+{
+	delete pathScheduler;
+}
+
+void AISystem::SetNavMesh(const NavMesh* navMesh)
+{
+	delete pathScheduler;
+	pathScheduler = navMesh ? new PathScheduler(navMesh) : nullptr;
+
+	// Whatever the agents were following came from the old mesh
+	for (uint32_t agent = 0; agent < agentCount; agent++)
+	{
+		paths[agent].clear();
+		pathSteps[agent] = 0;
+		needsPath[agent] = 1;
+		pathPending[agent] = 0;
+	}
+}
+
+uint32_t AISystem::AddRoute(const XMFLOAT3* points, uint32_t pointCount)
+{
+	assert(pointCount > 0);
+
+	routeStarts.push_back((uint32_t)routePoints.size());
+	routeCounts.push_back(pointCount);
+	routePoints.insert(routePoints.end(), points, points + pointCount);
+	return (uint32_t)routeStarts.size() - 1;
+}
+
+uint32_t AISystem::AddAgent(Transform* transform, uint32_t route, float speed)
+{
+	return AddAgent(transform, route, transform->GetPosition(), speed);
+}
+
+uint32_t AISystem::AddAgent(Transform* transform, uint32_t route, XMFLOAT3 position, float speed)
+{
+	assert(route < routeStarts.size());
+
+	uint32_t agent = agentCount++;
+
+	// Grow a whole vector's worth at a time, the new padding lanes sit still
+	if (agent >= positionsX.size())
+	{
+		size_t padded = positionsX.size() + 4;
+		positionsX.resize(padded, 0);
+		positionsY.resize(padded, 0);
+		positionsZ.resize(padded, 0);
+		speeds.resize(padded, 0);
+		carryTimes.resize(padded, 0);
+		tickTimes.resize(padded, 0);
+		routes.resize(padded, route);
+		routeSteps.resize(padded, 0);
+		states.resize(padded, (uint8_t)AI_State::PATROL_PATH);
+		moved.resize(padded, 0);
+		transforms.resize(padded, nullptr);
+		paths.resize(padded);
+		pathSteps.resize(padded, 0);
+		pathGoals.resize(padded, XMFLOAT3(0, 0, 0));
+		needsPath.resize(padded, 0);
+		pathPending.resize(padded, 0);
+		requestStates.resize(padded, (uint8_t)AI_State::PATROL_PATH);
+
+		// New groups tick straight away, their rate is set by that first tick
+		groupIntervals.push_back(1);
+		groupWaits.push_back(0);
+		groupTimes.push_back(0);
+	}
+
+	positionsX[agent] = position.x;
+	positionsY[agent] = position.y;
+	positionsZ[agent] = position.z;
+	speeds[agent] = speed;
+	carryTimes[agent] = 0;
+	tickTimes[agent] = 0;
+	routes[agent] = route;
+	routeSteps[agent] = 0;
+	states[agent] = (uint8_t)AI_State::PATROL_PATH;
+	moved[agent] = 0;
+	transforms[agent] = transform;
+	paths[agent].clear();
+	pathSteps[agent] = 0;
+	pathGoals[agent] = position;
+	needsPath[agent] = 1;
+	pathPending[agent] = 0;
+
+	return agent;
+}
+
+XMFLOAT3 AISystem::GetAgentPosition(uint32_t agent) const
+{
+	return XMFLOAT3(positionsX[agent], positionsY[agent], positionsZ[agent]);
+}
+
+void AISystem::Update(XMFLOAT3 playerPosition, bool playerInLight, float deltaTime)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	stats = AISystemStats();
+	stats.agents = agentCount;
+
+	// Ghosts can see farther if the player is in light
+	float sqRange = playerInLight ? AI_SQ_LIGHT_RANGE : AI_SQ_DARK_RANGE;
+
+	ScheduleGroups(deltaTime);
+	std::chrono::high_resolution_clock::time_point scheduled = std::chrono::high_resolution_clock::now();
+
+	// Each job owns its chunk, the stats are only summed up afterwards
+	uint32_t tickCount = (uint32_t)tickList.size();
+	std::vector<AISystemStats> chunkStats((tickCount + AI_TICK_CHUNK - 1) / AI_TICK_CHUNK);
+
+	JobCounter tickJobs;
+	JobSystem::Get().ParallelFor(tickCount, AI_TICK_CHUNK, [&](uint32_t begin, uint32_t end)
+	{
+		TickGroups(&tickList[begin], end - begin, playerPosition, sqRange, chunkStats[begin / AI_TICK_CHUNK]);
+	}, &tickJobs);
+	JobSystem::Get().Wait(&tickJobs);
+
+	for (const AISystemStats& local : chunkStats)
+	{
+		stats.attacking += local.attacking;
+		stats.stateChanges += local.stateChanges;
+		stats.agentsTicked += local.agentsTicked;
+	}
+
+	std::chrono::high_resolution_clock::time_point ticked = std::chrono::high_resolution_clock::now();
+	RequestPaths(playerPosition);
+	ReceivePaths();
+
+	std::chrono::high_resolution_clock::time_point pathed = std::chrono::high_resolution_clock::now();
+	WriteBack();
+
+	std::chrono::high_resolution_clock::time_point written = std::chrono::high_resolution_clock::now();
+
+	agentGrid.Clear();
+	for (uint32_t i = 0; i < agentCount; i++)
+	{
+		agentGrid.Insert(i, XMFLOAT3(positionsX[i], positionsY[i], positionsZ[i]), 0.f);
+	}
+	agentGrid.Build();
+
+	stats.tickSeconds = std::chrono::duration<double>(ticked - start).count();
+
+	// The budget covers the ticks themselves, next frame's schedule
+	// assumes groups cost what they did here
+	double groupsSeconds = std::chrono::duration<double>(ticked - scheduled).count();
+	if (tickCount > 0)
+	{
+		double groupSeconds = groupsSeconds / tickCount;
+		groupTickEstimate = groupTickEstimate > 0 ? groupTickEstimate * .9 + groupSeconds * .1 : groupSeconds;
+	}
+	stats.overBudget = groupsSeconds * 1e6 > tickBudgetMicroseconds;
+	budgetOverruns += stats.overBudget ? 1 : 0;
+	stats.budgetOverruns = budgetOverruns;
+	stats.pathSeconds = std::chrono::duration<double>(pathed - ticked).count();
+	stats.writeBackSeconds = std::chrono::duration<double>(written - pathed).count();
+	stats.indexSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - written).count();
+}
+
+void AISystem::FindAgentsNear(XMFLOAT3 position, float radius, std::vector<uint32_t>& agents)
+{
+	agentGrid.Query(position, radius, agents);
+
+	// Drop the candidates that only shared a cell
+	float sqRadius = radius * radius;
+	agents.erase(std::remove_if(agents.begin(), agents.end(), [&](uint32_t agent)
+	{
+		float x = positionsX[agent] - position.x;
+		float y = positionsY[agent] - position.y;
+		float z = positionsZ[agent] - position.z;
+		return x * x + y * y + z * z > sqRadius;
+	}), agents.end());
+}
+
+void AISystem::ScheduleGroups(float deltaTime)
+{
+	frameIndex++;
+	tickList.clear();
+	optionalGroups.clear();
+
+	uint32_t groupCount = (uint32_t)groupIntervals.size();
+	for (uint32_t group = 0; group < groupCount; group++)
+	{
+		// Skipped frames still count, the next tick moves the group the whole way
+		groupTimes[group] += deltaTime;
+		if (groupWaits[group] < UINT8_MAX)
+		{
+			groupWaits[group]++;
+		}
+
+		// Each group's ticks land on its own phase of the interval, or as soon as possible if it was deferred
+		uint32_t interval = groupIntervals[group];
+		if ((frameIndex + group) % interval != 0 && groupWaits[group] < interval)
+			continue;
+
+		if (interval == 1)
+		{
+			tickList.push_back(group);
+		}
+		else
+		{
+			optionalGroups.push_back(group);
+		}
+	}
+
+	// Whatever fits in the budget after the groups that have to tick, longest waiting first
+	size_t allowed = optionalGroups.size();
+	if (groupTickEstimate > 0 && !deterministic)
+	{
+		double budgetSeconds = tickBudgetMicroseconds * 1e-6 - tickList.size() * groupTickEstimate;
+		allowed = budgetSeconds > 0 ? (std::min)(allowed, (size_t)(budgetSeconds / groupTickEstimate)) : 0;
+	}
+
+	if (allowed < optionalGroups.size())
+	{
+		std::sort(optionalGroups.begin(), optionalGroups.end(), [&](uint32_t a, uint32_t b)
+		{
+			return groupWaits[a] != groupWaits[b] ? groupWaits[a] > groupWaits[b] : a < b;
+		});
+	}
+
+	tickList.insert(tickList.end(), optionalGroups.begin(), optionalGroups.begin() + allowed);
+	stats.groupsTicked = (unsigned int)tickList.size();
+	stats.groupsDeferred = (unsigned int)(optionalGroups.size() - allowed);
+}
+
+void AISystem::TickGroups(const uint32_t* groups, uint32_t groupCount, XMFLOAT3 playerPosition, float sqRange, AISystemStats& rangeStats)
+{
+	XMVECTOR playerX = XMVectorReplicate(playerPosition.x);
+	XMVECTOR playerY = XMVectorReplicate(playerPosition.y);
+	XMVECTOR playerZ = XMVectorReplicate(playerPosition.z);
+	XMVECTOR range = XMVectorReplicate(sqRange);
+	XMVECTOR arriveDistance = XMVectorReplicate(AI_SQ_ARRIVE_DISTANCE);
+	XMVECTOR minDistance = XMVectorReplicate(1e-12f);
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR one = XMVectorSplatOne();
+
+	for (uint32_t g = 0; g < groupCount; g++)
+	{
+		uint32_t group = groups[g];
+		uint32_t i = group * 4;
+		XMVECTOR deltaTime = XMVectorAdd(XMVectorReplicate(groupTimes[group]), XMLoadFloat4((const XMFLOAT4*)&carryTimes[i]));
+		XMStoreFloat4((XMFLOAT4*)&tickTimes[i], deltaTime);
+		groupTimes[group] = 0;
+		groupWaits[group] = 0;
+
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&positionsX[i]);
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&positionsY[i]);
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&positionsZ[i]);
+
+		// Path corners have to be gathered one lane at a time, lanes without one aim at themselves
+		XMFLOAT4 cornerX, cornerZ;
+		float* cx = &cornerX.x;
+		float* cz = &cornerZ.x;
+		bool hasCorner[4];
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			uint32_t agent = i + lane;
+			hasCorner[lane] = agent < agentCount && pathSteps[agent] < paths[agent].size();
+			if (hasCorner[lane])
+			{
+				const XMFLOAT3& corner = paths[agent][pathSteps[agent]];
+				cx[lane] = corner.x;
+				cz[lane] = corner.z;
+			}
+			else
+			{
+				cx[lane] = positionsX[agent];
+				cz[lane] = positionsZ[agent];
+			}
+		}
+
+		// Spot the player
+		XMVECTOR toPlayerX = XMVectorSubtract(playerX, x);
+		XMVECTOR toPlayerY = XMVectorSubtract(playerY, y);
+		XMVECTOR toPlayerZ = XMVectorSubtract(playerZ, z);
+		XMVECTOR sqPlayerDistance = XMVectorMultiplyAdd(toPlayerX, toPlayerX, XMVectorMultiplyAdd(toPlayerY, toPlayerY, XMVectorMultiply(toPlayerZ, toPlayerZ)));
+		XMVECTOR attacking = XMVectorLess(sqPlayerDistance, range);
+
+		// Head for the corner, only along the floor
+		XMVECTOR toTargetX = XMVectorSubtract(XMLoadFloat4(&cornerX), x);
+		XMVECTOR toTargetZ = XMVectorSubtract(XMLoadFloat4(&cornerZ), z);
+		XMVECTOR sqTargetDistance = XMVectorMultiplyAdd(toTargetX, toTargetX, XMVectorMultiply(toTargetZ, toTargetZ));
+
+		XMVECTOR arrived = XMVectorLessOrEqual(sqTargetDistance, arriveDistance);
+		XMVECTOR moving = XMVectorAndCInt(XMVectorTrueInt(), arrived);
+
+		// Normalized direction times speed, capped so a long frame can't overshoot the corner
+		XMVECTOR speed = XMLoadFloat4((const XMFLOAT4*)&speeds[i]);
+		XMVECTOR step = XMVectorMultiply(speed, deltaTime);
+		XMVECTOR inverseDistance = XMVectorReciprocalSqrt(XMVectorMax(sqTargetDistance, minDistance));
+		XMVECTOR scale = XMVectorMin(XMVectorMultiply(inverseDistance, step), one);
+		scale = XMVectorSelect(zero, scale, moving);
+
+		XMStoreFloat4((XMFLOAT4*)&positionsX[i], XMVectorMultiplyAdd(toTargetX, scale, x));
+		XMStoreFloat4((XMFLOAT4*)&positionsZ[i], XMVectorMultiplyAdd(toTargetZ, scale, z));
+
+		// Time left over after reaching the end of the path, picked up by the next tick
+		XMVECTOR walked = XMVectorMultiply(XMVectorMultiply(scale, sqTargetDistance), inverseDistance);
+		XMFLOAT4 unusedTimes;
+		XMStoreFloat4(&unusedTimes, XMVectorMax(XMVectorSubtract(deltaTime, XMVectorDivide(walked, XMVectorMax(speed, minDistance))), zero));
+
+		uint32_t attackBits[4];
+		uint32_t arrivedBits[4];
+		uint32_t movingBits[4];
+		XMStoreInt4(attackBits, attacking);
+		XMStoreInt4(arrivedBits, arrived);
+		XMStoreInt4(movingBits, moving);
+
+		// Closest lane to the player sets the group's next rate
+		XMFLOAT4 sqDistances;
+		XMStoreFloat4(&sqDistances, sqPlayerDistance);
+		float sqClosest = FLT_MAX;
+		bool anyAttacking = false;
+
+		uint32_t lanes = (std::min)(4u, agentCount > i ? agentCount - i : 0u);
+		rangeStats.agentsTicked += lanes;
+		for (uint32_t lane = 0; lane < lanes; lane++)
+		{
+			sqClosest = (std::min)(sqClosest, (&sqDistances.x)[lane]);
+			anyAttacking = anyAttacking || attackBits[lane] != 0;
+
+			uint32_t agent = i + lane;
+
+			uint8_t state = (uint8_t)(attackBits[lane] ? AI_State::ATTACK_PLAYER : AI_State::PATROL_PATH);
+			if (state != states[agent])
+			{
+				states[agent] = state;
+				rangeStats.stateChanges++;
+
+				// The old path leads somewhere else now
+				paths[agent].clear();
+				pathSteps[agent] = 0;
+				needsPath[agent] = 1;
+			}
+			else if (hasCorner[lane] && arrivedBits[lane] && ++pathSteps[agent] == paths[agent].size())
+			{
+				// End of the path, on to the next waypoint or another look at the player
+				if (!attackBits[lane])
+				{
+					routeSteps[agent] = (routeSteps[agent] + 1) % routeCounts[routes[agent]];
+				}
+				needsPath[agent] = 1;
+			}
+
+			if (attackBits[lane])
+			{
+				rangeStats.attacking++;
+
+				float goalX = pathGoals[agent].x - playerPosition.x;
+				float goalZ = pathGoals[agent].z - playerPosition.z;
+				if (goalX * goalX + goalZ * goalZ > AI_SQ_REPATH_DISTANCE)
+				{
+					needsPath[agent] = 1;
+				}
+			}
+
+			if (!hasCorner[lane] && !pathPending[agent])
+			{
+				needsPath[agent] = 1;
+			}
+
+			moved[agent] = movingBits[lane] && hasCorner[lane] ? 1 : 0;
+
+			// Agents waiting on a path hold on to their leftover time, but the wait itself doesn't add to it
+			if (hasCorner[lane])
+			{
+				carryTimes[agent] = (&unusedTimes.x)[lane];
+			}
+		}
+
+		uint8_t interval = AI_LOD_MAX_INTERVAL;
+		if (anyAttacking || sqClosest < AI_LOD_EVERY_FRAME_DISTANCE * AI_LOD_EVERY_FRAME_DISTANCE)
+		{
+			interval = 1;
+		}
+		else if (sqClosest < AI_LOD_HALF_RATE_DISTANCE * AI_LOD_HALF_RATE_DISTANCE)
+		{
+			interval = 2;
+		}
+		else if (sqClosest < AI_LOD_QUARTER_RATE_DISTANCE * AI_LOD_QUARTER_RATE_DISTANCE)
+		{
+			interval = 4;
+		}
+		groupIntervals[group] = interval;
+	}
+}
+
+void AISystem::RequestPaths(XMFLOAT3 playerPosition)
+{
+	for (uint32_t agent = 0; agent < agentCount; agent++)
+	{
+		if (!needsPath[agent] || pathPending[agent])
+			continue;
+
+		needsPath[agent] = 0;
+		XMFLOAT3 goal = states[agent] == (uint8_t)AI_State::ATTACK_PLAYER ?
+			playerPosition :
+			routePoints[routeStarts[routes[agent]] + routeSteps[agent]];
+		pathGoals[agent] = goal;
+
+		if (pathScheduler)
+		{
+			pathScheduler->Request(agent, GetAgentPosition(agent), goal);
+			pathPending[agent] = 1;
+			requestStates[agent] = states[agent];
+			stats.pathRequests++;
+		}
+		else
+		{
+			paths[agent].assign(1, goal);
+			pathSteps[agent] = 0;
+		}
+	}
+}
+
+void AISystem::ReceivePaths()
+{
+	if (!pathScheduler)
+		return;
+
+	pathResults.clear();
+	if (deterministic)
+	{
+		pathScheduler->ProcessExpansions(AI_PATH_EXPANSION_BUDGET, pathResults);
+	}
+	else
+	{
+		pathScheduler->Process(AI_PATH_BUDGET_SECONDS, pathResults);
+	}
+
+	for (PathResult& result : pathResults)
+	{
+		uint32_t agent = result.owner;
+		pathPending[agent] = 0;
+		stats.pathsReceived++;
+
+		// Asked for while doing something else, so it leads to the wrong place
+		if (requestStates[agent] != states[agent])
+		{
+			needsPath[agent] = 1;
+			continue;
+		}
+
+		paths[agent] = std::move(result.corners);
+		pathSteps[agent] = 0;
+		needsPath[agent] = 0;
+
+		// Skip waypoints that can't be reached, chasing ghosts just wait
+		if (!result.found && states[agent] == (uint8_t)AI_State::PATROL_PATH)
+		{
+			routeSteps[agent] = (routeSteps[agent] + 1) % routeCounts[routes[agent]];
+			needsPath[agent] = 1;
+		}
+	}
+
+	for (uint32_t agent = 0; agent < agentCount; agent++)
+	{
+		stats.waitingForPath += pathPending[agent];
+	}
+}
+
+void AISystem::WriteBack()
+{
+	// Only the ticked groups have anything new
+	for (uint32_t group : tickList)
+	{
+		for (uint32_t agent = group * 4; agent < (std::min)(group * 4 + 4, agentCount); agent++)
+		{
+			Transform* transform = transforms[agent];
+			if (transform && moved[agent])
+			{
+				transform->SetPosition(positionsX[agent], positionsY[agent], positionsZ[agent]);
+
+				// A tick can cover several frames, the spin keeps up with all of them
+				XMFLOAT4 spin;
+				XMStoreFloat4(&spin, XMQuaternionRotationRollPitchYaw(0.f, AI_SPIN_RADIANS_PER_SECOND * tickTimes[agent], 0.f));
+				transform->RotateWorld(spin);
+			}
+		}
+	}
+}
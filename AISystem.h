@@ -0,0 +1,160 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "SpatialGrid.h"
+
+class Transform;
+class NavMesh;
+class PathScheduler;
+struct PathResult;
+
+enum class AI_State: unsigned char
+{
+	DEFAULT = 0x01,
+	PATROL_PATH = 0x02,
+	ATTACK_PLAYER = 0x04
+};
+
+// --------------------------------------------------------
+// Counts from the last AISystem::Update()
+// --------------------------------------------------------
+struct AISystemStats
+{
+	unsigned int agents = 0;
+	unsigned int attacking = 0;
+	unsigned int stateChanges = 0;
+	unsigned int agentsTicked = 0;
+	unsigned int groupsTicked = 0;		// Groups of 4 agents
+	unsigned int groupsDeferred = 0;	// Due but pushed to a later frame by the budget
+	bool overBudget = false;			// Ticking took longer than the budget
+	uint64_t budgetOverruns = 0;		// Frames over budget since the start
+	double tickSeconds = 0;			// Simulation only
+	double writeBackSeconds = 0;	// Copying the results to the transforms
+	double indexSeconds = 0;		// Rebuilding the agent grid
+	unsigned int pathRequests = 0;
+	unsigned int pathsReceived = 0;
+	unsigned int waitingForPath = 0;	// Agents standing still until their path arrives
+	double pathSeconds = 0;			// Searching, capped by the path budget
+};
+
+// --------------------------------------------------------
+// Patrols waypoint routes and chases the player for every
+// ghost at once
+//
+// - Agents walk the corners of a path to their waypoint or
+//   to the player. Paths come from a PathScheduler on the
+//   nav mesh, searched within a time budget each frame,
+//   without one agents head straight for their target.
+// - Agent positions, speeds, route progress and states live
+//   in flat arrays padded to a multiple of 4, so the
+//   distance and normalize math runs on 4 agents per
+//   XMVECTOR
+// - Each group of 4 agents ticks at its own rate: every
+//   frame when chasing or near the player, down to every
+//   8th frame far away. Groups are phased so the ticks are
+//   spread evenly over the frames, and a tick covers all
+//   the time since the group's last one.
+// - Due groups past the per frame budget are pushed to the
+//   next frame, longest waiting first. Chasing groups
+//   always tick.
+// - Chunks of groups are ticked in parallel on the
+//   JobSystem, every agent only writes its own slots
+// - Results are copied to the agents' transforms in one
+//   pass afterwards, from the calling thread
+// - A spatial grid over the agents is rebuilt after every
+//   tick for proximity queries
+// - Agents without a transform only live in the arrays,
+//   handy for crowds and benchmarks
+// - In deterministic mode the budgets count work instead of
+//   time, so the same inputs always give the same results
+// --------------------------------------------------------
+class AISystem
+{
+public:
+	AISystem();
+	~AISystem();
+
+	// Paths are searched on the nav mesh from now on, nullptr walks in straight lines
+	void SetNavMesh(const NavMesh* navMesh);
+
+	// Time the ticks can take each frame
+	inline void SetTickBudget(unsigned int microseconds) { tickBudgetMicroseconds = microseconds; }
+
+	// Every due group ticks and path searches get a fixed number of cells each frame
+	inline void SetDeterministic(bool deterministic) { this->deterministic = deterministic; }
+
+	// Copies the points, returns the route's id
+	uint32_t AddRoute(const DirectX::XMFLOAT3* points, uint32_t pointCount);
+
+	// Starts patrolling the route from the transform's current position
+	uint32_t AddAgent(Transform* transform, uint32_t route, float speed = 3.f);
+	uint32_t AddAgent(Transform* transform, uint32_t route, DirectX::XMFLOAT3 position, float speed = 3.f);
+
+	// Ticks the groups that are due then writes their results back to the transforms
+	void Update(DirectX::XMFLOAT3 playerPosition, bool playerInLight, float deltaTime);
+
+	inline uint32_t GetAgentCount() const { return agentCount; }
+	DirectX::XMFLOAT3 GetAgentPosition(uint32_t agent) const;
+	inline AI_State GetAgentState(uint32_t agent) const { return (AI_State)states[agent]; }
+	inline const AISystemStats& GetStats() const { return stats; }
+
+	// Agents within radius of the position as of the last Update(), sorted by id
+	void FindAgentsNear(DirectX::XMFLOAT3 position, float radius, std::vector<uint32_t>& agents);
+
+private:
+	void ScheduleGroups(float deltaTime);
+	void TickGroups(const uint32_t* groups, uint32_t groupCount, DirectX::XMFLOAT3 playerPosition, float sqRange, AISystemStats& rangeStats);
+	void RequestPaths(DirectX::XMFLOAT3 playerPosition);
+	void ReceivePaths();
+	void WriteBack();
+
+	uint32_t agentCount = 0;
+
+	// Agent arrays, padding lanes past agentCount are ticked but ignored
+	std::vector<float> positionsX;
+	std::vector<float> positionsY;
+	std::vector<float> positionsZ;
+	std::vector<float> speeds;
+	std::vector<uint32_t> routes;
+	std::vector<uint32_t> routeSteps;		// Waypoint the agent is heading for
+	std::vector<uint8_t> states;
+	std::vector<uint8_t> moved;
+	std::vector<Transform*> transforms;
+
+	// Path following, paths[agent][pathSteps[agent]] is the corner being walked to
+	std::vector<std::vector<DirectX::XMFLOAT3>> paths;
+	std::vector<uint32_t> pathSteps;
+	std::vector<DirectX::XMFLOAT3> pathGoals;	// Where the current or requested path leads
+	std::vector<uint8_t> needsPath;
+	std::vector<uint8_t> pathPending;
+	std::vector<uint8_t> requestStates;		// State the pending request was made in
+
+	// Scheduling, one entry per group of 4 agents
+	std::vector<uint8_t> groupIntervals;	// Frames between ticks
+	std::vector<uint8_t> groupWaits;		// Frames since the last tick
+	std::vector<float> groupTimes;			// Time since the last tick, handed to the next one
+	std::vector<float> carryTimes;			// Per agent, time a tick couldn't use after reaching a corner
+	std::vector<float> tickTimes;			// Per agent, time the last tick covered
+	std::vector<uint32_t> tickList;			// Groups ticking this frame
+	std::vector<uint32_t> optionalGroups;	// Due groups the budget can defer
+	uint32_t frameIndex = 0;
+	unsigned int tickBudgetMicroseconds;
+	bool deterministic = false;
+	double groupTickEstimate = 0;			// Seconds per group, smoothed over frames
+	uint64_t budgetOverruns = 0;
+
+	class PathScheduler* pathScheduler = nullptr;
+	std::vector<PathResult> pathResults;
+
+	// Route r is routePoints[routeStarts[r]] up to routeStarts[r] + routeCounts[r]
+	std::vector<DirectX::XMFLOAT3> routePoints;
+	std::vector<uint32_t> routeStarts;
+	std::vector<uint32_t> routeCounts;
+
+	// Agent positions, binned at the end of Update()
+	SpatialGrid agentGrid;
+
+	AISystemStats stats;
+};
@@ -0,0 +1,299 @@
+#include "AssetLoader.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "TextureStreamer.h"
+#include "JobSystem.h"
+#include <wincodec.h>
+#include <wrl/client.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+using Microsoft::WRL::ComPtr;
+
+typedef std::chrono::high_resolution_clock AssetClock;
+
+static double SecondsSince(AssetClock::time_point start)
+{
+	return std::chrono::duration<double>(AssetClock::now() - start).count();
+}
+
+HRESULT DecodeImageFile(const wchar_t* fileName, DecodedImage& outImage)
+{
+	// WIC needs COM on whichever thread this runs on
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	bool comInitialized = SUCCEEDED(comResult);
+
+	HRESULT hr = S_OK;
+	{
+		ComPtr<IWICImagingFactory> factory;
+		ComPtr<IWICBitmapDecoder> decoder;
+		ComPtr<IWICBitmapFrameDecode> frame;
+		ComPtr<IWICFormatConverter> converter;
+
+		hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()));
+		if (SUCCEEDED(hr))
+			hr = factory->CreateDecoderFromFilename(fileName, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+		if (SUCCEEDED(hr))
+			hr = decoder->GetFrame(0, frame.GetAddressOf());
+		if (SUCCEEDED(hr))
+			hr = factory->CreateFormatConverter(converter.GetAddressOf());
+		if (SUCCEEDED(hr))
+			hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+		if (SUCCEEDED(hr))
+			hr = converter->GetSize(&outImage.width, &outImage.height);
+		if (SUCCEEDED(hr))
+		{
+			UINT rowPitch = outImage.width * 4;
+			outImage.pixels.resize((size_t)rowPitch * outImage.height);
+			hr = converter->CopyPixels(nullptr, rowPitch, (UINT)outImage.pixels.size(), outImage.pixels.data());
+		}
+	}
+
+	if (comInitialized)
+		CoUninitialize();
+
+	return hr;
+}
+
+HRESULT CreateTextureFromImage(ID3D11Device* device, ID3D11DeviceContext* context, const DecodedImage& image, ID3D11ShaderResourceView** outSRV)
+{
+	if (image.pixels.empty())
+		return E_INVALIDARG;
+
+	// Same setup as the WIC loader uses for auto generated mips:
+	// a full mip chain that the GPU fills in from the top level
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = image.width;
+	textureDesc.Height = image.height;
+	textureDesc.MipLevels = 0;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	ComPtr<ID3D11Texture2D> texture;
+	HRESULT hr = device->CreateTexture2D(&textureDesc, nullptr, texture.GetAddressOf());
+	if (FAILED(hr))
+		return hr;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = textureDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = (UINT)-1;
+
+	hr = device->CreateShaderResourceView(texture.Get(), &srvDesc, outSRV);
+	if (FAILED(hr))
+		return hr;
+
+	context->UpdateSubresource(texture.Get(), 0, nullptr, image.pixels.data(), image.width * 4, (UINT)image.pixels.size());
+	context->GenerateMips(*outSRV);
+
+	return S_OK;
+}
+
+HRESULT CreateTextureFromCache(ID3D11Device* device, const TextureCacheView& view, ID3D11ShaderResourceView** outSRV)
+{
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = view.GetWidth();
+	textureDesc.Height = view.GetHeight();
+	textureDesc.MipLevels = view.GetMipCount();
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = (DXGI_FORMAT)view.GetDxgiFormat();
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initialData[TEXTURE_MAX_MIPS] = {};
+	for (unsigned int mip = 0; mip < view.GetMipCount(); mip++)
+	{
+		initialData[mip].pSysMem = view.GetMipData(mip);
+		initialData[mip].SysMemPitch = (UINT)view.GetMipRowPitch(mip);
+	}
+
+	ComPtr<ID3D11Texture2D> texture;
+	HRESULT hr = device->CreateTexture2D(&textureDesc, initialData, texture.GetAddressOf());
+	if (FAILED(hr))
+		return hr;
+
+	return device->CreateShaderResourceView(texture.Get(), nullptr, outSRV);
+}
+
+AssetLoader::AssetLoader() = default;
+
+AssetLoader::~AssetLoader() = default;
+
+void AssetLoader::QueueMesh(const std::string& fileName, Mesh** outMesh)
+{
+	std::unique_ptr<AssetJob> job(new AssetJob());
+	job->type = AssetType::Mesh;
+	job->meshFileName = fileName;
+	job->outMesh = outMesh;
+	jobs.push_back(std::move(job));
+}
+
+void AssetLoader::QueueTexture(const std::string& fileName, TextureUsage usage, ID3D11ShaderResourceView** outSRV, uint64_t* outSourceHash)
+{
+	std::unique_ptr<AssetJob> job(new AssetJob());
+	job->type = AssetType::Texture;
+	job->textureFileName = fileName;
+	job->textureUsage = usage;
+	job->outSRV = outSRV;
+	job->outSourceHash = outSourceHash;
+	jobs.push_back(std::move(job));
+}
+
+bool AssetLoader::LoadAll(ID3D11Device* device, ID3D11DeviceContext* context, TextureStreamer* streamer)
+{
+	AssetClock::time_point start = AssetClock::now();
+
+	// Workers push the index of each job as its CPU work finishes
+	std::mutex readyMutex;
+	std::condition_variable readyChanged;
+	std::deque<size_t> readyJobs;
+	JobCounter cpuJobs;
+
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		JobSystem::Get().Run([this, i, &readyMutex, &readyChanged, &readyJobs]()
+		{
+			RunCpuStage(*jobs[i]);
+			{
+				std::lock_guard<std::mutex> lock(readyMutex);
+				readyJobs.push_back(i);
+			}
+			readyChanged.notify_one();
+		}, &cpuJobs);
+	}
+
+	// Meanwhile this thread turns finished jobs into GPU resources, sleeping
+	// while there are none. In the single thread mode they're all done already.
+	size_t finished = 0;
+	while (finished < jobs.size())
+	{
+		size_t index;
+		{
+			std::unique_lock<std::mutex> lock(readyMutex);
+			readyChanged.wait(lock, [&readyJobs]() { return !readyJobs.empty(); });
+			index = readyJobs.front();
+			readyJobs.pop_front();
+		}
+		RunGpuStage(*jobs[index], device, context, streamer);
+		finished++;
+	}
+
+	// The last job may still be between its push and finishing
+	JobSystem::Get().Wait(&cpuJobs);
+	wallSeconds = SecondsSince(start);
+
+	bool allSucceeded = true;
+	for (const auto& job : jobs)
+	{
+		if (FAILED(job->result))
+			allSucceeded = false;
+	}
+	return allSucceeded;
+}
+
+void AssetLoader::RunCpuStage(AssetJob& job)
+{
+	AssetClock::time_point start = AssetClock::now();
+
+	if (job.type == AssetType::Mesh)
+	{
+		job.meshSource.reset(new MeshSource());
+		if (!job.meshSource->Load(job.meshFileName.c_str()))
+			job.result = E_FAIL;
+	}
+	else
+	{
+		// Bakes the texture the first time, after that it's just mapping the bake
+		job.textureSource.reset(new TextureSource());
+		if (!job.textureSource->Load(job.textureFileName.c_str(), job.textureUsage))
+		{
+			job.textureSource.reset();
+
+			wchar_t wideFileName[MAX_PATH];
+			if (MultiByteToWideChar(CP_ACP, 0, job.textureFileName.c_str(), -1, wideFileName, MAX_PATH) == 0)
+				job.result = E_INVALIDARG;
+			else
+				job.result = DecodeImageFile(wideFileName, job.image);
+		}
+	}
+
+	job.cpuSeconds = SecondsSince(start);
+}
+
+void AssetLoader::RunGpuStage(AssetJob& job, ID3D11Device* device, ID3D11DeviceContext* context, TextureStreamer* streamer)
+{
+	AssetClock::time_point start = AssetClock::now();
+
+	if (job.type == AssetType::Mesh)
+	{
+		// Failed meshes still get an (empty) Mesh so indices into the mesh list stay valid
+		*job.outMesh = new Mesh(*job.meshSource, device);
+		job.meshSource.reset();
+	}
+	else if (job.textureSource)
+	{
+		if (job.outSourceHash)
+			*job.outSourceHash = job.textureSource->GetView().GetSourceHash();
+
+		if (streamer)
+			job.result = streamer->Add(device, std::move(job.textureSource), job.outSRV);
+		else
+			job.result = CreateTextureFromCache(device, job.textureSource->GetView(), job.outSRV);
+
+		job.textureSource.reset();
+	}
+	else if (SUCCEEDED(job.result))
+	{
+		job.result = CreateTextureFromImage(device, context, job.image, job.outSRV);
+
+		// Free the decoded pixels now that they're on the GPU
+		job.image = DecodedImage();
+	}
+
+	job.gpuSeconds = SecondsSince(start);
+}
+
+void AssetLoader::PrintTimings() const
+{
+	double cpuTotal = 0;
+	double gpuTotal = 0;
+	double criticalPath = 0;
+
+	printf("Asset loading timings (cpu / gpu ms):\n");
+	for (const auto& job : jobs)
+	{
+		if (job->type == AssetType::Mesh)
+			printf("  %8.2f / %6.2f  %s%s\n", job->cpuSeconds * 1000.0, job->gpuSeconds * 1000.0, job->meshFileName.c_str(), FAILED(job->result) ? " (FAILED)" : "");
+		else
+			printf("  %8.2f / %6.2f  %s%s\n", job->cpuSeconds * 1000.0, job->gpuSeconds * 1000.0, job->textureFileName.c_str(), FAILED(job->result) ? " (FAILED)" : "");
+
+		cpuTotal += job->cpuSeconds;
+		gpuTotal += job->gpuSeconds;
+
+		// With enough workers the slowest single asset bounds the load
+		double assetPath = job->cpuSeconds + job->gpuSeconds;
+		if (assetPath > criticalPath)
+			criticalPath = assetPath;
+	}
+
+	// ...unless the serial GPU stage on the device thread takes longer
+	if (gpuTotal > criticalPath)
+		criticalPath = gpuTotal;
+
+	printf("  %zu assets: %.2f ms cpu, %.2f ms gpu, %.2f ms critical path, %.2f ms wall (serial would be %.2f ms)\n",
+		jobs.size(), cpuTotal * 1000.0, gpuTotal * 1000.0, criticalPath * 1000.0, wallSeconds * 1000.0, (cpuTotal + gpuTotal) * 1000.0);
+}
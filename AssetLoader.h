@@ -0,0 +1,81 @@
+#pragma once
+
+#include <d3d11.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include "TextureCache.h"
+
+class Mesh;
+class MeshSource;
+class TextureStreamer;
+
+// Decodes any WIC supported image file. Safe to call from any thread.
+HRESULT DecodeImageFile(const wchar_t* fileName, DecodedImage& outImage);
+
+// Creates a mipmapped texture and SRV from a decoded image.
+// Uses the immediate context, so only call it from the device thread.
+HRESULT CreateTextureFromImage(ID3D11Device* device, ID3D11DeviceContext* context, const DecodedImage& image, ID3D11ShaderResourceView** outSRV);
+
+// Creates a texture and SRV holding every mip of a baked texture
+HRESULT CreateTextureFromCache(ID3D11Device* device, const TextureCacheView& view, ID3D11ShaderResourceView** outSRV);
+
+// --------------------------------------------------------
+// Loads a batch of meshes and textures in parallel
+//
+// - File reading, OBJ parsing and texture baking run as
+//   jobs on the JobSystem's workers
+// - GPU resources are created on the calling (device)
+//   thread as soon as each asset's CPU work is done
+// - Textures go to the streamer when there is one, which
+//   only uploads their small mips up front
+// - Textures that aren't PNGs fall back to WIC and get
+//   GPU generated mips
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	AssetLoader();
+	~AssetLoader();
+
+	// Queue up assets, the targets are filled in by LoadAll()
+	void QueueMesh(const std::string& fileName, Mesh** outMesh);
+	// outSourceHash gets the hash of the file's contents, 0 if it wasn't baked
+	void QueueTexture(const std::string& fileName, TextureUsage usage, ID3D11ShaderResourceView** outSRV, uint64_t* outSourceHash = nullptr);
+
+	// Loads everything that's queued. Returns false if any asset failed.
+	bool LoadAll(ID3D11Device* device, ID3D11DeviceContext* context, TextureStreamer* streamer = nullptr);
+
+	// Prints per asset timings, the critical path and the total wall time
+	void PrintTimings() const;
+
+private:
+	enum class AssetType { Mesh, Texture };
+
+	struct AssetJob
+	{
+		AssetType type;
+		std::string meshFileName;
+		std::string textureFileName;
+		TextureUsage textureUsage = TextureUsage::Color;
+		Mesh** outMesh = nullptr;
+		ID3D11ShaderResourceView** outSRV = nullptr;
+		uint64_t* outSourceHash = nullptr;
+
+		// CPU side results
+		std::unique_ptr<MeshSource> meshSource;
+		std::unique_ptr<TextureSource> textureSource;
+		DecodedImage image;
+		HRESULT result = S_OK;
+
+		// Timings in seconds
+		double cpuSeconds = 0;
+		double gpuSeconds = 0;
+	};
+
+	void RunCpuStage(AssetJob& job);
+	void RunGpuStage(AssetJob& job, ID3D11Device* device, ID3D11DeviceContext* context, TextureStreamer* streamer);
+
+	std::vector<std::unique_ptr<AssetJob>> jobs;
+	double wallSeconds = 0;
+};
@@ -0,0 +1,650 @@
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Block rows each JobSystem job compresses
+#define COMPRESS_ROWS_PER_JOB 4
+
+namespace
+{
+	// BC7 mode 6 interpolation weights, out of 64
+	const int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	inline float Clamp(float value, float low, float high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	// --------------------------------------------------------
+	// Direction the block's colors spread along the most, from
+	// their covariance. The endpoints of a block lie on it.
+	// --------------------------------------------------------
+	template <int Channels>
+	void PrincipalAxis(const float (*colors)[4], float* mean, float* axis)
+	{
+		for (int c = 0; c < Channels; c++)
+		{
+			mean[c] = 0;
+			for (int i = 0; i < 16; i++)
+				mean[c] += colors[i][c];
+			mean[c] /= 16.f;
+		}
+
+		float covariance[Channels][Channels] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < Channels; a++)
+			{
+				for (int b = a; b < Channels; b++)
+					covariance[a][b] += (colors[i][a] - mean[a]) * (colors[i][b] - mean[b]);
+			}
+		}
+		for (int a = 0; a < Channels; a++)
+		{
+			for (int b = 0; b < a; b++)
+				covariance[a][b] = covariance[b][a];
+		}
+
+		// Power iteration, starting from the widest channel converges quickly
+		for (int c = 0; c < Channels; c++)
+			axis[c] = 0;
+		int widest = 0;
+		for (int c = 1; c < Channels; c++)
+		{
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		}
+		axis[widest] = 1;
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[Channels] = {};
+			for (int a = 0; a < Channels; a++)
+			{
+				for (int b = 0; b < Channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+			}
+
+			float length = 0;
+			for (int c = 0; c < Channels; c++)
+				length += next[c] * next[c];
+			if (length < 1e-12f)
+				break;
+
+			length = 1.f / sqrtf(length);
+			for (int c = 0; c < Channels; c++)
+				axis[c] = next[c] * length;
+		}
+	}
+
+	// Extremes of the colors along the axis
+	template <int Channels>
+	void AxisEndpoints(const float (*colors)[4], const float* mean, const float* axis, float* low, float* high)
+	{
+		float minT = 0;
+		float maxT = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0;
+			for (int c = 0; c < Channels; c++)
+				t += (colors[i][c] - mean[c]) * axis[c];
+			minT = (std::min)(minT, t);
+			maxT = (std::max)(maxT, t);
+		}
+
+		for (int c = 0; c < Channels; c++)
+		{
+			low[c] = Clamp(mean[c] + axis[c] * minT, 0, 255);
+			high[c] = Clamp(mean[c] + axis[c] * maxT, 0, 255);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Endpoints that best fit the colors for the given blend
+	// weights, weights[i] being how much of the high endpoint
+	// pixel i takes. Returns false if the system is singular.
+	// --------------------------------------------------------
+	template <int Channels>
+	bool FitEndpoints(const float (*colors)[4], const float* weights, float* low, float* high)
+	{
+		float aa = 0, ab = 0, bb = 0;
+		float ax[Channels] = {}, bx[Channels] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			float b = weights[i];
+			float a = 1.f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < Channels; c++)
+			{
+				ax[c] += a * colors[i][c];
+				bx[c] += b * colors[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		float inverse = 1.f / determinant;
+		for (int c = 0; c < Channels; c++)
+		{
+			low[c] = Clamp((ax[c] * bb - bx[c] * ab) * inverse, 0, 255);
+			high[c] = Clamp((bx[c] * aa - ax[c] * ab) * inverse, 0, 255);
+		}
+		return true;
+	}
+
+	void LoadColors(const unsigned char* pixels, float (*colors)[4])
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+				colors[i][c] = pixels[i * 4 + c];
+		}
+	}
+
+	// ---- BC1 ----------------------------------------------
+
+	inline uint16_t To565(const float* color)
+	{
+		int r = (int)(color[0] * 31.f / 255.f + .5f);
+		int g = (int)(color[1] * 63.f / 255.f + .5f);
+		int b = (int)(color[2] * 31.f / 255.f + .5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	inline void From565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// The four colors a BC1 block can use in four color mode
+	void BC1Palette(uint16_t c0, uint16_t c1, int (*palette)[3])
+	{
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+
+	// Closest palette color for every pixel, returns the squared error
+	int BC1Indices(const float (*colors)[4], uint16_t c0, uint16_t c1, uint32_t& indices)
+	{
+		int palette[4][3];
+		BC1Palette(c0, c1, palette);
+
+		int error = 0;
+		indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestError = 1 << 30;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = (int)colors[i][0] - palette[p][0];
+				int dg = (int)colors[i][1] - palette[p][1];
+				int db = (int)colors[i][2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestError)
+				{
+					bestError = distance;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+			error += bestError;
+		}
+		return error;
+	}
+
+	void WriteBC1(uint16_t c0, uint16_t c1, uint32_t indices, unsigned char* block)
+	{
+		// Four color mode needs c0 > c1, swapping the endpoints swaps 0 with 1 and 2 with 3
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			indices ^= 0x55555555;
+		}
+		else if (c0 == c1)
+		{
+			indices = 0;
+		}
+
+		block[0] = (unsigned char)(c0 & 255);
+		block[1] = (unsigned char)(c0 >> 8);
+		block[2] = (unsigned char)(c1 & 255);
+		block[3] = (unsigned char)(c1 >> 8);
+		memcpy(block + 4, &indices, 4);
+	}
+
+	void CompressBC1(const unsigned char* pixels, unsigned char* block)
+	{
+		float colors[16][4];
+		LoadColors(pixels, colors);
+
+		float mean[4], axis[4], low[4], high[4];
+		PrincipalAxis<3>(colors, mean, axis);
+		AxisEndpoints<3>(colors, mean, axis, low, high);
+
+		// Pull the endpoints in a little, the in between colors then land closer to the pixels
+		for (int c = 0; c < 3; c++)
+		{
+			float inset = (high[c] - low[c]) / 16.f;
+			low[c] += inset;
+			high[c] -= inset;
+		}
+
+		uint16_t c0 = To565(high);
+		uint16_t c1 = To565(low);
+		uint32_t indices;
+		int error = BC1Indices(colors, c0, c1, indices);
+
+		// Refit the endpoints to the chosen indices while it helps, high being c0
+		static const float IndexWeights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+		for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+		{
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = IndexWeights[(indices >> (i * 2)) & 3];
+
+			if (!FitEndpoints<3>(colors, weights, low, high))
+				break;
+
+			uint16_t fitC0 = To565(high);
+			uint16_t fitC1 = To565(low);
+			uint32_t fitIndices;
+			int fitError = BC1Indices(colors, fitC0, fitC1, fitIndices);
+			if (fitError >= error)
+				break;
+
+			c0 = fitC0;
+			c1 = fitC1;
+			indices = fitIndices;
+			error = fitError;
+		}
+
+		WriteBC1(c0, c1, indices, block);
+	}
+
+	void DecompressBC1(const unsigned char* block, unsigned char* pixels)
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+		uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+		uint32_t indices;
+		memcpy(&indices, block + 4, 4);
+
+		int palette[4][3];
+		int alpha[4] = { 255, 255, 255, 255 };
+		BC1Palette(c0, c1, palette);
+		if (c0 <= c1)
+		{
+			// Three color mode with transparent black, never written but valid
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			alpha[3] = 0;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (indices >> (i * 2)) & 3;
+			pixels[i * 4] = (unsigned char)palette[index][0];
+			pixels[i * 4 + 1] = (unsigned char)palette[index][1];
+			pixels[i * 4 + 2] = (unsigned char)palette[index][2];
+			pixels[i * 4 + 3] = (unsigned char)alpha[index];
+		}
+	}
+
+	// ---- BC4, two of which make up BC5 ---------------------
+
+	void CompressBC4(const unsigned char* pixels, int channel, unsigned char* block)
+	{
+		int low = 255;
+		int high = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			low = (std::min)(low, (int)pixels[i * 4 + channel]);
+			high = (std::max)(high, (int)pixels[i * 4 + channel]);
+		}
+
+		// Eight value mode: index 0 is high, 1 is low and 2 to 7 step from high to low
+		block[0] = (unsigned char)high;
+		block[1] = (unsigned char)low;
+
+		uint64_t indices = 0;
+		if (high > low)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int value = pixels[i * 4 + channel];
+				int step = ((high - value) * 14 + (high - low)) / ((high - low) * 2);	// 0 to 7, rounded
+				static const int StepToIndex[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+				indices |= (uint64_t)StepToIndex[step] << (i * 3);
+			}
+		}
+
+		for (int i = 0; i < 6; i++)
+			block[2 + i] = (unsigned char)(indices >> (i * 8));
+	}
+
+	void DecompressBC4(const unsigned char* block, int channel, unsigned char* pixels)
+	{
+		int values[8];
+		values[0] = block[0];
+		values[1] = block[1];
+		if (values[0] > values[1])
+		{
+			for (int i = 1; i < 7; i++)
+				values[i + 1] = ((7 - i) * values[0] + i * values[1]) / 7;
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+				values[i + 1] = ((5 - i) * values[0] + i * values[1]) / 5;
+			values[6] = 0;
+			values[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= (uint64_t)block[2 + i] << (i * 8);
+
+		for (int i = 0; i < 16; i++)
+			pixels[i * 4 + channel] = (unsigned char)values[(indices >> (i * 3)) & 7];
+	}
+
+	// ---- BC7 mode 6 ---------------------------------------
+
+	struct BC7Endpoints
+	{
+		int values[2][4];	// 8 bit endpoints, the lowest bit is the endpoint's p-bit
+	};
+
+	// Rounds an endpoint to 7 bits plus the given p-bit
+	inline void QuantizeBC7(const float* color, int pBit, int* values)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int quantized = (int)((color[c] - pBit) / 2.f + .5f);
+			quantized = quantized < 0 ? 0 : (quantized > 127 ? 127 : quantized);
+			values[c] = (quantized << 1) | pBit;
+		}
+	}
+
+	// Picks each pixel's weight by projecting it onto the endpoint line, returns the squared error
+	int BC7Indices(const float (*colors)[4], const BC7Endpoints& endpoints, unsigned char* indices)
+	{
+		float direction[4];
+		float lengthSq = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			direction[c] = (float)(endpoints.values[1][c] - endpoints.values[0][c]);
+			lengthSq += direction[c] * direction[c];
+		}
+		float scale = lengthSq > 0 ? 15.f / lengthSq : 0;
+
+		int error = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0;
+			for (int c = 0; c < 4; c++)
+				t += (colors[i][c] - endpoints.values[0][c]) * direction[c];
+
+			int index = (int)(t * scale + .5f);
+			index = index < 0 ? 0 : (index > 15 ? 15 : index);
+			indices[i] = (unsigned char)index;
+
+			for (int c = 0; c < 4; c++)
+			{
+				int value = ((64 - BC7Weights[index]) * endpoints.values[0][c] + BC7Weights[index] * endpoints.values[1][c] + 32) >> 6;
+				int difference = (int)colors[i][c] - value;
+				error += difference * difference;
+			}
+		}
+		return error;
+	}
+
+	// Tries all four p-bit pairs for the endpoints, keeps the best
+	int QuantizeBC7Best(const float (*colors)[4], const float* low, const float* high, BC7Endpoints& endpoints, unsigned char* indices)
+	{
+		int bestError = -1;
+		for (int pBits = 0; pBits < 4; pBits++)
+		{
+			BC7Endpoints candidate;
+			unsigned char candidateIndices[16];
+			QuantizeBC7(low, pBits & 1, candidate.values[0]);
+			QuantizeBC7(high, pBits >> 1, candidate.values[1]);
+
+			int error = BC7Indices(colors, candidate, candidateIndices);
+			if (bestError < 0 || error < bestError)
+			{
+				bestError = error;
+				endpoints = candidate;
+				memcpy(indices, candidateIndices, 16);
+			}
+		}
+		return bestError;
+	}
+
+	void WriteBits(unsigned char* block, int& position, uint32_t value, int count)
+	{
+		for (int i = 0; i < count; i++, position++)
+		{
+			if ((value >> i) & 1)
+				block[position >> 3] |= (unsigned char)(1 << (position & 7));
+		}
+	}
+
+	uint32_t ReadBits(const unsigned char* block, int& position, int count)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < count; i++, position++)
+			value |= (uint32_t)((block[position >> 3] >> (position & 7)) & 1) << i;
+		return value;
+	}
+
+	void CompressBC7(const unsigned char* pixels, unsigned char* block)
+	{
+		float colors[16][4];
+		LoadColors(pixels, colors);
+
+		float mean[4], axis[4], low[4], high[4];
+		PrincipalAxis<4>(colors, mean, axis);
+		AxisEndpoints<4>(colors, mean, axis, low, high);
+
+		BC7Endpoints endpoints;
+		unsigned char indices[16];
+		int error = QuantizeBC7Best(colors, low, high, endpoints, indices);
+
+		// Refit the endpoints to the chosen weights while it helps
+		for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+		{
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = BC7Weights[indices[i]] / 64.f;
+
+			if (!FitEndpoints<4>(colors, weights, low, high))
+				break;
+
+			BC7Endpoints fitEndpoints;
+			unsigned char fitIndices[16];
+			int fitError = QuantizeBC7Best(colors, low, high, fitEndpoints, fitIndices);
+			if (fitError >= error)
+				break;
+
+			endpoints = fitEndpoints;
+			memcpy(indices, fitIndices, 16);
+			error = fitError;
+		}
+
+		// The first pixel's index drops its top bit, so it has to be below 8
+		if (indices[0] & 8)
+		{
+			std::swap(endpoints.values[0], endpoints.values[1]);
+			for (int i = 0; i < 16; i++)
+				indices[i] = (unsigned char)(15 - indices[i]);
+		}
+
+		memset(block, 0, 16);
+		int position = 0;
+		WriteBits(block, position, 1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			WriteBits(block, position, endpoints.values[0][c] >> 1, 7);
+			WriteBits(block, position, endpoints.values[1][c] >> 1, 7);
+		}
+		WriteBits(block, position, endpoints.values[0][0] & 1, 1);
+		WriteBits(block, position, endpoints.values[1][0] & 1, 1);
+		for (int i = 0; i < 16; i++)
+			WriteBits(block, position, indices[i], i == 0 ? 3 : 4);
+	}
+
+	bool DecompressBC7(const unsigned char* block, unsigned char* pixels)
+	{
+		if ((block[0] & 0x7F) != 0x40)
+			return false;
+
+		int position = 7;
+		int values[2][4];
+		for (int c = 0; c < 4; c++)
+		{
+			values[0][c] = (int)ReadBits(block, position, 7) << 1;
+			values[1][c] = (int)ReadBits(block, position, 7) << 1;
+		}
+		int pBit0 = (int)ReadBits(block, position, 1);
+		int pBit1 = (int)ReadBits(block, position, 1);
+		for (int c = 0; c < 4; c++)
+		{
+			values[0][c] |= pBit0;
+			values[1][c] |= pBit1;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (int)ReadBits(block, position, i == 0 ? 3 : 4);
+			for (int c = 0; c < 4; c++)
+				pixels[i * 4 + c] = (unsigned char)(((64 - BC7Weights[index]) * values[0][c] + BC7Weights[index] * values[1][c] + 32) >> 6);
+		}
+		return true;
+	}
+}
+
+size_t GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t GetCompressedSize(BlockFormat format, unsigned int width, unsigned int height)
+{
+	size_t blocksWide = (std::max)(1u, (width + 3) / 4);
+	size_t blocksHigh = (std::max)(1u, (height + 3) / 4);
+	return blocksWide * blocksHigh * GetBlockBytes(format);
+}
+
+void CompressBlock(BlockFormat format, const unsigned char* pixels, unsigned char* block)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		CompressBC1(pixels, block);
+		break;
+	case BlockFormat::BC5:
+		CompressBC4(pixels, 0, block);
+		CompressBC4(pixels, 1, block + 8);
+		break;
+	case BlockFormat::BC7:
+		CompressBC7(pixels, block);
+		break;
+	}
+}
+
+bool DecompressBlock(BlockFormat format, const unsigned char* block, unsigned char* pixels)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		DecompressBC1(block, pixels);
+		return true;
+	case BlockFormat::BC5:
+		DecompressBC4(block, 0, pixels);
+		DecompressBC4(block + 8, 1, pixels);
+		for (int i = 0; i < 16; i++)
+		{
+			pixels[i * 4 + 2] = 0;
+			pixels[i * 4 + 3] = 255;
+		}
+		return true;
+	case BlockFormat::BC7:
+		return DecompressBC7(block, pixels);
+	}
+	return false;
+}
+
+void CompressImage(BlockFormat format, const unsigned char* pixels, unsigned int width, unsigned int height, unsigned char* blocks)
+{
+	unsigned int blocksWide = (std::max)(1u, (width + 3) / 4);
+	unsigned int blocksHigh = (std::max)(1u, (height + 3) / 4);
+	size_t blockBytes = GetBlockBytes(format);
+
+	JobCounter counter;
+	JobSystem::Get().ParallelFor(blocksHigh, COMPRESS_ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+	{
+		unsigned char blockPixels[64];
+		for (uint32_t blockY = begin; blockY < end; blockY++)
+		{
+			for (unsigned int blockX = 0; blockX < blocksWide; blockX++)
+			{
+				for (unsigned int y = 0; y < 4; y++)
+				{
+					unsigned int sourceY = (std::min)(blockY * 4 + y, height - 1);
+					for (unsigned int x = 0; x < 4; x++)
+					{
+						unsigned int sourceX = (std::min)(blockX * 4 + x, width - 1);
+						memcpy(blockPixels + (y * 4 + x) * 4, pixels + ((size_t)sourceY * width + sourceX) * 4, 4);
+					}
+				}
+
+				CompressBlock(format, blockPixels, blocks + ((size_t)blockY * blocksWide + blockX) * blockBytes);
+			}
+		}
+	}, &counter);
+	JobSystem::Get().Wait(&counter);
+}
+
+bool DecompressImage(BlockFormat format, const unsigned char* blocks, unsigned int width, unsigned int height, unsigned char* pixels)
+{
+	unsigned int blocksWide = (std::max)(1u, (width + 3) / 4);
+	unsigned int blocksHigh = (std::max)(1u, (height + 3) / 4);
+	size_t blockBytes = GetBlockBytes(format);
+
+	unsigned char blockPixels[64];
+	for (unsigned int blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (unsigned int blockX = 0; blockX < blocksWide; blockX++)
+		{
+			if (!DecompressBlock(format, blocks + ((size_t)blockY * blocksWide + blockX) * blockBytes, blockPixels))
+				return false;
+
+			for (unsigned int y = 0; y < 4 && blockY * 4 + y < height; y++)
+			{
+				for (unsigned int x = 0; x < 4 && blockX * 4 + x < width; x++)
+					memcpy(pixels + ((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4, blockPixels + (y * 4 + x) * 4, 4);
+			}
+		}
+	}
+	return true;
+}
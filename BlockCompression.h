@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// The block compressed formats textures are baked to. Every
+// format packs a 4x4 block of pixels into a fixed number of
+// bytes, and the GPU samples them without unpacking.
+//
+// - BC1: RGB at 4 bits per pixel, for flat colored textures
+// - BC5: two channels at 8 bits per pixel, for normal maps,
+//   the shader rebuilds z from x and y
+// - BC7: RGBA at 8 bits per pixel, for detailed color
+//   textures. Only mode 6 (one subset, 4 bit indices) is
+//   written, which is the best single mode for photos.
+// --------------------------------------------------------
+enum class BlockFormat : uint32_t
+{
+	BC1,
+	BC5,
+	BC7
+};
+
+// Bytes per 4x4 block
+size_t GetBlockBytes(BlockFormat format);
+
+// Bytes for a whole image, partial blocks at the edges count as whole ones
+size_t GetCompressedSize(BlockFormat format, unsigned int width, unsigned int height);
+
+// One block from 16 RGBA pixels in rows of 4
+void CompressBlock(BlockFormat format, const unsigned char* pixels, unsigned char* block);
+
+// 16 RGBA pixels back out of a block, returns false for BC7 modes other than 6
+bool DecompressBlock(BlockFormat format, const unsigned char* block, unsigned char* pixels);
+
+// Compresses tightly packed RGBA pixels, rows of blocks are split across the JobSystem.
+// Pixels past the edges repeat the last row and column.
+void CompressImage(BlockFormat format, const unsigned char* pixels, unsigned int width, unsigned int height, unsigned char* blocks);
+
+// Unpacks blocks to tightly packed RGBA pixels, for checking the baked results
+bool DecompressImage(BlockFormat format, const unsigned char* blocks, unsigned int width, unsigned int height, unsigned char* pixels);
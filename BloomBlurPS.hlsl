@@ -0,0 +1,29 @@
+cbuffer externalData : register(b0)
+{
+	float2 direction;	// One texel along the axis being blurred
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+Texture2D pixels			: register(t0);
+SamplerState samplerOptions	: register(s0);
+
+// Weights of a 9 tap gaussian, the center one and then each side
+static const float weights[5] = { 0.227027f, 0.1945946f, 0.1216216f, 0.054054f, 0.016216f };
+
+// One axis of a separable blur, drawn once across and once down
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float3 color = pixels.Sample(samplerOptions, input.uv).rgb * weights[0];
+	for (int i = 1; i < 5; i++)
+	{
+		color += pixels.Sample(samplerOptions, input.uv + direction * i).rgb * weights[i];
+		color += pixels.Sample(samplerOptions, input.uv - direction * i).rgb * weights[i];
+	}
+	return float4(color, 1.0f);
+}
@@ -0,0 +1,24 @@
+cbuffer externalData : register(b0)
+{
+	float threshold;
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+Texture2D pixels			: register(t0);
+SamplerState samplerOptions	: register(s0);
+
+// Keeps what's brighter than the threshold. Drawn at half size, so
+// the linear sampler also averages each 2x2 block of the scene.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float3 color = pixels.Sample(samplerOptions, input.uv).rgb;
+	float brightness = max(color.r, max(color.g, color.b));
+	float amount = saturate(brightness - threshold) / max(brightness, 0.0001f);
+	return float4(color * amount, 1.0f);
+}
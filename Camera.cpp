@@ -28,21 +28,16 @@ void Camera::UpdateProjectionMatrix(float aspectRatio)
 
 void Camera::UpdateViewMatrix()
 {
-	DirectX::XMVECTOR forward = DirectX::XMVectorSet(0,0,1,0);
-	DirectX::XMVECTOR rotQuat = DirectX::XMQuaternionRotationRollPitchYawFromVector
-	(
-		DirectX::XMLoadFloat3
-		(
-			&transform.GetPitchYawRoll()
-		)
-	);
-
-	forward = DirectX::XMVector3Rotate(forward, rotQuat);
+	// built from where the renderer shows the camera, its rows are
+	// already the rotated axes so no euler conversion here
+	DirectX::XMFLOAT4X4 world = transform.GetRenderMatrix();
+	DirectX::XMFLOAT3 position(world._41, world._42, world._43);
+	DirectX::XMFLOAT3 forward(world._31, world._32, world._33);
 
 	DirectX::XMMATRIX lookToMatrix = DirectX::XMMatrixLookToLH
 	(
-		DirectX::XMLoadFloat3(&transform.GetPosition()),
-		forward,
+		DirectX::XMLoadFloat3(&position),
+		DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&forward)),
 		DirectX::XMVectorSet(0, 1, 0, 0)
 	);
 
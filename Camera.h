@@ -1,6 +1,6 @@
 #pragma once
 
-#include <Windows.h>
+#include "Platform.h"
 #include <DirectXMath.h>
 #include "Transform.h"
 #include "PlayerInterface.h"
@@ -22,6 +22,7 @@ public:
 	~Camera() = default;
 
 	void UpdateProjectionMatrix(float aspectRatio);
+	// Follows the transform's render matrix, so call it from the renderer
 	void UpdateViewMatrix();
 
 	inline DirectX::XMFLOAT4X4 GetProjectionMatrix() const { return projMatrix; };
@@ -0,0 +1,83 @@
+#include "ClusteredLighting.h"
+#include "SimpleShader.h"
+#include <cstring>
+
+using namespace DirectX;
+
+// Globals and every cluster list full is the most the index list can hold
+#define CLUSTER_INDEX_CAPACITY (CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER + 128)
+
+// Creates a dynamic structured buffer and a view of it
+static void CreateStructuredBuffer(ID3D11Device* device, unsigned int stride, unsigned int count, ID3D11Buffer** outBuffer, ID3D11ShaderResourceView** outSRV)
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = stride * count;
+	bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = stride;
+	device->CreateBuffer(&bufferDesc, nullptr, outBuffer);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = count;
+	device->CreateShaderResourceView(*outBuffer, &srvDesc, outSRV);
+}
+
+ClusteredLighting::ClusteredLighting(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	this->context = context;
+	viewDepthPlane = XMFLOAT4(0, 0, 1, 0);
+	tileScale = XMFLOAT2(0, 0);
+
+	CreateStructuredBuffer(device, sizeof(ClusterLightRange), CLUSTER_COUNT, rangeBuffer.GetAddressOf(), rangeSRV.GetAddressOf());
+	CreateStructuredBuffer(device, sizeof(unsigned int), CLUSTER_INDEX_CAPACITY, indexBuffer.GetAddressOf(), indexSRV.GetAddressOf());
+}
+
+void ClusteredLighting::Update(const Light* lights, int lightCount, const XMFLOAT4X4& view, const XMFLOAT4X4& proj, unsigned int screenWidth, unsigned int screenHeight)
+{
+	Build(lights, lightCount, view, proj);
+	Upload(screenWidth, screenHeight);
+}
+
+void ClusteredLighting::Build(const Light* lights, int lightCount, const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	clusters.Build(lights, lightCount, view, proj);
+
+	// View depth is the dot of the world position with the view matrix's third column
+	viewDepthPlane = XMFLOAT4(view._13, view._23, view._33, view._43);
+}
+
+void ClusteredLighting::Upload(unsigned int screenWidth, unsigned int screenHeight)
+{
+	const std::vector<ClusterLightRange>& ranges = clusters.GetClusterRanges();
+	const std::vector<unsigned int>& indices = clusters.GetLightIndices();
+	UploadBuffer(rangeBuffer.Get(), ranges.data(), sizeof(ClusterLightRange) * ranges.size());
+	UploadBuffer(indexBuffer.Get(), indices.data(), sizeof(unsigned int) * indices.size());
+
+	tileScale = XMFLOAT2((float)CLUSTER_TILES_X / screenWidth, (float)CLUSTER_TILES_Y / screenHeight);
+}
+
+void ClusteredLighting::Bind(SimplePixelShader* ps)
+{
+	ps->SetFloat4("viewDepthPlane", viewDepthPlane);
+	ps->SetFloat2("clusterTileScale", tileScale);
+	ps->SetFloat("clusterSliceScale", clusters.GetSliceScale());
+	ps->SetFloat("clusterSliceBias", clusters.GetSliceBias());
+	ps->SetInt("globalLightCount", (int)clusters.GetGlobalLightCount());
+
+	ps->SetShaderResourceView("clusterLightRanges", rangeSRV.Get());
+	ps->SetShaderResourceView("clusterLightIndices", indexSRV.Get());
+}
+
+void ClusteredLighting::UploadBuffer(ID3D11Buffer* buffer, const void* data, size_t size)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, data, size);
+	context->Unmap(buffer, 0);
+}
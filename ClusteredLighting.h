@@ -0,0 +1,48 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "LightClusters.h"
+
+class SimplePixelShader;
+
+// --------------------------------------------------------
+// GPU side of clustered forward shading: uploads the light
+// lists built by LightClusters into structured buffers and
+// hands them to the lighting pixel shaders
+// --------------------------------------------------------
+class ClusteredLighting
+{
+public:
+	ClusteredLighting(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	// Bins the lights for this camera and uploads the results
+	void Update(const Light* lights, int lightCount, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj, unsigned int screenWidth, unsigned int screenHeight);
+
+	// The two halves of Update(). Build() only touches the CPU side, so
+	// it can overlap other work, Upload() needs the context.
+	void Build(const Light* lights, int lightCount, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+	void Upload(unsigned int screenWidth, unsigned int screenHeight);
+
+	// Sets the cluster buffers and per frame cluster values on a
+	// lighting pixel shader. Still needs a CopyAllBufferData() after.
+	void Bind(SimplePixelShader* ps);
+
+	inline const LightClusters& GetClusters() const { return clusters; }
+
+private:
+	void UploadBuffer(ID3D11Buffer* buffer, const void* data, size_t size);
+
+	ID3D11DeviceContext* context;
+
+	LightClusters clusters;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> rangeBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rangeSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> indexSRV;
+
+	// Values for the shader's per frame buffer
+	DirectX::XMFLOAT4 viewDepthPlane;
+	DirectX::XMFLOAT2 tileScale;
+};
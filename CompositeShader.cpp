@@ -0,0 +1,121 @@
+#include "CompositeShader.h"
+
+namespace
+{
+	struct CompositeFeature
+	{
+		uint32_t bit;
+		const char* name;
+		const char* source;	// Reads and writes "color"
+	};
+
+	// In the order they're applied
+	const CompositeFeature compositeFeatures[COMPOSITE_FEATURE_COUNT] =
+	{
+		{
+			COMPOSITE_COLOR_GRADING, "color grading",
+			"\t// Color grading\n"
+			"\tcolor.rgb *= compositeData.colorFilter;\n"
+			"\tcolor.rgb = (color.rgb - 0.5f) * compositeData.contrast + 0.5f;\n"
+			"\tfloat luma = dot(color.rgb, float3(0.299f, 0.587f, 0.114f));\n"
+			"\tcolor.rgb = max(lerp(luma.xxx, color.rgb, compositeData.saturation), 0.0f);\n"
+		},
+		{
+			// Same falloff as VignettePS used to draw in a pass of its own,
+			// centered on the offset uv the color was sampled at
+			COMPOSITE_VIGNETTE, "vignette",
+			"\t// Vignette\n"
+			"\tfloat2 centered = uv - float2(0.5f, 0.5f);\n"
+			"\tfloat darken = 1.0f - smoothstep(compositeData.vignetteInnerRadius, compositeData.vignetteOuterRadius, length(centered));\n"
+			"\tcolor.rgb = lerp(color.rgb, color.rgb * darken, compositeData.vignetteOpacity);\n"
+		},
+		{
+			COMPOSITE_FILM_GRAIN, "film grain",
+			"\t// Film grain\n"
+			"\tfloat noise = frac(sin(dot(input.position.xy + compositeData.time, float2(12.9898f, 78.233f))) * 43758.5453f);\n"
+			"\tcolor.rgb += (noise - 0.5f) * compositeData.grainIntensity;\n"
+		},
+		{
+			COMPOSITE_GAMMA, "gamma",
+			"\t// Gamma\n"
+			"\tcolor.rgb = pow(saturate(color.rgb), compositeData.inverseGamma);\n"
+		}
+	};
+
+	const char* compositeHeader =
+		"struct CompositeData\n"
+		"{\n"
+		"\tfloat vignetteInnerRadius;\n"
+		"\tfloat vignetteOuterRadius;\n"
+		"\tfloat vignetteOpacity;\n"
+		"\tfloat contrast;\n"
+		"\tfloat saturation;\n"
+		"\tfloat grainIntensity;\n"
+		"\tfloat time;\n"
+		"\tfloat inverseGamma;\n"
+		"\tfloat3 colorFilter;\n"
+		"\tfloat padding;\n"
+		"\tfloat2 pixelSize;\n"
+		"};\n"
+		"\n"
+		"cbuffer externalData : register(b0)\n"
+		"{\n"
+		"\tCompositeData compositeData;\n"
+		"}\n"
+		"\n"
+		"struct VertexToPixel\n"
+		"{\n"
+		"\tfloat4 position\t\t: SV_POSITION;\n"
+		"\tfloat2 uv\t\t\t: TEXCOORD0;\n"
+		"};\n"
+		"\n"
+		"Texture2D pixels\t\t\t: register(t0);\n"
+		"SamplerState samplerOptions\t: register(s0);\n"
+		"\n"
+		"float4 main(VertexToPixel input) : SV_TARGET\n"
+		"{\n";
+
+	const char* compositeSample =
+		"\tfloat4 color = pixels.Sample(samplerOptions, uv);\n";
+}
+
+std::string GenerateCompositeShader(uint32_t features)
+{
+	std::string source = "// Composite post process shader: " + GetCompositeFeatureNames(features) + "\n\n";
+	source += compositeHeader;
+
+	// VignettePS read its input a pixel over, so the permutations
+	// with the vignette keep doing that for the whole composite
+	if (features & COMPOSITE_VIGNETTE)
+		source += "\tfloat2 uv = input.uv + compositeData.pixelSize;\n";
+	else
+		source += "\tfloat2 uv = input.uv;\n";
+	source += compositeSample;
+
+	for (const CompositeFeature& feature : compositeFeatures)
+	{
+		if (features & feature.bit)
+		{
+			source += "\n";
+			source += feature.source;
+		}
+	}
+
+	source += "\n\treturn color;\n}\n";
+	return source;
+}
+
+std::string GetCompositeFeatureNames(uint32_t features)
+{
+	std::string names;
+	for (const CompositeFeature& feature : compositeFeatures)
+	{
+		if (features & feature.bit)
+		{
+			if (!names.empty())
+				names += " + ";
+			names += feature.name;
+		}
+	}
+	return names.empty() ? "none" : names;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include "PostProcessData.h"
+
+// --------------------------------------------------------
+// Per pixel effects the composite pass fuses into one pixel
+// shader, as bits of a feature mask. They run in this order.
+// --------------------------------------------------------
+#define COMPOSITE_COLOR_GRADING	(1u << 0)	// Color filter, contrast and saturation
+#define COMPOSITE_VIGNETTE		(1u << 1)	// Darkens towards the edges of the screen
+#define COMPOSITE_FILM_GRAIN	(1u << 2)	// Noise that changes every frame
+#define COMPOSITE_GAMMA			(1u << 3)	// Display gamma, applied last
+
+#define COMPOSITE_FEATURE_COUNT 4
+#define COMPOSITE_PERMUTATION_COUNT (1u << COMPOSITE_FEATURE_COUNT)
+
+// --------------------------------------------------------
+// The composite shader's constant buffer. Every permutation
+// declares all of it, so one layout fits them all.
+// --------------------------------------------------------
+struct CompositeData
+{
+	float vignetteInnerRadius;
+	float vignetteOuterRadius;
+	float vignetteOpacity;
+	float contrast;
+
+	float saturation;
+	float grainIntensity;
+	float time;
+	float inverseGamma;
+
+	DirectX::XMFLOAT3 colorFilter;
+	float padding;
+
+	DirectX::XMFLOAT2 pixelSize;	// Of the input, the vignette samples one pixel over
+};
+
+// Takes the vignette animated by the simulation
+inline void SetCompositeVignette(CompositeData& data, const VignetteData& vignette)
+{
+	data.vignetteInnerRadius = vignette.innerRadius;
+	data.vignetteOuterRadius = vignette.outerRadius;
+	data.vignetteOpacity = vignette.opacity;
+}
+
+// --------------------------------------------------------
+// HLSL for the permutation with these features, a pixel
+// shader with a "main" entry point reading "pixels" and
+// "samplerOptions" and writing the result of every effect
+// in one go. Effects that are off aren't in the source at
+// all, so they cost nothing.
+// --------------------------------------------------------
+std::string GenerateCompositeShader(uint32_t features);
+
+// Names of the features in the mask, i.e. "vignette + gamma", for debug output
+std::string GetCompositeFeatureNames(uint32_t features);
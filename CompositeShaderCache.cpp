@@ -0,0 +1,69 @@
+#include "CompositeShaderCache.h"
+#include "SimpleShader.h"
+#include <cstdio>
+
+CompositeShaderCache::CompositeShaderCache(ID3D11Device* device, ID3D11DeviceContext* context)
+	: device(device), context(context)
+{
+}
+
+CompositeShaderCache::~CompositeShaderCache()
+{
+	for (SimplePixelShader* shader : shaders)
+	{
+		delete shader;
+	}
+}
+
+SimplePixelShader* CompositeShaderCache::Get(uint32_t features)
+{
+	features &= COMPOSITE_PERMUTATION_COUNT - 1;
+	if (!compiled[features])
+	{
+		shaders[features] = Compile(features);
+		compiled[features] = true;
+	}
+	return shaders[features];
+}
+
+SimplePixelShader* CompositeShaderCache::Compile(uint32_t features)
+{
+	std::string source = GenerateCompositeShader(features);
+	compileCount++;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	UINT flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	UINT flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+	ID3DBlob* compiledShader = 0;
+	ID3DBlob* errors = 0;
+	HRESULT hr = D3DCompile(source.c_str(), source.size(), "CompositePS", 0, 0, "main", "ps_5_0", flags, 0, &compiledShader, &errors);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (errors)
+		printf("Composite shader (%s):\n%s\n", GetCompositeFeatureNames(features).c_str(), (const char*)errors->GetBufferPointer());
+	else
+		printf("Compiled composite shader: %s\n", GetCompositeFeatureNames(features).c_str());
+#endif
+
+	if (errors)
+		errors->Release();
+
+	if (FAILED(hr))
+	{
+		if (compiledShader)
+			compiledShader->Release();
+		return nullptr;
+	}
+
+	// The shader takes over the byte code
+	SimplePixelShader* shader = new SimplePixelShader(device, context, compiledShader);
+	if (!shader->IsShaderValid())
+	{
+		delete shader;
+		return nullptr;
+	}
+	return shader;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <d3d11.h>
+#include "CompositeShader.h"
+
+class SimplePixelShader;
+
+// --------------------------------------------------------
+// Compiles composite shader permutations at runtime, each
+// the first time its feature mask is asked for, and keeps
+// them. Toggling effects back and forth only ever looks up
+// the mask, there's at most one compile per permutation.
+// --------------------------------------------------------
+class CompositeShaderCache
+{
+public:
+	CompositeShaderCache(ID3D11Device* device, ID3D11DeviceContext* context);
+	~CompositeShaderCache();
+
+	// The shader for these features, or null if it didn't compile
+	SimplePixelShader* Get(uint32_t features);
+
+	inline unsigned int GetCompileCount() const { return compileCount; }
+
+private:
+	SimplePixelShader* Compile(uint32_t features);
+
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	// Indexed by the feature mask. A failed compile is remembered too,
+	// so it isn't retried every frame.
+	SimplePixelShader* shaders[COMPOSITE_PERMUTATION_COUNT] = {};
+	bool compiled[COMPOSITE_PERMUTATION_COUNT] = {};
+	unsigned int compileCount = 0;
+};
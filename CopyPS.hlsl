@@ -0,0 +1,15 @@
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+Texture2D pixels			: register(t0);
+SamplerState samplerOptions	: register(s0);
+
+// Passes the image through, for when no effect is on
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	return pixels.Sample(samplerOptions, input.uv);
+}
@@ -2,6 +2,14 @@
 
 #include <WindowsX.h>
 #include <sstream>
+#include <cmath>
+#include <chrono>
+
+// Ticks a single frame may run to catch up. Past this the simulation
+// drops the time instead, or a slow tick would only make it slower.
+#define MAX_TICKS_PER_FRAME 5
+
+#define DEFAULT_TICKS_PER_SECOND 60
 
 // Define the static instance variable so our OS-level 
 // message handling function below can talk to our object
@@ -56,6 +64,13 @@ DXCore::DXCore(
 	this->deltaTime = 0;
 	this->startTime = 0;
 	this->totalTime = 0;
+	this->clockSeconds = 0;
+
+	this->tickStep = 1.0 / DEFAULT_TICKS_PER_SECOND;
+	this->simulationTime = 0;
+	this->threadedSimulation = false;
+	this->simulationRunning = false;
+	this->ticksRun = 0;
 
 	// Query performance counter for accurate timing information
 	__int64 perfFreq;
@@ -368,7 +383,9 @@ void DXCore::OnResize()
 // --------------------------------------------------------
 // This is the main game loop, handling the following:
 //  - OS-level messages coming in from Windows itself
-//  - Calling update & draw back and forth, forever
+//  - Running the simulation at its fixed tick rate, either
+//    here or on its own thread
+//  - Calling draw once per loop, forever
 // --------------------------------------------------------
 HRESULT DXCore::Run()
 {
@@ -380,11 +397,24 @@ HRESULT DXCore::Run()
 	currentTime = now;
 	previousTime = now;
 
+	// Create the input system before the game initializes,
+	// so it can set up recording or playback
+	inputSystem = new Input::InputSystem();
+
 	// Give subclass a chance to initialize
-	Init();
+	if (!Init())
+		return E_FAIL;
 
-	// After game is initialized, create an input system
-	inputSystem = new Input::InputSystem();
+	// The renderer always has a state to show, even before the first tick
+	simulationTime = 0;
+	PublishSnapshot(simulationTime);
+
+	if (threadedSimulation)
+	{
+		simulationRunning = true;
+		simulationThread = std::thread(&DXCore::RunSimulationThread, this);
+	}
+	unsigned int ticksSeen = 0;
 
 	// Our overall game and message loop
 	MSG msg = {};
@@ -405,30 +435,149 @@ HRESULT DXCore::Run()
 			if(titleBarStats)
 				UpdateTitleBarStats();
 
-			#ifndef DEBUG
-			// Define screen center (in client coords)
-			POINT center;
-			center.x = this->width/2;
-			center.y = this->height/2;
-
-			// Convert to screen coordinates
-			ClientToScreen(this->hWnd, &center);
-
-			// Move cursor back to center
-			SetCursorPos(center.x, center.y);
-			#endif
-
 			// The game loop
-			Update(deltaTime, totalTime);
+			//  - Frames without a tick leave the cursor alone, so the
+			//    mouse movement is still there for the next tick to read
+			if (threadedSimulation)
+			{
+				unsigned int ticks = ticksRun.load();
+				if (ticks != ticksSeen)
+				{
+					RecenterCursor();
+					ticksSeen = ticks;
+				}
+			}
+			else
+			{
+				if (simulationTime + tickStep <= clockSeconds)
+					RecenterCursor();
+				RunTicks(clockSeconds);
+			}
+
+			// The tick only flags the quit command, it may not be on this thread
+			if (inputSystem->TakeQuitRequest())
+				Quit();
+
 			Draw(deltaTime, totalTime);
 		}
 	}
 
+	if (simulationThread.joinable())
+	{
+		simulationRunning = false;
+		simulationThread.join();
+	}
+
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
 	return (HRESULT)msg.wParam;
 }
 
+// --------------------------------------------------------
+// Sets how many times a second Update runs, only takes
+// effect before Run()
+// --------------------------------------------------------
+void DXCore::SetTickRate(unsigned int ticksPerSecond)
+{
+	tickStep = 1.0 / (double)(ticksPerSecond > 0 ? ticksPerSecond : DEFAULT_TICKS_PER_SECOND);
+}
+
+// --------------------------------------------------------
+// Runs Update on its own thread instead of between draws,
+// only takes effect before Run()
+//  - Update and Draw then run at the same time, so Draw
+//    must only read what PublishSnapshot() handed over
+// --------------------------------------------------------
+void DXCore::SetThreadedSimulation(bool threaded)
+{
+	threadedSimulation = threaded;
+}
+
+// --------------------------------------------------------
+// Seconds since Run() started, readable from any thread
+// --------------------------------------------------------
+double DXCore::ReadClock() const
+{
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	return (double)(now - startTime) * perfCounterSeconds;
+}
+
+// --------------------------------------------------------
+// Runs one Update per tick that's due by now and publishes
+// the result. Returns the number of ticks run.
+// --------------------------------------------------------
+unsigned int DXCore::RunTicks(double now)
+{
+	unsigned int ticks = 0;
+	while (simulationTime + tickStep <= now)
+	{
+		// Too far behind to catch up, skip the whole ticks that are left
+		if (ticks == MAX_TICKS_PER_FRAME)
+		{
+			simulationTime = now - fmod(now - simulationTime, tickStep);
+			break;
+		}
+
+		// Game time counts ticks instead of following the clock, so a
+		// replay sees the same times however the frames fell
+		simulationTime += tickStep;
+		ticks++;
+		Update((float)tickStep, (float)((ticksRun.load() + ticks) * tickStep));
+	}
+
+	if (ticks > 0)
+	{
+		PublishSnapshot(simulationTime);
+		ticksRun += ticks;
+	}
+	return ticks;
+}
+
+// --------------------------------------------------------
+// The simulation thread's loop, ticks whenever one is due
+// and sleeps in between
+// --------------------------------------------------------
+void DXCore::RunSimulationThread()
+{
+	while (simulationRunning)
+	{
+		RunTicks(ReadClock());
+
+		// Sleeping is only accurate to a millisecond or so,
+		// so yield for the last stretch before the next tick
+		double wait = simulationTime + tickStep - ReadClock();
+		if (wait > 0.002)
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(wait - 0.001));
+		}
+		else if (wait > 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Moves the cursor back to the middle of the window, so
+// mouse look never runs out of screen
+// --------------------------------------------------------
+void DXCore::RecenterCursor()
+{
+#ifndef DEBUG
+	// Define screen center (in client coords)
+	POINT center;
+	center.x = this->width/2;
+	center.y = this->height/2;
+
+	// Convert to screen coordinates
+	ClientToScreen(this->hWnd, &center);
+
+	// Move cursor back to center
+	SetCursorPos(center.x, center.y);
+#endif
+}
+
 
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
@@ -457,7 +606,8 @@ void DXCore::UpdateTimer()
 	deltaTime = max((float)((currentTime - previousTime) * perfCounterSeconds), 0.0f);
 
 	// Calculate the total time from start to now
-	totalTime = (float)((currentTime - startTime) * perfCounterSeconds);
+	clockSeconds = (double)(currentTime - startTime) * perfCounterSeconds;
+	totalTime = (float)clockSeconds;
 
 	// Save current time for next frame
 	previousTime = currentTime;
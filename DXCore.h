@@ -3,6 +3,8 @@
 #include <Windows.h>
 #include <d3d11.h>
 #include <string>
+#include <atomic>
+#include <thread>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
 // Base DXCore holds the owning pointer to the input wrangler
@@ -43,10 +45,19 @@ public:
 	virtual void OnResize();
 
 	// Pure virtual methods for setup and game functionality
-	virtual void Init() = 0;
+	//  - Update runs at the fixed tick rate, deltaTime is always one tick
+	//    and totalTime is the simulation's time
+	//  - Draw runs once per loop with the real frame time
+	//  - Init returns false if the game can't start, Run then returns
+	//    without starting the simulation or the loop
+	virtual bool Init() = 0;
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
+	// Called after the last Update of a batch of ticks, on the thread that ran
+	// them, with the time the state is for. Hand the renderer a copy here.
+	virtual void PublishSnapshot(double tickTime) {}
+
 protected:
 	HINSTANCE	hInstance;		// The handle to the application
 	HWND		hWnd;			// The handle to the window itself
@@ -83,6 +94,15 @@ protected:
 	// Input System
 	Input::InputSystem* inputSystem;
 
+	// Simulation timing, set these up before Run()
+	void SetTickRate(unsigned int ticksPerSecond);
+	void SetThreadedSimulation(bool threaded);
+	inline double GetTickStep() const { return tickStep; }
+
+	// Time Draw should show, one tick behind the clock so there's
+	// always a newer tick to blend towards
+	inline double GetRenderTime() const { return clockSeconds - tickStep; }
+
 private:
 	// Timing related data
 	double perfCounterSeconds;
@@ -92,11 +112,26 @@ private:
 	__int64 currentTime;
 	__int64 previousTime;
 
+	double clockSeconds;
+
+	// Fixed step simulation
+	double tickStep;
+	double simulationTime;		// Time of the latest tick's state
+	bool threadedSimulation;
+	std::thread simulationThread;
+	std::atomic<bool> simulationRunning;
+	std::atomic<unsigned int> ticksRun;
+
 	// FPS calculation
 	int fpsFrameCount;
 	float fpsTimeElapsed;
 
 	void UpdateTimer();			// Updates the timer for this frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
+	void RecenterCursor();
+
+	double ReadClock() const;
+	unsigned int RunTicks(double now);	// Runs every tick that's due by now
+	void RunSimulationThread();
 };
 
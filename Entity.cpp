@@ -5,17 +5,16 @@
 #include "Material.h"
 #include "Vertex.h"
 #include "SimpleShader.h"
+#include <cstring>
 
 Entity::Entity(Mesh* incomingMesh, Material* incomingMaterial)
 {
 	mesh = incomingMesh;
 	material = incomingMaterial;
-	transform = new Transform();
 }
 
 Entity::~Entity()
 {
-	delete transform;
 }
 
 Mesh* Entity::GetMesh() const
@@ -25,7 +24,7 @@ Mesh* Entity::GetMesh() const
 
 Transform* Entity::GetTransform()
 {
-	return transform;
+	return &transform;
 }
 
 class Material* Entity::GetMaterial() const
@@ -33,64 +32,72 @@ class Material* Entity::GetMaterial() const
 	return material;
 }
 
-// doesn't involve instanced rendering yet
-void Entity::Draw(ID3D11DeviceContext* context, Camera* mainCamera)
+void Entity::SetColorTint(const DirectX::XMFLOAT4& tint)
 {
+	colorTint = tint;
+	hasColorTint = true;
+}
 
-	SimpleVertexShader* vs = material->GetVertexShader();
-	SimplePixelShader* ps = material->GetPixelShader();
-
-	// set the vertex shader data
-	vs->SetFloat4("colorTint",  material->GetColorTint());
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("view", mainCamera->GetViewMatrix());
-	vs->SetMatrix4x4("proj", mainCamera->GetProjectionMatrix());
-	vs->CopyAllBufferData();
+void Entity::ClearColorTint()
+{
+	hasColorTint = false;
+}
 
-	ps->SetFloat("shininess", material->GetShininess());
-	ps->CopyAllBufferData();
+DirectX::XMFLOAT4 Entity::GetColorTint() const
+{
+	return hasColorTint ? colorTint : material->GetColorTint();
+}
 
-	ps->SetShaderResourceView("diffuseTexture", material->GetDiffuseTextureWrapper());
-	if(material->IsNormalMapMaterial()) 
-	{
-		ps->SetShaderResourceView("normalMap", material->GetNormalMapWrapper());
-	}
-	ps->SetSamplerState("samplerOptions", material->GetTextureSampler());
+const DirectX::BoundingBox& Entity::GetWorldBoundingBox()
+{
+	UpdateWorldBounds();
+	return worldBox;
+}
 
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+const DirectX::BoundingSphere& Entity::GetWorldBoundingSphere()
+{
+	UpdateWorldBounds();
+	return worldSphere;
+}
 
-	// set vertex and index buffers and draw the mesh
-	context->IASetVertexBuffers(0, 1, mesh->GetVertexBuffer(), &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-	context->DrawIndexed
-	(
-		mesh->GetIndexCount(),
-		0,
-		0
-	);
+void Entity::UpdateWorldBounds()
+{
+	// the render matrix has no revision of its own, and the simulation's
+	// revision can't be read while another thread is ticking
+	DirectX::XMFLOAT4X4 world = transform.GetRenderMatrix();
+	if (boundsValid && memcmp(&boundsMatrix, &world, sizeof(world)) == 0)
+		return;
+
+	DirectX::XMMATRIX worldMatrix = DirectX::XMLoadFloat4x4(&world);
+	mesh->GetLocalBoundingBox().Transform(worldBox, worldMatrix);
+	mesh->GetLocalBoundingSphere().Transform(worldSphere, worldMatrix);
+
+	boundsMatrix = world;
+	boundsValid = true;
 }
 
-void Entity::DrawTransparent(struct ID3D11DeviceContext* context, class Camera* mainCamera)
+// draws just this entity, see InstancedRenderer for drawing many entities sharing a mesh and material
+void Entity::Draw(ID3D11DeviceContext* context, Camera* mainCamera)
 {
 	SimpleVertexShader* vs = material->GetVertexShader();
-	SimplePixelShader* ps = material->GetPixelShader();
+	vs->SetMatrix4x4(material->GetViewHandle(), mainCamera->GetViewMatrix());
+	vs->SetMatrix4x4(material->GetProjHandle(), mainCamera->GetProjectionMatrix());
 
-	// set the vertex shader data
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("view", mainCamera->GetViewMatrix());
-	vs->SetMatrix4x4("proj", mainCamera->GetProjectionMatrix());
-	vs->CopyAllBufferData();
+	material->BindResources();
+	mesh->Bind(context);
+
+	DrawObject(context, mainCamera);
+}
 
-	ps->SetFloat4("colorAndAlpha",  material->GetColorTint());
-	ps->CopyAllBufferData();
+void Entity::DrawObject(ID3D11DeviceContext* context, Camera* mainCamera)
+{
+	SimpleVertexShader* vs = material->GetVertexShader();
 
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	// only the per object buffer changes between entities sharing a material,
+	// the per frame and per material buffers are skipped unless they're dirty
+	vs->SetMatrix4x4(material->GetWorldHandle(), transform.GetRenderMatrix());
+	vs->CopyAllBufferData();
 
-	// set vertex and index buffers and draw the mesh
-	context->IASetVertexBuffers(0, 1, mesh->GetVertexBuffer(), &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
 	context->DrawIndexed
 	(
 		mesh->GetIndexCount(),
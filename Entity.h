@@ -1,11 +1,11 @@
 #pragma once
 
+#include <DirectXCollision.h>
 #include "Transform.h"
 
 class Mesh;
 class Camera;
 class Material;
-class Transform;
 
 struct ID3D11DeviceContext;
 
@@ -19,10 +19,34 @@ public:
 	class Transform* GetTransform();
 	class Material* GetMaterial() const;
 
+	// Overrides the material's tint for just this entity, the instanced
+	// renderer hands it to the shaders per instance
+	void SetColorTint(const DirectX::XMFLOAT4& tint);
+	void ClearColorTint();
+	DirectX::XMFLOAT4 GetColorTint() const;
+
 	void Draw(struct ID3D11DeviceContext* context, class Camera* mainCamera);
-	void DrawTransparent(struct ID3D11DeviceContext* context, class Camera* mainCamera);
+
+	// Only uploads the per object data and issues the draw, the shaders,
+	// material, mesh and per frame camera data are expected to be set already
+	void DrawObject(struct ID3D11DeviceContext* context, class Camera* mainCamera);
+
+	// World space bounds of the mesh where the renderer shows it, rebuilt when that moves
+	const DirectX::BoundingBox& GetWorldBoundingBox();
+	const DirectX::BoundingSphere& GetWorldBoundingSphere();
 private:
-	class Transform* transform;
+	void UpdateWorldBounds();
+
+	// Only holds a handle, the data lives in the TransformSystem's arrays
+	Transform transform;
 	class Mesh* mesh;
 	class Material* material;
+
+	DirectX::XMFLOAT4 colorTint;
+	bool hasColorTint = false;
+
+	DirectX::BoundingBox worldBox;
+	DirectX::BoundingSphere worldSphere;
+	DirectX::XMFLOAT4X4 boundsMatrix;
+	bool boundsValid = false;
 };
\ No newline at end of file
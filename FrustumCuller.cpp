@@ -0,0 +1,60 @@
+#include "FrustumCuller.h"
+
+using namespace DirectX;
+
+void FrustumCuller::Update(const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	stats = FrustumCullStats();
+
+	// Row vectors, so a point is inside when 0 <= p.col[2] <= p.col[3]
+	// and -p.col[3] <= p.col[0..1] <= p.col[3]. Transposing turns the
+	// columns into rows that can be added up into the planes.
+	XMMATRIX viewProj = XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj)));
+
+	XMVECTOR frustumPlanes[6] =
+	{
+		XMVectorAdd(viewProj.r[3], viewProj.r[0]),
+		XMVectorSubtract(viewProj.r[3], viewProj.r[0]),
+		XMVectorAdd(viewProj.r[3], viewProj.r[1]),
+		XMVectorSubtract(viewProj.r[3], viewProj.r[1]),
+		viewProj.r[2],
+		XMVectorSubtract(viewProj.r[3], viewProj.r[2])
+	};
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(frustumPlanes[i]));
+	}
+}
+
+bool FrustumCuller::IsVisible(const BoundingSphere& sphere, const BoundingBox& box)
+{
+	stats.tested++;
+
+	XMVECTOR sphereCenter = XMLoadFloat3(&sphere.Center);
+	XMVECTOR negativeRadius = XMVectorReplicate(-sphere.Radius);
+	XMVECTOR boxCenter = XMLoadFloat3(&box.Center);
+	XMVECTOR boxExtents = XMLoadFloat3(&box.Extents);
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[i]);
+
+		// Whole sphere behind the plane
+		if (XMVector4Less(XMPlaneDotCoord(plane, sphereCenter), negativeRadius))
+		{
+			stats.culled++;
+			return false;
+		}
+
+		// Box corner furthest along the normal is still behind the plane
+		XMVECTOR reach = XMVector3Dot(XMVectorAbs(plane), boxExtents);
+		if (XMVector4Less(XMVectorAdd(XMPlaneDotCoord(plane, boxCenter), reach), XMVectorZero()))
+		{
+			stats.culled++;
+			return false;
+		}
+	}
+
+	return true;
+}
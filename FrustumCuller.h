@@ -0,0 +1,50 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+// --------------------------------------------------------
+// Counts since the last FrustumCuller::Update()
+// --------------------------------------------------------
+struct FrustumCullStats
+{
+	unsigned int tested = 0;
+	unsigned int culled = 0;
+};
+
+// --------------------------------------------------------
+// Drops draws whose bounds are fully outside the camera's
+// view frustum
+//
+// - The six planes are pulled out of view * proj once per
+//   frame, pointing inwards and normalized
+// - Spheres are tested first since they're cheapest, then
+//   the box is tested against its most positive corner
+// - Only depends on DirectXMath, so it can be run without
+//   a device
+// --------------------------------------------------------
+class FrustumCuller
+{
+public:
+	// Rebuilds the planes for a camera and resets the stats
+	void Update(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+
+	// True when any part of the bounds might be on screen
+	bool IsVisible(const DirectX::BoundingSphere& sphere, const DirectX::BoundingBox& box);
+
+	// Anything with world bounds, kept in the header so the
+	// culler doesn't have to link against Entity
+	template<typename T>
+	bool IsVisible(T* object)
+	{
+		return IsVisible(object->GetWorldBoundingSphere(), object->GetWorldBoundingBox());
+	}
+
+	inline const FrustumCullStats& GetStats() const { return stats; }
+
+private:
+	// Left, right, bottom, top, near, far
+	DirectX::XMFLOAT4 planes[6];
+
+	FrustumCullStats stats;
+};
@@ -0,0 +1,59 @@
+cbuffer externalData : register(b0)
+{
+	float2 pixelSize;	// 1 / screen size
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+Texture2D pixels			: register(t0);
+SamplerState samplerOptions	: register(s0);
+
+#define FXAA_REDUCE_MIN (1.0f / 128.0f)
+#define FXAA_REDUCE_MUL (1.0f / 8.0f)
+#define FXAA_SPAN_MAX 8.0f
+
+float Luma(float3 color)
+{
+	return dot(color, float3(0.299f, 0.587f, 0.114f));
+}
+
+// A cut down FXAA: finds the direction of the edge from the luma of
+// the corners and blurs along it, leaving flat areas untouched
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float lumaNW = Luma(pixels.Sample(samplerOptions, input.uv + float2(-1, -1) * pixelSize).rgb);
+	float lumaNE = Luma(pixels.Sample(samplerOptions, input.uv + float2(1, -1) * pixelSize).rgb);
+	float lumaSW = Luma(pixels.Sample(samplerOptions, input.uv + float2(-1, 1) * pixelSize).rgb);
+	float lumaSE = Luma(pixels.Sample(samplerOptions, input.uv + float2(1, 1) * pixelSize).rgb);
+	float3 colorM = pixels.Sample(samplerOptions, input.uv).rgb;
+	float lumaM = Luma(colorM);
+
+	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+	float2 dir;
+	dir.x = -((lumaNW + lumaNE) - (lumaSW + lumaSE));
+	dir.y = ((lumaNW + lumaSW) - (lumaNE + lumaSE));
+
+	float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25f * FXAA_REDUCE_MUL, FXAA_REDUCE_MIN);
+	float rcpDirMin = 1.0f / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+	dir = clamp(dir * rcpDirMin, -FXAA_SPAN_MAX, FXAA_SPAN_MAX) * pixelSize;
+
+	float3 colorA = 0.5f * (
+		pixels.Sample(samplerOptions, input.uv + dir * (1.0f / 3.0f - 0.5f)).rgb +
+		pixels.Sample(samplerOptions, input.uv + dir * (2.0f / 3.0f - 0.5f)).rgb);
+	float3 colorB = colorA * 0.5f + 0.25f * (
+		pixels.Sample(samplerOptions, input.uv + dir * -0.5f).rgb +
+		pixels.Sample(samplerOptions, input.uv + dir * 0.5f).rgb);
+
+	// The wider blur overshot the edge if it left the local range
+	float lumaB = Luma(colorB);
+	if (lumaB < lumaMin || lumaB > lumaMax)
+		return float4(colorA, 1.0f);
+	return float4(colorB, 1.0f);
+}
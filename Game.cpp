@@ -5,9 +5,22 @@
 #include "Camera.h"
 #include "Material.h"
 #include "SimpleShader.h"
-#include "SimpleAI.h"
-#include "WICTextureLoader.h"
+#include "AISystem.h"
+#include "AssetLoader.h"
+#include "TextureRegistry.h"
+#include "InstancedRenderer.h"
+#include "RenderQueue.h"
+#include "ClusteredLighting.h"
+#include "PostProcessChain.h"
+#include "FrustumCuller.h"
+#include "SimulationSnapshot.h"
+#include "TransformSystem.h"
+#include "JobSystem.h"
 #include "PlayerInterface.h"
+#include "GameSimulation.h"
+#include "InputRecording.h"
+#include "InputSystem.h"
+#include "SceneFile.h"
 #include <algorithm>
 #include <ppl.h>
 #include <iostream>
@@ -45,6 +58,8 @@ Game::Game(HINSTANCE hInstance)
 	printf("Console window created successfully.  Feel free to printf() here.\n");
 #endif
 
+	SetTickRate(SIMULATION_TICKS_PER_SECOND);
+	SetThreadedSimulation(SIMULATION_ON_OWN_THREAD);
 }
 
 // --------------------------------------------------------
@@ -54,6 +69,8 @@ Game::Game(HINSTANCE hInstance)
 // --------------------------------------------------------
 Game::~Game()
 {
+	JobSystem::Get().Stop();
+
 	parallel_for
 	(
 		size_t(0), entities.size(), [&](size_t i)
@@ -92,46 +109,33 @@ Game::~Game()
 
 	parallel_for
 	(
-		size_t(0), route1.size(), [&](size_t i)
+		size_t(0), waypoints.size(), [&](size_t i)
 		{
-			delete route1[i];
+			delete waypoints[i];
 		},
 		static_partitioner()
 	);
 
-	parallel_for
-	(
-		size_t(0), route2.size(), [&](size_t i)
-		{
-			delete route2[i];
-		},
-		static_partitioner()
-	);
+	delete sceneData;
 
-	parallel_for
-	(
-		size_t(0), aiGhosts.size(), [&](size_t i)
-		{
-			delete aiGhosts[i];
-		},
-		static_partitioner()
-	);
+	// the recording covers every tick that ran
+	if (inputRecording)
+	{
+		inputSystem->StartRecording(nullptr);
+		inputRecording->Save(recordingFileName.c_str());
+		delete inputRecording;
+	}
 
-	srvBrick->Release();
-	srvMetal->Release();
-	srvRock->Release();
-	srvRockNormal->Release();
-	textureSampler->Release();
-	srvCushion->Release();
-	srvCushionNormal->Release();
+	delete simulation;
 
-	srvBlueprintBlue->Release();
-	srvBlueprintGray->Release();
-	srvBlueprintOrange->Release();
-	srvBlueprintDefault->Release();
-	srvBlueprintGreen->Release();
+	// after the materials, which hold references into it
+	delete textureRegistry;
+	// null when the scene failed to load
+	if (textureSampler)
+		textureSampler->Release();
 
-	blendState->Release();
+	if (blendState)
+		blendState->Release();
 
 	delete playerCamera;
 
@@ -143,110 +147,59 @@ Game::~Game()
 
 	delete solidColorTransparentPS;
 
-	delete[] lights;
+	delete instancedVS;
+	delete instancedColorPS;
+	delete instancedRenderer;
+	delete renderQueue;
+	delete clusteredLighting;
+	delete frustumCuller;
+	delete snapshots;
 
+	delete postProcess;
 	delete ppVS;
-	
-	delete ppPS;
+	delete copyPS;
+	delete bloomExtractPS;
+	delete bloomBlurPS;
+	delete tonemapPS;
+	delete fxaaPS;
 }
 
 // --------------------------------------------------------
 // Called once per program, after DirectX and the window
-// are initialized but before the game loop.
+// are initialized but before the game loop. Returns false
+// when the scene can't be loaded.
 // --------------------------------------------------------
-void Game::Init()
+bool Game::Init()
 {
-	LoadShaders();
+	// worker threads for the update phase, the main thread helps out while it waits
+	JobSystem::Get().Start(JobSystem::GetDefaultWorkerCount());
 
-	CreateBasicGeometry();
+	LoadShaders();
 
-	lights = new Light[MAX_LIGHTS_IN_SCENE];
+	if (!CreateBasicGeometry())
+		return false;
 
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
 	// Essentially: "What kind of shape should the GPU draw with our data?"
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	/**
-	 * Scene Light definitions
-	 */
-
-	lights[lightsInScene].color = XMFLOAT3(1.0f, 0.2f, 0.2f);
-	lights[lightsInScene].type = LIGHT_TYPE_SPOT;
-	lights[lightsInScene].direction = XMFLOAT3(0.f, 0.f, -1.f);
-	lights[lightsInScene].range = 15.f;
-	lights[lightsInScene].intensity = 5.f;
-	lights[lightsInScene].spotFalloff = 25.f;
-	lights[lightsInScene++].position = XMFLOAT3(-4.5f, 3.f, -34.5f);
-
-	lights[lightsInScene].color = XMFLOAT3(1.0f, 0.2f, 0.2f);
-	lights[lightsInScene].type = LIGHT_TYPE_SPOT;
-	lights[lightsInScene].direction = XMFLOAT3(0.f, 0.f, -1.f);
-	lights[lightsInScene].range = 15.f;
-	lights[lightsInScene].intensity = 5.f;
-	lights[lightsInScene].spotFalloff = 25.f;
-	lights[lightsInScene++].position = XMFLOAT3(-3.f, .5f, -24.f);
-
-	lights[lightsInScene].color = XMFLOAT3(.65f, .2f, .3f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 5.f;
-	lights[lightsInScene].intensity = 2.f;
-	lights[lightsInScene++].position = XMFLOAT3(0, 0, 0);
-
-	lights[lightsInScene].color = XMFLOAT3(1.f, 1.f, 1.f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 4.f;
-	lights[lightsInScene].intensity = 2.f;
-	lights[lightsInScene++].position = XMFLOAT3(-7.5f, 3.f, 7.5f);
-
-	lights[lightsInScene].color = XMFLOAT3(1.f, 1.f, 1.f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 2.5f;
-	lights[lightsInScene].intensity = 2.f;
-	lights[lightsInScene++].position = XMFLOAT3(-5.f, 1.85f, 1.f);
-
-	lights[lightsInScene].color = XMFLOAT3(1.f, 1.f, 1.f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 3.f;
-	lights[lightsInScene].intensity = 1.5f;
-	lights[lightsInScene++].position = XMFLOAT3(-5.f, 1.85f, -11.f);
-
-	lights[lightsInScene].color = XMFLOAT3(1.f, 1.f, 1.f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 4.5f;
-	lights[lightsInScene].intensity = 1.f;
-	lights[lightsInScene++].position = XMFLOAT3(5.f, 2.5f, -20.f);
-
-	lights[lightsInScene].color = XMFLOAT3(1.f, 1.f, 1.f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 4.f;
-	lights[lightsInScene].intensity = 1.f;
-	lights[lightsInScene++].position = XMFLOAT3(5.f, 2.5f, -33.f);
-
-	lights[lightsInScene].color = XMFLOAT3(.5f, 1.f, .9f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 4.f;
-	lights[lightsInScene].intensity = 1.f;
-	lights[lightsInScene++].position = XMFLOAT3(-4.5f, 2.5f, -34.5f);
-
-	lights[lightsInScene].color = XMFLOAT3(.98f, .85f, .85f);
-	lights[lightsInScene].type = LIGHT_TYPE_POINT;
-	lights[lightsInScene].range = 4.5f;
-	lights[lightsInScene].intensity = 1.f;
-	lights[lightsInScene++].position = XMFLOAT3(-11.5f, 2.5f, -26.5f);
-
-	lights[lightsInScene].color = XMFLOAT3(1.f, 1.f, 1.f);
-	lights[lightsInScene].type = LIGHT_TYPE_AMBIENT;
-	lights[lightsInScene++].intensity = .1f;
+	// the lights, the ghosts' AI and everything else that moves
+	simulation = new GameSimulation();
 
 	ResizePostProcessResources();
+#if defined(DEBUG) || defined(_DEBUG)
+	postProcess->PrintStats();
+#endif
+
+	snapshots = new SnapshotBuffer();
 
-	ppData.opacity = .95f;
-	ppData.innerRadius = 0.2f;
-	ppData.outerRadius = .6f;
-	
 	// all the initialization for the engine has to be done prior to this. Now the game specific stuff needs to initialize
 	BeginPlay();
+
+	// the first snapshot is taken before any tick runs
+	TransformSystem::Get().UpdateWorldMatrices();
+	return true;
 }
 
 // --------------------------------------------------------
@@ -259,7 +212,8 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	playerCamera = new Camera(XMFLOAT3(-5.1f, 2.1f, 5.0f), XMFLOAT3(0, XM_PI, 0), (float)this->width / this->height);
+	// BeginPlay puts the camera where the scene starts the player
+	playerCamera = new Camera(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), (float)this->width / this->height);
 
 	vertexShader = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShader.cso").c_str());
 	pixelShader = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShader.cso").c_str());
@@ -269,15 +223,50 @@ void Game::LoadShaders()
 
 	solidColorTransparentPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"SolidColorTransparentShader.cso").c_str());
 
+	// The "_PER_INSTANCE" semantics in this shader mark it as per instance compatible
+	instancedVS = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"InstancedVS.cso").c_str());
+	instancedColorPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"InstancedColorPS.cso").c_str());
+
+	instancedRenderer = new InstancedRenderer(device.Get());
+	renderQueue = new RenderQueue();
+	clusteredLighting = new ClusteredLighting(device.Get(), context.Get());
+	frustumCuller = new FrustumCuller();
+
 	ppVS = new SimpleVertexShader(
 		device.Get(),
 		context.Get(),
 		GetFullPathTo_Wide(L"PostProcessVS.cso").c_str());
 
-	ppPS = new SimplePixelShader(
-		device.Get(),
-		context.Get(),
-		GetFullPathTo_Wide(L"VignettePS.cso").c_str());
+	copyPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"CopyPS.cso").c_str());
+	bloomExtractPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"BloomExtractPS.cso").c_str());
+	bloomBlurPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"BloomBlurPS.cso").c_str());
+	tonemapPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"TonemapPS.cso").c_str());
+	fxaaPS = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"FxaaPS.cso").c_str());
+
+	PostProcessShaders ppShaders;
+	ppShaders.fullscreenVS = ppVS;
+	ppShaders.copyPS = copyPS;
+	ppShaders.bloomExtractPS = bloomExtractPS;
+	ppShaders.bloomBlurPS = bloomBlurPS;
+	ppShaders.tonemapPS = tonemapPS;
+	ppShaders.fxaaPS = fxaaPS;
+	postProcess = new PostProcessChain(device.Get(), context.Get(), ppShaders);
+
+	// the scene is drawn in HDR and brought back down by the tonemapper,
+	// effects that are off are culled from the graph along with their targets.
+	// Grading, vignette and grain are drawn by the one composite pass. Gamma
+	// stays off, the lighting shaders already write display colors.
+	PostProcessSettings ppSettings;
+	ppSettings.bloom = true;
+	ppSettings.tonemap = true;
+	ppSettings.fxaa = true;
+	ppSettings.colorGrading = true;
+	ppSettings.vignette = true;
+	ppSettings.filmGrain = true;
+	ppSettings.contrast = 1.05f;
+	ppSettings.saturation = 1.1f;
+	ppSettings.grainIntensity = .03f;
+	postProcess->SetSettings(ppSettings);
 
 	// Make the blend state for basic alpha blending
 	D3D11_BLEND_DESC blendDesc = {};
@@ -304,27 +293,48 @@ void Game::LoadShaders()
 
 // --------------------------------------------------------
 // Creates the geometry we're going to draw - a single triangle for now
+// Returns false if the scene couldn't be loaded
 // --------------------------------------------------------
-void Game::CreateBasicGeometry()
+bool Game::CreateBasicGeometry()
 {
-	// setup models
-    meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/torus.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), device.Get()));
+	// Meshes and textures are parsed and decoded on worker threads,
+	// only the GPU resource creation happens here on the device thread
+	AssetLoader loader;
+	textureRegistry = new TextureRegistry();
+
+	// everything the level starts out as, compiled to a binary the first time it loads
+	sceneData = new SceneData();
+	SceneLoadStats sceneStats;
+	if (!LoadScene(GetFullPathTo(GAME_SCENE_FILE).c_str(), *sceneData, &sceneStats))
+	{
+		MessageBoxA(hWnd, sceneStats.error.c_str(), "The scene failed to load", MB_OK | MB_ICONERROR);
+		assert(false && "The scene failed to load");
+		return false;
+	}
+
+	meshes.resize(sceneData->meshes.size(), nullptr);
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		loader.QueueMesh(sceneData->GetPath(sceneData->meshes[i].path), &meshes[i]);
+	}
 
-	// setup game room models
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/Rooms/BeginRoom.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/Rooms/MainRoom.obj").c_str(), device.Get()));
+	// textures are baked to block compressed mips next to the PNGs the first time they load
+	std::vector<TextureHandle> textures;
+	for (const SceneTexture& texture : sceneData->textures)
+	{
+		textures.push_back(textureRegistry->Load(loader, sceneData->GetPath(texture.path), texture.usage));
+	}
 
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/RoomAssets/Arch.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/RoomAssets/Doorway.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/RoomAssets/Prism.obj").c_str(), device.Get()));
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/RoomAssets/Pipe.obj").c_str(), device.Get()));
+	loader.LoadAll(device.Get(), context.Get(), textureRegistry->GetStreamer());
+	textureRegistry->FinishLoads();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	loader.PrintTimings();
+	textureRegistry->PrintStats();
+#endif
 
-	// ghost model
-	meshes.push_back(new Mesh(GetFullPathTo("../../Assets/Models/Enemies/inky.obj").c_str(), device.Get()));
+	// The ghost model isn't checked in yet, so only the textures are required
+	assert(textureRegistry->GetStats().failedLoads == 0);
 
 	D3D11_SAMPLER_DESC sampDesc = {};
 	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -334,142 +344,48 @@ void Game::CreateBasicGeometry()
 	sampDesc.Filter = D3D11_FILTER_ANISOTROPIC;
 	sampDesc.MaxAnisotropy = 16;
 	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	HRESULT res = device->CreateSamplerState(&sampDesc, &textureSampler);
+	device->CreateSamplerState(&sampDesc, &textureSampler);
 
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/brick.png").c_str(), nullptr, &srvBrick);
-	if(res != S_OK) 
-	{
-		assert(false);
-	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/metal.png").c_str(), nullptr, &srvMetal);
-	if (res != S_OK)
-	{
-		assert(false);
-	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/rock.png").c_str(), nullptr, &srvRock);
-	if (res != S_OK)
+	// setup materials, each shader binds the textures the scene checked it has
+	for (const SceneMaterial& material : sceneData->materials)
 	{
-		assert(false);
-	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/rock_normals.png").c_str(), nullptr, &srvRockNormal);
-	if (res != S_OK)
-	{
-		assert(false);
-	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/cushion.png").c_str(), nullptr, &srvCushion);
-	if (res != S_OK)
-	{
-		assert(false);
-	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/cushion_normals.png").c_str(), nullptr, &srvCushionNormal);
-	if (res != S_OK)
-	{
-		assert(false);
-	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/GridBox_Default.png").c_str(), nullptr, &srvBlueprintDefault);
-	if (res != S_OK)
-	{
-		assert(false);
-	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/prototype_512x512_orange.png").c_str(), nullptr, &srvBlueprintOrange);
-	if (res != S_OK)
-	{
-		assert(false);
+		switch (material.shader)
+		{
+		case SceneShader::Lit:
+			materials.push_back(new Material(material.tint, material.shininess, textureRegistry, textures[material.diffuse], textureSampler, vertexShader, pixelShader));
+			break;
+		case SceneShader::NormalMapped:
+			materials.push_back(new Material(material.tint, material.shininess, textureRegistry, textures[material.diffuse], textures[material.normal], textureSampler, normalVS, normalPS));
+			break;
+		case SceneShader::Instanced:
+			materials.push_back(new Material(material.tint, material.shininess, instancedVS, instancedColorPS));
+			break;
+		}
 	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/prototype_512x512_blue2.png").c_str(), nullptr, &srvBlueprintBlue);
-	if(res != S_OK) 
+
+	// setup entities, the simulation places them in BeginPlay
+	for (const SceneEntity& entity : sceneData->entities)
 	{
-		assert(false);
+		entities.push_back(new Entity(meshes[entity.mesh], materials[entity.material]));
 	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/prototype_512x512_grey2.png").c_str(), nullptr, &srvBlueprintGray);
-	if (res != S_OK)
+
+	// the ghosts are transparent
+	for (const SceneGhost& ghost : sceneData->ghosts)
 	{
-		assert(false);
+		ghostEntities.push_back(new Entity(meshes[ghost.mesh], materials[ghost.material]));
 	}
-	res = CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"/../../Assets/Textures/prototype_512x512_green1.png").c_str(), nullptr, &srvBlueprintGreen);
-	if (res != S_OK)
+
+	waypoints.resize(sceneData->waypoints.size(), nullptr);
+	for (const SceneRoute& route : sceneData->routes)
 	{
-		assert(false);
+		for (uint32_t i = route.firstWaypoint; i < route.firstWaypoint + route.waypointCount; i++)
+		{
+			waypoints[i] = new Entity(meshes[route.mesh], materials[route.material]);
+		}
 	}
 
-	// setup materials
-	// sphere gets shininess
-	// uses normal maps
-	materials.push_back(new Material(XMFLOAT4(1.f, 1.f, 1.f, 1.f), 5.f, srvCushion, srvCushionNormal, textureSampler, normalVS, normalPS));
-	// cube gets full shininess
-	materials.push_back(new Material(XMFLOAT4(.8f, .86f, .8f, 1), 1.f, srvBrick, textureSampler, vertexShader, pixelShader));
-	// helix slightly less shiny
-	materials.push_back(new Material(XMFLOAT4(.88f, 0.1f, .68f, 1), .75f, srvMetal, textureSampler, vertexShader, pixelShader));
-	// torus barely shiny
-	materials.push_back(new Material(XMFLOAT4(.75f, .75f, .8f, 1), .45f, srvRock, srvRockNormal, textureSampler, normalVS, normalPS));
-	// cylinder is not going to have any shininess
-	materials.push_back(new Material(XMFLOAT4(0.2f, 0.8f, .28f, 1), 0, srvMetal, textureSampler, vertexShader, pixelShader));
-
-	/*
-	Stealth Game materials go here
-	*/
-	materials.push_back(new Material(XMFLOAT4(1.f, 1.f, 1.f, 1.f), 0.f, srvBlueprintBlue, textureSampler, vertexShader, pixelShader));
-	materials.push_back(new Material(XMFLOAT4(1.f, 1.f, 1.f, 1.f), 0.f, srvBlueprintGray, textureSampler, vertexShader, pixelShader));
-
-	materials.push_back(new Material(XMFLOAT4(1.f, 1.f, 1.f, 1.f), 0.f, srvBlueprintDefault, textureSampler, vertexShader, pixelShader));
-	materials.push_back(new Material(XMFLOAT4(1.f, 1.f, 1.f, 1.f), 0.f, srvBlueprintOrange, textureSampler, vertexShader, pixelShader));
-	materials.push_back(new Material(XMFLOAT4(1.f, 1.f, 1.f, 1.f), 0.f, srvBlueprintGreen, textureSampler, vertexShader, pixelShader));
-
-	// transparent material
-	materials.push_back(new Material(XMFLOAT4(.1f, .1f, 1.f, .5f), 0.f, vertexShader, solidColorTransparentPS));
-
-	materials.push_back(new Material(XMFLOAT4(1.f, 1.f, 0.f, 1.f), 0.f, vertexShader, solidColorTransparentPS));
-
-	// setup entities
-	entities.push_back(new Entity(meshes[0], materials[0]));
-	entities.push_back(new Entity(meshes[1], materials[1]));
-	entities.push_back(new Entity(meshes[2], materials[2]));
-	entities.push_back(new Entity(meshes[3],  materials[3]));
-	entities.push_back(new Entity(meshes[4],  materials[4]));
-
-	/*entities for the stealth game*/
-
-	// blue building
-	entities.push_back(new Entity(meshes[5], materials[5]));
-	// gray building
-	entities.push_back(new Entity(meshes[6], materials[6]));
-
-	// room assets
-	
-	//arch
-	entities.push_back(new Entity(meshes[7], materials[7]));
-	//doorway
-	entities.push_back(new Entity(meshes[8], materials[8]));
-	//prism
-	entities.push_back(new Entity(meshes[9], materials[8]));
-	//pipe
-	entities.push_back(new Entity(meshes[10], materials[9]));
-
-	// Ghost
-	ghostEntities.push_back(new Entity(meshes[11], materials[10]));
-	ghostEntities.push_back(new Entity(meshes[11], materials[10]));
-
-	/**
-	 * The first route for the right side of the room
-	 */
-	
-	route1.push_back(new Entity(meshes[0], materials[11]));
-	route1.push_back(new Entity(meshes[0], materials[11]));
-	route1.push_back(new Entity(meshes[0], materials[11]));
-	route1.push_back(new Entity(meshes[0], materials[11]));
-	route1.push_back(new Entity(meshes[0], materials[11]));
-
-	route2.push_back(new Entity(meshes[0], materials[11]));
-	route2.push_back(new Entity(meshes[0], materials[11]));
-	route2.push_back(new Entity(meshes[0], materials[11]));
-	route2.push_back(new Entity(meshes[0], materials[11]));
-	route2.push_back(new Entity(meshes[0], materials[11]));
-
-	aiGhosts.push_back(new SimpleAI(playerCamera, &route1[0], ghostEntities[0]));
-	aiGhosts.push_back(new SimpleAI(playerCamera, &route2[0], ghostEntities[1]));
-
-	
 	bDrawWaypoints = true;
+	return true;
 }
 
 
@@ -478,80 +394,63 @@ void Game::BeginPlay()
 	if(entities.size() <= 0)
 		return;
 
-	entities[0]->GetTransform()->MoveAbsolute(3, 0, 1);
-
-	entities[1]->GetTransform()->SetPosition(.2f, 1, .5f);
-
-	//helix
-	entities[2]->GetTransform()->SetPosition(-1.5, 0, -1);
-	entities[2]->GetTransform()->SetScale(.5f, .5f, .5f);
-
-	entities[4]->GetTransform()->SetPosition(1, -1.5, -.05f);
-
-	// stealth game related begin play
-	entities[6]->GetTransform()->MoveAbsolute(0, 0, -10);
-
-	entities[7]->GetTransform()->SetRotation(0, 35.5f, 0.f);
-	entities[7]->GetTransform()->MoveAbsolute(0,0,-24);
-
-	entities[8]->GetTransform()->MoveAbsolute(8,.5f,-27);
-
-	entities[9]->GetTransform()->MoveAbsolute(-9,.5f,-22);
-
-	entities[10]->GetTransform()->MoveAbsolute(-6,.5f,-34);
-
-	ghostEntities[0]->GetTransform()->MoveAbsolute(-6.f, .5f, -30.f);
-	ghostEntities[1]->GetTransform()->MoveAbsolute(-3.f,.5f, -24.f);
-	
-	route1[0]->GetTransform()->MoveAbsolute(-8.5f, 1.5f, -35.f);
-	route1[0]->GetTransform()->SetScale(.25f, .25f, .25f);
-
-	route1[1]->GetTransform()->MoveAbsolute(-15.f, 1.5f, -35.f);
-	route1[1]->GetTransform()->SetScale(.25f, .25f, .25f);
-
-	route1[2]->GetTransform()->MoveAbsolute(-16.f, 1.5f, -30.f);
-	route1[2]->GetTransform()->SetScale(.25f, .25f, .25f);
-
-	route1[3]->GetTransform()->MoveAbsolute(-8.f, 1.5f, -27.f);
-	route1[3]->GetTransform()->SetScale(.25f, .25f, .25f);
-
-	route1[4]->GetTransform()->MoveAbsolute(-2.f, 1.5f, -29.f);
-	route1[4]->GetTransform()->SetScale(.25f, .25f, .25f);
-
-	route2[0]->GetTransform()->MoveAbsolute(-2.f, 1.5f, -20.f);
-	route2[0]->GetTransform()->SetScale(.25f, .25f, .25f);
+	// the simulation places and moves the entities through their transforms
+	SimulationScene scene;
+	scene.player = playerCamera;
+	for (Entity* entity : entities)
+	{
+		scene.entities.push_back(entity->GetTransform());
+	}
 
-	route2[1]->GetTransform()->MoveAbsolute(0.f, 1.5f, -13.5f);
-	route2[1]->GetTransform()->SetScale(.25f, .25f, .25f);
+	for (Entity* ghost : ghostEntities)
+	{
+		scene.ghosts.push_back(ghost->GetTransform());
+	}
 
-	route2[2]->GetTransform()->MoveAbsolute(-8.f, 1.5f, -12.f);
-	route2[2]->GetTransform()->SetScale(.25f, .25f, .25f);
+	for (Entity* waypoint : waypoints)
+	{
+		scene.waypoints.push_back(waypoint->GetTransform());
+	}
 
-	route2[3]->GetTransform()->MoveAbsolute(-16.3f, 1.5f, -14.f);
-	route2[3]->GetTransform()->SetScale(.25f, .25f, .25f);
+	simulation->BeginPlay(*sceneData, scene, GetFullPathTo("../../Assets/Models/Rooms/Level.snav"));
 
-	route2[4]->GetTransform()->MoveAbsolute(-13.5f, 1.5f, -20.f);
-	route2[4]->GetTransform()->SetScale(.25f, .25f, .25f);
+	if (!recordingFileName.empty())
+	{
+		inputRecording = new InputRecording(SIMULATION_TICKS_PER_SECOND);
+		inputSystem->StartRecording(inputRecording);
+	}
 }
 
 // ghostEntities are all transparent
 void Game::SortAndRenderTransparentEntities()
 {
-	ghostEntities[0]->GetMaterial()->GetVertexShader()->SetShader();
-	ghostEntities[0]->GetMaterial()->GetPixelShader()->SetShader();
 	// Turn on the blend state
 	context->OMSetBlendState(blendState, 0, UINT_MAX);
 
-	auto camTransform = playerCamera->GetTransform();
-	std::sort(ghostEntities.begin(), ghostEntities.end(), [&](const auto& lhs, const auto& rhs)
+	// sorted by where they're drawn, which can be between ticks
+	XMFLOAT3 eye = playerCamera->GetTransform()->GetRenderPosition();
+	auto sqDistance = [&](Entity* entity)
+	{
+		XMFLOAT3 position = entity->GetTransform()->GetRenderPosition();
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&position), XMLoadFloat3(&eye));
+		return XMVectorGetX(XMVector3LengthSq(offset));
+	};
+	transparentEntities.assign(ghostEntities.begin(), ghostEntities.end());
+	std::sort(transparentEntities.begin(), transparentEntities.end(), [&](const auto& lhs, const auto& rhs)
 		{
-			return (camTransform->DistanceSquaredTo(lhs->GetTransform()->GetPosition()) > camTransform->DistanceSquaredTo(rhs->GetTransform()->GetPosition()));
+			return sqDistance(lhs) > sqDistance(rhs);
 		});
 
-	for (auto& ghost : ghostEntities)
+	// Instances keep the sorted order, so they still blend back to front
+	instancedRenderer->Begin();
+	for (auto& ghost : transparentEntities)
 	{
-		ghost->DrawTransparent(context.Get(), playerCamera);
+		if (frustumCuller->IsVisible(ghost))
+		{
+			instancedRenderer->Submit(ghost);
+		}
 	}
+	instancedRenderer->Flush(context.Get(), playerCamera);
 
 	context->OMSetBlendState(nullptr, 0, UINT_MAX);
 }
@@ -580,52 +479,29 @@ void Game::Update(float deltaTime, float totalTime)
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 
-	// Handle input
-	inputSystem->Frame(deltaTime, playerCamera);
-
-	if(entities.size() == 0) 
-	{
-		return;
-	}
-
-	float sinTime = (float)sin(totalTime);
-	float offset = (sinTime*deltaTime);
-
-	entities[0]->GetTransform()->MoveAbsolute(-offset/3.f, offset/5.f, 0);
-	entities[0]->GetTransform()->SetPosition(
-		entities[0]->GetTransform()->GetPosition().x,
-		entities[0]->GetTransform()->GetPosition().y, -.01f
-	);
-
-	entities[1]->GetTransform()->MoveAbsolute(0, offset, 0);
-
-	entities[2]->GetTransform()->Rotate(0,  1.f * deltaTime, 0);
-	
-	entities[3]->GetTransform()->MoveAbsolute(0,0, offset*2.f);
-	entities[3]->GetTransform()->MoveAbsolute(offset/2.f, -offset/2.f, 0);
-	entities[3]->GetTransform()->Rotate(-1.5f * deltaTime, 0, 0);
+	// input, the shapes, the ghosts and their lights, and the vignette
+	simulation->Tick(deltaTime, totalTime, inputSystem);
+}
 
-	entities[4]->GetTransform()->Rotate(0, 0,  offset*2.f);
-	
-	// Vignette Calculation
-	float	distToLight;
-	int	lightType;
-	float	lightRange;
-	bool	inLight = PlayerInLight(&distToLight, &lightType, &lightRange);
-	CalculateVignette(inLight, distToLight, lightType, lightRange);
-	
-	for (SimpleAI* ai : aiGhosts)
+// --------------------------------------------------------
+// Hands the state of the last tick over to Draw, which may
+// be running on another thread
+// --------------------------------------------------------
+void Game::PublishSnapshot(double tickTime)
+{
+	SimulationSnapshot& snapshot = snapshots->GetBack();
+	snapshot.time = tickTime;
+	TransformSystem::Get().CopyWorldMatrices(snapshot.worldMatrices);
+	snapshot.lights.assign(simulation->GetLights(), simulation->GetLights() + simulation->GetLightCount());
+	snapshot.vignette = simulation->GetVignette();
+
+	AISystem* aiSystem = simulation->GetAISystem();
+	snapshot.agentStates.resize(aiSystem->GetAgentCount());
+	for (uint32_t agent = 0; agent < aiSystem->GetAgentCount(); agent++)
 	{
-		ai->Update(inLight, deltaTime);
+		snapshot.agentStates[agent] = (uint8_t)aiSystem->GetAgentState(agent);
 	}
-
-	lights[0].position = aiGhosts[0]->self->GetTransform()->GetPosition();
-	lights[0].position.y = 1.5f;
-	
-	lights[1].position = aiGhosts[1]->self->GetTransform()->GetPosition();
-	lights[1].position.y = 1.5f;	
-
-	playerCamera->UpdateViewMatrix();
+	snapshots->Publish();
 }
 
 // --------------------------------------------------------
@@ -633,6 +509,40 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	// blend between the last two ticks, everything below draws from
+	// these and never reads what the simulation is changing
+	snapshots->Acquire();
+	float blend = snapshots->GetBlend(GetRenderTime());
+	snapshots->InterpolateMatrices(blend, renderMatrices);
+	TransformSystem::Get().SwapRenderMatrices(renderMatrices);
+	snapshots->InterpolateLights(blend, renderLights);
+	VignetteData vignette = snapshots->GetCurrent().vignette;
+
+	// each ghost turns red while its own agent is chasing the player
+	const std::vector<uint8_t>& agentStates = snapshots->GetCurrent().agentStates;
+	for (size_t i = 0; i < ghostEntities.size() && i < agentStates.size(); i++)
+	{
+		if (agentStates[i] == (uint8_t)AI_State::ATTACK_PLAYER)
+		{
+			XMFLOAT4 tint = ghostEntities[i]->GetMaterial()->GetColorTint();
+			ghostEntities[i]->SetColorTint(XMFLOAT4(1.f, .1f, .1f, tint.w));
+		}
+		else
+		{
+			ghostEntities[i]->ClearColorTint();
+		}
+	}
+
+	// upload any mips that finished streaming, the materials pick them up through their handles
+	textureRegistry->Update(device.Get(), context.Get());
+
+	playerCamera->UpdateViewMatrix();
+
+	// bin the lights now that they and the camera are placed, the slices are
+	// spread over the job system and all done when Build() returns, Upload()
+	// below only copies the results to the GPU
+	clusteredLighting->Build(renderLights.data(), (int)renderLights.size(), playerCamera->GetViewMatrix(), playerCamera->GetProjectionMatrix());
+
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
 
@@ -647,84 +557,80 @@ void Game::Draw(float deltaTime, float totalTime)
 		0);
 
 	// Clear post process target too
-	context->ClearRenderTargetView(ppRTV.Get(), color);
+	ID3D11RenderTargetView* sceneTarget = postProcess->GetSceneTarget();
+	context->ClearRenderTargetView(sceneTarget, color);
 	
 	// --- Post Processing - Pre-Draw ---------------------
 	{
 		// Change the render target
-		context->OMSetRenderTargets(1, ppRTV.GetAddressOf(), depthStencilView.Get());
+		context->OMSetRenderTargets(1, &sceneTarget, depthStencilView.Get());
 	}
 
 	// since they are all shared we don't need to individually set it per entity
-	normalPS->SetData("lights", (void*)(lights), sizeof(Light) * lightsInScene);
-	normalPS->SetInt("lightCount", lightsInScene);
-	normalPS->SetFloat3("cameraPosition", playerCamera->GetTransform()->GetPosition());
+	vertexShader->SetMatrix4x4("view", playerCamera->GetViewMatrix());
+	vertexShader->SetMatrix4x4("proj", playerCamera->GetProjectionMatrix());
+
+	normalVS->SetMatrix4x4("view", playerCamera->GetViewMatrix());
+	normalVS->SetMatrix4x4("proj", playerCamera->GetProjectionMatrix());
+
+	// the light clusters were built above, so each pixel only loops over nearby lights
+	clusteredLighting->Upload(width, height);
+
+	normalPS->SetData("lights", (void*)(renderLights.data()), (unsigned int)(sizeof(Light) * renderLights.size()));
+	normalPS->SetFloat3("cameraPosition", playerCamera->GetTransform()->GetRenderPosition());
+	clusteredLighting->Bind(normalPS);
 	normalPS->CopyAllBufferData();
 
-	pixelShader->SetData("lights", (void*)(lights), sizeof(Light) * lightsInScene);
-	pixelShader->SetInt("lightCount", lightsInScene);
-	pixelShader->SetFloat3("cameraPosition", playerCamera->GetTransform()->GetPosition());
+	pixelShader->SetData("lights", (void*)(renderLights.data()), (unsigned int)(sizeof(Light) * renderLights.size()));
+	pixelShader->SetFloat3("cameraPosition", playerCamera->GetTransform()->GetRenderPosition());
+	clusteredLighting->Bind(pixelShader);
 	pixelShader->CopyAllBufferData();
 
+	// anything outside the view never makes it into the queues
+	frustumCuller->Update(playerCamera->GetViewMatrix(), playerCamera->GetProjectionMatrix());
+
+	// sorted by shader, material and mesh so only the changes get bound
+	renderQueue->Clear();
 	for (Entity* entity : entities)
 	{
-		// detect if light affects the material
-		Material* entityMat = entity->GetMaterial();
-		entityMat->GetVertexShader()->SetShader();
-		entityMat->GetPixelShader()->SetShader();
+		if (frustumCuller->IsVisible(entity))
+		{
+			renderQueue->Submit(entity, playerCamera);
+		}
+	}
+	renderQueue->Sort();
 
-		entity->Draw(context.Get(), playerCamera);
+	D3D11RenderBackend backend(context.Get(), playerCamera, blendState);
+	renderQueue->Execute(backend);
+#if defined(DEBUG) || defined(_DEBUG)
+	// Once a second is plenty to see what the sorting saves
+	if (totalTime >= nextRenderStatsTime)
+	{
+		renderQueue->PrintStats();
+		nextRenderStatsTime = totalTime + 1.f;
 	}
+#endif
 
 
 	if(bDrawWaypoints) 
 	{
-		route1[0]->GetMaterial()->GetPixelShader()->SetShader();
-		for(Entity* route : route1) 
+		// waypoints sharing a mesh and material are drawn in one call
+		instancedRenderer->Begin();
+		for (Entity* waypoint : waypoints)
 		{
-			route->DrawTransparent(context.Get(), playerCamera);
-		}
-		for (Entity* route : route2)
-		{
-			route->DrawTransparent(context.Get(), playerCamera);
+			if (frustumCuller->IsVisible(waypoint))
+			{
+				instancedRenderer->Submit(waypoint);
+			}
 		}
+		instancedRenderer->Flush(context.Get(), playerCamera);
 	}
 
 	SortAndRenderTransparentEntities();
 
 	// --- Post processing - Post-Draw -----------------------
-	{
-		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), 0);
-
-		// Set up post process shaders
-		ppVS->SetShader();
-
-		ppPS->SetShaderResourceView("pixels", ppSRV.Get());
-		ppPS->SetSamplerState("samplerOptions", textureSampler);
-		ppPS->SetShader();
-
-		ppData.ppgData.width = 1.f / width;
-		ppData.ppgData.height = 1.f / height;
-		ppPS->SetData("vignetteData", (void*)&ppData, sizeof(VignetteData));
-		ppPS->CopyAllBufferData();
-
-		// Turn OFF vertex and index buffers
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		ID3D11Buffer* nothing = 0;
-		context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
-		context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
-
-		// Draw exactly 3 vertices for our "full screen triangle"
-		context->Draw(3, 0);
-
-
-		// Unbind shader resource views at the end of the frame,
-		// since we'll be rendering into one of those textures
-		// at the start of the next
-		ID3D11ShaderResourceView* nullSRVs[16] = {};
-		context->PSSetShaderResources(0, 16, nullSRVs);
-	}
+	// every effect that's on, the last one draws into the back buffer
+	postProcess->Execute(backBufferRTV.Get(), vignette, totalTime);
 
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
@@ -738,86 +644,6 @@ void Game::Draw(float deltaTime, float totalTime)
 
 void Game::ResizePostProcessResources()
 {
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = width;
-	textureDesc.Height = height;
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // Will render to it and sample from it!
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	ID3D11Texture2D* ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, &ppTexture);
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-	device->CreateRenderTargetView(ppTexture, &rtvDesc, ppRTV.ReleaseAndGetAddressOf());
-
-	// Create the Shader Resource View
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = textureDesc.Format;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-
-	device->CreateShaderResourceView(ppTexture, &srvDesc, ppSRV.ReleaseAndGetAddressOf());
-
-	// We don't need the texture reference itself no mo'
-	ppTexture->Release();
-}
-
-// --------------------------------------------------------
-// Calculate the vignette opacity and pass to post processing
-// --------------------------------------------------------
-void Game::CalculateVignette(bool inLight, float sqDist, int lightType, float lightRange)
-{
-	// Only point lights affect vignette
-	if (!inLight || lightType != LIGHT_TYPE_POINT)
-	{
-		ppData.opacity = .95f;
-		return;
-	}
-
-	// Calculate vignette based on light range
-	ppData.opacity = (sqDist / lightRange) - .05f;
+	// the pooled targets only change if the size did
+	postProcess->Resize(width, height);
 }
-
-// --------------------------------------------------------
-// Iterate through all lights, and return information about
-// any lights the player is standing in.
-// --------------------------------------------------------
-bool Game::PlayerInLight(_Out_ float* _sqDist, _Out_ int* _lightType, _Out_ float* _sqLightRange)
-{
-	// Return true if player is within the range of any light
-	for (int i = 0; i < lightsInScene; ++i)
-	{
-		float SqLightRange = lights[i].range * lights[i].range;
-		XMFLOAT3 lightPos = lights[i].position;
-		float sqDistToLight = playerCamera->GetTransform()->DistanceSquaredTo(lightPos);
-
-		if (sqDistToLight < SqLightRange)
-		{
-			// If in light range, return light type and distance to light thru params
-			// some processes like vignette need this info
-			*_sqDist = sqDistToLight;
-			*_lightType = lights[i].type;
-			*_sqLightRange = SqLightRange;
-			return true;
-		}
-	}
-	// If false, return clearly invalid values to each 
-	*_sqDist = -1.0f;
-	*_lightType = -1;
-	*_sqLightRange = -1.0f;
-
-	return false;
-}
\ No newline at end of file
@@ -3,15 +3,18 @@
 #include "DXCore.h"
 #include <wrl/client.h>
 #include <vector>
+#include <string>
 #include "Lights.h"
 #include "PostProcessData.h"
 
-#define MAX_LIGHTS_IN_SCENE 128
+// the level the game loads, relative to the executable
+#define GAME_SCENE_FILE "../../Assets/Scenes/Level.scene"
 
-#define LIGHT_TYPE_DIR 0
-#define LIGHT_TYPE_POINT 1
-#define LIGHT_TYPE_SPOT 2
-#define LIGHT_TYPE_AMBIENT 3
+// the simulation runs at this fixed rate, rendering blends between its ticks
+#define SIMULATION_TICKS_PER_SECOND 60
+
+// runs Update on its own thread, Draw only reads the snapshots it hands over
+#define SIMULATION_ON_OWN_THREAD false
 
 class Mesh;
 class Entity;
@@ -19,7 +22,14 @@ class Camera;
 class Material;
 class SimplePixelShader;
 class SimpleVertexShader;
-class SimpleAI;
+class InstancedRenderer;
+class RenderQueue;
+class ClusteredLighting;
+class SnapshotBuffer;
+class GameSimulation;
+class InputRecording;
+class TextureRegistry;
+class PostProcessChain;
 
 class Game 
 	: public DXCore
@@ -30,21 +40,22 @@ public:
 	~Game();
 
 	// Overridden setup and game loop methods
-	void Init();
+	bool Init();
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
+	void PublishSnapshot(double tickTime);
+
+	// Saves every tick's input to the file on exit, for the headless runner to replay
+	inline void RecordInputTo(const std::string& fileName) { recordingFileName = fileName; }
 
 private:
 
 	// Initialization helper methods
 	void LoadShaders(); 
-	void CreateBasicGeometry();
+	bool CreateBasicGeometry();
 	void ResizePostProcessResources();
 
-	// AI helpers
-	bool PlayerInLight(_Out_ float* sqDist, _Out_ int* lightType, _Out_ float* sqLightRange);
-
 	// Shaders and shader-related constructs
 	class SimplePixelShader* pixelShader = nullptr;
 	class SimpleVertexShader* vertexShader = nullptr;
@@ -54,62 +65,91 @@ private:
 
 	class SimplePixelShader* solidColorTransparentPS = nullptr;
 
+	// Shaders for entities drawn through the instanced renderer
+	class SimpleVertexShader* instancedVS = nullptr;
+	class SimplePixelShader* instancedColorPS = nullptr;
+
+	/**
+	 * Batches entities sharing a mesh and material into instanced draws
+	 */
+	class InstancedRenderer* instancedRenderer = nullptr;
+
+	/**
+	 * Sorts the opaque entities to skip redundant state changes
+	 */
+	class RenderQueue* renderQueue = nullptr;
+	float nextRenderStatsTime = 0;	// When debug builds next print the queue's stats
+
+	/**
+	 * Bins lights into view space clusters for the lighting shaders
+	 */
+	class ClusteredLighting* clusteredLighting = nullptr;
+
+	/**
+	 * Skips entities that are outside the camera's view
+	 */
+	class FrustumCuller* frustumCuller = nullptr;
+
 	/**
 	 * The current active blend state used for ghostEntities
 	 */
 	ID3D11BlendState* blendState = nullptr;
 
 	//texture stuff
-	ID3D11ShaderResourceView* srvBrick;
-	ID3D11ShaderResourceView* srvMetal;
-	ID3D11ShaderResourceView* srvRock;
-	ID3D11ShaderResourceView* srvRockNormal;
-	ID3D11ShaderResourceView* srvCushion;
-	ID3D11ShaderResourceView* srvCushionNormal;
-	ID3D11SamplerState* textureSampler;
+	ID3D11SamplerState* textureSampler = nullptr;
 
-	/**
-	 * Stealth Game Related textures go here
-	 */
-	ID3D11ShaderResourceView* srvBlueprintDefault;
-	ID3D11ShaderResourceView* srvBlueprintOrange;
-	ID3D11ShaderResourceView* srvBlueprintBlue;
-	ID3D11ShaderResourceView* srvBlueprintGray;
-	ID3D11ShaderResourceView* srvBlueprintGreen;
+	// every loaded texture, the materials hold handles into it
+	class TextureRegistry* textureRegistry = nullptr;
 
 	std::vector<class Entity*> entities;
 	std::vector<class Material*> materials;
 	std::vector<class Mesh*> meshes;
 
+	// in the order of their agents in the AISystem
 	std::vector<class Entity*> ghostEntities;
 
-	// requires a built entity to control
-	std::vector<class SimpleAI*> aiGhosts;
+	// the ghosts sorted back to front for blending, rebuilt every frame
+	std::vector<class Entity*> transparentEntities;
+
+	// moves everything above, the same logic the headless runner ticks
+	class GameSimulation* simulation = nullptr;
 
-	std::vector<class Entity*> route1;
-	std::vector<class Entity*> route2;
+	// every route's waypoints, parallel to the scene's waypoints
+	std::vector<class Entity*> waypoints;
+
+	// what the level starts out as, the meshes, materials and entities above are made from it
+	struct SceneData* sceneData = nullptr;
 
 	/**
 	 * DEBUG items
 	 */
 	bool bDrawWaypoints = false;
 
-	struct Light* lights = nullptr; // all the lights
-	int lightsInScene = 0;
-
 	class Camera* playerCamera = nullptr;
 
-	// Post processing resources
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ppRTV;		// Allows us to render to a texture
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ppSRV;		// Allows us to sample from the same texture
-	SimpleVertexShader* ppVS;
-	SimplePixelShader* ppPS;
+	// each tick's state handed over to Draw, which blends the last two
+	class SnapshotBuffer* snapshots = nullptr;
+	std::vector<DirectX::XMFLOAT4X4> renderMatrices;
+	std::vector<struct Light> renderLights;
+
+	// the input of every tick, when recording
+	class InputRecording* inputRecording = nullptr;
+	std::string recordingFileName;
 
-	// Vignette variables
-	struct VignetteData ppData;
+	// Post processing shaders, the chain runs whichever effects are on
+	SimpleVertexShader* ppVS = nullptr;
+	SimplePixelShader* copyPS = nullptr;
+	SimplePixelShader* bloomExtractPS = nullptr;
+	SimplePixelShader* bloomBlurPS = nullptr;
+	SimplePixelShader* tonemapPS = nullptr;
+	SimplePixelShader* fxaaPS = nullptr;
+
+	/**
+	 * Owns the pooled render targets the scene and the effects draw into
+	 */
+	class PostProcessChain* postProcess = nullptr;
 
 protected:
 	virtual void BeginPlay();
 	virtual void SortAndRenderTransparentEntities();
-	void CalculateVignette(bool inLight, float sqDist, int lightType, float lightRange);
 };
\ No newline at end of file
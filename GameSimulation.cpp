@@ -0,0 +1,342 @@
+#include "GameSimulation.h"
+#include "Camera.h"
+#include "Transform.h"
+#include "TransformSystem.h"
+#include "AISystem.h"
+#include "SpatialGrid.h"
+#include "NavMesh.h"
+#include "MeshCache.h"
+#include "InputSystem.h"
+#include "SceneFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+
+using namespace DirectX;
+
+GameSimulation::GameSimulation()
+{
+	lights = new Light[MAX_LIGHTS_IN_SCENE]();
+	lightGrid = new SpatialGrid(LIGHT_GRID_CELL_SIZE);
+
+	ppData = {};
+	ppData.opacity = .95f;
+	ppData.innerRadius = 0.2f;
+	ppData.outerRadius = .6f;
+
+	aiSystem = new AISystem();
+}
+
+GameSimulation::~GameSimulation()
+{
+	delete aiSystem;
+	delete navMesh;
+	delete lightGrid;
+	delete[] lights;
+
+	for (const LightAnchor& anchor : lightAnchors)
+	{
+		delete anchor.anchor;
+	}
+}
+
+void GameSimulation::BeginPlay(const SceneData& data, const SimulationScene& scene, const std::string& navMeshCachePath)
+{
+	this->scene = scene;
+
+	if (scene.entities.size() != data.entities.size() || scene.ghosts.size() != data.ghosts.size() ||
+		scene.waypoints.size() != data.waypoints.size())
+		return;
+
+	auto place = [](Transform* transform, const SceneTransform& start)
+	{
+		transform->SetPosition(start.position.x, start.position.y, start.position.z);
+		transform->SetRotation(start.rotation.x, start.rotation.y, start.rotation.z);
+		transform->SetScale(start.scale.x, start.scale.y, start.scale.z);
+	};
+
+	place(scene.player->GetTransform(), data.player);
+
+	for (size_t i = 0; i < data.entities.size(); i++)
+	{
+		place(scene.entities[i], data.entities[i].transform);
+
+		if (data.entities[i].group == SceneGroup::Shape)
+		{
+			shapes.push_back(scene.entities[i]);
+			continue;
+		}
+
+		level.push_back(scene.entities[i]);
+		levelFiles.push_back(data.GetPath(data.meshes[data.entities[i].mesh].path));
+	}
+
+	for (size_t i = 0; i < data.ghosts.size(); i++)
+	{
+		place(scene.ghosts[i], data.ghosts[i].transform);
+	}
+
+	// each route's waypoints are drawn where the ghosts walk
+	std::vector<uint32_t> aiRoutes;
+	for (const SceneRoute& route : data.routes)
+	{
+		for (uint32_t i = route.firstWaypoint; i < route.firstWaypoint + route.waypointCount; i++)
+		{
+			const XMFLOAT3& point = data.waypoints[i];
+			scene.waypoints[i]->SetPosition(point.x, point.y, point.z);
+			scene.waypoints[i]->SetScale(route.waypointScale, route.waypointScale, route.waypointScale);
+		}
+
+		aiRoutes.push_back(aiSystem->AddRoute(&data.waypoints[route.firstWaypoint], route.waypointCount));
+	}
+
+	for (size_t i = 0; i < data.ghosts.size(); i++)
+	{
+		aiSystem->AddAgent(scene.ghosts[i], aiRoutes[data.ghosts[i].route]);
+	}
+
+	// the simulation moves every light, only as many as it holds
+	lightsInScene = (int)(std::min)(data.lights.size(), (size_t)MAX_LIGHTS_IN_SCENE);
+	std::copy(data.lights.begin(), data.lights.begin() + lightsInScene, lights);
+
+	// linked lights float along with their ghost
+	for (const SceneLightLink& link : data.lightLinks)
+	{
+		if ((int)link.light >= lightsInScene)
+			continue;
+
+		Transform* anchor = new Transform();
+		anchor->SetParent(scene.ghosts[link.ghost]);
+		anchor->SetPosition(link.offset.x, link.offset.y, link.offset.z);
+		lightAnchors.push_back({ (int)link.light, anchor });
+	}
+	UpdateLightGrid();
+
+	// the ghosts walk between their waypoints and to the player on the nav mesh
+	BuildNavMesh(navMeshCachePath);
+	aiSystem->SetNavMesh(navMesh);
+
+	TransformSystem::Get().UpdateWorldMatrices();
+}
+
+void GameSimulation::SetDeterministic(bool deterministic)
+{
+	aiSystem->SetDeterministic(deterministic);
+}
+
+// --------------------------------------------------------
+// Loads the baked nav mesh, or builds and bakes it if the
+// level changed since. Call once the level is placed.
+// --------------------------------------------------------
+void GameSimulation::BuildNavMesh(const std::string& cachePath)
+{
+	NavMeshSettings settings;
+
+	// the bake is only valid for the same files in the same places
+	std::vector<uint64_t> sourceKey;
+	sourceKey.push_back(HashBytes(&settings, sizeof(settings)));
+	for (size_t i = 0; i < level.size(); i++)
+	{
+		XMFLOAT4X4 world = level[i]->GetWorldMatrix();
+		sourceKey.push_back(HashFile(levelFiles[i].c_str()));
+		sourceKey.push_back(HashBytes(&world, sizeof(world)));
+	}
+	uint64_t sourceHash = HashBytes(sourceKey.data(), sourceKey.size() * sizeof(uint64_t));
+
+	navMesh = new NavMesh();
+	if (navMesh->Load(cachePath.c_str(), sourceHash))
+	{
+		return;
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+#endif
+
+	// world space triangles of everything in the level
+	std::vector<XMFLOAT3> triangles;
+	for (size_t i = 0; i < level.size(); i++)
+	{
+		MeshSource source;
+		if (!source.Load(levelFiles[i].c_str()))
+			continue;
+
+		XMFLOAT4X4 world = level[i]->GetWorldMatrix();
+		XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+		for (unsigned int index = 0; index < source.GetIndexCount(); index++)
+		{
+			XMFLOAT3 corner;
+			XMStoreFloat3(&corner, XMVector3TransformCoord(XMLoadFloat3(&source.GetVertices()[source.GetIndices()[index]].Position), worldMatrix));
+			triangles.push_back(corner);
+		}
+	}
+
+	navMesh->Build(triangles.data(), triangles.size() / 3, settings);
+	navMesh->Save(cachePath.c_str(), sourceHash);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Nav mesh: %dx%d cells, %d walkable, built from %u triangles in %.2f ms\n",
+		navMesh->GetWidth(), navMesh->GetDepth(), navMesh->GetWalkableCellCount(), (unsigned int)(triangles.size() / 3),
+		std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+#endif
+}
+
+void GameSimulation::Tick(float deltaTime, float totalTime, Input::InputSystem* input)
+{
+	// Handle input
+	input->Frame(deltaTime, scene.player);
+
+	// The demo shapes only animate when the scene has all five of them,
+	// the rest of the tick runs either way
+	if (shapes.size() >= 5)
+	{
+		float sinTime = (float)sin(totalTime);
+		float offset = (sinTime*deltaTime);
+
+		shapes[0]->MoveAbsolute(-offset/3.f, offset/5.f, 0);
+		shapes[0]->SetPosition(
+			shapes[0]->GetPosition().x,
+			shapes[0]->GetPosition().y, -.01f
+		);
+
+		shapes[1]->MoveAbsolute(0, offset, 0);
+
+		shapes[2]->Rotate(0,  1.f * deltaTime, 0);
+
+		shapes[3]->MoveAbsolute(0,0, offset*2.f);
+		shapes[3]->MoveAbsolute(offset/2.f, -offset/2.f, 0);
+		shapes[3]->Rotate(-1.5f * deltaTime, 0, 0);
+
+		shapes[4]->Rotate(0, 0,  offset*2.f);
+	}
+
+	// Vignette Calculation
+	float	distToLight;
+	int	lightType;
+	float	lightRange;
+	bool	inLight = PlayerInLight(&distToLight, &lightType, &lightRange);
+	CalculateVignette(inLight, distToLight, lightType, lightRange);
+	
+	// every ghost patrols or chases in one batched pass, the results are
+	// copied to their transforms before the sweep below
+	aiSystem->Update(scene.player->GetTransform()->GetPosition(), inLight, deltaTime);
+
+	// rebuild every world matrix that changed this tick in one pass,
+	// children like the light anchors get moved along with their parents
+	TransformSystem::Get().UpdateWorldMatrices();
+
+	for (const LightAnchor& anchor : lightAnchors)
+	{
+		lights[anchor.light].position = anchor.anchor->GetWorldPosition();
+	}
+
+	// next tick's PlayerInLight sees the lights where they were drawn
+	UpdateLightGrid();
+}
+
+uint64_t GameSimulation::HashState()
+{
+	std::vector<float> values;
+	auto addTransform = [&](Transform* transform)
+	{
+		XMFLOAT3 position = transform->GetPosition();
+		XMFLOAT4 rotation = transform->GetRotationQuaternion();
+		XMFLOAT3 scale = transform->GetScale();
+		values.insert(values.end(), { position.x, position.y, position.z, rotation.x, rotation.y, rotation.z, rotation.w, scale.x, scale.y, scale.z });
+	};
+
+	addTransform(scene.player->GetTransform());
+	for (Transform* shape : shapes)
+	{
+		addTransform(shape);
+	}
+	for (Transform* ghost : scene.ghosts)
+	{
+		addTransform(ghost);
+	}
+
+	// the light structs have padding, so only the values
+	for (int i = 0; i < lightsInScene; i++)
+	{
+		values.insert(values.end(), { lights[i].position.x, lights[i].position.y, lights[i].position.z });
+	}
+	values.push_back(ppData.opacity);
+
+	for (uint32_t agent = 0; agent < aiSystem->GetAgentCount(); agent++)
+	{
+		values.push_back((float)aiSystem->GetAgentState(agent));
+	}
+
+	return HashBytes(values.data(), values.size() * sizeof(float));
+}
+
+void GameSimulation::CalculateVignette(bool inLight, float sqDist, int lightType, float lightRange)
+{
+	// Only point lights affect vignette
+	if (!inLight || lightType != LIGHT_TYPE_POINT)
+	{
+		ppData.opacity = .95f;
+		return;
+	}
+
+	// Calculate vignette based on light range
+	ppData.opacity = (sqDist / lightRange) - .05f;
+}
+
+// --------------------------------------------------------
+// Iterate through all lights, and return information about
+// any lights the player is standing in.
+// --------------------------------------------------------
+bool GameSimulation::PlayerInLight(_Out_ float* _sqDist, _Out_ int* _lightType, _Out_ float* _sqLightRange)
+{
+	XMFLOAT3 playerPos = scene.player->GetTransform()->GetPosition();
+
+	// Only the lights whose range reaches the player's cell, sorted by index
+	// so the first hit is the same light the full scan used to find
+	lightGrid->Query(playerPos, 0.f, nearbyLights);
+
+	// Return true if player is within the range of any light
+	for (uint32_t i : nearbyLights)
+	{
+		float SqLightRange = lights[i].range * lights[i].range;
+		XMFLOAT3 lightPos = lights[i].position;
+		float sqDistToLight = scene.player->GetTransform()->DistanceSquaredTo(lightPos);
+
+		if (sqDistToLight < SqLightRange)
+		{
+			// If in light range, return light type and distance to light thru params
+			// some processes like vignette need this info
+			*_sqDist = sqDistToLight;
+			*_lightType = lights[i].type;
+			*_sqLightRange = SqLightRange;
+			return true;
+		}
+	}
+	// If false, return clearly invalid values to each 
+	*_sqDist = -1.0f;
+	*_lightType = -1;
+	*_sqLightRange = -1.0f;
+
+	return false;
+}
+
+// --------------------------------------------------------
+// Bins every light with a range so PlayerInLight only has
+// to check the ones near the player
+// --------------------------------------------------------
+void GameSimulation::UpdateLightGrid()
+{
+	lightGrid->Clear();
+	for (int i = 0; i < lightsInScene; ++i)
+	{
+		// ambient and directional lights never set a range
+		if (lights[i].type != LIGHT_TYPE_POINT && lights[i].type != LIGHT_TYPE_SPOT)
+		{
+			continue;
+		}
+
+		lightGrid->Insert((uint32_t)i, lights[i].position, lights[i].range);
+	}
+	lightGrid->Build();
+}
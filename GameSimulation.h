@@ -0,0 +1,110 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Lights.h"
+#include "PostProcessData.h"
+#include "Platform.h"
+
+#define MAX_LIGHTS_IN_SCENE 128
+
+// about the range of the bigger lights
+#define LIGHT_GRID_CELL_SIZE 8.f
+
+class Camera;
+class Transform;
+class AISystem;
+class SpatialGrid;
+class NavMesh;
+struct SceneData;
+
+namespace Input { class InputSystem; }
+
+// --------------------------------------------------------
+// The transforms the simulation places and moves, owned by
+// whoever draws them, one for each item of the SceneData
+// they were made from
+// --------------------------------------------------------
+struct SimulationScene
+{
+	Camera* player = nullptr;
+	std::vector<Transform*> entities;	// Parallel to the scene's entities
+	std::vector<Transform*> ghosts;		// Parallel to its ghosts
+	std::vector<Transform*> waypoints;	// Parallel to its waypoints
+};
+
+// --------------------------------------------------------
+// The game's logic without any of the rendering: moving
+// the player, the demo shapes, the ghosts and their lights,
+// and the vignette
+//
+// - Only needs transforms, so the windowed game runs it on
+//   its entities and the headless runner on bare transforms
+// - A tick depends only on the state, the input and the
+//   delta time. With SetDeterministic() the AI budgets count
+//   work instead of time, so a recorded input stream always
+//   replays to the same states. HashState() sums a state up
+//   for comparing runs.
+// --------------------------------------------------------
+class GameSimulation
+{
+public:
+	GameSimulation();
+	~GameSimulation();
+
+	// Places the scene where the data starts it, sets up its lights, puts the
+	// ghosts on their routes and loads the nav mesh from the cache path, or
+	// bakes it there if the level changed
+	void BeginPlay(const SceneData& data, const SimulationScene& scene, const std::string& navMeshCachePath);
+
+	void SetDeterministic(bool deterministic);
+
+	void Tick(float deltaTime, float totalTime, Input::InputSystem* input);
+
+	// FNV-1a over the player, the shapes, the ghosts, the lights and the vignette
+	uint64_t HashState();
+
+	inline const Light* GetLights() const { return lights; }
+	inline int GetLightCount() const { return lightsInScene; }
+	inline const VignetteData& GetVignette() const { return ppData; }
+	inline AISystem* GetAISystem() { return aiSystem; }
+	inline const NavMesh* GetNavMesh() const { return navMesh; }
+
+private:
+	void BuildNavMesh(const std::string& cachePath);
+
+	bool PlayerInLight(_Out_ float* sqDist, _Out_ int* lightType, _Out_ float* sqLightRange);
+	void UpdateLightGrid();
+	void CalculateVignette(bool inLight, float sqDist, int lightType, float lightRange);
+
+	SimulationScene scene;
+	std::vector<Transform*> shapes;		// The demo shapes that bob and spin
+	std::vector<Transform*> level;		// The rooms and their props
+	std::vector<std::string> levelFiles;	// Full paths, parallel to level
+
+	// moves the ghosts
+	AISystem* aiSystem = nullptr;
+
+	// where the ghosts can walk, baked from the rooms and their props
+	NavMesh* navMesh = nullptr;
+
+	// children of the ghosts, the lights linked to them follow these
+	struct LightAnchor
+	{
+		int light;
+		Transform* anchor;
+	};
+	std::vector<LightAnchor> lightAnchors;
+
+	Light* lights = nullptr; // all the lights
+	int lightsInScene = 0;
+
+	// the lights' ranges binned by position, rebuilt whenever they move
+	SpatialGrid* lightGrid = nullptr;
+	std::vector<uint32_t> nearbyLights;
+
+	// Vignette variables
+	VignetteData ppData;
+};
@@ -0,0 +1,190 @@
+// --------------------------------------------------------
+// Runs the game's simulation without a window or a GPU, on
+// any platform, for replaying recorded input and checking
+// that runs stay deterministic. Not part of the Windows
+// project, see the README for building it.
+//
+//  --root <dir>       Folder holding Assets/, default "."
+//  --ticks <n>        Ticks to run, default the replay's length or 600
+//  --replay <file>    Input recorded with the game's -record switch
+//  --hashes <file>    Writes "tick hash" for every tick
+//  --expect <file>    Compares against hashes written before,
+//                     exits with 1 at the first difference
+//  --threads <n>      Job system workers, default one per core
+// --------------------------------------------------------
+#include "GameSimulation.h"
+#include "Camera.h"
+#include "Transform.h"
+#include "InputSystem.h"
+#include "InputRecording.h"
+#include "JobSystem.h"
+#include "SceneFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define HEADLESS_TICKS_PER_SECOND 60
+#define HEADLESS_DEFAULT_TICKS 600
+
+int main(int argc, char** argv)
+{
+	std::string root = ".";
+	std::string replayFile;
+	std::string hashFile;
+	std::string expectFile;
+	unsigned int ticks = 0;
+	unsigned int threads = JobSystem::GetDefaultWorkerCount();
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "--root")) root = argv[i + 1];
+		else if (!strcmp(argv[i], "--ticks")) ticks = (unsigned int)atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--replay")) replayFile = argv[i + 1];
+		else if (!strcmp(argv[i], "--hashes")) hashFile = argv[i + 1];
+		else if (!strcmp(argv[i], "--expect")) expectFile = argv[i + 1];
+		else if (!strcmp(argv[i], "--threads")) threads = (unsigned int)atoi(argv[i + 1]);
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	InputRecording replay;
+	if (!replayFile.empty())
+	{
+		if (!replay.Load(replayFile.c_str()))
+		{
+			printf("Couldn't read the recording %s\n", replayFile.c_str());
+			return 2;
+		}
+
+		if (replay.GetTicksPerSecond() != HEADLESS_TICKS_PER_SECOND)
+		{
+			printf("%s was recorded at %u ticks a second, this runs %u\n", replayFile.c_str(), replay.GetTicksPerSecond(), HEADLESS_TICKS_PER_SECOND);
+			return 2;
+		}
+
+		if (ticks == 0)
+			ticks = (unsigned int)replay.GetFrameCount();
+	}
+	if (ticks == 0)
+		ticks = HEADLESS_DEFAULT_TICKS;
+
+	// Hashes from an earlier run, one "tick hash" per line
+	std::vector<uint64_t> expected;
+	if (!expectFile.empty())
+	{
+		FILE* file = fopen(expectFile.c_str(), "r");
+		if (!file)
+		{
+			printf("Couldn't read the hashes %s\n", expectFile.c_str());
+			return 2;
+		}
+
+		unsigned int tick;
+		uint64_t hash;
+		while (fscanf(file, "%u %" SCNx64, &tick, &hash) == 2)
+		{
+			expected.push_back(hash);
+		}
+		fclose(file);
+	}
+
+	JobSystem::Get().Start(threads);
+
+	// The same scene the game draws, as bare transforms
+	SceneData sceneData;
+	SceneLoadStats sceneStats;
+	std::string sceneFile = root + "/Assets/Scenes/Level.scene";
+	if (!LoadScene(sceneFile.c_str(), sceneData, &sceneStats))
+	{
+		printf("Couldn't load the scene %s\n", sceneStats.error.c_str());
+		JobSystem::Get().Stop();
+		return 2;
+	}
+
+	Camera player;
+	std::unique_ptr<Transform[]> entities(new Transform[sceneData.entities.size()]);
+	std::unique_ptr<Transform[]> ghosts(new Transform[sceneData.ghosts.size()]);
+	std::unique_ptr<Transform[]> waypoints(new Transform[sceneData.waypoints.size()]);
+
+	SimulationScene scene;
+	scene.player = &player;
+	for (size_t i = 0; i < sceneData.entities.size(); i++)
+	{
+		scene.entities.push_back(&entities[i]);
+	}
+	for (size_t i = 0; i < sceneData.ghosts.size(); i++)
+	{
+		scene.ghosts.push_back(&ghosts[i]);
+	}
+	for (size_t i = 0; i < sceneData.waypoints.size(); i++)
+	{
+		scene.waypoints.push_back(&waypoints[i]);
+	}
+
+	GameSimulation simulation;
+	simulation.SetDeterministic(true);
+	simulation.BeginPlay(sceneData, scene, root + "/Assets/Models/Rooms/Level.snav");
+
+	Input::InputSystem input;
+	if (!replayFile.empty())
+	{
+		input.StartPlayback(&replay);
+	}
+
+	FILE* hashes = hashFile.empty() ? nullptr : fopen(hashFile.c_str(), "w");
+	if (!hashFile.empty() && !hashes)
+	{
+		printf("Couldn't write the hashes %s\n", hashFile.c_str());
+		return 2;
+	}
+
+	// Same step and tick counted time as the windowed game
+	const double tickStep = 1.0 / HEADLESS_TICKS_PER_SECOND;
+	int result = 0;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int tick = 1; tick <= ticks; tick++)
+	{
+		simulation.Tick((float)tickStep, (float)(tick * tickStep), &input);
+
+		uint64_t hash = simulation.HashState();
+		if (hashes)
+		{
+			fprintf(hashes, "%u %016" PRIx64 "\n", tick, hash);
+		}
+
+		if (tick <= expected.size() && expected[tick - 1] != hash)
+		{
+			printf("Diverged at tick %u: %016" PRIx64 ", expected %016" PRIx64 "\n", tick, hash, expected[tick - 1]);
+			result = 1;
+			break;
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (hashes)
+	{
+		fclose(hashes);
+	}
+
+	if (result == 0)
+	{
+		printf("%u ticks in %.3f s, %.0f ticks/s, final hash %016" PRIx64 "\n", ticks, seconds, ticks / seconds, simulation.HashState());
+		if (!expected.empty())
+		{
+			printf("Matched %zu expected hashes\n", (std::min)(expected.size(), (size_t)ticks));
+		}
+	}
+
+	JobSystem::Get().Stop();
+	return result;
+}
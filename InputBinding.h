@@ -12,7 +12,7 @@ to be used by the Inputhandling InputSystem class
 #include <array>
 #include <vector>
 
-#include <windows.h>
+#include "Platform.h"
 
 namespace Input {
     
@@ -0,0 +1,62 @@
+#include "InputRecording.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+InputRecording::InputRecording(unsigned int ticksPerSecond)
+{
+	this->ticksPerSecond = ticksPerSecond;
+}
+
+bool InputRecording::Load(const char* fileName)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+		return false;
+
+	if (file.GetSize() < sizeof(SInpHeader))
+		return false;
+
+	const SInpHeader* header = (const SInpHeader*)file.GetData();
+	if (header->magic != SINP_MAGIC ||
+		header->version != SINP_VERSION ||
+		file.GetSize() != sizeof(SInpHeader) + (size_t)header->frameCount * sizeof(InputFrame))
+	{
+		return false;
+	}
+
+	ticksPerSecond = header->ticksPerSecond;
+	frames.resize(header->frameCount);
+	memcpy(frames.data(), file.GetData() + sizeof(SInpHeader), frames.size() * sizeof(InputFrame));
+	return true;
+}
+
+bool InputRecording::Save(const char* fileName) const
+{
+	SInpHeader header = {};
+	header.magic = SINP_MAGIC;
+	header.version = SINP_VERSION;
+	header.ticksPerSecond = ticksPerSecond;
+	header.frameCount = (uint32_t)frames.size();
+
+	// Same as the mesh cache, never leave a half written file behind
+	std::string tempFileName = std::string(fileName) + ".tmp";
+	{
+		std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)frames.data(), frames.size() * sizeof(InputFrame));
+		if (!out.good())
+		{
+			out.close();
+			std::remove(tempFileName.c_str());
+			return false;
+		}
+	}
+
+	std::remove(fileName);
+	return std::rename(tempFileName.c_str(), fileName) == 0;
+}
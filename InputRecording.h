@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Layout of a recorded input (.sinp) file:
+//  - SInpHeader
+//  - frameCount InputFrames
+//
+// Bump SINP_VERSION whenever the layout changes
+// --------------------------------------------------------
+#define SINP_MAGIC 0x504E4953 // "SINP"
+#define SINP_VERSION 1
+
+struct SInpHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ticksPerSecond;	// Replays at another rate won't match
+	uint32_t frameCount;
+};
+
+// --------------------------------------------------------
+// What InputSystem::Frame() read on one tick
+// --------------------------------------------------------
+struct InputFrame
+{
+	uint8_t keys[32];	// One bit per virtual key code
+	int32_t mouseX;
+	int32_t mouseY;
+};
+
+// --------------------------------------------------------
+// Input for a run of ticks, recorded from a live session
+// and played back through the InputSystem, so the same
+// run can be simulated again anywhere
+// --------------------------------------------------------
+class InputRecording
+{
+public:
+	InputRecording(unsigned int ticksPerSecond = 0);
+
+	inline void AddFrame(const InputFrame& frame) { frames.push_back(frame); }
+	inline const InputFrame& GetFrame(size_t index) const { return frames[index]; }
+	inline size_t GetFrameCount() const { return frames.size(); }
+	inline unsigned int GetTicksPerSecond() const { return ticksPerSecond; }
+
+	bool Load(const char* fileName);
+	bool Save(const char* fileName) const;
+
+	static inline bool IsKeyDown(const InputFrame& frame, unsigned int keyCode)
+	{
+		return (frame.keys[(keyCode & 255) >> 3] >> (keyCode & 7)) & 1;
+	}
+
+	static inline void SetKeyDown(InputFrame& frame, unsigned int keyCode)
+	{
+		frame.keys[(keyCode & 255) >> 3] |= (uint8_t)(1 << (keyCode & 7));
+	}
+
+private:
+	unsigned int ticksPerSecond;
+	std::vector<InputFrame> frames;
+};
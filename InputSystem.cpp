@@ -35,10 +35,19 @@ namespace Input {
 
     void InputSystem::Frame(float dt, Camera* camera)
     {
+        std::lock_guard<std::mutex> lock(mouseMutex);
+
         float speed = camera->GetMovementSpeed() * dt;
         
+        if (playback)
+            ReadPlaybackFrame();
+
         GetKeyboardInput();
 
+        // Recorded before acting on it, the mouse "lockback" below changes the mouse state
+        if (recording)
+            RecordFrame();
+
         // Camera references
         Transform* playerTransform = camera->GetTransform();
 
@@ -51,7 +60,7 @@ namespace Input {
             switch (pair.first)
             {
             case GameCommands::Quit:
-                PostQuitMessage(0);
+                quitRequested = true;
                 break;
             case GameCommands::MoveForward:
                 camera->GetTransform()->MoveRelative(0.0f, 0.0f, speed);
@@ -67,7 +76,7 @@ namespace Input {
                 break;
             case GameCommands::CameraRotation:
             {
-                std::pair<float, float> delta = this->GetMouseDelta();
+                std::pair<float, float> delta = this->ReadMouseDelta();
 
                 float mouseSensitivity = camera->GetSensitivity();
                 delta.first *= mouseSensitivity * dt;
@@ -107,10 +116,23 @@ namespace Input {
 
     void InputSystem::OnMouseMove(short newX, short newY)
     {
+        std::lock_guard<std::mutex> lock(mouseMutex);
         mouseCurrent = { newX, newY };
     }
 
+    POINT InputSystem::GetMousePosition() const
+    {
+        std::lock_guard<std::mutex> lock(mouseMutex);
+        return mouseCurrent;
+    }
+
     std::pair<float,float> InputSystem::GetMouseDelta() const
+    {
+        std::lock_guard<std::mutex> lock(mouseMutex);
+        return ReadMouseDelta();
+    }
+
+    std::pair<float,float> InputSystem::ReadMouseDelta() const
     {
         std::pair<float, float> pt;
         
@@ -158,7 +180,57 @@ namespace Input {
         keyboardPrevious = keyboardCurrent;
 
         for (int i = 0; i < 256; i++)
-            keyboardCurrent[i] = isPressed(i);
+            keyboardCurrent[i] = playback ? InputRecording::IsKeyDown(playbackFrame, i) : isPressed(i);
+    }
+
+    void InputSystem::StartRecording(InputRecording* recording)
+    {
+        std::lock_guard<std::mutex> lock(mouseMutex);
+        this->recording = recording;
+    }
+
+    void InputSystem::StartPlayback(const InputRecording* recording)
+    {
+        std::lock_guard<std::mutex> lock(mouseMutex);
+        playback = recording;
+        playbackIndex = 0;
+    }
+
+    bool InputSystem::TakeQuitRequest()
+    {
+        return quitRequested.exchange(false);
+    }
+
+    bool InputSystem::IsPlaybackFinished() const
+    {
+        return !playback || playbackIndex >= playback->GetFrameCount();
+    }
+
+    void InputSystem::ReadPlaybackFrame()
+    {
+        if (playbackIndex >= playback->GetFrameCount())
+        {
+            // Out of input, let go of everything and leave the mouse where it is
+            playbackFrame = {};
+            return;
+        }
+
+        playbackFrame = playback->GetFrame(playbackIndex++);
+        mouseCurrent.x = playbackFrame.mouseX;
+        mouseCurrent.y = playbackFrame.mouseY;
+    }
+
+    void InputSystem::RecordFrame()
+    {
+        InputFrame frame = {};
+        for (int i = 0; i < 256; i++)
+        {
+            if (keyboardCurrent[i])
+                InputRecording::SetKeyDown(frame, i);
+        }
+        frame.mouseX = (int32_t)mouseCurrent.x;
+        frame.mouseY = (int32_t)mouseCurrent.y;
+        recording->AddFrame(frame);
     }
 
     // Use logic to deduce Keystate from current and previous keyboard states
@@ -7,11 +7,14 @@ Description : Interface for the InputSystem class
 #define INPUTSYSTEM_H
 
 #include <array>
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
 #include "InputBinding.h"
+#include "InputRecording.h"
 #include "Camera.h"
 
-#include <Windows.h>
+#include "Platform.h"
 
 namespace Input {
     
@@ -30,11 +33,23 @@ public:
     void OnMouseMove(short newX, short newY);
 
     // Returns the current mouse position as a POINT
-    POINT GetMousePosition() const { return mouseCurrent; }
+    POINT GetMousePosition() const;
 
     // Returns the difference between current and previous as a std::pair
     std::pair<float, float> GetMouseDelta() const;
 
+    // True once after the quit command, for the window's thread to act on.
+    // Frame() can run on the simulation thread, which can't close the window.
+    bool TakeQuitRequest();
+
+    // Appends what every Frame() reads from here on, nullptr stops
+    void StartRecording(InputRecording* recording);
+
+    // Frame() reads the recording's frames in order instead of the keyboard
+    // and mouse, nothing is pressed once it runs out. nullptr goes back to live input.
+    void StartPlayback(const InputRecording* recording);
+    bool IsPlaybackFinished() const;
+
 private:
     // Keyboard States
     std::array<BYTE, 256> keyboardCurrent;
@@ -44,6 +59,24 @@ private:
     POINT mouseCurrent;
     POINT mousePrevious;
 
+    // Mouse moves come in on the window's thread, which isn't
+    // the one calling Frame when the simulation has its own
+    mutable std::mutex mouseMutex;
+
+    std::atomic<bool> quitRequested{ false };
+
+    InputRecording* recording = nullptr;
+    const InputRecording* playback = nullptr;
+    size_t playbackIndex = 0;
+    InputFrame playbackFrame = {};
+
+    // GetMouseDelta() for when mouseMutex is already held
+    std::pair<float, float> ReadMouseDelta() const;
+
+    // Next recorded frame into playbackFrame and the mouse state
+    void ReadPlaybackFrame();
+    void RecordFrame();
+
     // returns the state of the key in enum form
     const KeyState GetKeyboardKeyState(const unsigned int pkeyCode) const;
 
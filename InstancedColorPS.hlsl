@@ -0,0 +1,10 @@
+#include "ShaderIncludes.hlsli"
+
+// --------------------------------------------------------
+// Solid color for instanced draws, the color and alpha
+// come from each instance's tint
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	return float4(input.color.rgb, clamp(input.color.a, 0.f, 1.f));
+}
@@ -0,0 +1,144 @@
+#include "InstancedRenderer.h"
+#include "Mesh.h"
+#include "Entity.h"
+#include "Camera.h"
+#include "Material.h"
+#include "Vertex.h"
+#include "SimpleShader.h"
+#include <cstring>
+
+using namespace DirectX;
+
+InstancedRenderer::InstancedRenderer(ID3D11Device* device, unsigned int initialCapacity)
+{
+	this->device = device;
+	GrowInstanceBuffer(initialCapacity);
+}
+
+void InstancedRenderer::Begin()
+{
+	batches.clear();
+	batchLookup.clear();
+}
+
+void InstancedRenderer::Submit(Entity* entity)
+{
+	std::pair<Mesh*, Material*> key(entity->GetMesh(), entity->GetMaterial());
+
+	auto found = batchLookup.find(key);
+	if (found == batchLookup.end())
+	{
+		Batch batch;
+		batch.mesh = key.first;
+		batch.material = key.second;
+		found = batchLookup.emplace(key, batches.size()).first;
+		batches.push_back(batch);
+	}
+
+	batches[found->second].entities.push_back(entity);
+}
+
+void InstancedRenderer::Flush(ID3D11DeviceContext* context, Camera* camera)
+{
+	drawCallCount = 0;
+	instanceCount = 0;
+
+	for (Batch& batch : batches)
+	{
+		DrawBatch(context, camera, batch);
+	}
+
+	Begin();
+}
+
+void InstancedRenderer::DrawBatch(ID3D11DeviceContext* context, Camera* camera, Batch& batch)
+{
+	Material* material = batch.material;
+	SimpleVertexShader* vs = material->GetVertexShader();
+	SimplePixelShader* ps = material->GetPixelShader();
+
+	vs->SetShader();
+	ps->SetShader();
+
+	// Nothing to batch with, draw them the old way
+	if (!vs->GetPerInstanceCompatible())
+	{
+		for (Entity* entity : batch.entities)
+		{
+			entity->Draw(context, camera);
+			drawCallCount++;
+		}
+		instanceCount += (unsigned int)batch.entities.size();
+		return;
+	}
+
+	unsigned int count = (unsigned int)batch.entities.size();
+	if (count > instanceCapacity)
+	{
+		GrowInstanceBuffer(count);
+		if (count > instanceCapacity)
+			return;
+	}
+
+	// Each instance has its own tint, the material's unless the entity overrides it
+	instanceData.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		instanceData[i].world = batch.entities[i]->GetTransform()->GetRenderMatrix();
+		instanceData[i].tint = batch.entities[i]->GetColorTint();
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, instanceData.data(), sizeof(InstanceData) * count);
+	context->Unmap(instanceBuffer.Get(), 0);
+
+	// Camera data is the only per draw vertex shader data left
+	vs->SetMatrix4x4(material->GetViewHandle(), camera->GetViewMatrix());
+	vs->SetMatrix4x4(material->GetProjHandle(), camera->GetProjectionMatrix());
+	vs->CopyAllBufferData();
+
+	material->BindResources();
+
+	// Slot 0 is the mesh, slot 1 the instances
+	ID3D11Buffer* buffers[2] = { *batch.mesh->GetVertexBuffer(), instanceBuffer.Get() };
+	UINT strides[2] = { sizeof(Vertex), sizeof(InstanceData) };
+	UINT offsets[2] = { 0, 0 };
+
+	context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	context->IASetIndexBuffer(batch.mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+	context->DrawIndexedInstanced
+	(
+		batch.mesh->GetIndexCount(),
+		count,
+		0,
+		0,
+		0
+	);
+
+	drawCallCount++;
+	instanceCount += count;
+}
+
+void InstancedRenderer::GrowInstanceBuffer(unsigned int requiredCapacity)
+{
+	unsigned int newCapacity = instanceCapacity > 0 ? instanceCapacity : 1;
+	while (newCapacity < requiredCapacity)
+	{
+		newCapacity *= 2;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = sizeof(InstanceData) * newCapacity;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	if (SUCCEEDED(device->CreateBuffer(&bufferDesc, nullptr, instanceBuffer.ReleaseAndGetAddressOf())))
+	{
+		instanceCapacity = newCapacity;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <wrl/client.h>
+#include <vector>
+#include <map>
+#include <utility>
+
+class Mesh;
+class Entity;
+class Camera;
+class Material;
+
+// --------------------------------------------------------
+// Per instance data, read by the vertex shader from input
+// slot 1 through the "_PER_INSTANCE" semantics
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4 tint;
+};
+
+// --------------------------------------------------------
+// Batches entities that share a Mesh and Material and
+// draws each batch with a single DrawIndexedInstanced
+//
+// - Batches are drawn in the order they were first
+//   submitted, and instances in the order they were
+//   submitted, so a caller can sort for transparency
+// - Materials whose vertex shader isn't per instance
+//   compatible fall back to one draw per entity
+// --------------------------------------------------------
+class InstancedRenderer
+{
+public:
+	InstancedRenderer(ID3D11Device* device, unsigned int initialCapacity = 64);
+	~InstancedRenderer() = default;
+
+	// Starts a new set of batches
+	void Begin();
+
+	// Adds an entity to the batch for its mesh and material
+	void Submit(Entity* entity);
+
+	// Draws all the batches, then clears them
+	void Flush(ID3D11DeviceContext* context, Camera* camera);
+
+	// Stats from the last Flush()
+	inline unsigned int GetDrawCallCount() const { return drawCallCount; }
+	inline unsigned int GetInstanceCount() const { return instanceCount; }
+
+private:
+	struct Batch
+	{
+		Mesh* mesh;
+		Material* material;
+		std::vector<Entity*> entities;
+	};
+
+	void DrawBatch(ID3D11DeviceContext* context, Camera* camera, Batch& batch);
+	void GrowInstanceBuffer(unsigned int requiredCapacity);
+
+	ID3D11Device* device;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	unsigned int instanceCapacity = 0;
+
+	std::vector<Batch> batches;
+	std::map<std::pair<Mesh*, Material*>, size_t> batchLookup;
+
+	// Scratch space for filling the instance buffer
+	std::vector<InstanceData> instanceData;
+
+	unsigned int drawCallCount = 0;
+	unsigned int instanceCount = 0;
+};
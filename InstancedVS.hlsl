@@ -0,0 +1,43 @@
+#include "ShaderIncludes.hlsli"
+
+cbuffer PerFrame : register(b0)
+{
+	matrix view;
+	matrix proj;
+}
+
+// Per vertex data comes from slot 0 and per instance data
+// from slot 1. The "_PER_INSTANCE" suffix is what tells
+// SimpleShader to build the input layout that way.
+struct InstancedVertexShaderInput
+{
+	float3 position		: POSITION;
+	float2 uv			: TEXCOORD;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+
+	float4x4 world		: WORLD_PER_INSTANCE;
+	float4 tint			: COLOR_PER_INSTANCE;
+};
+
+// --------------------------------------------------------
+// Same as VertexShader.hlsl, but the world matrix and
+// color tint are read per instance instead of per draw
+// --------------------------------------------------------
+VertexToPixel main(InstancedVertexShaderInput input)
+{
+	VertexToPixel output;
+
+	// Instance matrices are uploaded row by row without the transpose
+	// a constant buffer gets, so flip them to match view and proj
+	matrix world = transpose(input.world);
+
+	matrix wvp = mul(proj, mul(view, world));
+	output.position = mul(wvp, float4(input.position, 1.0f));
+
+	output.normal = mul((float3x3)world, input.normal);
+	output.color = input.tint;
+	output.worldPos = mul(world, float4(input.position, 1.0f)).xyz;
+	output.uv = input.uv;
+	return output;
+}
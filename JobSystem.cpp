@@ -0,0 +1,220 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+// Queue owned by the current thread, 0 for anything that isn't a worker
+static thread_local unsigned int threadQueue = 0;
+static thread_local const JobSystem* threadSystem = nullptr;
+
+JobSystem& JobSystem::Get()
+{
+	static JobSystem system;
+	return system;
+}
+
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+unsigned int JobSystem::GetDefaultWorkerCount()
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 0;
+}
+
+void JobSystem::Start(unsigned int workerCount)
+{
+	Stop();
+
+	queues.clear();
+	for (unsigned int i = 0; i <= workerCount; i++)
+	{
+		queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	running = true;
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+	}
+}
+
+void JobSystem::Stop()
+{
+	if (workers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	// The workers drain the queues before leaving, this catches
+	// a job pushed right as the last one went to exit
+	Job job;
+	while (TakeJob(0, job))
+	{
+		Execute(job, 0);
+	}
+	workers.clear();
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter* counter)
+{
+	if (IsSingleThreaded())
+	{
+		job();
+		jobsRun++;
+		return;
+	}
+
+	if (counter)
+	{
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	unsigned int queue = GetThreadQueue();
+	{
+		std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+		Job queued;
+		queued.function = std::move(job);
+		queued.counter = counter;
+		queued.queue = queue;
+		queues[queue]->jobs.push_back(std::move(queued));
+	}
+
+	// Taking the lock keeps a worker from missing the wake up
+	// between checking queuedJobs and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queuedJobs++;
+	}
+	wake.notify_one();
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t chunkSize, std::function<void(uint32_t, uint32_t)> body, JobCounter* counter)
+{
+	chunkSize = (std::max)(chunkSize, 1u);
+
+	// One shared copy of the body for all the chunks
+	std::shared_ptr<std::function<void(uint32_t, uint32_t)>> shared = std::make_shared<std::function<void(uint32_t, uint32_t)>>(std::move(body));
+	for (uint32_t begin = 0; begin < count; begin += chunkSize)
+	{
+		uint32_t end = (std::min)(begin + chunkSize, count);
+		Run([shared, begin, end]() { (*shared)(begin, end); }, counter);
+	}
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	unsigned int queue = GetThreadQueue();
+	while (!counter->IsDone())
+	{
+		Job job;
+		if (TakeJob(queue, job))
+		{
+			Execute(job, queue);
+		}
+		else
+		{
+			// Whatever's left is running on another thread
+			std::this_thread::yield();
+		}
+	}
+}
+
+JobSystemStats JobSystem::GetStats() const
+{
+	JobSystemStats stats;
+	stats.jobsRun = jobsRun.load();
+	stats.jobsStolen = jobsStolen.load();
+	return stats;
+}
+
+void JobSystem::ResetStats()
+{
+	jobsRun = 0;
+	jobsStolen = 0;
+}
+
+unsigned int JobSystem::GetThreadQueue() const
+{
+	return threadSystem == this ? threadQueue : 0;
+}
+
+bool JobSystem::TakeJob(unsigned int queue, Job& job)
+{
+	// Own queue first, newest job is the most likely to be in cache
+	{
+		WorkerQueue& own = *queues[queue];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// Then steal the oldest job from the others, starting after our own
+	// queue so the threads don't all pile onto the same victim
+	unsigned int queueCount = (unsigned int)queues.size();
+	for (unsigned int i = 1; i < queueCount; i++)
+	{
+		WorkerQueue& victim = *queues[(queue + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::Execute(Job& job, unsigned int queue)
+{
+	job.function();
+
+	jobsRun++;
+	if (job.queue != queue)
+	{
+		jobsStolen++;
+	}
+
+	if (job.counter)
+	{
+		job.counter->pending.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void JobSystem::WorkerLoop(unsigned int queue)
+{
+	threadQueue = queue;
+	threadSystem = this;
+
+	while (true)
+	{
+		Job job;
+		if (TakeJob(queue, job))
+		{
+			Execute(job, queue);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]() { return !running || queuedJobs > 0; });
+		if (!running && queuedJobs <= 0)
+			return;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Number of jobs still to finish, handed to Run() and
+// waited on with JobSystem::Wait(). A job that has to
+// run after others just waits on their counter first.
+// --------------------------------------------------------
+class JobCounter
+{
+public:
+	inline bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<int> pending{ 0 };
+};
+
+// --------------------------------------------------------
+// Counts since the last JobSystem::ResetStats()
+// --------------------------------------------------------
+struct JobSystemStats
+{
+	unsigned int jobsRun = 0;
+	unsigned int jobsStolen = 0;		// Run by a thread that didn't queue them
+};
+
+// --------------------------------------------------------
+// Portable job system built on std::thread
+//
+// - Every worker owns a deque, it pushes and pops at the
+//   back and idle threads steal from the front of others
+// - Threads that aren't workers (the main thread) share
+//   one extra queue
+// - Wait() runs queued jobs instead of blocking, so jobs
+//   can wait on other jobs without deadlocking
+// - With no workers every job runs right away on the
+//   calling thread in submission order, for deterministic
+//   runs and debugging
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	// The system shared by the engine's systems, starts out single threaded
+	static JobSystem& Get();
+
+	~JobSystem();
+
+	// Worker count that leaves one core for the main thread
+	static unsigned int GetDefaultWorkerCount();
+
+	// Stops any running workers and starts workerCount new ones,
+	// 0 switches to the single thread mode
+	void Start(unsigned int workerCount);
+	// Finishes every queued job before returning, so no counter is left waiting
+	void Stop();
+
+	inline unsigned int GetWorkerCount() const { return (unsigned int)workers.size(); }
+	inline bool IsSingleThreaded() const { return workers.empty(); }
+
+	void Run(std::function<void()> job, JobCounter* counter);
+
+	// Runs body(begin, end) over [0, count) in chunks of at most chunkSize
+	void ParallelFor(uint32_t count, uint32_t chunkSize, std::function<void(uint32_t, uint32_t)> body, JobCounter* counter);
+
+	// Helps with queued jobs until the counter reaches zero
+	void Wait(JobCounter* counter);
+
+	JobSystemStats GetStats() const;
+	void ResetStats();
+
+private:
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter = nullptr;
+		unsigned int queue = 0;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	unsigned int GetThreadQueue() const;
+	bool TakeJob(unsigned int queue, Job& job);
+	void Execute(Job& job, unsigned int queue);
+	void WorkerLoop(unsigned int queue);
+
+	// Queue 0 is shared by outside threads, worker i owns queue i + 1
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> queuedJobs{ 0 };
+	std::atomic<bool> running{ false };
+
+	std::atomic<unsigned int> jobsRun{ 0 };
+	std::atomic<unsigned int> jobsStolen{ 0 };
+};
@@ -0,0 +1,183 @@
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+
+LightClusters::LightClusters()
+{
+	clusterCounts.resize(CLUSTER_COUNT, 0);
+	clusterSlots.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER, 0);
+	clusterRanges.resize(CLUSTER_COUNT);
+
+	for (int i = 0; i <= CLUSTER_SLICES; i++)
+	{
+		sliceDepths[i] = 0;
+	}
+}
+
+void LightClusters::Build(const Light* lights, int lightCount, const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	stats = LightClusterStats();
+	lightIndices.clear();
+	binnedLights.clear();
+
+	// Pull the frustum back out of the projection matrix, for a left handed
+	// perspective _33 = f / (f - n) and _43 = -n * f / (f - n)
+	projScaleX = proj._11;
+	projScaleY = proj._22;
+	nearDepth = -proj._43 / proj._33;
+	farDepth = proj._33 * nearDepth / (proj._33 - 1.0f);
+
+	// Exponential slices, so clusters stay roughly cube shaped with distance
+	float sliceNear = (std::max)(nearDepth, CLUSTER_MIN_SLICE_DEPTH);
+	float logRange = std::log(farDepth / sliceNear);
+	sliceScale = CLUSTER_SLICES / logRange;
+	sliceBias = -CLUSTER_SLICES * std::log(sliceNear) / logRange;
+
+	sliceDepths[0] = nearDepth;
+	for (int i = 1; i <= CLUSTER_SLICES; i++)
+	{
+		sliceDepths[i] = sliceNear * std::pow(farDepth / sliceNear, (float)i / CLUSTER_SLICES);
+	}
+
+	// Lights without a range go everywhere, the rest get binned in view space
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+	for (int i = 0; i < lightCount; i++)
+	{
+		const Light& light = lights[i];
+		if (light.type == LIGHT_TYPE_POINT || light.type == LIGHT_TYPE_SPOT)
+		{
+			BinnedLight binned;
+			XMStoreFloat3(&binned.center, XMVector3TransformCoord(XMLoadFloat3(&light.position), viewMatrix));
+			binned.radius = light.range;
+			binned.index = (unsigned int)i;
+			binnedLights.push_back(binned);
+		}
+		else
+		{
+			lightIndices.push_back((unsigned int)i);
+		}
+	}
+	stats.globalLights = (unsigned int)lightIndices.size();
+	stats.binnedLights = (unsigned int)binnedLights.size();
+
+	// Each slice owns its own clusters, so no locking is needed
+	std::fill(clusterCounts.begin(), clusterCounts.end(), 0);
+	JobCounter sliceJobs;
+	JobSystem::Get().ParallelFor(CLUSTER_SLICES, 1, [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t slice = begin; slice < end; slice++)
+		{
+			BinSlice((int)slice);
+		}
+	}, &sliceJobs);
+	JobSystem::Get().Wait(&sliceJobs);
+
+	// Pack the fixed size lists down into one index list
+	for (unsigned int c = 0; c < CLUSTER_COUNT; c++)
+	{
+		unsigned int count = clusterCounts[c];
+		if (count > MAX_LIGHTS_PER_CLUSTER)
+		{
+			stats.droppedPairs += count - MAX_LIGHTS_PER_CLUSTER;
+			count = MAX_LIGHTS_PER_CLUSTER;
+		}
+
+		clusterRanges[c].offset = (unsigned int)lightIndices.size();
+		clusterRanges[c].count = count;
+
+		const unsigned int* slots = &clusterSlots[c * MAX_LIGHTS_PER_CLUSTER];
+		lightIndices.insert(lightIndices.end(), slots, slots + count);
+
+		stats.lightClusterPairs += count;
+		stats.maxLightsInCluster = (std::max)(stats.maxLightsInCluster, count);
+	}
+
+	stats.buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void LightClusters::BinSlice(int slice)
+{
+	float z0 = sliceDepths[slice];
+	float z1 = sliceDepths[slice + 1];
+
+	for (const BinnedLight& light : binnedLights)
+	{
+		float r = light.radius;
+		XMFLOAT3 c = light.center;
+
+		// Depth range of the light inside this slice
+		float za = (std::max)(z0, c.z - r);
+		float zb = (std::min)(z1, c.z + r);
+		if (za > zb)
+			continue;
+		za = (std::max)(za, nearDepth);
+
+		// Screen space extent of the light's box over that depth range. x / z
+		// is monotonic in x and in 1 / z, so the corners give the extremes.
+		float ndcMinX = (std::min)((c.x - r) / za, (c.x - r) / zb) * projScaleX;
+		float ndcMaxX = (std::max)((c.x + r) / za, (c.x + r) / zb) * projScaleX;
+		float ndcMinY = (std::min)((c.y - r) / za, (c.y - r) / zb) * projScaleY;
+		float ndcMaxY = (std::max)((c.y + r) / za, (c.y + r) / zb) * projScaleY;
+		if (ndcMaxX < -1 || ndcMinX > 1 || ndcMaxY < -1 || ndcMinY > 1)
+			continue;
+
+		// Tiles are numbered from the top left like pixels
+		int tileX0 = (std::max)(0, (int)std::floor((ndcMinX + 1) * 0.5f * CLUSTER_TILES_X));
+		int tileX1 = (std::min)(CLUSTER_TILES_X - 1, (int)std::floor((ndcMaxX + 1) * 0.5f * CLUSTER_TILES_X));
+		int tileY0 = (std::max)(0, (int)std::floor((1 - ndcMaxY) * 0.5f * CLUSTER_TILES_Y));
+		int tileY1 = (std::min)(CLUSTER_TILES_Y - 1, (int)std::floor((1 - ndcMinY) * 0.5f * CLUSTER_TILES_Y));
+
+		XMVECTOR center = XMLoadFloat3(&light.center);
+		float radiusSq = r * r;
+
+		for (int ty = tileY0; ty <= tileY1; ty++)
+		{
+			float ndcTop = 1 - 2.0f * ty / CLUSTER_TILES_Y;
+			float ndcBottom = 1 - 2.0f * (ty + 1) / CLUSTER_TILES_Y;
+			float minY = (std::min)(ndcBottom * z0, ndcBottom * z1) / projScaleY;
+			float maxY = (std::max)(ndcTop * z0, ndcTop * z1) / projScaleY;
+
+			for (int tx = tileX0; tx <= tileX1; tx++)
+			{
+				float ndcLeft = -1 + 2.0f * tx / CLUSTER_TILES_X;
+				float ndcRight = -1 + 2.0f * (tx + 1) / CLUSTER_TILES_X;
+				float minX = (std::min)(ndcLeft * z0, ndcLeft * z1) / projScaleX;
+				float maxX = (std::max)(ndcRight * z0, ndcRight * z1) / projScaleX;
+
+				// Sphere vs the cluster's view space box
+				XMVECTOR boxMin = XMVectorSet(minX, minY, z0, 0);
+				XMVECTOR boxMax = XMVectorSet(maxX, maxY, z1, 0);
+				XMVECTOR closest = XMVectorClamp(center, boxMin, boxMax);
+				if (XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(center, closest))) > radiusSq)
+					continue;
+
+				int cluster = GetClusterIndex(tx, ty, slice);
+				unsigned int count = clusterCounts[cluster]++;
+				if (count < MAX_LIGHTS_PER_CLUSTER)
+				{
+					clusterSlots[cluster * MAX_LIGHTS_PER_CLUSTER + count] = light.index;
+				}
+			}
+		}
+	}
+}
+
+int LightClusters::GetSlice(float viewDepth) const
+{
+	if (viewDepth <= 0)
+		return 0;
+
+	int slice = (int)std::floor(std::log(viewDepth) * sliceScale + sliceBias);
+	return (std::min)((std::max)(slice, 0), CLUSTER_SLICES - 1);
+}
+
+int LightClusters::GetClusterIndex(int tileX, int tileY, int slice) const
+{
+	return (slice * CLUSTER_TILES_Y + tileY) * CLUSTER_TILES_X + tileX;
+}
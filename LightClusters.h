@@ -0,0 +1,108 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Lights.h"
+
+// Must match the defines in ShaderIncludes.hlsli
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define CLUSTER_COUNT (CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+#define MAX_LIGHTS_PER_CLUSTER 32
+
+// Anything closer than this falls in the first depth slice,
+// keeps a tiny near plane from wasting slices on the first few cm
+#define CLUSTER_MIN_SLICE_DEPTH 0.1f
+
+// --------------------------------------------------------
+// Offset and count into the light index list for a cluster
+// --------------------------------------------------------
+struct ClusterLightRange
+{
+	unsigned int offset;
+	unsigned int count;
+};
+
+// --------------------------------------------------------
+// Counts from the last LightClusters::Build()
+// --------------------------------------------------------
+struct LightClusterStats
+{
+	unsigned int globalLights = 0;			// Directional and ambient lights, applied everywhere
+	unsigned int binnedLights = 0;			// Point and spot lights that touched at least one cluster
+	unsigned int lightClusterPairs = 0;		// Total entries in all cluster lists
+	unsigned int maxLightsInCluster = 0;
+	unsigned int droppedPairs = 0;			// Lights that didn't fit in a full cluster
+	double buildSeconds = 0;
+};
+
+// --------------------------------------------------------
+// Bins point and spot lights into view space clusters for
+// clustered forward shading
+//
+// - The view frustum is split into CLUSTER_TILES_X by
+//   CLUSTER_TILES_Y screen tiles and CLUSTER_SLICES
+//   exponentially spaced depth slices
+// - Each light's bounding sphere is tested against each
+//   cluster's view space AABB
+// - Depth slices are binned in parallel on the JobSystem,
+//   each slice only writes its own clusters
+// - Only depends on DirectXMath and the JobSystem, so it
+//   can be run and timed without a device
+// --------------------------------------------------------
+class LightClusters
+{
+public:
+	LightClusters();
+
+	// Rebuilds the cluster lists for a camera. Expects a left handed
+	// perspective projection like XMMatrixPerspectiveFovLH makes.
+	void Build(const Light* lights, int lightCount, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+
+	// Light indices: global lights first, then each cluster's list
+	inline const std::vector<unsigned int>& GetLightIndices() const { return lightIndices; }
+	inline const std::vector<ClusterLightRange>& GetClusterRanges() const { return clusterRanges; }
+	inline unsigned int GetGlobalLightCount() const { return stats.globalLights; }
+
+	// Values the shaders need to find a pixel's depth slice:
+	// slice = log(viewDepth) * scale + bias
+	inline float GetSliceScale() const { return sliceScale; }
+	inline float GetSliceBias() const { return sliceBias; }
+
+	inline const LightClusterStats& GetStats() const { return stats; }
+
+	// Helpers for locating a view space point, also used when testing
+	int GetSlice(float viewDepth) const;
+	int GetClusterIndex(int tileX, int tileY, int slice) const;
+
+private:
+	struct BinnedLight
+	{
+		DirectX::XMFLOAT3 center; // View space
+		float radius;
+		unsigned int index;
+	};
+
+	void BinSlice(int slice);
+
+	// Camera info for the current build
+	float projScaleX = 1;
+	float projScaleY = 1;
+	float nearDepth = 0.1f;
+	float farDepth = 100.f;
+	float sliceScale = 0;
+	float sliceBias = 0;
+	float sliceDepths[CLUSTER_SLICES + 1];
+
+	std::vector<BinnedLight> binnedLights;
+
+	// Fixed size lists per cluster, compacted into lightIndices afterwards
+	std::vector<unsigned int> clusterCounts;
+	std::vector<unsigned int> clusterSlots;
+
+	std::vector<unsigned int> lightIndices;
+	std::vector<ClusterLightRange> clusterRanges;
+
+	LightClusterStats stats;
+};
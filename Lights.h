@@ -2,6 +2,11 @@
 
 #include <DirectXMath.h>
 
+#define LIGHT_TYPE_DIR 0
+#define LIGHT_TYPE_POINT 1
+#define LIGHT_TYPE_SPOT 2
+#define LIGHT_TYPE_AMBIENT 3
+
 struct Light
 {
 	DirectX::XMFLOAT3 color;
@@ -1,6 +1,7 @@
 
 #include <Windows.h>
 #include "Game.h"
+#include <cstring>
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -22,6 +23,11 @@ int WINAPI WinMain(
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
 
+	// "-record <file>" saves every tick's input, the headless runner can replay it
+	const char* record = strstr(lpCmdLine, "-record ");
+	if (record)
+		dxGame.RecordInputTo(record + strlen("-record "));
+
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
 
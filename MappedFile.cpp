@@ -0,0 +1,104 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fstream>
+#include <sys/stat.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char* fileName)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		// Empty files can't be mapped
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	// 100 ns ticks
+	FILETIME lastWrite;
+	if (GetFileTime(file, nullptr, nullptr, &lastWrite))
+		writeTime = ((uint64_t)lastWrite.dwHighDateTime << 32) | lastWrite.dwLowDateTime;
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	size = (size_t)fileSize.QuadPart;
+#else
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamoff fileSize = file.tellg();
+	if (fileSize <= 0)
+		return false;
+
+	buffer.resize((size_t)fileSize);
+	file.seekg(0);
+	if (!file.read(buffer.data(), fileSize))
+	{
+		buffer.clear();
+		return false;
+	}
+
+	// Whole seconds
+	struct stat info;
+	if (stat(fileName, &info) == 0)
+		writeTime = (uint64_t)info.st_mtime;
+
+	data = buffer.data();
+	size = buffer.size();
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle)
+		CloseHandle(fileHandle);
+
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	buffer.clear();
+	buffer.shrink_to_fit();
+#endif
+
+	data = nullptr;
+	size = 0;
+	writeTime = 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Read-only view of an entire file in memory
+//
+// - On Windows the file is memory mapped, so the OS pages
+//   it in on demand and nothing is copied
+// - Elsewhere the file is read in with a single bulk read
+// - The last write time is only good for comparing against
+//   another one from here, it's 0 if the OS didn't give one
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* fileName);
+	void Close();
+
+	inline const char* GetData() const { return data; }
+	inline size_t GetSize() const { return size; }
+	inline uint64_t GetWriteTime() const { return writeTime; }
+	inline bool IsOpen() const { return data != nullptr; }
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+	uint64_t writeTime = 0;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	std::vector<char> buffer;
+#endif
+};
@@ -8,25 +8,76 @@ Material::Material(DirectX::XMFLOAT4 colorTint, float shininess, class SimpleVer
 	this->shininess = shininess;
 	this->vertShader = VS;
 	this->pixelShader = PS;
+	ResolveShaderHandles();
 }
 
-Material::Material(DirectX::XMFLOAT4 colorTint, float shininess, ID3D11ShaderResourceView* texResource, ID3D11SamplerState* sampler, SimpleVertexShader* VS, SimplePixelShader* PS)
+Material::Material(DirectX::XMFLOAT4 colorTint, float shininess, TextureRegistry* textures, TextureHandle diffuseTexture, ID3D11SamplerState* sampler, SimpleVertexShader* VS, SimplePixelShader* PS)
 {
 	this->colorTint = colorTint;
 	this->shininess = shininess;
-	this->diffuseTextureWrapper = texResource;
+	this->textures = textures;
+	this->diffuseTexture = diffuseTexture;
 	textureSampler = sampler;
 	this->vertShader = VS;
 	this->pixelShader = PS;
+	textures->AddRef(diffuseTexture);
+	ResolveShaderHandles();
 }
 
-Material::Material(DirectX::XMFLOAT4 colorTint, float shininess, struct ID3D11ShaderResourceView* diffuseTexture, struct ID3D11ShaderResourceView* normalMapTexture, struct ID3D11SamplerState* sampler, class SimpleVertexShader* VS, class SimplePixelShader* PS)
+Material::Material(DirectX::XMFLOAT4 colorTint, float shininess, TextureRegistry* textures, TextureHandle diffuseTexture, TextureHandle normalMapTexture, struct ID3D11SamplerState* sampler, class SimpleVertexShader* VS, class SimplePixelShader* PS)
 {
 	this->colorTint = colorTint;
 	this->shininess = shininess;
-	this->diffuseTextureWrapper = diffuseTexture;
+	this->textures = textures;
+	this->diffuseTexture = diffuseTexture;
 	textureSampler = sampler;
 	this->vertShader = VS;
 	this->pixelShader = PS;
-	this->normalMapWrapper = normalMapTexture;
+	this->normalMap = normalMapTexture;
+	textures->AddRef(diffuseTexture);
+	textures->AddRef(normalMapTexture);
+	ResolveShaderHandles();
+}
+
+Material::~Material()
+{
+	if (textures)
+	{
+		textures->Release(diffuseTexture);
+		textures->Release(normalMap);
+	}
+}
+
+void Material::BindResources()
+{
+	// Only marks the per material buffers dirty when the values differ
+	// from the last material that used these shaders
+	vertShader->SetFloat4(colorTintHandle, colorTint);
+
+	pixelShader->SetFloat(shininessHandle, shininess);
+	pixelShader->CopyAllBufferData();
+
+	if (diffuseTexture.IsValid())
+	{
+		pixelShader->SetShaderResourceView("diffuseTexture", textures->GetView(diffuseTexture));
+	}
+	if (normalMap.IsValid())
+	{
+		pixelShader->SetShaderResourceView("normalMap", textures->GetView(normalMap));
+	}
+	if (textureSampler)
+	{
+		pixelShader->SetSamplerState("samplerOptions", textureSampler);
+	}
+}
+
+// Looks up the per draw variables once, so drawing doesn't hash their names
+void Material::ResolveShaderHandles()
+{
+	colorTintHandle = vertShader->GetVariableHandle("colorTint");
+	worldHandle = vertShader->GetVariableHandle("world");
+	viewHandle = vertShader->GetVariableHandle("view");
+	projHandle = vertShader->GetVariableHandle("proj");
+
+	shininessHandle = pixelShader->GetVariableHandle("shininess");
 }
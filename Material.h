@@ -1,6 +1,8 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include "SimpleShader.h"
+#include "TextureRegistry.h"
 
 class SimpleVertexShader;
 class SimplePixelShader;
@@ -10,9 +12,10 @@ class Material
 public:
 
 	Material(DirectX::XMFLOAT4 colorTint, float shininess, class SimpleVertexShader* VS, class SimplePixelShader* PS);
-	Material(DirectX::XMFLOAT4 colorTint, float shininess, struct ID3D11ShaderResourceView* texResource, struct ID3D11SamplerState* sampler,  class SimpleVertexShader* VS, class SimplePixelShader* PS);
-	Material(DirectX::XMFLOAT4 colorTint, float shininess, struct ID3D11ShaderResourceView* diffuseTexture, struct ID3D11ShaderResourceView* normalMapTexture, struct ID3D11SamplerState* sampler,  class SimpleVertexShader* VS, class SimplePixelShader* PS);
-	~Material() = default;
+	// Textured materials hold a reference on their textures until they're deleted
+	Material(DirectX::XMFLOAT4 colorTint, float shininess, class TextureRegistry* textures, TextureHandle diffuseTexture, struct ID3D11SamplerState* sampler,  class SimpleVertexShader* VS, class SimplePixelShader* PS);
+	Material(DirectX::XMFLOAT4 colorTint, float shininess, class TextureRegistry* textures, TextureHandle diffuseTexture, TextureHandle normalMapTexture, struct ID3D11SamplerState* sampler,  class SimpleVertexShader* VS, class SimplePixelShader* PS);
+	~Material();
 
 	inline class SimpleVertexShader* GetVertexShader() { return vertShader; }
 	inline class SimplePixelShader* GetPixelShader() { return pixelShader; }
@@ -20,17 +23,28 @@ public:
 	inline DirectX::XMFLOAT4 GetColorTint() { return colorTint; }
 	inline float GetShininess() { return shininess; }
 
-	inline ID3D11ShaderResourceView* GetDiffuseTextureWrapper() { return diffuseTextureWrapper; }
-	inline ID3D11ShaderResourceView* GetNormalMapWrapper() { return normalMapWrapper; }
+	inline TextureHandle GetDiffuseTexture() { return diffuseTexture; }
+	inline TextureHandle GetNormalMap() { return normalMap; }
 	inline ID3D11SamplerState* GetTextureSampler() { return textureSampler; }
 
 	inline void SetColorTint(DirectX::XMFLOAT4 tint) { colorTint = tint; }
 	inline void SetShininess(float value) { shininess = shininess; }
 
-	inline bool IsNormalMapMaterial() { return normalMapWrapper;}
+	inline bool IsNormalMapMaterial() { return normalMap.IsValid(); }
+
+	// Variables in this material's shaders, resolved when the material is made
+	inline const SimpleShaderVariableHandle& GetWorldHandle() const { return worldHandle; }
+	inline const SimpleShaderVariableHandle& GetViewHandle() const { return viewHandle; }
+	inline const SimpleShaderVariableHandle& GetProjHandle() const { return projHandle; }
+
+	// Sets the per material shader data, uploads the pixel shader's buffers
+	// and binds the textures and sampler. Expects the material's shaders to be set already.
+	void BindResources();
 
 private:
 
+	void ResolveShaderHandles();
+
 	// @todo: everything will be shiny by default. 
 	// Maybe make a separate shader for none shiny objects
 	// @todo make sure to clamp the value of the shininess
@@ -41,10 +55,18 @@ private:
 	class SimpleVertexShader* vertShader = nullptr;
 	class SimplePixelShader* pixelShader = nullptr;
 
-	ID3D11ShaderResourceView* diffuseTextureWrapper = nullptr;
+	// Looked up on every bind, so streamed in mips show up without touching the material
+	class TextureRegistry* textures = nullptr;
+	TextureHandle diffuseTexture;
 
 	// @todo: some objects might not have a normal map, consider making a more robust system
-	ID3D11ShaderResourceView* normalMapWrapper = nullptr;
+	TextureHandle normalMap;
 
 	ID3D11SamplerState* textureSampler = nullptr; 
+
+	SimpleShaderVariableHandle colorTintHandle;
+	SimpleShaderVariableHandle shininessHandle;
+	SimpleShaderVariableHandle worldHandle;
+	SimpleShaderVariableHandle viewHandle;
+	SimpleShaderVariableHandle projHandle;
 };
\ No newline at end of file
@@ -1,29 +1,45 @@
 #pragma once
 
 #include <wrl/client.h>
+#include <DirectXCollision.h>
 
 struct Vertex;
 struct ID3D11Device;
 struct ID3D11Buffer;
+struct ID3D11DeviceContext;
+class MeshSource;
 
 class Mesh
 {
 public:
 	Mesh(struct Vertex* vertexData, unsigned int vertexCount, unsigned int* indices, int indexCount, struct ID3D11Device* device);
 	Mesh(const char* fileName, struct ID3D11Device* device);
+	Mesh(const class MeshSource& source, struct ID3D11Device* device);
 	~Mesh() = default;
 
 	struct ID3D11Buffer* const* GetVertexBuffer() const;
 	struct ID3D11Buffer* GetIndexBuffer() const;
 	int GetIndexCount() const;
+	int GetVertexCount() const;
+
+	// Sets the vertex and index buffers on the input assembler
+	void Bind(struct ID3D11DeviceContext* context) const;
+
+	// Object space bounds, computed from the vertex positions at load
+	inline const DirectX::BoundingBox& GetLocalBoundingBox() const { return localBox; }
+	inline const DirectX::BoundingSphere& GetLocalBoundingSphere() const { return localSphere; }
 
 private:
 
-	void GenerateVertAndIndexBuffers(struct Vertex* vertexData, unsigned int vertexCount, unsigned int* indices, int indexCount, struct ID3D11Device* device);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	void GenerateVertAndIndexBuffers(const struct Vertex* vertexData, unsigned int vertexCount, const unsigned int* indices, int indexCount, struct ID3D11Device* device);
 
 	Microsoft::WRL::ComPtr<struct ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<struct ID3D11Buffer> indexBuffer;
 	
 	int indexBufferCount = 0;
+	int vertexBufferCount = 0;
+
+	// Empty meshes keep a zero size box at the origin
+	DirectX::BoundingBox localBox = DirectX::BoundingBox(DirectX::XMFLOAT3(0, 0, 0), DirectX::XMFLOAT3(0, 0, 0));
+	DirectX::BoundingSphere localSphere = DirectX::BoundingSphere(DirectX::XMFLOAT3(0, 0, 0), 0);
 };
@@ -0,0 +1,179 @@
+#include "MeshCache.h"
+#include "Vertex.h"
+#include <fstream>
+#include <cstdio>
+
+bool MeshCacheView::Open(const char* cacheFileName, uint64_t expectedSourceHash)
+{
+	vertices = nullptr;
+	indices = nullptr;
+	vertexCount = 0;
+	indexCount = 0;
+
+	if (!file.Open(cacheFileName))
+		return false;
+
+	if (file.GetSize() < sizeof(SMeshHeader))
+	{
+		file.Close();
+		return false;
+	}
+
+	const SMeshHeader* header = (const SMeshHeader*)file.GetData();
+	size_t expectedSize = sizeof(SMeshHeader) +
+		(size_t)header->vertexCount * sizeof(Vertex) +
+		(size_t)header->indexCount * sizeof(unsigned int);
+
+	if (header->magic != SMESH_MAGIC ||
+		header->version != SMESH_VERSION ||
+		header->vertexStride != sizeof(Vertex) ||
+		header->sourceHash != expectedSourceHash ||
+		header->vertexCount == 0 ||
+		header->indexCount == 0 ||
+		file.GetSize() != expectedSize)
+	{
+		file.Close();
+		return false;
+	}
+
+	vertexCount = header->vertexCount;
+	indexCount = header->indexCount;
+	vertices = (const Vertex*)(file.GetData() + sizeof(SMeshHeader));
+	indices = (const unsigned int*)(file.GetData() + sizeof(SMeshHeader) + vertexCount * sizeof(Vertex));
+	return true;
+}
+
+bool MeshSource::Load(const char* fileName)
+{
+	fromCache = false;
+	data.vertices.clear();
+	data.indices.clear();
+
+	// Hash the source so we can tell if the baked version is stale
+	uint64_t sourceHash = HashFile(fileName);
+	if (sourceHash == 0)
+		return false;
+
+	// Use the baked mesh if there's an up to date one, this
+	// skips all of the text parsing and tangent calculation
+	std::string cachePath = GetMeshCachePath(fileName);
+	if (cache.Open(cachePath.c_str(), sourceHash))
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Mesh %s: loaded baked %s (%u vertices, %u indices)\n",
+			fileName, cachePath.c_str(), cache.GetVertexCount(), cache.GetIndexCount());
+#endif
+		fromCache = true;
+		return true;
+	}
+
+	ObjLoadStats stats;
+	if (!LoadObj(fileName, data, &stats))
+		return false;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Mesh %s: %u vertices deduplicated to %u (%u indices), parsed %.1f KB in %.2f ms (%.1f MB/s)\n",
+		fileName, (unsigned int)stats.cornerCount, (unsigned int)data.vertices.size(), (unsigned int)data.indices.size(),
+		stats.fileBytes / 1024.0, stats.parseSeconds * 1000.0, stats.MegabytesPerSecond());
+#endif
+
+	CalculateTangents(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size());
+
+	// Bake the final data so the next launch can map it directly
+	if (!BakeMeshCache(cachePath.c_str(), sourceHash, data))
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Mesh %s: could not write %s\n", fileName, cachePath.c_str());
+#endif
+	}
+
+	return true;
+}
+
+const Vertex* MeshSource::GetVertices() const
+{
+	return fromCache ? cache.GetVertices() : data.vertices.data();
+}
+
+const unsigned int* MeshSource::GetIndices() const
+{
+	return fromCache ? cache.GetIndices() : data.indices.data();
+}
+
+unsigned int MeshSource::GetVertexCount() const
+{
+	return fromCache ? cache.GetVertexCount() : (unsigned int)data.vertices.size();
+}
+
+unsigned int MeshSource::GetIndexCount() const
+{
+	return fromCache ? cache.GetIndexCount() : (unsigned int)data.indices.size();
+}
+
+bool BakeMeshCache(const char* cacheFileName, uint64_t sourceHash, const MeshData& data)
+{
+	if (data.vertices.empty() || data.indices.empty())
+		return false;
+
+	SMeshHeader header = {};
+	header.magic = SMESH_MAGIC;
+	header.version = SMESH_VERSION;
+	header.sourceHash = sourceHash;
+	header.vertexCount = (uint32_t)data.vertices.size();
+	header.indexCount = (uint32_t)data.indices.size();
+	header.vertexStride = sizeof(Vertex);
+
+	// Write to a temporary file first so a crash mid-write
+	// never leaves a half baked cache behind
+	std::string tempFileName = std::string(cacheFileName) + ".tmp";
+	{
+		std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)data.vertices.data(), data.vertices.size() * sizeof(Vertex));
+		out.write((const char*)data.indices.data(), data.indices.size() * sizeof(unsigned int));
+		if (!out.good())
+		{
+			out.close();
+			std::remove(tempFileName.c_str());
+			return false;
+		}
+	}
+
+	std::remove(cacheFileName);
+	return std::rename(tempFileName.c_str(), cacheFileName) == 0;
+}
+
+uint64_t HashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t HashFile(const char* fileName)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+		return 0;
+
+	return HashBytes(file.GetData(), file.GetSize());
+}
+
+std::string GetMeshCachePath(const char* sourceFileName)
+{
+	std::string path(sourceFileName);
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+
+	return path + ".smesh";
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+#include "ObjLoader.h"
+
+// --------------------------------------------------------
+// Layout of a baked mesh (.smesh) file:
+//  - SMeshHeader
+//  - vertexCount Vertex structs (tangents already calculated)
+//  - indexCount 32 bit indices
+//
+// Bump SMESH_VERSION whenever the layout of the file, of
+// Vertex or what gets baked into it changes, so stale caches
+// get rebaked
+// --------------------------------------------------------
+#define SMESH_MAGIC 0x48534D53 // "SMSH"
+#define SMESH_VERSION 2
+
+struct SMeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;	// Hash of the source file's contents
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t vertexStride;	// sizeof(Vertex) when baked
+	uint32_t reserved;
+};
+
+// --------------------------------------------------------
+// A memory mapped view of a baked mesh. The vertex and index
+// pointers point straight into the mapping, so they are only
+// valid while the view is open.
+// --------------------------------------------------------
+class MeshCacheView
+{
+public:
+	// Maps the cache file and validates it against the hash
+	// of the source it was baked from. Returns false if the
+	// file is missing, corrupt or stale.
+	bool Open(const char* cacheFileName, uint64_t expectedSourceHash);
+
+	inline const Vertex* GetVertices() const { return vertices; }
+	inline const unsigned int* GetIndices() const { return indices; }
+	inline unsigned int GetVertexCount() const { return vertexCount; }
+	inline unsigned int GetIndexCount() const { return indexCount; }
+
+private:
+	MappedFile file;
+	const Vertex* vertices = nullptr;
+	const unsigned int* indices = nullptr;
+	unsigned int vertexCount = 0;
+	unsigned int indexCount = 0;
+};
+
+// --------------------------------------------------------
+// The CPU side of loading a mesh file: either maps an up to
+// date baked cache, or parses the source, calculates tangents
+// and bakes a new cache. Touches no D3D objects, so it's safe
+// to run on any thread; the result is then handed to a Mesh.
+// --------------------------------------------------------
+class MeshSource
+{
+public:
+	bool Load(const char* fileName);
+
+	const Vertex* GetVertices() const;
+	const unsigned int* GetIndices() const;
+	unsigned int GetVertexCount() const;
+	unsigned int GetIndexCount() const;
+
+	inline bool IsFromCache() const { return fromCache; }
+
+private:
+	MeshCacheView cache;
+	MeshData data;
+	bool fromCache = false;
+};
+
+// Writes the final vertex and index arrays of a mesh to a cache file
+bool BakeMeshCache(const char* cacheFileName, uint64_t sourceHash, const MeshData& data);
+
+// 64 bit FNV-1a hash of a block of memory
+uint64_t HashBytes(const void* data, size_t size);
+
+// Hash of a whole file's contents, 0 if it can't be read
+uint64_t HashFile(const char* fileName);
+
+// The cache file used for a given source file, i.e. "Models/cube.obj" -> "Models/cube.smesh"
+std::string GetMeshCachePath(const char* sourceFileName);
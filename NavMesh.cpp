@@ -0,0 +1,502 @@
+#include "NavMesh.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace DirectX;
+
+// Corners a triangle can have after being clipped to a height band
+#define NAV_MAX_CLIPPED_CORNERS 8
+
+namespace
+{
+	// Keeps the part of the polygon above (or below) the height
+	int ClipPolygonY(const XMFLOAT3* in, int count, float y, bool keepAbove, XMFLOAT3* out)
+	{
+		int outCount = 0;
+		for (int i = 0; i < count; i++)
+		{
+			const XMFLOAT3& a = in[i];
+			const XMFLOAT3& b = in[(i + 1) % count];
+			float da = keepAbove ? a.y - y : y - a.y;
+			float db = keepAbove ? b.y - y : y - b.y;
+
+			if (da >= 0)
+			{
+				out[outCount++] = a;
+			}
+			if ((da >= 0) != (db >= 0))
+			{
+				float t = da / (da - db);
+				out[outCount++] = XMFLOAT3(a.x + (b.x - a.x) * t, y, a.z + (b.z - a.z) * t);
+			}
+		}
+		return outCount;
+	}
+
+	// Separating axis test of a polygon seen from above against an xz rectangle.
+	// Walls are edge on from above, so degenerate polygons have to work too.
+	bool PolygonOverlapsRect(const XMFLOAT3* corners, int count, float minX, float minZ, float maxX, float maxZ)
+	{
+		float polyMinX = FLT_MAX, polyMaxX = -FLT_MAX;
+		float polyMinZ = FLT_MAX, polyMaxZ = -FLT_MAX;
+		for (int i = 0; i < count; i++)
+		{
+			polyMinX = (std::min)(polyMinX, corners[i].x);
+			polyMaxX = (std::max)(polyMaxX, corners[i].x);
+			polyMinZ = (std::min)(polyMinZ, corners[i].z);
+			polyMaxZ = (std::max)(polyMaxZ, corners[i].z);
+		}
+		if (polyMaxX < minX || polyMinX > maxX || polyMaxZ < minZ || polyMinZ > maxZ)
+			return false;
+
+		for (int i = 0; i < count; i++)
+		{
+			const XMFLOAT3& a = corners[i];
+			const XMFLOAT3& b = corners[(i + 1) % count];
+			float axisX = -(b.z - a.z);
+			float axisZ = b.x - a.x;
+			if (axisX == 0 && axisZ == 0)
+				continue;
+
+			float polyMin = FLT_MAX, polyMax = -FLT_MAX;
+			for (int j = 0; j < count; j++)
+			{
+				float d = corners[j].x * axisX + corners[j].z * axisZ;
+				polyMin = (std::min)(polyMin, d);
+				polyMax = (std::max)(polyMax, d);
+			}
+
+			float r0 = minX * axisX + minZ * axisZ;
+			float r1 = maxX * axisX + minZ * axisZ;
+			float r2 = minX * axisX + maxZ * axisZ;
+			float r3 = maxX * axisX + maxZ * axisZ;
+			float rectMin = (std::min)((std::min)(r0, r1), (std::min)(r2, r3));
+			float rectMax = (std::max)((std::max)(r0, r1), (std::max)(r2, r3));
+			if (polyMax < rectMin || polyMin > rectMax)
+				return false;
+		}
+		return true;
+	}
+}
+
+bool NavMesh::Build(const XMFLOAT3* triangleCorners, size_t triangleCount, const NavMeshSettings& settings)
+{
+	width = 0;
+	depth = 0;
+	walkableCells = 0;
+	heights.clear();
+	walkable.clear();
+	regions.clear();
+
+	cellSize = settings.cellSize;
+	maxStepHeight = settings.maxStepHeight;
+
+	// Only floors can be walked on, so they decide the extents of the grid
+	std::vector<uint8_t> isFloor(triangleCount, 0);
+	float minX = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxZ = -FLT_MAX;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		XMVECTOR a = XMLoadFloat3(&triangleCorners[t * 3 + 0]);
+		XMVECTOR b = XMLoadFloat3(&triangleCorners[t * 3 + 1]);
+		XMVECTOR c = XMLoadFloat3(&triangleCorners[t * 3 + 2]);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+		float length = XMVectorGetX(XMVector3Length(normal));
+		if (length <= 0 || XMVectorGetY(normal) / length < settings.minFloorNormalY)
+			continue;
+
+		isFloor[t] = 1;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const XMFLOAT3& p = triangleCorners[t * 3 + corner];
+			minX = (std::min)(minX, p.x);
+			minZ = (std::min)(minZ, p.z);
+			maxX = (std::max)(maxX, p.x);
+			maxZ = (std::max)(maxZ, p.z);
+		}
+	}
+	if (minX > maxX)
+		return false;
+
+	originX = minX;
+	originZ = minZ;
+	width = (std::max)(1, (int)std::ceil((maxX - minX) / cellSize));
+	depth = (std::max)(1, (int)std::ceil((maxZ - minZ) / cellSize));
+	heights.assign(width * depth, FLT_MAX);
+
+	// Lowest floor under each cell center
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (!isFloor[t])
+			continue;
+
+		const XMFLOAT3& a = triangleCorners[t * 3 + 0];
+		const XMFLOAT3& b = triangleCorners[t * 3 + 1];
+		const XMFLOAT3& c = triangleCorners[t * 3 + 2];
+		float area = (b.z - c.z) * (a.x - c.x) + (c.x - b.x) * (a.z - c.z);
+		if (std::fabs(area) < 1e-8f)
+			continue;
+
+		int x0 = (std::max)(0, (int)std::floor(((std::min)((std::min)(a.x, b.x), c.x) - originX) / cellSize));
+		int z0 = (std::max)(0, (int)std::floor(((std::min)((std::min)(a.z, b.z), c.z) - originZ) / cellSize));
+		int x1 = (std::min)(width - 1, (int)std::floor(((std::max)((std::max)(a.x, b.x), c.x) - originX) / cellSize));
+		int z1 = (std::min)(depth - 1, (int)std::floor(((std::max)((std::max)(a.z, b.z), c.z) - originZ) / cellSize));
+
+		for (int z = z0; z <= z1; z++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				float px = originX + (x + .5f) * cellSize;
+				float pz = originZ + (z + .5f) * cellSize;
+				float w0 = ((b.z - c.z) * (px - c.x) + (c.x - b.x) * (pz - c.z)) / area;
+				float w1 = ((c.z - a.z) * (px - c.x) + (a.x - c.x) * (pz - c.z)) / area;
+				float w2 = 1.f - w0 - w1;
+				if (w0 < -1e-5f || w1 < -1e-5f || w2 < -1e-5f)
+					continue;
+
+				float& height = heights[CellIndex(x, z)];
+				height = (std::min)(height, w0 * a.y + w1 * b.y + w2 * c.y);
+			}
+		}
+	}
+
+	walkable.resize(width * depth);
+	for (int i = 0; i < width * depth; i++)
+	{
+		walkable[i] = heights[i] != FLT_MAX ? 1 : 0;
+	}
+
+	// Anything in the band between a step and the agent's height blocks the cell
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const XMFLOAT3* corners = &triangleCorners[t * 3];
+		float triMinY = (std::min)((std::min)(corners[0].y, corners[1].y), corners[2].y);
+		float triMaxY = (std::max)((std::max)(corners[0].y, corners[1].y), corners[2].y);
+
+		int x0 = (std::max)(0, (int)std::floor(((std::min)((std::min)(corners[0].x, corners[1].x), corners[2].x) - originX) / cellSize));
+		int z0 = (std::max)(0, (int)std::floor(((std::min)((std::min)(corners[0].z, corners[1].z), corners[2].z) - originZ) / cellSize));
+		int x1 = (std::min)(width - 1, (int)std::floor(((std::max)((std::max)(corners[0].x, corners[1].x), corners[2].x) - originX) / cellSize));
+		int z1 = (std::min)(depth - 1, (int)std::floor(((std::max)((std::max)(corners[0].z, corners[1].z), corners[2].z) - originZ) / cellSize));
+
+		for (int z = z0; z <= z1; z++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				int cell = CellIndex(x, z);
+				if (!walkable[cell])
+					continue;
+
+				float bandMin = heights[cell] + settings.maxStepHeight;
+				float bandMax = heights[cell] + settings.agentHeight;
+				if (triMaxY < bandMin || triMinY > bandMax)
+					continue;
+
+				XMFLOAT3 above[NAV_MAX_CLIPPED_CORNERS];
+				XMFLOAT3 band[NAV_MAX_CLIPPED_CORNERS];
+				int aboveCount = ClipPolygonY(corners, 3, bandMin, true, above);
+				int bandCount = ClipPolygonY(above, aboveCount, bandMax, false, band);
+				if (bandCount == 0)
+					continue;
+
+				float cellMinX = originX + x * cellSize;
+				float cellMinZ = originZ + z * cellSize;
+				if (PolygonOverlapsRect(band, bandCount, cellMinX, cellMinZ, cellMinX + cellSize, cellMinZ + cellSize))
+				{
+					walkable[cell] = 0;
+				}
+			}
+		}
+	}
+
+	ErodeWalkable(settings.agentRadius);
+	BuildRegions();
+	return true;
+}
+
+bool NavMesh::Load(const char* fileName, uint64_t expectedSourceHash)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+		return false;
+
+	if (file.GetSize() < sizeof(SNavHeader))
+		return false;
+
+	const SNavHeader* header = (const SNavHeader*)file.GetData();
+	size_t cellCount = (size_t)header->width * header->depth;
+	size_t expectedSize = sizeof(SNavHeader) + cellCount * sizeof(float) + cellCount * sizeof(uint8_t);
+
+	if (header->magic != SNAV_MAGIC ||
+		header->version != SNAV_VERSION ||
+		header->sourceHash != expectedSourceHash ||
+		cellCount == 0 ||
+		file.GetSize() != expectedSize)
+	{
+		return false;
+	}
+
+	width = (int)header->width;
+	depth = (int)header->depth;
+	cellSize = header->cellSize;
+	maxStepHeight = header->maxStepHeight;
+	originX = header->originX;
+	originZ = header->originZ;
+
+	const char* cells = file.GetData() + sizeof(SNavHeader);
+	heights.resize(cellCount);
+	walkable.resize(cellCount);
+	memcpy(heights.data(), cells, cellCount * sizeof(float));
+	memcpy(walkable.data(), cells + cellCount * sizeof(float), cellCount * sizeof(uint8_t));
+
+	BuildRegions();
+	return true;
+}
+
+bool NavMesh::Save(const char* fileName, uint64_t sourceHash) const
+{
+	if (heights.empty())
+		return false;
+
+	SNavHeader header = {};
+	header.magic = SNAV_MAGIC;
+	header.version = SNAV_VERSION;
+	header.sourceHash = sourceHash;
+	header.width = (uint32_t)width;
+	header.depth = (uint32_t)depth;
+	header.cellSize = cellSize;
+	header.maxStepHeight = maxStepHeight;
+	header.originX = originX;
+	header.originZ = originZ;
+
+	// Same as the mesh cache, never leave a half written file behind
+	std::string tempFileName = std::string(fileName) + ".tmp";
+	{
+		std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)heights.data(), heights.size() * sizeof(float));
+		out.write((const char*)walkable.data(), walkable.size() * sizeof(uint8_t));
+		if (!out.good())
+		{
+			out.close();
+			std::remove(tempFileName.c_str());
+			return false;
+		}
+	}
+
+	std::remove(fileName);
+	return std::rename(tempFileName.c_str(), fileName) == 0;
+}
+
+XMFLOAT3 NavMesh::GetCellCenter(int cell) const
+{
+	int x = cell % width;
+	int z = cell / width;
+	return XMFLOAT3(originX + (x + .5f) * cellSize, heights[cell], originZ + (z + .5f) * cellSize);
+}
+
+int NavMesh::GetCell(const XMFLOAT3& position) const
+{
+	int x = (int)std::floor((position.x - originX) / cellSize);
+	int z = (int)std::floor((position.z - originZ) / cellSize);
+	if (x < 0 || z < 0 || x >= width || z >= depth)
+		return -1;
+
+	return CellIndex(x, z);
+}
+
+int NavMesh::FindNearestWalkableCell(const XMFLOAT3& position, int maxCellDistance) const
+{
+	int cell = GetCell(position);
+	if (cell >= 0 && walkable[cell])
+		return cell;
+
+	int centerX = (int)std::floor((position.x - originX) / cellSize);
+	int centerZ = (int)std::floor((position.z - originZ) / cellSize);
+
+	int nearest = -1;
+	float nearestSqDistance = FLT_MAX;
+	for (int z = (std::max)(0, centerZ - maxCellDistance); z <= (std::min)(depth - 1, centerZ + maxCellDistance); z++)
+	{
+		for (int x = (std::max)(0, centerX - maxCellDistance); x <= (std::min)(width - 1, centerX + maxCellDistance); x++)
+		{
+			int candidate = CellIndex(x, z);
+			if (!walkable[candidate])
+				continue;
+
+			float dx = originX + (x + .5f) * cellSize - position.x;
+			float dz = originZ + (z + .5f) * cellSize - position.z;
+			float sqDistance = dx * dx + dz * dz;
+			if (sqDistance < nearestSqDistance)
+			{
+				nearestSqDistance = sqDistance;
+				nearest = candidate;
+			}
+		}
+	}
+	return nearest;
+}
+
+bool NavMesh::CanMove(int x, int z, int dx, int dz) const
+{
+	int nx = x + dx;
+	int nz = z + dz;
+	if (nx < 0 || nz < 0 || nx >= width || nz >= depth)
+		return false;
+
+	int from = CellIndex(x, z);
+	int to = CellIndex(nx, nz);
+	if (!walkable[to] || std::fabs(heights[to] - heights[from]) > maxStepHeight)
+		return false;
+
+	if (dx != 0 && dz != 0)
+	{
+		return walkable[CellIndex(nx, z)] && walkable[CellIndex(x, nz)];
+	}
+	return true;
+}
+
+bool NavMesh::HasLineOfSight(int fromCell, int toCell) const
+{
+	int x = fromCell % width;
+	int z = fromCell / width;
+	int endX = toCell % width;
+	int endZ = toCell / width;
+
+	int dx = endX - x;
+	int dz = endZ - z;
+	int stepX = dx > 0 ? 1 : (dx < 0 ? -1 : 0);
+	int stepZ = dz > 0 ? 1 : (dz < 0 ? -1 : 0);
+
+	// Walk the cells the line between the centers passes through,
+	// t is how far along the line each next cell boundary is
+	float deltaX = dx != 0 ? 1.f / std::abs(dx) : FLT_MAX;
+	float deltaZ = dz != 0 ? 1.f / std::abs(dz) : FLT_MAX;
+	float nextX = dx != 0 ? .5f * deltaX : FLT_MAX;
+	float nextZ = dz != 0 ? .5f * deltaZ : FLT_MAX;
+
+	int steps = std::abs(dx) + std::abs(dz);
+	while ((x != endX || z != endZ) && steps-- > 0)
+	{
+		if (std::fabs(nextX - nextZ) < 1e-6f)
+		{
+			// Right through a corner, both cells next to it have to be clear
+			if (!CanMove(x, z, stepX, stepZ))
+				return false;
+			x += stepX;
+			z += stepZ;
+			nextX += deltaX;
+			nextZ += deltaZ;
+			steps--;
+		}
+		else if (nextX < nextZ)
+		{
+			if (!CanMove(x, z, stepX, 0))
+				return false;
+			x += stepX;
+			nextX += deltaX;
+		}
+		else
+		{
+			if (!CanMove(x, z, 0, stepZ))
+				return false;
+			z += stepZ;
+			nextZ += deltaZ;
+		}
+	}
+	return x == endX && z == endZ;
+}
+
+void NavMesh::ErodeWalkable(float agentRadius)
+{
+	// Offsets of the cells that come closer than the radius to a cell's center
+	int reach = (int)std::ceil(agentRadius / cellSize);
+	std::vector<int> offsetsX;
+	std::vector<int> offsetsZ;
+	for (int dz = -reach; dz <= reach; dz++)
+	{
+		for (int dx = -reach; dx <= reach; dx++)
+		{
+			float gapX = (std::max)(0.f, std::abs(dx) - .5f) * cellSize;
+			float gapZ = (std::max)(0.f, std::abs(dz) - .5f) * cellSize;
+			if ((dx != 0 || dz != 0) && gapX * gapX + gapZ * gapZ < agentRadius * agentRadius)
+			{
+				offsetsX.push_back(dx);
+				offsetsZ.push_back(dz);
+			}
+		}
+	}
+
+	std::vector<uint8_t> original = walkable;
+	for (int z = 0; z < depth; z++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (!original[CellIndex(x, z)])
+				continue;
+
+			// Off the edge of the grid counts as blocked
+			for (size_t i = 0; i < offsetsX.size(); i++)
+			{
+				int nx = x + offsetsX[i];
+				int nz = z + offsetsZ[i];
+				if (nx < 0 || nz < 0 || nx >= width || nz >= depth || !original[CellIndex(nx, nz)])
+				{
+					walkable[CellIndex(x, z)] = 0;
+					break;
+				}
+			}
+		}
+	}
+}
+
+void NavMesh::BuildRegions()
+{
+	regions.assign(width * depth, 0);
+	walkableCells = 0;
+
+	uint32_t regionCount = 0;
+	std::vector<int> open;
+	for (int start = 0; start < width * depth; start++)
+	{
+		if (!walkable[start] || regions[start] != 0)
+			continue;
+
+		// Flood fill using the same moves as the path search
+		regionCount++;
+		regions[start] = regionCount;
+		open.push_back(start);
+		while (!open.empty())
+		{
+			int cell = open.back();
+			open.pop_back();
+			walkableCells++;
+
+			int x = cell % width;
+			int z = cell / width;
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					if ((dx != 0 || dz != 0) && CanMove(x, z, dx, dz))
+					{
+						int next = CellIndex(x + dx, z + dz);
+						if (regions[next] == 0)
+						{
+							regions[next] = regionCount;
+							open.push_back(next);
+						}
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Layout of a baked nav mesh (.snav) file:
+//  - SNavHeader
+//  - width * depth floor heights (floats)
+//  - width * depth walkable flags (bytes)
+//
+// Bump SNAV_VERSION whenever the layout or the build rules
+// change, so stale caches get rebuilt
+// --------------------------------------------------------
+#define SNAV_MAGIC 0x56414E53 // "SNAV"
+#define SNAV_VERSION 1
+
+struct SNavHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;	// Hash of the geometry and settings it was built from
+	uint32_t width;
+	uint32_t depth;
+	float cellSize;
+	float maxStepHeight;
+	float originX;
+	float originZ;
+};
+
+// --------------------------------------------------------
+// How the walkable area is carved out of the level, in
+// world units
+// --------------------------------------------------------
+struct NavMeshSettings
+{
+	float cellSize = .25f;
+	float agentRadius = .5f;		// Walkable cells keep at least this far from anything solid
+	float agentHeight = 2.f;		// Clearance needed above the floor
+	float maxStepHeight = .4f;		// Taller ledges block movement
+	float minFloorNormalY = .7f;	// Steeper triangles are never floors
+};
+
+// --------------------------------------------------------
+// The walkable floor of the level, rasterized into a grid
+// of cells seen from above
+//
+// - Floors are the lowest upward facing triangles under each
+//   cell, anything solid between a step and an agent's
+//   height above that floor blocks the cell
+// - The blocked area is grown by the agent radius, so paths
+//   through walkable cell centers keep clear of the walls
+// - Cells reachable from each other share a region id, so
+//   impossible requests are rejected without a search
+// - Building is slow compared to loading, so the result is
+//   baked to a .snav file keyed by a hash of its inputs
+// --------------------------------------------------------
+class NavMesh
+{
+public:
+	// Triangles are 3 world space corners each, wound like LoadObj's output
+	bool Build(const DirectX::XMFLOAT3* triangleCorners, size_t triangleCount, const NavMeshSettings& settings);
+
+	// Returns false if the file is missing, corrupt or built from something else
+	bool Load(const char* fileName, uint64_t expectedSourceHash);
+	bool Save(const char* fileName, uint64_t sourceHash) const;
+
+	inline int GetWidth() const { return width; }
+	inline int GetDepth() const { return depth; }
+	inline int GetCellCount() const { return width * depth; }
+	inline float GetCellSize() const { return cellSize; }
+	inline int GetWalkableCellCount() const { return walkableCells; }
+
+	inline bool IsWalkable(int cell) const { return walkable[cell] != 0; }
+	inline uint32_t GetRegion(int cell) const { return regions[cell]; }
+	inline int CellIndex(int x, int z) const { return z * width + x; }
+
+	// Cell center on the floor
+	DirectX::XMFLOAT3 GetCellCenter(int cell) const;
+
+	// The cell under the position, -1 outside the grid
+	int GetCell(const DirectX::XMFLOAT3& position) const;
+
+	// The walkable cell closest to the position within a few cells, -1 if there's none
+	int FindNearestWalkableCell(const DirectX::XMFLOAT3& position, int maxCellDistance) const;
+
+	// True if an agent can move from the cell to its neighbour at (x + dx, z + dz).
+	// Diagonal moves can't cut the corner of a blocked cell.
+	bool CanMove(int x, int z, int dx, int dz) const;
+
+	// True if every cell on the straight line between the two cell centers can be walked in a row
+	bool HasLineOfSight(int fromCell, int toCell) const;
+
+private:
+	void ErodeWalkable(float agentRadius);
+	void BuildRegions();
+
+	int width = 0;
+	int depth = 0;
+	float cellSize = 1.f;
+	float maxStepHeight = 0;
+	float originX = 0;
+	float originZ = 0;
+	int walkableCells = 0;
+
+	std::vector<float> heights;
+	std::vector<uint8_t> walkable;
+	std::vector<uint32_t> regions;	// 0 for blocked cells
+};
@@ -0,0 +1,181 @@
+#include "NavMeshQuery.h"
+#include "NavMesh.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+#define NAV_DIAGONAL_COST 1.41421356f
+
+// Nudges the search toward the goal when many routes cost the same, which
+// is most of them on an open floor. Paths can come out this much too long.
+#define NAV_HEURISTIC_TIE_BREAK 1.001f
+
+NavMeshQuery::NavMeshQuery(const NavMesh* navMesh)
+{
+	this->navMesh = navMesh;
+}
+
+NavQueryStatus NavMeshQuery::Begin(int startCell, int goalCell)
+{
+	this->startCell = startCell;
+	this->goalCell = goalCell;
+	expansions = 0;
+	open.clear();
+
+	int cellCount = navMesh->GetCellCount();
+	if (startCell < 0 || goalCell < 0 || startCell >= cellCount || goalCell >= cellCount ||
+		!navMesh->IsWalkable(startCell) || !navMesh->IsWalkable(goalCell) ||
+		navMesh->GetRegion(startCell) != navMesh->GetRegion(goalCell))
+	{
+		status = NavQueryStatus::Failed;
+		return status;
+	}
+
+	if ((int)stamps.size() != cellCount)
+	{
+		stamps.assign(cellCount, 0);
+		costs.resize(cellCount);
+		parents.resize(cellCount);
+		closed.resize(cellCount);
+		searchId = 0;
+	}
+
+	// Wrapped around, every old stamp could look current again
+	if (++searchId == 0)
+	{
+		std::fill(stamps.begin(), stamps.end(), 0);
+		searchId = 1;
+	}
+
+	stamps[startCell] = searchId;
+	costs[startCell] = 0;
+	parents[startCell] = -1;
+	closed[startCell] = 0;
+	Push(startCell, Heuristic(startCell));
+
+	status = NavQueryStatus::InProgress;
+	return status;
+}
+
+NavQueryStatus NavMeshQuery::Step(unsigned int maxExpansions)
+{
+	if (status != NavQueryStatus::InProgress)
+		return status;
+
+	int width = navMesh->GetWidth();
+
+	for (unsigned int i = 0; i < maxExpansions; i++)
+	{
+		if (open.empty())
+		{
+			status = NavQueryStatus::Failed;
+			return status;
+		}
+
+		std::pop_heap(open.begin(), open.end(), CostGreater);
+		int cell = open.back().cell;
+		open.pop_back();
+
+		// Stale heap entries are left behind when a cheaper route is found
+		if (closed[cell])
+			continue;
+		closed[cell] = 1;
+		expansions++;
+
+		if (cell == goalCell)
+		{
+			status = NavQueryStatus::Found;
+			return status;
+		}
+
+		int x = cell % width;
+		int z = cell / width;
+		for (int dz = -1; dz <= 1; dz++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				if ((dx == 0 && dz == 0) || !navMesh->CanMove(x, z, dx, dz))
+					continue;
+
+				int next = cell + dz * width + dx;
+				float cost = costs[cell] + (dx != 0 && dz != 0 ? NAV_DIAGONAL_COST : 1.f);
+				if (stamps[next] == searchId)
+				{
+					if (closed[next] || cost >= costs[next])
+						continue;
+				}
+				else
+				{
+					stamps[next] = searchId;
+					closed[next] = 0;
+				}
+
+				costs[next] = cost;
+				parents[next] = cell;
+				Push(next, cost + Heuristic(next));
+			}
+		}
+	}
+	return status;
+}
+
+NavQueryStatus NavMeshQuery::FindPath(int startCell, int goalCell)
+{
+	Begin(startCell, goalCell);
+	while (status == NavQueryStatus::InProgress)
+	{
+		Step(UINT32_MAX);
+	}
+	return status;
+}
+
+void NavMeshQuery::GetCorners(std::vector<XMFLOAT3>& corners) const
+{
+	corners.clear();
+	if (status != NavQueryStatus::Found)
+		return;
+
+	// Cells from the goal back to the start
+	std::vector<int> cells;
+	for (int cell = goalCell; cell != -1; cell = parents[cell])
+	{
+		cells.push_back(cell);
+	}
+	std::reverse(cells.begin(), cells.end());
+
+	// Keep going straight until the line of sight breaks, then turn at the last cell that was still visible
+	int anchor = 0;
+	for (int i = 2; i < (int)cells.size(); i++)
+	{
+		if (!navMesh->HasLineOfSight(cells[anchor], cells[i]))
+		{
+			anchor = i - 1;
+			corners.push_back(navMesh->GetCellCenter(cells[anchor]));
+		}
+	}
+	corners.push_back(navMesh->GetCellCenter(goalCell));
+}
+
+float NavMeshQuery::Heuristic(int cell) const
+{
+	// Octile distance, exact on an empty grid with diagonal moves
+	int width = navMesh->GetWidth();
+	float dx = (float)std::abs(cell % width - goalCell % width);
+	float dz = (float)std::abs(cell / width - goalCell / width);
+	return ((std::max)(dx, dz) + (NAV_DIAGONAL_COST - 1.f) * (std::min)(dx, dz)) * NAV_HEURISTIC_TIE_BREAK;
+}
+
+bool NavMeshQuery::CostGreater(const OpenNode& a, const OpenNode& b)
+{
+	return a.cost > b.cost;
+}
+
+void NavMeshQuery::Push(int cell, float cost)
+{
+	OpenNode node;
+	node.cost = cost;
+	node.cell = cell;
+	open.push_back(node);
+	std::push_heap(open.begin(), open.end(), CostGreater);
+}
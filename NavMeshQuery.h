@@ -0,0 +1,72 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+class NavMesh;
+
+enum class NavQueryStatus
+{
+	Failed,
+	InProgress,
+	Found
+};
+
+// --------------------------------------------------------
+// A* over the cells of a NavMesh
+//
+// - Searches are sliced: Begin() then Step() with a limit on
+//   the cells expanded, so a long search can be spread over
+//   several frames
+// - The per cell scratch arrays are stamped with a search id
+//   instead of being cleared, so starting a search costs
+//   nothing no matter how big the mesh is
+// - Found paths are string pulled down to the cells where
+//   the line of sight breaks
+// - One search at a time, use a query per thread
+// --------------------------------------------------------
+class NavMeshQuery
+{
+public:
+	NavMeshQuery(const NavMesh* navMesh);
+
+	NavQueryStatus Begin(int startCell, int goalCell);
+	NavQueryStatus Step(unsigned int maxExpansions);
+
+	// Runs a whole search at once
+	NavQueryStatus FindPath(int startCell, int goalCell);
+
+	// Corners of the last found path after the start cell, ending in the goal cell
+	void GetCorners(std::vector<DirectX::XMFLOAT3>& corners) const;
+
+	inline NavQueryStatus GetStatus() const { return status; }
+	inline unsigned int GetExpansions() const { return expansions; }
+
+private:
+	struct OpenNode
+	{
+		float cost;		// Cost so far plus the heuristic
+		int cell;
+	};
+
+	static bool CostGreater(const OpenNode& a, const OpenNode& b);
+	float Heuristic(int cell) const;
+	void Push(int cell, float cost);
+
+	const NavMesh* navMesh;
+
+	int startCell = -1;
+	int goalCell = -1;
+	NavQueryStatus status = NavQueryStatus::Failed;
+	unsigned int expansions = 0;
+
+	// Per cell, only valid where stamps matches searchId
+	uint32_t searchId = 0;
+	std::vector<uint32_t> stamps;
+	std::vector<float> costs;
+	std::vector<int> parents;
+	std::vector<uint8_t> closed;
+
+	std::vector<OpenNode> open;	// Min heap on cost
+};
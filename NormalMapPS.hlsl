@@ -1,11 +1,22 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer ExternalData : register(b0) 
+// The light array is large, so keep it away from
+// the per material data that changes between draws
+cbuffer PerFrame : register(b0)
 {
 	Light lights[MAX_LIGHTS];
-	int lightCount;
 
+	float4 viewDepthPlane; // dot with the world position for view space depth
 	float3 cameraPosition;
+	int globalLightCount;
+
+	float2 clusterTileScale;
+	float clusterSliceScale;
+	float clusterSliceBias;
+}
+
+cbuffer PerMaterial : register(b1)
+{
 	float shininess;
 }
 
@@ -16,7 +27,9 @@ SamplerState samplerOptions:	register(s0);
 
 float4 main( V2P_NormalMap input ) : SV_TARGET
 {
-	float3 unpackedNormal = normalMap.Sample(samplerOptions, input.uv).rgb * 2 - 1;
+	// normal maps are baked to BC5, which only keeps x and y
+	float2 xy = normalMap.Sample(samplerOptions, input.uv).rg * 2 - 1;
+	float3 unpackedNormal = float3(xy, sqrt(saturate(1 - dot(xy, xy))));
 	input.normal = normalize(input.normal);
 	input.tangent = normalize(input.tangent);
 
@@ -39,32 +52,17 @@ float4 main( V2P_NormalMap input ) : SV_TARGET
 	pixelData.worldPos = input.worldPos;
 	pixelData.shininess = shininess;
 
-	for (int i = 0; i < lightCount; i++) 
+	// Lights that reach everywhere, then only the ones binned into this pixel's cluster
+	for (int i = 0; i < globalLightCount; i++)
+	{
+		finalLight += AccumulateLight(pixelData, cameraPosition, lights[clusterLightIndices[i]]);
+	}
+
+	uint cluster = GetClusterIndex(input.position.xy, dot(float4(input.worldPos, 1), viewDepthPlane), clusterTileScale, clusterSliceScale, clusterSliceBias);
+	uint2 range = clusterLightRanges[cluster];
+	for (uint j = 0; j < range.y; j++)
 	{
-		// point light diffuse & spec
-		switch(lights[i].type) 
-		{
-		case LIGHT_TYPE_POINT:
-			///
-			finalLight += PointLight(pixelData, cameraPosition, lights[i]);
-			///
-			break;
-		case LIGHT_TYPE_DIR:
-			///
-			finalLight += DirectionLight(pixelData, cameraPosition, lights[i]);
-			///
-			break;
-		case LIGHT_TYPE_SPOT:
-			///
-			finalLight += SpotLight(pixelData, cameraPosition, lights[i]);
-			///
-			break;
-		case LIGHT_TYPE_AMBIENT:
-			///
-			finalLight += AmbientLight(lights[i]);
-			///
-			break;
-		}
+		finalLight += AccumulateLight(pixelData, cameraPosition, lights[clusterLightIndices[range.x + j]]);
 	}
 
 	return float4(finalLight * (float3)input.color, 1);
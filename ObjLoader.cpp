@@ -0,0 +1,433 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include <unordered_map>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+// The attributes of a single face corner from an OBJ file.
+// Corners are matched by value rather than by their indices
+// in the file, since many exporters write out a separate
+// normal or uv for every corner even when they're identical.
+struct ObjVertexKey
+{
+	XMFLOAT3 position;
+	XMFLOAT2 uv;
+	XMFLOAT3 normal;
+
+	bool operator==(const ObjVertexKey& other) const
+	{
+		return memcmp(this, &other, sizeof(ObjVertexKey)) == 0;
+	}
+};
+
+struct ObjVertexKeyHash
+{
+	size_t operator()(const ObjVertexKey& key) const
+	{
+		// FNV-1a over the raw bits of the attributes
+		const unsigned char* bytes = (const unsigned char*)&key;
+		size_t hash = 2166136261u;
+		for (size_t i = 0; i < sizeof(ObjVertexKey); i++)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		return hash;
+	}
+};
+
+// --------------------------------------------------------
+// Hand written scanners that work directly on the mapped
+// file. Each one advances the cursor past what it read and
+// never reads past the end pointer.
+// --------------------------------------------------------
+static inline bool IsLineSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline void SkipLineSpace(const char*& p, const char* end)
+{
+	while (p < end && IsLineSpace(*p))
+		p++;
+}
+
+static inline void SkipLine(const char*& p, const char* end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	if (p < end)
+		p++;
+}
+
+static inline bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static float ScanFloat(const char*& p, const char* end)
+{
+	static const double powersOf10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+		1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+	};
+
+	SkipLineSpace(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	// Accumulate all significant digits as one integer
+	unsigned long long mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	while (p < end && IsDigit(*p))
+	{
+		if (digits < 18) { mantissa = mantissa * 10 + (*p - '0'); digits++; }
+		else exponent++;
+		p++;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && IsDigit(*p))
+		{
+			if (digits < 18) { mantissa = mantissa * 10 + (*p - '0'); digits++; exponent--; }
+			p++;
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool negativeExp = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negativeExp = *p == '-';
+			p++;
+		}
+		int e = 0;
+		while (p < end && IsDigit(*p))
+		{
+			e = e * 10 + (*p - '0');
+			p++;
+		}
+		exponent += negativeExp ? -e : e;
+	}
+
+	double value = (double)mantissa;
+	while (exponent > 0)
+	{
+		int step = exponent > 18 ? 18 : exponent;
+		value *= powersOf10[step];
+		exponent -= step;
+	}
+	while (exponent < 0)
+	{
+		int step = -exponent > 18 ? 18 : -exponent;
+		value /= powersOf10[step];
+		exponent += step;
+	}
+
+	return (float)(negative ? -value : value);
+}
+
+// Reads an OBJ index, resolving negative (relative) indices
+// against the current element count. Returns 0 if missing.
+static unsigned int ScanIndex(const char*& p, const char* end, size_t count)
+{
+	bool negative = false;
+	if (p < end && *p == '-')
+	{
+		negative = true;
+		p++;
+	}
+
+	long long value = 0;
+	while (p < end && IsDigit(*p))
+	{
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+
+	if (negative)
+		value = (long long)count - value + 1;
+
+	return value > 0 ? (unsigned int)value : 0;
+}
+
+bool LoadObj(const char* fileName, MeshData& outData, ObjLoadStats* outStats)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	MappedFile file;
+	if (!file.Open(fileName))
+		return false;
+
+	const char* p = file.GetData();
+	const char* end = p + file.GetSize();
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions;     // Positions from the file
+	std::vector<XMFLOAT3> normals;       // Normals from the file
+	std::vector<XMFLOAT2> uvs;           // UVs from the file
+	std::vector<Vertex>& verts = outData.vertices;
+	std::vector<unsigned int>& indices = outData.indices;
+	size_t cornerCount = 0;
+
+	verts.clear();
+	indices.clear();
+
+	// Rough guesses based on typical files, saves most regrowing
+	size_t estimatedLines = file.GetSize() / 32;
+	positions.reserve(estimatedLines / 4);
+	normals.reserve(estimatedLines / 4);
+	uvs.reserve(estimatedLines / 4);
+	verts.reserve(estimatedLines / 2);
+	indices.reserve(estimatedLines);
+
+	// Maps a position/uv/normal triplet to the index
+	// of the vertex we already built for it
+	std::unordered_map<ObjVertexKey, unsigned int, ObjVertexKeyHash> uniqueVerts;
+	uniqueVerts.reserve(estimatedLines / 2);
+
+	// Returns the index of the vertex for a face corner,
+	// only building a new vertex the first time its attributes are seen
+	// - OBJ File indices are 1-based, so they need to be adusted
+	// - Missing or out of range indices leave that attribute zeroed
+	auto getOrAddVertex = [&](unsigned int position, unsigned int uv, unsigned int normal) -> unsigned int
+	{
+		cornerCount++;
+
+		ObjVertexKey key = {};
+		if (position > 0 && position <= positions.size())
+			key.position = positions[position - 1];
+		if (uv > 0 && uv <= uvs.size())
+			key.uv = uvs[uv - 1];
+		if (normal > 0 && normal <= normals.size())
+			key.normal = normals[normal - 1];
+
+		auto found = uniqueVerts.find(key);
+		if (found != uniqueVerts.end())
+			return found->second;
+
+		Vertex v = {};
+		v.Position = key.position;
+		v.UV = key.uv;
+		v.Normal = key.normal;
+
+		// The model is most likely in a right-handed space,
+		// especially if it came from Maya.  We want to convert
+		// to a left-handed space for DirectX.  This means we
+		// need to:
+		//  - Invert the Z position
+		//  - Invert the normal's Z
+		//  - Flip the winding order (done by the caller)
+		// We also need to flip the UV coordinate since DirectX
+		// defines (0,0) as the top left of the texture, and many
+		// 3D modeling packages use the bottom left as (0,0)
+		v.UV.y = 1.0f - v.UV.y;
+		v.Position.z *= -1.0f;
+		v.Normal.z *= -1.0f;
+
+		unsigned int index = (unsigned int)verts.size();
+		verts.push_back(v);
+		uniqueVerts.emplace(key, index);
+		return index;
+	};
+
+	while (p < end)
+	{
+		SkipLineSpace(p, end);
+		if (p >= end)
+			break;
+
+		if (p[0] == 'v' && p + 1 < end)
+		{
+			if (p[1] == 'n')
+			{
+				p += 2;
+				XMFLOAT3 norm;
+				norm.x = ScanFloat(p, end);
+				norm.y = ScanFloat(p, end);
+				norm.z = ScanFloat(p, end);
+				normals.push_back(norm);
+			}
+			else if (p[1] == 't')
+			{
+				p += 2;
+				XMFLOAT2 uv;
+				uv.x = ScanFloat(p, end);
+				uv.y = ScanFloat(p, end);
+				uvs.push_back(uv);
+			}
+			else if (IsLineSpace(p[1]))
+			{
+				p += 1;
+				XMFLOAT3 pos;
+				pos.x = ScanFloat(p, end);
+				pos.y = ScanFloat(p, end);
+				pos.z = ScanFloat(p, end);
+				positions.push_back(pos);
+			}
+		}
+		else if (p[0] == 'f' && p + 1 < end && IsLineSpace(p[1]))
+		{
+			p += 1;
+
+			// Faces can have any number of corners, so split
+			// them into a fan around the first corner:
+			//  (0,1,2), (0,2,3), (0,3,4) ...
+			unsigned int first = 0;
+			unsigned int previous = 0;
+			int corner = 0;
+
+			while (true)
+			{
+				SkipLineSpace(p, end);
+				if (p >= end || !(IsDigit(*p) || *p == '-'))
+					break;
+
+				unsigned int position = ScanIndex(p, end, positions.size());
+				unsigned int uv = 0;
+				unsigned int normal = 0;
+				if (p < end && *p == '/')
+				{
+					p++;
+					uv = ScanIndex(p, end, uvs.size());
+					if (p < end && *p == '/')
+					{
+						p++;
+						normal = ScanIndex(p, end, normals.size());
+					}
+				}
+
+				unsigned int index = getOrAddVertex(position, uv, normal);
+				if (corner == 0)
+				{
+					first = index;
+				}
+				else if (corner >= 2)
+				{
+					// Add a whole triangle (flipping the winding order)
+					indices.push_back(first);
+					indices.push_back(index);
+					indices.push_back(previous);
+				}
+
+				previous = index;
+				corner++;
+			}
+		}
+
+		SkipLine(p, end);
+	}
+
+	if (outStats)
+	{
+		outStats->fileBytes = file.GetSize();
+		outStats->cornerCount = cornerCount;
+		outStats->parseSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	return !verts.empty() && !indices.empty();
+}
+
+// Calculates the tangents of the vertices in a mesh
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - Note: For this code to work, your Vertex format must
+//         contain an XMFLOAT3 called Tangent
+void CalculateTangents(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+{
+	// Reset tangents
+	for (int i = 0; i < numVerts; i++)
+	{
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (int i = 0; i < numIndices;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// A triangle whose uvs are collinear has no tangent direction, and
+		// since vertices are shared it would spread inf/NaN to its neighbors
+		float determinant = s1 * t2 - s2 * t1;
+		if (fabsf(determinant) < TANGENT_MIN_UV_DETERMINANT)
+			continue;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / determinant;
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->Tangent.x += tx;
+		v1->Tangent.y += ty;
+		v1->Tangent.z += tz;
+
+		v2->Tangent.x += tx;
+		v2->Tangent.y += ty;
+		v2->Tangent.z += tz;
+
+		v3->Tangent.x += tx;
+		v3->Tangent.y += ty;
+		v3->Tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (int i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+		// Use Gram-Schmidt orthogonalize
+		tangent = tangent - normal * XMVector3Dot(normal, tangent);
+
+		// Only degenerate triangles touched this vertex, any
+		// direction along the surface beats a zero tangent
+		if (XMVectorGetX(XMVector3LengthSq(tangent)) < TANGENT_MIN_UV_DETERMINANT)
+		{
+			XMVECTOR axis = fabsf(verts[i].Normal.x) < .9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+			tangent = XMVector3Cross(normal, axis);
+		}
+
+		tangent = XMVector3Normalize(tangent);
+
+		// Store the tangent
+		XMStoreFloat3(&verts[i].Tangent, tangent);
+	}
+}
\ No newline at end of file
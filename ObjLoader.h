@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// CPU side result of parsing a mesh file, ready to be
+// handed to the GPU as a vertex and index buffer
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+};
+
+// --------------------------------------------------------
+// Timing and size information for a single load
+// --------------------------------------------------------
+struct ObjLoadStats
+{
+	size_t fileBytes = 0;		// Size of the source file
+	size_t cornerCount = 0;		// Face corners read, i.e. the vertex count without any reuse
+	double parseSeconds = 0;	// Time spent reading and parsing the file
+
+	inline double MegabytesPerSecond() const
+	{
+		return parseSeconds > 0 ? (fileBytes / (1024.0 * 1024.0)) / parseSeconds : 0;
+	}
+};
+
+// --------------------------------------------------------
+// Loads an OBJ file into deduplicated, indexed vertex data
+//
+// - The whole file is mapped (or bulk read) into memory and
+//   scanned in place, so no per-line allocation happens
+// - Converts from right handed to left handed space and
+//   splits any polygon into a triangle fan
+// - Returns false if the file couldn't be read or is empty
+// --------------------------------------------------------
+bool LoadObj(const char* fileName, MeshData& outData, ObjLoadStats* outStats = nullptr);
+
+// Triangles with a smaller uv determinant than this add nothing to the tangents
+#define TANGENT_MIN_UV_DETERMINANT 1e-12f
+
+// --------------------------------------------------------
+// Calculates per vertex tangents from positions and uvs,
+// overwriting any tangents already in the vertices.
+// Triangles with degenerate uvs are skipped, and vertices
+// only they touch get some tangent along the surface.
+// --------------------------------------------------------
+void CalculateTangents(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices);
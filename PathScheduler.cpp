@@ -0,0 +1,154 @@
+#include "PathScheduler.h"
+#include "NavMesh.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <limits>
+
+using namespace DirectX;
+
+// Starts and goals this many cells from the walkable area get moved onto it
+#define PATH_SNAP_CELLS 8
+
+// Cells a search expands between checks of the clock
+#define PATH_EXPANSIONS_PER_SLICE 128
+
+PathScheduler::PathScheduler(const NavMesh* navMesh, size_t cacheCapacity)
+	: query(navMesh)
+{
+	this->navMesh = navMesh;
+	this->cacheCapacity = cacheCapacity;
+	active = {};
+}
+
+void PathScheduler::Request(uint32_t owner, XMFLOAT3 start, XMFLOAT3 goal)
+{
+	PathRequest request;
+	request.owner = owner;
+	request.goal = goal;
+	request.startCell = navMesh->FindNearestWalkableCell(start, PATH_SNAP_CELLS);
+	request.goalCell = navMesh->FindNearestWalkableCell(goal, PATH_SNAP_CELLS);
+	queue.push_back(request);
+}
+
+void PathScheduler::Process(double budgetSeconds, std::vector<PathResult>& results)
+{
+	Process(budgetSeconds, UINT_MAX, results);
+}
+
+void PathScheduler::ProcessExpansions(unsigned int maxExpansions, std::vector<PathResult>& results)
+{
+	Process(std::numeric_limits<double>::infinity(), maxExpansions, results);
+}
+
+void PathScheduler::Process(double budgetSeconds, unsigned int maxExpansions, std::vector<PathResult>& results)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	stats = PathSchedulerStats();
+
+	std::vector<XMFLOAT3> noCorners;
+	while (true)
+	{
+		if (!searching)
+		{
+			if (queue.empty())
+				break;
+
+			PathRequest request = queue.front();
+			queue.pop_front();
+
+			uint64_t key = ((uint64_t)(uint32_t)request.startCell << 32) | (uint32_t)request.goalCell;
+			std::unordered_map<uint64_t, CachedPath>::iterator cached = cache.find(key);
+
+			if (request.startCell < 0 || request.goalCell < 0 ||
+				navMesh->GetRegion(request.startCell) != navMesh->GetRegion(request.goalCell))
+			{
+				Finish(request, false, noCorners, results);
+			}
+			else if (cached != cache.end())
+			{
+				cached->second.lastUsed = ++useCounter;
+				stats.cacheHits++;
+				Finish(request, cached->second.found, cached->second.corners, results);
+			}
+			else
+			{
+				active = request;
+				query.Begin(request.startCell, request.goalCell);
+				searching = true;
+			}
+		}
+
+		if (searching)
+		{
+			unsigned int expanded = query.GetExpansions();
+			NavQueryStatus status = query.Step((std::min)((unsigned int)PATH_EXPANSIONS_PER_SLICE, maxExpansions - stats.expansions));
+			stats.expansions += query.GetExpansions() - expanded;
+
+			if (status != NavQueryStatus::InProgress)
+			{
+				bool found = status == NavQueryStatus::Found;
+				query.GetCorners(corners);
+				AddToCache(((uint64_t)(uint32_t)active.startCell << 32) | (uint32_t)active.goalCell, found, corners);
+				Finish(active, found, corners, results);
+				searching = false;
+			}
+		}
+
+		if (stats.expansions >= maxExpansions ||
+			std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() >= budgetSeconds)
+			break;
+	}
+
+	stats.queued = (unsigned int)GetQueuedCount();
+	stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void PathScheduler::ClearCache()
+{
+	cache.clear();
+}
+
+void PathScheduler::Finish(const PathRequest& request, bool found, const std::vector<XMFLOAT3>& corners, std::vector<PathResult>& results)
+{
+	PathResult result;
+	result.owner = request.owner;
+	result.found = found;
+	if (found)
+	{
+		// The path ends at the goal cell's center, finish at the exact goal instead
+		result.corners = corners;
+		result.corners.back().x = request.goal.x;
+		result.corners.back().z = request.goal.z;
+		stats.completed++;
+	}
+	else
+	{
+		stats.failed++;
+	}
+	results.push_back(std::move(result));
+}
+
+void PathScheduler::AddToCache(uint64_t key, bool found, const std::vector<XMFLOAT3>& corners)
+{
+	if (cacheCapacity == 0)
+		return;
+
+	if (cache.size() >= cacheCapacity)
+	{
+		std::unordered_map<uint64_t, CachedPath>::iterator oldest = cache.begin();
+		for (std::unordered_map<uint64_t, CachedPath>::iterator it = cache.begin(); it != cache.end(); ++it)
+		{
+			if (it->second.lastUsed < oldest->second.lastUsed)
+			{
+				oldest = it;
+			}
+		}
+		cache.erase(oldest);
+	}
+
+	CachedPath& entry = cache[key];
+	entry.found = found;
+	entry.corners = corners;
+	entry.lastUsed = ++useCounter;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "NavMeshQuery.h"
+
+class NavMesh;
+
+// --------------------------------------------------------
+// Counts from the last PathScheduler::Process()
+// --------------------------------------------------------
+struct PathSchedulerStats
+{
+	unsigned int completed = 0;
+	unsigned int failed = 0;
+	unsigned int cacheHits = 0;
+	unsigned int expansions = 0;	// Cells the searches expanded
+	unsigned int queued = 0;		// Still waiting afterwards
+	double seconds = 0;
+};
+
+// --------------------------------------------------------
+// A path handed back by the scheduler, corners run from just
+// after the start position to the requested goal
+// --------------------------------------------------------
+struct PathResult
+{
+	uint32_t owner;
+	bool found;
+	std::vector<DirectX::XMFLOAT3> corners;
+};
+
+// --------------------------------------------------------
+// Spreads path requests over as many frames as it takes to
+// stay inside a time budget
+//
+// - Requests are served in order, one search at a time. A
+//   search that runs out of budget picks up where it left
+//   off next frame.
+// - Results are cached by start and goal cell, so agents
+//   patrolling the same legs only search once. The least
+//   recently used path goes when the cache is full.
+// - Keeping to one request per owner at a time is up to
+//   the caller
+// --------------------------------------------------------
+class PathScheduler
+{
+public:
+	PathScheduler(const NavMesh* navMesh, size_t cacheCapacity = 256);
+
+	void Request(uint32_t owner, DirectX::XMFLOAT3 start, DirectX::XMFLOAT3 goal);
+
+	// Searches until the budget is spent, finished paths are appended to results
+	void Process(double budgetSeconds, std::vector<PathResult>& results);
+
+	// Same with the budget in expanded cells, so the results don't depend on how fast the machine is
+	void ProcessExpansions(unsigned int maxExpansions, std::vector<PathResult>& results);
+
+	void ClearCache();
+
+	inline size_t GetQueuedCount() const { return queue.size() + (searching ? 1 : 0); }
+	inline const PathSchedulerStats& GetStats() const { return stats; }
+
+private:
+	struct PathRequest
+	{
+		uint32_t owner;
+		DirectX::XMFLOAT3 goal;
+		int startCell;
+		int goalCell;
+	};
+
+	struct CachedPath
+	{
+		bool found;
+		std::vector<DirectX::XMFLOAT3> corners;
+		uint64_t lastUsed;
+	};
+
+	void Process(double budgetSeconds, unsigned int maxExpansions, std::vector<PathResult>& results);
+	void Finish(const PathRequest& request, bool found, const std::vector<DirectX::XMFLOAT3>& corners, std::vector<PathResult>& results);
+	void AddToCache(uint64_t key, bool found, const std::vector<DirectX::XMFLOAT3>& corners);
+
+	const NavMesh* navMesh;
+	NavMeshQuery query;
+
+	std::deque<PathRequest> queue;
+	PathRequest active;
+	bool searching = false;
+	std::vector<DirectX::XMFLOAT3> corners;
+
+	std::unordered_map<uint64_t, CachedPath> cache;
+	size_t cacheCapacity;
+	uint64_t useCounter = 0;
+
+	PathSchedulerStats stats;
+};
@@ -1,11 +1,22 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer ExternalData : register(b0) 
+// The light array is large, so keep it away from
+// the per material data that changes between draws
+cbuffer PerFrame : register(b0)
 {
 	Light lights[MAX_LIGHTS];
-	int lightCount;
 
+	float4 viewDepthPlane; // dot with the world position for view space depth
 	float3 cameraPosition;
+	int globalLightCount;
+
+	float2 clusterTileScale;
+	float clusterSliceScale;
+	float clusterSliceBias;
+}
+
+cbuffer PerMaterial : register(b1)
+{
 	float shininess;
 }
 
@@ -26,32 +37,17 @@ float4 main(VertexToPixel input) : SV_TARGET
 	pixelData.worldPos = input.worldPos;
 	pixelData.shininess = shininess;
 
-	for (int i = 0; i < lightCount; i++) 
+	// Lights that reach everywhere, then only the ones binned into this pixel's cluster
+	for (int i = 0; i < globalLightCount; i++)
+	{
+		finalLight += AccumulateLight(pixelData, cameraPosition, lights[clusterLightIndices[i]]);
+	}
+
+	uint cluster = GetClusterIndex(input.position.xy, dot(float4(input.worldPos, 1), viewDepthPlane), clusterTileScale, clusterSliceScale, clusterSliceBias);
+	uint2 range = clusterLightRanges[cluster];
+	for (uint j = 0; j < range.y; j++)
 	{
-		// point light diffuse & spec
-		switch(lights[i].type) 
-		{
-		case LIGHT_TYPE_POINT:
-			///
-			finalLight += PointLight(pixelData, cameraPosition, lights[i]);
-			///
-			break;
-		case LIGHT_TYPE_DIR:
-			///
-			finalLight += DirectionLight(pixelData, cameraPosition, lights[i]);
-			///
-			break;
-		case LIGHT_TYPE_SPOT:
-			///
-			finalLight += SpotLight(pixelData, cameraPosition, lights[i]);
-			///
-			break;
-		case LIGHT_TYPE_AMBIENT:
-			///
-			finalLight += AmbientLight(lights[i]);
-			///
-			break;
-		}
+		finalLight += AccumulateLight(pixelData, cameraPosition, lights[clusterLightIndices[range.x + j]]);
 	}
 
 	return float4(finalLight * (float3)input.color, 1);
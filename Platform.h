@@ -0,0 +1,30 @@
+#pragma once
+
+// --------------------------------------------------------
+// The few Windows types and calls the game logic uses.
+// Elsewhere they're stood in for, so the simulation can
+// run headless on other platforms: no keys are ever down
+// and quitting is left to the caller.
+// --------------------------------------------------------
+#ifdef _WIN32
+
+#include <Windows.h>
+
+#else
+
+typedef unsigned char BYTE;
+
+struct POINT
+{
+	long x;
+	long y;
+};
+
+#define VK_RBUTTON 0x02
+#define VK_ESCAPE 0x1B
+
+#define _Out_
+
+inline short GetAsyncKeyState(int) { return 0; }
+
+#endif
@@ -0,0 +1,532 @@
+#include "PngDecoder.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Codes up to this long are decoded with one table lookup, longer ones bit by bit
+#define INFLATE_FAST_BITS 10
+
+namespace
+{
+	// --------------------------------------------------------
+	// Reads the deflate stream's bits, least significant first
+	// --------------------------------------------------------
+	struct BitReader
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t position = 0;	// Next byte to load, can run past the end by a few padding bytes
+		uint64_t bits = 0;
+		unsigned int count = 0;
+
+		BitReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+
+		inline void Refill()
+		{
+			while (count <= 56)
+			{
+				uint64_t byte = position < size ? data[position] : 0;
+				bits |= byte << count;
+				position++;
+				count += 8;
+			}
+		}
+
+		inline unsigned int Peek(unsigned int bitCount)
+		{
+			if (count < bitCount)
+				Refill();
+			return (unsigned int)(bits & ((1ull << bitCount) - 1));
+		}
+
+		inline void Consume(unsigned int bitCount)
+		{
+			bits >>= bitCount;
+			count -= bitCount;
+		}
+
+		inline unsigned int Read(unsigned int bitCount)
+		{
+			if (bitCount == 0)
+				return 0;
+
+			unsigned int value = Peek(bitCount);
+			Consume(bitCount);
+			return value;
+		}
+
+		inline void AlignToByte()
+		{
+			Consume(count & 7);
+		}
+
+		// Bytes used so far, past the end means the stream was cut short
+		inline size_t BytesUsed() const
+		{
+			return position - count / 8;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Canonical Huffman code, deflate packs the codes most
+	// significant bit first
+	// --------------------------------------------------------
+	struct Huffman
+	{
+		uint16_t fast[1 << INFLATE_FAST_BITS];	// (symbol << 4) | length, 0 if the code is longer
+		uint16_t counts[16];
+		uint16_t symbols[288];
+
+		bool Build(const unsigned char* lengths, unsigned int symbolCount)
+		{
+			memset(counts, 0, sizeof(counts));
+			for (unsigned int i = 0; i < symbolCount; i++)
+				counts[lengths[i]]++;
+			counts[0] = 0;
+
+			// Over subscribed codes can't be decoded, incomplete ones are allowed
+			int left = 1;
+			for (int length = 1; length < 16; length++)
+			{
+				left = (left << 1) - counts[length];
+				if (left < 0)
+					return false;
+			}
+
+			uint16_t offsets[16];
+			offsets[1] = 0;
+			for (int length = 1; length < 15; length++)
+				offsets[length + 1] = offsets[length] + counts[length];
+
+			for (unsigned int i = 0; i < symbolCount; i++)
+			{
+				if (lengths[i])
+					symbols[offsets[lengths[i]]++] = (uint16_t)i;
+			}
+
+			memset(fast, 0, sizeof(fast));
+			unsigned int code = 0;
+			unsigned int index = 0;
+			for (unsigned int length = 1; length <= INFLATE_FAST_BITS; length++)
+			{
+				for (unsigned int i = 0; i < counts[length]; i++, code++, index++)
+				{
+					// Reversed, since the stream is read least significant bit first
+					unsigned int reversed = 0;
+					for (unsigned int bit = 0; bit < length; bit++)
+						reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+
+					for (unsigned int fill = reversed; fill < (1u << INFLATE_FAST_BITS); fill += 1u << length)
+						fast[fill] = (uint16_t)((symbols[index] << 4) | length);
+				}
+				code <<= 1;
+			}
+			return true;
+		}
+
+		inline int Decode(BitReader& reader) const
+		{
+			unsigned int peeked = reader.Peek(15);
+			uint16_t entry = fast[peeked & ((1 << INFLATE_FAST_BITS) - 1)];
+			if (entry)
+			{
+				reader.Consume(entry & 15);
+				return entry >> 4;
+			}
+
+			// Walk the longer codes one bit at a time
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (unsigned int length = 1; length < 16; length++)
+			{
+				code |= (peeked >> (length - 1)) & 1;
+				int count = counts[length];
+				if (code - count < first)
+				{
+					reader.Consume(length);
+					return symbols[index + (code - first)];
+				}
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	const uint16_t LengthBases[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistanceBases[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DistanceExtraBits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	bool InflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances, std::vector<unsigned char>& out)
+	{
+		for (;;)
+		{
+			int symbol = literals.Decode(reader);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 256)
+			{
+				out.push_back((unsigned char)symbol);
+				continue;
+			}
+
+			if (symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LengthBases[symbol] + reader.Read(LengthExtraBits[symbol]);
+
+			int distanceSymbol = distances.Decode(reader);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = DistanceBases[distanceSymbol] + reader.Read(DistanceExtraBits[distanceSymbol]);
+			if (distance > out.size())
+				return false;
+
+			// Copies can overlap what they write, so byte by byte
+			size_t from = out.size() - distance;
+			for (size_t i = 0; i < length; i++)
+				out.push_back(out[from + i]);
+
+			if (reader.BytesUsed() > reader.size)
+				return false;
+		}
+	}
+
+	// Raw deflate stream, returns the bytes of input it used or 0 if it's invalid
+	size_t Inflate(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+	{
+		BitReader reader(data, size);
+
+		static Huffman fixedLiterals;
+		static Huffman fixedDistances;
+		static bool fixedBuilt = []()
+		{
+			unsigned char lengths[288];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			fixedLiterals.Build(lengths, 288);
+
+			memset(lengths, 5, 30);
+			fixedDistances.Build(lengths, 30);
+			return true;
+		}();
+		(void)fixedBuilt;
+
+		Huffman literals;
+		Huffman distances;
+
+		bool finalBlock = false;
+		while (!finalBlock)
+		{
+			finalBlock = reader.Read(1) != 0;
+			unsigned int type = reader.Read(2);
+
+			if (type == 0)
+			{
+				reader.AlignToByte();
+				unsigned int length = reader.Read(16);
+				unsigned int inverse = reader.Read(16);
+				if ((length ^ 0xFFFF) != inverse || reader.BytesUsed() + length > size)
+					return 0;
+
+				for (unsigned int i = 0; i < length; i++)
+					out.push_back((unsigned char)reader.Read(8));
+			}
+			else if (type == 1)
+			{
+				if (!InflateBlock(reader, fixedLiterals, fixedDistances, out))
+					return 0;
+			}
+			else if (type == 2)
+			{
+				unsigned int literalCount = reader.Read(5) + 257;
+				unsigned int distanceCount = reader.Read(5) + 1;
+				unsigned int codeLengthCount = reader.Read(4) + 4;
+
+				static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+				unsigned char codeLengths[19] = {};
+				for (unsigned int i = 0; i < codeLengthCount; i++)
+					codeLengths[order[i]] = (unsigned char)reader.Read(3);
+
+				Huffman codeLengthCode;
+				if (!codeLengthCode.Build(codeLengths, 19))
+					return 0;
+
+				// The literal and distance lengths are one run, repeats can cross between them
+				unsigned char lengths[288 + 32] = {};
+				unsigned int filled = 0;
+				while (filled < literalCount + distanceCount)
+				{
+					int symbol = codeLengthCode.Decode(reader);
+					if (symbol < 0)
+						return 0;
+
+					if (symbol < 16)
+					{
+						lengths[filled++] = (unsigned char)symbol;
+						continue;
+					}
+
+					unsigned char repeated = 0;
+					unsigned int repeat;
+					if (symbol == 16)
+					{
+						if (filled == 0)
+							return 0;
+						repeated = lengths[filled - 1];
+						repeat = 3 + reader.Read(2);
+					}
+					else if (symbol == 17)
+					{
+						repeat = 3 + reader.Read(3);
+					}
+					else
+					{
+						repeat = 11 + reader.Read(7);
+					}
+
+					if (filled + repeat > literalCount + distanceCount)
+						return 0;
+					while (repeat--)
+						lengths[filled++] = repeated;
+				}
+
+				if (lengths[256] == 0 ||
+					!literals.Build(lengths, literalCount) ||
+					!distances.Build(lengths + literalCount, distanceCount))
+				{
+					return 0;
+				}
+
+				if (!InflateBlock(reader, literals, distances, out))
+					return 0;
+			}
+			else
+			{
+				return 0;
+			}
+
+			if (reader.BytesUsed() > size)
+				return 0;
+		}
+
+		reader.AlignToByte();
+		return reader.BytesUsed();
+	}
+
+	uint32_t Adler32(const unsigned char* data, size_t size)
+	{
+		uint32_t a = 1;
+		uint32_t b = 0;
+		while (size > 0)
+		{
+			// The largest run that can't overflow before the modulo
+			size_t run = size < 5552 ? size : 5552;
+			size -= run;
+			while (run--)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	inline uint32_t ReadBigEndian(const unsigned char* bytes)
+	{
+		return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+	}
+
+	inline int Paeth(int left, int up, int upLeft)
+	{
+		int estimate = left + up - upLeft;
+		int toLeft = abs(estimate - left);
+		int toUp = abs(estimate - up);
+		int toUpLeft = abs(estimate - upLeft);
+		if (toLeft <= toUp && toLeft <= toUpLeft)
+			return left;
+		return toUp <= toUpLeft ? up : upLeft;
+	}
+}
+
+bool DecodePng(const unsigned char* data, size_t size, DecodedImage& outImage)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+		return false;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	unsigned int colorType = 0;
+	unsigned char palette[256][4];
+	unsigned int paletteSize = 0;
+	bool hasColorKey = false;
+	uint16_t colorKey[3] = {};
+	std::vector<unsigned char> compressed;
+
+	memset(palette, 255, sizeof(palette));
+
+	size_t position = 8;
+	bool ended = false;
+	while (!ended && position + 12 <= size)
+	{
+		uint32_t length = ReadBigEndian(data + position);
+		const unsigned char* type = data + position + 4;
+		const unsigned char* chunk = data + position + 8;
+		if (length > size - position - 12)
+			return false;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length < 13)
+				return false;
+
+			width = ReadBigEndian(chunk);
+			height = ReadBigEndian(chunk + 4);
+			unsigned int bitDepth = chunk[8];
+			colorType = chunk[9];
+			unsigned int interlace = chunk[12];
+
+			if (width == 0 || height == 0 || width > 16384 || height > 16384 ||
+				bitDepth != 8 || chunk[10] != 0 || chunk[11] != 0 || interlace != 0 ||
+				(colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6))
+			{
+				return false;
+			}
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = length / 3 < 256 ? length / 3 : 256;
+			for (unsigned int i = 0; i < paletteSize; i++)
+			{
+				palette[i][0] = chunk[i * 3];
+				palette[i][1] = chunk[i * 3 + 1];
+				palette[i][2] = chunk[i * 3 + 2];
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (colorType == 3)
+			{
+				for (unsigned int i = 0; i < length && i < 256; i++)
+					palette[i][3] = chunk[i];
+			}
+			else if ((colorType == 0 && length >= 2) || (colorType == 2 && length >= 6))
+			{
+				hasColorKey = true;
+				for (unsigned int i = 0; i < (colorType == 0 ? 1u : 3u); i++)
+					colorKey[i] = (uint16_t)((chunk[i * 2] << 8) | chunk[i * 2 + 1]);
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			ended = true;
+		}
+
+		position += 12 + (size_t)length;
+	}
+
+	if (width == 0 || compressed.size() < 6 || (colorType == 3 && paletteSize == 0))
+		return false;
+
+	// zlib wrapper: deflate without a preset dictionary, then an Adler-32 of the result
+	unsigned int method = compressed[0];
+	unsigned int flags = compressed[1];
+	if ((method & 15) != 8 || ((method << 8) | flags) % 31 != 0 || (flags & 0x20))
+		return false;
+
+	static const unsigned int channelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	unsigned int channels = channelCounts[colorType];
+	size_t stride = (size_t)width * channels;
+
+	std::vector<unsigned char> filtered;
+	filtered.reserve((stride + 1) * height);
+	size_t used = Inflate(compressed.data() + 2, compressed.size() - 2, filtered);
+	if (used == 0 || used + 6 > compressed.size() ||
+		ReadBigEndian(compressed.data() + 2 + used) != Adler32(filtered.data(), filtered.size()) ||
+		filtered.size() < (stride + 1) * height)
+	{
+		return false;
+	}
+
+	// Undo each row's filter in place, every row starts with its filter type
+	for (uint32_t y = 0; y < height; y++)
+	{
+		unsigned char* row = filtered.data() + y * (stride + 1) + 1;
+		const unsigned char* above = y > 0 ? row - (stride + 1) : nullptr;
+		unsigned int filter = row[-1];
+
+		for (size_t x = 0; x < stride; x++)
+		{
+			int left = x >= channels ? row[x - channels] : 0;
+			int up = above ? above[x] : 0;
+			int upLeft = above && x >= channels ? above[x - channels] : 0;
+
+			switch (filter)
+			{
+			case 0: break;
+			case 1: row[x] = (unsigned char)(row[x] + left); break;
+			case 2: row[x] = (unsigned char)(row[x] + up); break;
+			case 3: row[x] = (unsigned char)(row[x] + ((left + up) >> 1)); break;
+			case 4: row[x] = (unsigned char)(row[x] + Paeth(left, up, upLeft)); break;
+			default: return false;
+			}
+		}
+	}
+
+	outImage.width = width;
+	outImage.height = height;
+	outImage.pixels.resize((size_t)width * height * 4);
+
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const unsigned char* row = filtered.data() + y * (stride + 1) + 1;
+		unsigned char* pixel = outImage.pixels.data() + (size_t)y * width * 4;
+
+		for (uint32_t x = 0; x < width; x++, pixel += 4)
+		{
+			const unsigned char* source = row + (size_t)x * channels;
+			switch (colorType)
+			{
+			case 0:
+				pixel[0] = pixel[1] = pixel[2] = source[0];
+				pixel[3] = hasColorKey && source[0] == colorKey[0] ? 0 : 255;
+				break;
+			case 2:
+				pixel[0] = source[0];
+				pixel[1] = source[1];
+				pixel[2] = source[2];
+				pixel[3] = hasColorKey && source[0] == colorKey[0] && source[1] == colorKey[1] && source[2] == colorKey[2] ? 0 : 255;
+				break;
+			case 3:
+				memcpy(pixel, palette[source[0]], 4);
+				break;
+			case 4:
+				pixel[0] = pixel[1] = pixel[2] = source[0];
+				pixel[3] = source[1];
+				break;
+			default:
+				memcpy(pixel, source, 4);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// An image decoded to tightly packed 32 bit RGBA pixels
+// --------------------------------------------------------
+struct DecodedImage
+{
+	std::vector<unsigned char> pixels;
+	unsigned int width = 0;
+	unsigned int height = 0;
+};
+
+// --------------------------------------------------------
+// Decodes a PNG file already in memory to RGBA, without any
+// OS or third party library, so textures can be baked on
+// any platform
+//
+// - Handles 8 bit grayscale, RGB, palette, gray + alpha and
+//   RGBA images, which is everything the art tools write
+// - Interlaced and 16 bit images return false, callers fall
+//   back to the OS decoder for those
+// - Doesn't check the CRCs, the zlib checksum catches a
+//   damaged image
+// --------------------------------------------------------
+bool DecodePng(const unsigned char* data, size_t size, DecodedImage& outImage);
@@ -0,0 +1,211 @@
+#include "PostProcessChain.h"
+#include "SimpleShader.h"
+
+PostProcessChain::PostProcessChain(ID3D11Device* device, ID3D11DeviceContext* context, const PostProcessShaders& shaders)
+	: device(device), context(context), shaders(shaders), compositeShaders(device, context)
+{
+	// Clamped, so the blur and FXAA taps don't wrap around the screen's edges
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	device->CreateSamplerState(&samplerDesc, sampler.GetAddressOf());
+
+	SetSettings(settings);
+}
+
+void PostProcessChain::SetSettings(const PostProcessSettings& newSettings)
+{
+	settings = newSettings;
+
+	graph.Clear();
+	sceneResource = BuildPostProcessChain(graph, settings);
+	graph.Compile();
+
+	// Compiled now rather than in the middle of a frame, and only
+	// the first time this combination of effects is turned on
+	uint32_t features = GetCompositeFeatures(settings);
+	if (features != 0)
+		compositeShaders.Get(features);
+
+	CreateTargets();
+}
+
+void PostProcessChain::Resize(unsigned int screenWidth, unsigned int screenHeight)
+{
+	width = screenWidth;
+	height = screenHeight;
+	CreateTargets();
+}
+
+void PostProcessChain::CreateTargets()
+{
+	if (width == 0 || height == 0)
+		return;
+
+	const std::vector<PostProcessTargetDesc>& pool = graph.GetTargets();
+	targets.resize(pool.size());
+
+	for (size_t i = 0; i < pool.size(); i++)
+	{
+		Target& target = targets[i];
+		unsigned int targetWidth = (width + pool[i].divisor - 1) / pool[i].divisor;
+		unsigned int targetHeight = (height + pool[i].divisor - 1) / pool[i].divisor;
+
+		// Toggling an effect usually leaves most of the pool as it was
+		if (target.rtv && target.desc == pool[i] && target.width == targetWidth && target.height == targetHeight)
+			continue;
+
+		target.desc = pool[i];
+		target.width = targetWidth;
+		target.height = targetHeight;
+
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = targetWidth;
+		textureDesc.Height = targetHeight;
+		textureDesc.ArraySize = 1;
+		textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.Format = pool[i].format == PostProcessFormat::HDRColor ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+		textureDesc.MipLevels = 1;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		device->CreateTexture2D(&textureDesc, 0, texture.GetAddressOf());
+
+		D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+		rtvDesc.Format = textureDesc.Format;
+		rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+		device->CreateRenderTargetView(texture.Get(), &rtvDesc, target.rtv.ReleaseAndGetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = textureDesc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = 1;
+		device->CreateShaderResourceView(texture.Get(), &srvDesc, target.srv.ReleaseAndGetAddressOf());
+	}
+}
+
+ID3D11RenderTargetView* PostProcessChain::GetSceneTarget() const
+{
+	uint32_t target = graph.GetResources()[sceneResource].target;
+	return target < targets.size() ? targets[target].rtv.Get() : nullptr;
+}
+
+ID3D11ShaderResourceView* PostProcessChain::GetSRV(uint32_t resource) const
+{
+	uint32_t target = graph.GetResources()[resource].target;
+	return target < targets.size() ? targets[target].srv.Get() : nullptr;
+}
+
+void PostProcessChain::Execute(ID3D11RenderTargetView* backBufferRTV, const VignetteData& vignette, float totalTime)
+{
+	backBuffer = backBufferRTV;
+
+	SetCompositeVignette(compositeData, vignette);
+	compositeData.colorFilter = settings.colorFilter;
+	compositeData.contrast = settings.contrast;
+	compositeData.saturation = settings.saturation;
+	compositeData.grainIntensity = settings.grainIntensity;
+	compositeData.time = totalTime;
+	compositeData.inverseGamma = 1.f / settings.displayGamma;
+	compositeData.pixelSize = DirectX::XMFLOAT2(1.f / width, 1.f / height);
+
+	// The full screen triangle is made up in the vertex shader
+	UINT stride = 0;
+	UINT offset = 0;
+	ID3D11Buffer* nothing = 0;
+	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+	shaders.fullscreenVS->SetShader();
+
+	graph.Execute(*this);
+
+	// Unbind shader resource views at the end of the frame,
+	// since we'll be rendering into one of those textures
+	// at the start of the next
+	ID3D11ShaderResourceView* nullSRVs[16] = {};
+	context->PSSetShaderResources(0, 16, nullSRVs);
+	backBuffer = nullptr;
+}
+
+void PostProcessChain::ExecutePass(const PostProcessGraph& passGraph, uint32_t passIndex)
+{
+	const PostProcessPass& pass = passGraph.GetPasses()[passIndex];
+
+	// The game already drew this one
+	if (pass.effect == PostProcessEffect::Scene)
+		return;
+
+	// A target can't be bound for reading and writing at once, and
+	// the last pass may still have this one's output as an input
+	ID3D11ShaderResourceView* nullSRVs[POSTPROCESS_MAX_INPUTS] = {};
+	context->PSSetShaderResources(0, POSTPROCESS_MAX_INPUTS, nullSRVs);
+
+	const PostProcessResource& output = passGraph.GetResources()[pass.output];
+	ID3D11RenderTargetView* rtv = output.imported ? backBuffer : targets[output.target].rtv.Get();
+	unsigned int targetWidth = output.imported ? width : targets[output.target].width;
+	unsigned int targetHeight = output.imported ? height : targets[output.target].height;
+	context->OMSetRenderTargets(1, &rtv, 0);
+
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)targetWidth;
+	viewport.Height = (float)targetHeight;
+	viewport.MaxDepth = 1.f;
+	context->RSSetViewports(1, &viewport);
+
+	SimplePixelShader* ps = shaders.copyPS;
+	switch (pass.effect)
+	{
+	case PostProcessEffect::BloomExtract:
+		ps = shaders.bloomExtractPS;
+		ps->SetFloat("threshold", settings.bloomThreshold);
+		break;
+	case PostProcessEffect::BloomBlurX:
+	case PostProcessEffect::BloomBlurY:
+		// One texel of the target along the blur's axis
+		ps = shaders.bloomBlurPS;
+		ps->SetFloat2("direction", pass.effect == PostProcessEffect::BloomBlurX ?
+			DirectX::XMFLOAT2(1.f / targetWidth, 0) : DirectX::XMFLOAT2(0, 1.f / targetHeight));
+		break;
+	case PostProcessEffect::Tonemap:
+		ps = shaders.tonemapPS;
+		ps->SetFloat("exposure", settings.exposure);
+		ps->SetFloat("bloomIntensity", pass.inputCount > 1 ? settings.bloomIntensity : 0.f);
+		break;
+	case PostProcessEffect::Composite:
+		// Falls back to a copy if the permutation didn't compile
+		ps = compositeShaders.Get(GetCompositeFeatures(settings));
+		if (ps)
+			ps->SetData("compositeData", (void*)&compositeData, sizeof(CompositeData));
+		else
+			ps = shaders.copyPS;
+		break;
+	case PostProcessEffect::Fxaa:
+		ps = shaders.fxaaPS;
+		ps->SetFloat2("pixelSize", DirectX::XMFLOAT2(1.f / width, 1.f / height));
+		break;
+	default:
+		break;
+	}
+
+	ps->SetShader();
+	ps->SetShaderResourceView("pixels", GetSRV(pass.inputs[0]));
+	if (pass.inputCount > 1)
+		ps->SetShaderResourceView("bloom", GetSRV(pass.inputs[1]));
+	ps->SetSamplerState("samplerOptions", sampler.Get());
+	ps->CopyAllBufferData();
+
+	// Draw exactly 3 vertices for our "full screen triangle"
+	context->Draw(3, 0);
+
+	// The scene and everything after it are drawn at full size
+	if (targetWidth != width || targetHeight != height)
+	{
+		viewport.Width = (float)width;
+		viewport.Height = (float)height;
+		context->RSSetViewports(1, &viewport);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "CompositeShaderCache.h"
+#include "PostProcessData.h"
+#include "PostProcessGraph.h"
+
+class SimplePixelShader;
+class SimpleVertexShader;
+
+// --------------------------------------------------------
+// The shaders of every effect, owned by the game
+// --------------------------------------------------------
+struct PostProcessShaders
+{
+	SimpleVertexShader* fullscreenVS = nullptr;
+	SimplePixelShader* copyPS = nullptr;
+	SimplePixelShader* bloomExtractPS = nullptr;
+	SimplePixelShader* bloomBlurPS = nullptr;
+	SimplePixelShader* tonemapPS = nullptr;
+	SimplePixelShader* fxaaPS = nullptr;
+};
+
+// --------------------------------------------------------
+// GPU side of the post processing: creates the pooled
+// targets a compiled PostProcessGraph asks for and draws
+// its passes as full screen triangles
+//
+// - Targets are only recreated when the screen size or the
+//   pool changes, not every frame
+// - The scene is drawn into GetSceneTarget() by the game,
+//   the last pass draws into the back buffer
+// - The composite pass uses the cached permutation for the
+//   per pixel effects that are on, so changing the settings
+//   compiles at most once per combination
+// --------------------------------------------------------
+class PostProcessChain : public IPostProcessBackend
+{
+public:
+	PostProcessChain(ID3D11Device* device, ID3D11DeviceContext* context, const PostProcessShaders& shaders);
+
+	// Rebuilds and compiles the graph for these effects
+	void SetSettings(const PostProcessSettings& newSettings);
+	inline const PostProcessSettings& GetSettings() const { return settings; }
+
+	// Matches the targets to the new screen size
+	void Resize(unsigned int screenWidth, unsigned int screenHeight);
+
+	// Where the game draws the scene before Execute()
+	ID3D11RenderTargetView* GetSceneTarget() const;
+
+	// Runs every live pass, ending in the back buffer. The time moves the film grain.
+	void Execute(ID3D11RenderTargetView* backBuffer, const VignetteData& vignette, float totalTime);
+
+	void ExecutePass(const PostProcessGraph& graph, uint32_t pass) override;
+
+	inline const PostProcessGraph& GetGraph() const { return graph; }
+	inline const CompositeShaderCache& GetCompositeShaders() const { return compositeShaders; }
+	inline void PrintStats() const { graph.PrintStats(width, height); }
+
+private:
+	struct Target
+	{
+		PostProcessTargetDesc desc;
+		unsigned int width = 0;
+		unsigned int height = 0;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtv;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	};
+
+	void CreateTargets();
+	ID3D11ShaderResourceView* GetSRV(uint32_t resource) const;
+
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+	PostProcessShaders shaders;
+	CompositeShaderCache compositeShaders;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
+
+	PostProcessSettings settings;
+	PostProcessGraph graph;
+	uint32_t sceneResource = POSTPROCESS_INVALID;
+	std::vector<Target> targets;	// Parallel to the graph's pool
+	unsigned int width = 0;
+	unsigned int height = 0;
+
+	// Only valid during Execute()
+	ID3D11RenderTargetView* backBuffer = nullptr;
+	CompositeData compositeData = {};
+};
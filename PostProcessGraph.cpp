@@ -0,0 +1,281 @@
+#include "PostProcessGraph.h"
+#include "CompositeShader.h"
+#include <cstdio>
+
+size_t GetPostProcessTargetBytes(const PostProcessTargetDesc& desc, unsigned int screenWidth, unsigned int screenHeight)
+{
+	size_t width = (screenWidth + desc.divisor - 1) / desc.divisor;
+	size_t height = (screenHeight + desc.divisor - 1) / desc.divisor;
+	return width * height * (desc.format == PostProcessFormat::HDRColor ? 8 : 4);
+}
+
+const char* GetPostProcessEffectName(PostProcessEffect effect)
+{
+	switch (effect)
+	{
+	case PostProcessEffect::Scene: return "scene";
+	case PostProcessEffect::BloomExtract: return "bloom extract";
+	case PostProcessEffect::BloomBlurX: return "bloom blur x";
+	case PostProcessEffect::BloomBlurY: return "bloom blur y";
+	case PostProcessEffect::Tonemap: return "tonemap";
+	case PostProcessEffect::Composite: return "composite";
+	case PostProcessEffect::Fxaa: return "fxaa";
+	case PostProcessEffect::Copy: return "copy";
+	}
+	return "unknown";
+}
+
+void PostProcessGraph::Clear()
+{
+	passes.clear();
+	resources.clear();
+	schedule.clear();
+	targets.clear();
+}
+
+uint32_t PostProcessGraph::ImportTarget(const char* name, bool isOutput)
+{
+	PostProcessResource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.isOutput = isOutput;
+	resources.push_back(resource);
+	return (uint32_t)resources.size() - 1;
+}
+
+uint32_t PostProcessGraph::CreateTarget(const char* name, const PostProcessTargetDesc& desc)
+{
+	PostProcessResource resource;
+	resource.name = name;
+	resource.desc = desc;
+	resources.push_back(resource);
+	return (uint32_t)resources.size() - 1;
+}
+
+uint32_t PostProcessGraph::AddPass(PostProcessEffect effect, std::initializer_list<uint32_t> inputs, uint32_t output)
+{
+	// Each resource has one writer, and everything read has to exist by now
+	bool valid = output < resources.size() && resources[output].writer == POSTPROCESS_INVALID && inputs.size() <= POSTPROCESS_MAX_INPUTS;
+	for (uint32_t input : inputs)
+	{
+		valid = valid && input < resources.size() && input != output &&
+			(resources[input].imported || resources[input].writer != POSTPROCESS_INVALID);
+	}
+
+	if (!valid)
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Post process pass %s has an input that isn't written yet or an output that already is\n", GetPostProcessEffectName(effect));
+#endif
+		return POSTPROCESS_INVALID;
+	}
+
+	PostProcessPass pass;
+	pass.effect = effect;
+	for (uint32_t input : inputs)
+	{
+		pass.inputs[pass.inputCount++] = input;
+	}
+	pass.output = output;
+	passes.push_back(pass);
+
+	resources[output].writer = (uint32_t)passes.size() - 1;
+	return resources[output].writer;
+}
+
+void PostProcessGraph::Compile()
+{
+	schedule.clear();
+	targets.clear();
+
+	// Walking back from the outputs, a pass only runs if something later reads what it writes
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		needed[i] = resources[i].imported && resources[i].isOutput;
+		resources[i].firstUse = 0;
+		resources[i].lastUse = 0;
+		resources[i].target = POSTPROCESS_INVALID;
+	}
+
+	for (size_t i = passes.size(); i-- > 0;)
+	{
+		PostProcessPass& pass = passes[i];
+		pass.culled = !needed[pass.output];
+		if (pass.culled)
+			continue;
+
+		for (uint32_t input = 0; input < pass.inputCount; input++)
+		{
+			needed[pass.inputs[input]] = true;
+		}
+	}
+
+	// Passes were declared after what they read, so declaration order is a valid order
+	for (uint32_t i = 0; i < (uint32_t)passes.size(); i++)
+	{
+		if (!passes[i].culled)
+			schedule.push_back(i);
+	}
+
+	// Each resource lives from the step writing it to the last step reading it
+	for (uint32_t step = 0; step < (uint32_t)schedule.size(); step++)
+	{
+		const PostProcessPass& pass = passes[schedule[step]];
+		resources[pass.output].firstUse = step;
+		resources[pass.output].lastUse = step;
+		for (uint32_t input = 0; input < pass.inputCount; input++)
+		{
+			resources[pass.inputs[input]].lastUse = step;
+		}
+	}
+
+	// A target is free again after the last step using what's in it. The inputs of a
+	// step are used by it, so a pass never writes a target it's reading.
+	std::vector<uint32_t> busyUntil;
+	for (uint32_t step = 0; step < (uint32_t)schedule.size(); step++)
+	{
+		PostProcessResource& output = resources[passes[schedule[step]].output];
+		if (output.imported)
+			continue;
+
+		uint32_t target = POSTPROCESS_INVALID;
+		for (uint32_t i = 0; i < (uint32_t)targets.size() && target == POSTPROCESS_INVALID; i++)
+		{
+			if (targets[i] == output.desc && busyUntil[i] < step)
+				target = i;
+		}
+
+		if (target == POSTPROCESS_INVALID)
+		{
+			target = (uint32_t)targets.size();
+			targets.push_back(output.desc);
+			busyUntil.push_back(0);
+		}
+
+		output.target = target;
+		busyUntil[target] = output.lastUse;
+	}
+}
+
+void PostProcessGraph::Execute(IPostProcessBackend& backend) const
+{
+	for (uint32_t pass : schedule)
+	{
+		backend.ExecutePass(*this, pass);
+	}
+}
+
+PostProcessGraphStats PostProcessGraph::GetStats(unsigned int screenWidth, unsigned int screenHeight) const
+{
+	PostProcessGraphStats stats;
+	stats.passes = (unsigned int)passes.size();
+	stats.culledPasses = (unsigned int)(passes.size() - schedule.size());
+	stats.targets = (unsigned int)targets.size();
+
+	for (const PostProcessResource& resource : resources)
+	{
+		if (resource.target == POSTPROCESS_INVALID)
+			continue;
+
+		stats.transients++;
+		stats.transientBytes += GetPostProcessTargetBytes(resource.desc, screenWidth, screenHeight);
+	}
+
+	for (const PostProcessTargetDesc& target : targets)
+	{
+		stats.targetBytes += GetPostProcessTargetBytes(target, screenWidth, screenHeight);
+	}
+	return stats;
+}
+
+void PostProcessGraph::PrintStats(unsigned int screenWidth, unsigned int screenHeight) const
+{
+	PostProcessGraphStats stats = GetStats(screenWidth, screenHeight);
+	printf("Post process graph: %u of %u passes run, %u transient targets in %u pooled (%.2f MB instead of %.2f MB)\n",
+		stats.passes - stats.culledPasses, stats.passes, stats.transients, stats.targets,
+		stats.targetBytes / 1048576.0, stats.transientBytes / 1048576.0);
+
+	for (uint32_t pass : schedule)
+	{
+		const PostProcessResource& output = resources[passes[pass].output];
+		if (output.imported)
+			printf("  %-14s -> %s\n", GetPostProcessEffectName(passes[pass].effect), output.name.c_str());
+		else
+			printf("  %-14s -> %s (target %u)\n", GetPostProcessEffectName(passes[pass].effect), output.name.c_str(), output.target);
+	}
+}
+
+uint32_t GetCompositeFeatures(const PostProcessSettings& settings)
+{
+	uint32_t features = 0;
+	if (settings.colorGrading) features |= COMPOSITE_COLOR_GRADING;
+	if (settings.vignette) features |= COMPOSITE_VIGNETTE;
+	if (settings.filmGrain) features |= COMPOSITE_FILM_GRAIN;
+	if (settings.gamma) features |= COMPOSITE_GAMMA;
+	return features;
+}
+
+uint32_t BuildPostProcessChain(PostProcessGraph& graph, const PostProcessSettings& settings, uint32_t* outBackBuffer)
+{
+	PostProcessTargetDesc sceneDesc;
+	sceneDesc.format = settings.tonemap ? PostProcessFormat::HDRColor : PostProcessFormat::Color;
+
+	PostProcessTargetDesc bloomDesc;
+	bloomDesc.format = PostProcessFormat::HDRColor;
+	bloomDesc.divisor = 2;
+
+	PostProcessTargetDesc colorDesc;
+
+	uint32_t backBuffer = graph.ImportTarget("back buffer", true);
+	uint32_t scene = graph.CreateTarget("scene", sceneDesc);
+	graph.AddPass(PostProcessEffect::Scene, {}, scene);
+
+	// The last effect that's on draws straight into the back buffer
+	PostProcessEffect last = PostProcessEffect::Copy;
+	if (settings.tonemap) last = PostProcessEffect::Tonemap;
+	if (GetCompositeFeatures(settings) != 0) last = PostProcessEffect::Composite;
+	if (settings.fxaa) last = PostProcessEffect::Fxaa;
+
+	auto createOutput = [&](PostProcessEffect effect, const char* name)
+	{
+		return effect == last ? backBuffer : graph.CreateTarget(name, colorDesc);
+	};
+
+	uint32_t bright = graph.CreateTarget("bloom bright", bloomDesc);
+	graph.AddPass(PostProcessEffect::BloomExtract, { scene }, bright);
+	uint32_t blurredX = graph.CreateTarget("bloom blurred x", bloomDesc);
+	graph.AddPass(PostProcessEffect::BloomBlurX, { bright }, blurredX);
+	uint32_t bloom = graph.CreateTarget("bloom", bloomDesc);
+	graph.AddPass(PostProcessEffect::BloomBlurY, { blurredX }, bloom);
+
+	// Each effect reads whatever the last enabled one wrote
+	uint32_t current = scene;
+
+	uint32_t tonemapped = createOutput(PostProcessEffect::Tonemap, "tonemapped");
+	if (settings.bloom)
+		graph.AddPass(PostProcessEffect::Tonemap, { scene, bloom }, tonemapped);
+	else
+		graph.AddPass(PostProcessEffect::Tonemap, { scene }, tonemapped);
+	if (settings.tonemap)
+		current = tonemapped;
+
+	// The per pixel effects share one pass, so turning on another
+	// one doesn't cost another read and write of the whole screen
+	uint32_t composited = createOutput(PostProcessEffect::Composite, "composited");
+	graph.AddPass(PostProcessEffect::Composite, { current }, composited);
+	if (GetCompositeFeatures(settings) != 0)
+		current = composited;
+
+	uint32_t antialiased = createOutput(PostProcessEffect::Fxaa, "antialiased");
+	graph.AddPass(PostProcessEffect::Fxaa, { current }, antialiased);
+	if (settings.fxaa)
+		current = antialiased;
+
+	if (last == PostProcessEffect::Copy)
+		graph.AddPass(PostProcessEffect::Copy, { current }, backBuffer);
+
+	if (outBackBuffer)
+		*outBackBuffer = backBuffer;
+	return scene;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Most textures a single pass reads
+#define POSTPROCESS_MAX_INPUTS 4
+
+// Returned by the graph for a resource or pass that couldn't be declared
+#define POSTPROCESS_INVALID UINT32_MAX
+
+// --------------------------------------------------------
+// What a transient target holds. Full screen targets have a
+// divisor of 1, half resolution ones 2 and so on.
+// --------------------------------------------------------
+enum class PostProcessFormat : uint8_t
+{
+	Color,		// 8 bits a channel, R8G8B8A8_UNORM
+	HDRColor	// Half floats, R16G16B16A16_FLOAT
+};
+
+struct PostProcessTargetDesc
+{
+	PostProcessFormat format = PostProcessFormat::Color;
+	uint32_t divisor = 1;
+
+	inline bool operator==(const PostProcessTargetDesc& other) const { return format == other.format && divisor == other.divisor; }
+	inline bool operator!=(const PostProcessTargetDesc& other) const { return !(*this == other); }
+};
+
+// Bytes of a target of this kind for a screen of the given size
+size_t GetPostProcessTargetBytes(const PostProcessTargetDesc& desc, unsigned int screenWidth, unsigned int screenHeight);
+
+// --------------------------------------------------------
+// What a pass draws. Scene is drawn by the game itself, the
+// rest are full screen triangles.
+// --------------------------------------------------------
+enum class PostProcessEffect : uint8_t
+{
+	Scene,
+	BloomExtract,	// The parts brighter than the threshold, at half size
+	BloomBlurX,
+	BloomBlurY,
+	Tonemap,		// HDR to LDR, adding the bloom if it has a second input
+	Composite,		// Every per pixel effect that's on, fused into one shader
+	Fxaa,
+	Copy
+};
+
+const char* GetPostProcessEffectName(PostProcessEffect effect);
+
+struct PostProcessPass
+{
+	PostProcessEffect effect;
+	uint32_t inputs[POSTPROCESS_MAX_INPUTS];	// Resources read
+	uint32_t inputCount = 0;
+	uint32_t output = POSTPROCESS_INVALID;		// The one resource written
+	bool culled = false;
+};
+
+struct PostProcessResource
+{
+	std::string name;
+	PostProcessTargetDesc desc;
+	bool imported = false;		// Owned outside the graph, like the back buffer
+	bool isOutput = false;		// Imported resources the frame has to end up in
+	uint32_t writer = POSTPROCESS_INVALID;	// Pass that writes it
+
+	// Set by Compile() for live transients: the first and last step
+	// of the schedule that use it, and the pooled target it lives in
+	uint32_t firstUse = 0;
+	uint32_t lastUse = 0;
+	uint32_t target = POSTPROCESS_INVALID;
+};
+
+// --------------------------------------------------------
+// Counts from the last PostProcessGraph::Compile()
+// --------------------------------------------------------
+struct PostProcessGraphStats
+{
+	unsigned int passes = 0;
+	unsigned int culledPasses = 0;
+	unsigned int transients = 0;	// Live transient resources
+	unsigned int targets = 0;		// Pooled targets they were packed into
+	size_t transientBytes = 0;		// What one target per transient would take
+	size_t targetBytes = 0;			// What the pool takes
+};
+
+class PostProcessGraph;
+
+// --------------------------------------------------------
+// Receives the passes of a compiled graph in order. The
+// graph says which pooled target each resource lives in.
+// --------------------------------------------------------
+class IPostProcessBackend
+{
+public:
+	virtual ~IPostProcessBackend() = default;
+
+	virtual void ExecutePass(const PostProcessGraph& graph, uint32_t pass) = 0;
+};
+
+// --------------------------------------------------------
+// Backend that touches no GPU state, only records the
+// passes. Handy for checking a graph without a device.
+// --------------------------------------------------------
+class RecordingPostProcessBackend : public IPostProcessBackend
+{
+public:
+	void ExecutePass(const PostProcessGraph&, uint32_t pass) override { passes.push_back(pass); }
+
+	std::vector<uint32_t> passes;
+};
+
+// --------------------------------------------------------
+// The post processing of a frame as passes that read and
+// write named resources
+//
+// - Passes are declared in the order they run and can only
+//   read resources that are imported or already written.
+//   Every resource is written by exactly one pass.
+// - Compile() culls every pass whose output never reaches
+//   an imported output, then packs the transient resources
+//   of the rest into a pool of targets. A target is reused
+//   once the last pass reading its resource is done, so a
+//   longer chain of full screen passes keeps ping-ponging
+//   between the same few targets instead of adding one each.
+// - Touches no GPU state, a backend creates the pooled
+//   targets and draws the passes
+// --------------------------------------------------------
+class PostProcessGraph
+{
+public:
+	// Removes every pass and resource, the pool is rebuilt by the next Compile()
+	void Clear();
+
+	// A texture owned outside the graph. Outputs are what the frame draws into.
+	uint32_t ImportTarget(const char* name, bool isOutput);
+
+	// A texture only used within the frame, backed by a pooled target
+	uint32_t CreateTarget(const char* name, const PostProcessTargetDesc& desc);
+
+	// Declares a pass reading the inputs and writing the output. Returns
+	// POSTPROCESS_INVALID if an input isn't written yet or the output is.
+	uint32_t AddPass(PostProcessEffect effect, std::initializer_list<uint32_t> inputs, uint32_t output);
+
+	// Culls, schedules and packs the resources into the pool
+	void Compile();
+
+	// Hands the passes that survived culling to the backend in order
+	void Execute(IPostProcessBackend& backend) const;
+
+	inline const std::vector<PostProcessPass>& GetPasses() const { return passes; }
+	inline const std::vector<PostProcessResource>& GetResources() const { return resources; }
+	inline const std::vector<uint32_t>& GetSchedule() const { return schedule; }
+
+	// The pool, indexed by PostProcessResource::target
+	inline const std::vector<PostProcessTargetDesc>& GetTargets() const { return targets; }
+
+	PostProcessGraphStats GetStats(unsigned int screenWidth, unsigned int screenHeight) const;
+	void PrintStats(unsigned int screenWidth, unsigned int screenHeight) const;
+
+private:
+	std::vector<PostProcessPass> passes;
+	std::vector<PostProcessResource> resources;
+	std::vector<uint32_t> schedule;
+	std::vector<PostProcessTargetDesc> targets;
+};
+
+// --------------------------------------------------------
+// Which effects the post processing runs and how strongly
+// --------------------------------------------------------
+struct PostProcessSettings
+{
+	bool bloom = false;		// Needs the tonemapper, which adds it back in
+	bool tonemap = false;	// Also makes the scene target HDR
+	bool fxaa = false;
+
+	// Drawn together by the composite pass, see CompositeShader.h
+	bool colorGrading = false;
+	bool vignette = true;
+	bool filmGrain = false;
+	bool gamma = false;
+
+	float bloomThreshold = 1.f;
+	float bloomIntensity = .6f;
+	float exposure = 1.f;
+
+	DirectX::XMFLOAT3 colorFilter = DirectX::XMFLOAT3(1.f, 1.f, 1.f);
+	float contrast = 1.f;
+	float saturation = 1.f;
+	float grainIntensity = .04f;
+	float displayGamma = 2.2f;
+};
+
+// The COMPOSITE_ feature bits of the effects that are on
+uint32_t GetCompositeFeatures(const PostProcessSettings& settings);
+
+// --------------------------------------------------------
+// Declares the game's chain on an empty graph: the scene,
+// bloom, tonemap, composite and FXAA, ending in the imported
+// back buffer. Every effect is declared, the disabled ones
+// just aren't read by anything and get culled. Returns the
+// scene resource.
+// --------------------------------------------------------
+uint32_t BuildPostProcessChain(PostProcessGraph& graph, const PostProcessSettings& settings, uint32_t* outBackBuffer = nullptr);
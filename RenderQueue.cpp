@@ -0,0 +1,259 @@
+#include "RenderQueue.h"
+#include <d3d11.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "Mesh.h"
+#include "Entity.h"
+#include "Camera.h"
+#include "Material.h"
+#include "SimpleShader.h"
+
+// Bits given to each part of the key, these add up to 64
+#define SORT_KEY_PASS_BITS 2
+#define SORT_KEY_SHADER_BITS 12
+#define SORT_KEY_MATERIAL_BITS 14
+#define SORT_KEY_MESH_BITS 14
+#define SORT_KEY_DEPTH_BITS 22
+
+D3D11RenderBackend::D3D11RenderBackend(ID3D11DeviceContext* context, Camera* camera, ID3D11BlendState* transparentBlendState)
+{
+	this->context = context;
+	this->camera = camera;
+	this->transparentBlendState = transparentBlendState;
+}
+
+void D3D11RenderBackend::BeginPass(RenderPass pass)
+{
+	context->OMSetBlendState(pass == RenderPass::Transparent ? transparentBlendState : nullptr, 0, UINT_MAX);
+}
+
+void D3D11RenderBackend::BindShaders(SimpleVertexShader* vs, SimplePixelShader* ps)
+{
+	vs->SetShader();
+	ps->SetShader();
+}
+
+void D3D11RenderBackend::BindMaterial(Material* material)
+{
+	material->BindResources();
+}
+
+void D3D11RenderBackend::BindMesh(Mesh* mesh)
+{
+	mesh->Bind(context);
+}
+
+void D3D11RenderBackend::DrawEntity(Entity* entity)
+{
+	entity->DrawObject(context, camera);
+}
+
+void RenderQueue::Clear()
+{
+	items.clear();
+}
+
+void RenderQueue::Submit(Entity* entity, Camera* camera, RenderPass pass)
+{
+	Material* material = entity->GetMaterial();
+
+	DirectX::XMFLOAT3 eye = camera->GetTransform()->GetRenderPosition();
+	DirectX::XMFLOAT3 position = entity->GetTransform()->GetRenderPosition();
+	float dx = position.x - eye.x;
+	float dy = position.y - eye.y;
+	float dz = position.z - eye.z;
+
+	DrawItem item;
+	item.entity = entity;
+	item.key = MakeKey
+	(
+		pass,
+		GetShaderId(material->GetVertexShader(), material->GetPixelShader()),
+		GetMaterialId(material),
+		GetMeshId(entity->GetMesh()),
+		std::sqrt(dx * dx + dy * dy + dz * dz)
+	);
+	items.push_back(item);
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, uint32_t shaderId, uint32_t materialId, uint32_t meshId, float depth)
+{
+	// Positive floats sort the same as their bit patterns, so the
+	// top bits (below the sign) make a cheap quantized depth
+	uint32_t depthBits = 0;
+	if (depth > 0)
+	{
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+		depthBits >>= (31 - SORT_KEY_DEPTH_BITS);
+	}
+
+	uint64_t shader = shaderId & ((1u << SORT_KEY_SHADER_BITS) - 1);
+	uint64_t mat = materialId & ((1u << SORT_KEY_MATERIAL_BITS) - 1);
+	uint64_t mesh = meshId & ((1u << SORT_KEY_MESH_BITS) - 1);
+	uint64_t key = (uint64_t)pass << (64 - SORT_KEY_PASS_BITS);
+
+	if (pass == RenderPass::Transparent)
+	{
+		// Far to near, state only sorts draws at the same depth
+		uint64_t invertedDepth = ((1u << SORT_KEY_DEPTH_BITS) - 1) - depthBits;
+		key |= invertedDepth << (SORT_KEY_SHADER_BITS + SORT_KEY_MATERIAL_BITS + SORT_KEY_MESH_BITS);
+		key |= shader << (SORT_KEY_MATERIAL_BITS + SORT_KEY_MESH_BITS);
+		key |= mat << SORT_KEY_MESH_BITS;
+		key |= mesh;
+	}
+	else
+	{
+		// State first, then near to far to help early z
+		key |= shader << (SORT_KEY_MATERIAL_BITS + SORT_KEY_MESH_BITS + SORT_KEY_DEPTH_BITS);
+		key |= mat << (SORT_KEY_MESH_BITS + SORT_KEY_DEPTH_BITS);
+		key |= mesh << SORT_KEY_DEPTH_BITS;
+		key |= depthBits;
+	}
+
+	return key;
+}
+
+// --------------------------------------------------------
+// LSD radix sort, 8 bits per pass. Passes where every key
+// has the same byte are skipped, which is most of them
+// since the ids only use a few bits each.
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	size_t count = items.size();
+	if (count < 2)
+		return;
+
+	scratch.resize(count);
+	DrawItem* src = items.data();
+	DrawItem* dst = scratch.data();
+
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			histogram[(src[i].key >> shift) & 0xFF]++;
+		}
+
+		// All in one bucket means this byte doesn't change the order
+		if (histogram[(src[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		size_t offset = 0;
+		for (unsigned int b = 0; b < 256; b++)
+		{
+			size_t bucketCount = histogram[b];
+			histogram[b] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+
+		DrawItem* temp = src;
+		src = dst;
+		dst = temp;
+	}
+
+	// Make sure the result ends up in items
+	if (src != items.data())
+	{
+		items.swap(scratch);
+	}
+}
+
+void RenderQueue::Execute(IRenderBackend& backend)
+{
+	stats = RenderQueueStats();
+
+	bool first = true;
+	RenderPass currentPass = RenderPass::Opaque;
+	SimpleVertexShader* currentVS = nullptr;
+	SimplePixelShader* currentPS = nullptr;
+	Material* currentMaterial = nullptr;
+	Mesh* currentMesh = nullptr;
+
+	for (const DrawItem& item : items)
+	{
+		Entity* entity = item.entity;
+		Material* material = entity->GetMaterial();
+		Mesh* mesh = entity->GetMesh();
+		RenderPass pass = (RenderPass)(item.key >> (64 - SORT_KEY_PASS_BITS));
+
+		if (first || pass != currentPass)
+		{
+			backend.BeginPass(pass);
+			currentPass = pass;
+		}
+
+		// Changing shaders re-sets the constant buffers and the material
+		// data lives in them, so anything below has to be rebound too
+		bool shaderChanged = first || material->GetVertexShader() != currentVS || material->GetPixelShader() != currentPS;
+		if (shaderChanged)
+		{
+			currentVS = material->GetVertexShader();
+			currentPS = material->GetPixelShader();
+			backend.BindShaders(currentVS, currentPS);
+			stats.shaderBinds++;
+		}
+		else
+		{
+			stats.skippedShaderBinds++;
+		}
+
+		if (shaderChanged || material != currentMaterial)
+		{
+			currentMaterial = material;
+			backend.BindMaterial(material);
+			stats.materialBinds++;
+		}
+		else
+		{
+			stats.skippedMaterialBinds++;
+		}
+
+		if (first || mesh != currentMesh)
+		{
+			currentMesh = mesh;
+			backend.BindMesh(mesh);
+			stats.meshBinds++;
+		}
+		else
+		{
+			stats.skippedMeshBinds++;
+		}
+
+		backend.DrawEntity(entity);
+		stats.draws++;
+		first = false;
+	}
+}
+
+void RenderQueue::PrintStats() const
+{
+	printf("Render queue: %u draws, %u shader binds (%u skipped), %u material binds (%u skipped), %u mesh binds (%u skipped)\n",
+		stats.draws, stats.shaderBinds, stats.skippedShaderBinds, stats.materialBinds, stats.skippedMaterialBinds,
+		stats.meshBinds, stats.skippedMeshBinds);
+}
+
+uint32_t RenderQueue::GetShaderId(SimpleVertexShader* vs, SimplePixelShader* ps)
+{
+	auto result = shaderIds.emplace(std::make_pair(vs, ps), (uint32_t)shaderIds.size());
+	return result.first->second;
+}
+
+uint32_t RenderQueue::GetMaterialId(Material* material)
+{
+	auto result = materialIds.emplace(material, (uint32_t)materialIds.size());
+	return result.first->second;
+}
+
+uint32_t RenderQueue::GetMeshId(Mesh* mesh)
+{
+	auto result = meshIds.emplace(mesh, (uint32_t)meshIds.size());
+	return result.first->second;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+class Mesh;
+class Entity;
+class Camera;
+class Material;
+class SimpleVertexShader;
+class SimplePixelShader;
+
+struct ID3D11DeviceContext;
+struct ID3D11BlendState;
+
+// --------------------------------------------------------
+// Passes are drawn in this order
+// --------------------------------------------------------
+enum class RenderPass : uint8_t
+{
+	Opaque = 0,
+	Transparent = 1
+};
+
+// --------------------------------------------------------
+// Receives the state changes and draws that a sorted
+// RenderQueue emits. Only called when the state actually
+// changes between neighbouring draws.
+// --------------------------------------------------------
+class IRenderBackend
+{
+public:
+	virtual ~IRenderBackend() = default;
+
+	virtual void BeginPass(RenderPass pass) = 0;
+	virtual void BindShaders(SimpleVertexShader* vs, SimplePixelShader* ps) = 0;
+	virtual void BindMaterial(Material* material) = 0;
+	virtual void BindMesh(Mesh* mesh) = 0;
+	virtual void DrawEntity(Entity* entity) = 0;
+};
+
+// --------------------------------------------------------
+// Backend that issues the calls on a D3D11 context
+// --------------------------------------------------------
+class D3D11RenderBackend : public IRenderBackend
+{
+public:
+	D3D11RenderBackend(ID3D11DeviceContext* context, Camera* camera, ID3D11BlendState* transparentBlendState);
+
+	void BeginPass(RenderPass pass) override;
+	void BindShaders(SimpleVertexShader* vs, SimplePixelShader* ps) override;
+	void BindMaterial(Material* material) override;
+	void BindMesh(Mesh* mesh) override;
+	void DrawEntity(Entity* entity) override;
+
+private:
+	ID3D11DeviceContext* context;
+	Camera* camera;
+	ID3D11BlendState* transparentBlendState;
+};
+
+// --------------------------------------------------------
+// Backend that touches no GPU state, only counts the calls.
+// Handy for checking how well a queue sorts without a device.
+// --------------------------------------------------------
+class CountingRenderBackend : public IRenderBackend
+{
+public:
+	void BeginPass(RenderPass) override { passChanges++; }
+	void BindShaders(SimpleVertexShader*, SimplePixelShader*) override { shaderBinds++; }
+	void BindMaterial(Material*) override { materialBinds++; }
+	void BindMesh(Mesh*) override { meshBinds++; }
+	void DrawEntity(Entity*) override { draws++; }
+
+	unsigned int passChanges = 0;
+	unsigned int shaderBinds = 0;
+	unsigned int materialBinds = 0;
+	unsigned int meshBinds = 0;
+	unsigned int draws = 0;
+};
+
+// --------------------------------------------------------
+// Counts from the last RenderQueue::Execute()
+// --------------------------------------------------------
+struct RenderQueueStats
+{
+	unsigned int draws = 0;
+
+	unsigned int shaderBinds = 0;
+	unsigned int materialBinds = 0;
+	unsigned int meshBinds = 0;
+
+	// Binds an unsorted, one-entity-at-a-time draw would have made
+	unsigned int skippedShaderBinds = 0;
+	unsigned int skippedMaterialBinds = 0;
+	unsigned int skippedMeshBinds = 0;
+};
+
+// --------------------------------------------------------
+// Collects draws for a frame, sorts them by a 64 bit key
+// and only emits the state changes between neighbours
+//
+// Key layout, most significant bits first:
+//  - Opaque:      pass | shader | material | mesh | depth (front to back)
+//  - Transparent: pass | depth (back to front) | shader | material | mesh
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	// Removes all submitted draws, ids stay assigned between frames
+	void Clear();
+
+	// Adds a draw for the entity, depth is measured from the camera
+	void Submit(Entity* entity, Camera* camera, RenderPass pass = RenderPass::Opaque);
+
+	// Radix sorts the submitted draws by key
+	void Sort();
+
+	// Walks the sorted draws, handing state changes and draws to the backend
+	void Execute(IRenderBackend& backend);
+
+	inline size_t GetDrawCount() const { return items.size(); }
+	inline const RenderQueueStats& GetStats() const { return stats; }
+	void PrintStats() const;
+
+	static uint64_t MakeKey(RenderPass pass, uint32_t shaderId, uint32_t materialId, uint32_t meshId, float depth);
+
+private:
+	struct DrawItem
+	{
+		uint64_t key;
+		Entity* entity;
+	};
+
+	uint32_t GetShaderId(SimpleVertexShader* vs, SimplePixelShader* ps);
+	uint32_t GetMaterialId(Material* material);
+	uint32_t GetMeshId(Mesh* mesh);
+
+	std::vector<DrawItem> items;
+	std::vector<DrawItem> scratch;
+
+	// Small ids handed out in the order things are first seen
+	std::map<std::pair<SimpleVertexShader*, SimplePixelShader*>, uint32_t> shaderIds;
+	std::unordered_map<Material*, uint32_t> materialIds;
+	std::unordered_map<Mesh*, uint32_t> meshIds;
+
+	RenderQueueStats stats;
+};
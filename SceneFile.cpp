@@ -0,0 +1,862 @@
+#include "SceneFile.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+// Words on one line of the text format, more is an error
+#define SCENE_MAX_TOKENS 32
+
+// --------------------------------------------------------
+// Reads the text format one line at a time. Every line is
+// a keyword followed by its values, names have to be
+// declared before anything refers to them, and everything
+// after a # is a comment.
+// --------------------------------------------------------
+class SceneParser
+{
+public:
+	SceneParser(const char* fileName, SceneData& scene) : fileName(fileName), scene(scene) {}
+
+	bool Parse(const char* data, size_t size);
+
+	// The first error as "file:line: message", empty if there was none
+	inline const std::string& GetError() const { return error; }
+
+private:
+	bool ParseLine();
+	bool ParsePlayer();
+	bool ParseMesh();
+	bool ParseTexture();
+	bool ParseMaterial();
+	bool ParseEntity();
+	bool ParseRoute();
+	bool ParseWaypoint();
+	bool ParseGhost();
+	bool ParseLight();
+
+	// Reads "position", "rotation" or "scale" and its values if that's the next word
+	bool ParseTransformValue(SceneTransform& transform, bool& matched);
+
+	bool Error(const char* message, const char* detail = "");
+
+	// The words of the current line, read front to back
+	inline bool AtEnd() const { return next >= tokenCount; }
+	std::string PeekWord() const;
+	bool IsNext(const char* word);
+	bool IsNextNumber() const;
+	bool ReadWord(std::string& out, const char* what);
+	bool ReadFloat(float& out);
+	bool ReadFloat3(XMFLOAT3& out);
+	bool ReadName(const std::unordered_map<std::string, uint32_t>& names, const char* kind, uint32_t& out);
+	bool AddName(std::unordered_map<std::string, uint32_t>& names, const char* kind, const std::string& name, uint32_t index);
+	uint32_t AddString(const std::string& text);
+
+	const char* fileName;
+	SceneData& scene;
+
+	const char* tokens[SCENE_MAX_TOKENS];
+	size_t lengths[SCENE_MAX_TOKENS];
+	unsigned int tokenCount = 0;
+	unsigned int next = 0;
+	unsigned int lineNumber = 0;
+	std::string error;
+
+	std::unordered_map<std::string, uint32_t> meshNames;
+	std::unordered_map<std::string, uint32_t> textureNames;
+	std::unordered_map<std::string, uint32_t> materialNames;
+	std::unordered_map<std::string, uint32_t> routeNames;
+	std::unordered_map<std::string, uint32_t> ghostNames;
+
+	// Waypoints can come in any order, each route's are made contiguous at the end
+	std::vector<std::vector<XMFLOAT3>> routeWaypoints;
+};
+
+static inline bool IsSceneSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool ValidateScene(const SceneData& scene);
+
+static std::string GetDirectory(const char* fileName)
+{
+	std::string path(fileName);
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+bool SceneParser::Parse(const char* data, size_t size)
+{
+	scene = SceneData();
+	scene.directory = GetDirectory(fileName);
+	scene.player.position = XMFLOAT3(0, 0, 0);
+	scene.player.rotation = XMFLOAT3(0, 0, 0);
+	scene.player.scale = XMFLOAT3(1, 1, 1);
+
+	const char* p = data;
+	const char* end = data + size;
+	while (p < end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (!lineEnd)
+			lineEnd = end;
+
+		const char* comment = (const char*)memchr(p, '#', lineEnd - p);
+		const char* wordsEnd = comment ? comment : lineEnd;
+		lineNumber++;
+
+		// Split the line in place
+		tokenCount = 0;
+		next = 0;
+		while (p < wordsEnd)
+		{
+			while (p < wordsEnd && IsSceneSpace(*p))
+				p++;
+			if (p == wordsEnd)
+				break;
+
+			if (tokenCount == SCENE_MAX_TOKENS)
+				return Error("too many words on one line");
+
+			tokens[tokenCount] = p;
+			while (p < wordsEnd && !IsSceneSpace(*p))
+				p++;
+			lengths[tokenCount] = p - tokens[tokenCount];
+			tokenCount++;
+		}
+
+		if (tokenCount > 0 && !ParseLine())
+			return false;
+
+		p = lineEnd + 1;
+	}
+
+	// Every route's waypoints end up next to each other
+	for (size_t i = 0; i < scene.routes.size(); i++)
+	{
+		if (routeWaypoints[i].empty())
+		{
+			for (const auto& route : routeNames)
+			{
+				if (route.second == i)
+					return Error("no waypoints for route ", route.first.c_str());
+			}
+		}
+
+		scene.routes[i].firstWaypoint = (uint32_t)scene.waypoints.size();
+		scene.routes[i].waypointCount = (uint32_t)routeWaypoints[i].size();
+		scene.waypoints.insert(scene.waypoints.end(), routeWaypoints[i].begin(), routeWaypoints[i].end());
+	}
+
+	if (scene.strings.empty())
+		scene.strings.push_back('\0');
+
+	if (!ValidateScene(scene))
+		return Error("an index or path is out of range");
+	return true;
+}
+
+bool SceneParser::ParseLine()
+{
+	std::string keyword;
+	ReadWord(keyword, "keyword");
+
+	bool parsed;
+	if (keyword == "player") parsed = ParsePlayer();
+	else if (keyword == "mesh") parsed = ParseMesh();
+	else if (keyword == "texture") parsed = ParseTexture();
+	else if (keyword == "material") parsed = ParseMaterial();
+	else if (keyword == "entity") parsed = ParseEntity();
+	else if (keyword == "route") parsed = ParseRoute();
+	else if (keyword == "waypoint") parsed = ParseWaypoint();
+	else if (keyword == "ghost") parsed = ParseGhost();
+	else if (keyword == "light") parsed = ParseLight();
+	else return Error("unknown keyword ", keyword.c_str());
+
+	if (parsed && !AtEnd())
+		return Error("unexpected ", PeekWord().c_str());
+	return parsed;
+}
+
+// player [position x y z] [rotation pitch yaw roll]
+bool SceneParser::ParsePlayer()
+{
+	while (!AtEnd())
+	{
+		bool matched;
+		if (!ParseTransformValue(scene.player, matched))
+			return false;
+		if (!matched)
+			return Error("unexpected ", PeekWord().c_str());
+	}
+	return true;
+}
+
+// mesh <name> <file>
+bool SceneParser::ParseMesh()
+{
+	std::string name, path;
+	if (!ReadWord(name, "mesh name") || !ReadWord(path, "mesh file") ||
+		!AddName(meshNames, "mesh", name, (uint32_t)scene.meshes.size()))
+		return false;
+
+	SceneMesh mesh;
+	mesh.path = AddString(path);
+	scene.meshes.push_back(mesh);
+	return true;
+}
+
+// texture <name> <file> <color | flat | normal>
+bool SceneParser::ParseTexture()
+{
+	std::string name, path, usage;
+	if (!ReadWord(name, "texture name") || !ReadWord(path, "texture file") || !ReadWord(usage, "texture usage"))
+		return false;
+
+	SceneTexture texture;
+	if (usage == "color") texture.usage = TextureUsage::Color;
+	else if (usage == "flat") texture.usage = TextureUsage::FlatColor;
+	else if (usage == "normal") texture.usage = TextureUsage::NormalMap;
+	else return Error("unknown texture usage ", usage.c_str());
+
+	if (!AddName(textureNames, "texture", name, (uint32_t)scene.textures.size()))
+		return false;
+
+	texture.path = AddString(path);
+	scene.textures.push_back(texture);
+	return true;
+}
+
+// material <name> <lit | normalmap | instanced> [tint r g b a] [shininess s] [diffuse <texture>] [normal <texture>]
+bool SceneParser::ParseMaterial()
+{
+	std::string name, shader;
+	if (!ReadWord(name, "material name") || !ReadWord(shader, "material shader"))
+		return false;
+
+	SceneMaterial material;
+	material.tint = XMFLOAT4(1, 1, 1, 1);
+	material.shininess = 0;
+	material.diffuse = SCENE_NONE;
+	material.normal = SCENE_NONE;
+
+	if (shader == "lit") material.shader = SceneShader::Lit;
+	else if (shader == "normalmap") material.shader = SceneShader::NormalMapped;
+	else if (shader == "instanced") material.shader = SceneShader::Instanced;
+	else return Error("unknown shader ", shader.c_str());
+
+	while (!AtEnd())
+	{
+		bool read;
+		if (IsNext("tint"))
+		{
+			XMFLOAT3 rgb;
+			read = ReadFloat3(rgb) && ReadFloat(material.tint.w);
+			material.tint.x = rgb.x;
+			material.tint.y = rgb.y;
+			material.tint.z = rgb.z;
+		}
+		else if (IsNext("shininess")) read = ReadFloat(material.shininess);
+		else if (IsNext("diffuse")) read = ReadName(textureNames, "texture", material.diffuse);
+		else if (IsNext("normal")) read = ReadName(textureNames, "texture", material.normal);
+		else return Error("unexpected ", PeekWord().c_str());
+
+		if (!read)
+			return false;
+	}
+
+	// What each shader binds has to be there
+	bool needsDiffuse = material.shader != SceneShader::Instanced;
+	bool needsNormal = material.shader == SceneShader::NormalMapped;
+	if ((material.diffuse != SCENE_NONE) != needsDiffuse || (material.normal != SCENE_NONE) != needsNormal)
+		return Error("wrong textures for the shader ", shader.c_str());
+
+	if (!AddName(materialNames, "material", name, (uint32_t)scene.materials.size()))
+		return false;
+
+	scene.materials.push_back(material);
+	return true;
+}
+
+// entity <shape | level> <mesh> <material> [position x y z] [rotation pitch yaw roll] [scale x y z | scale s]
+bool SceneParser::ParseEntity()
+{
+	std::string group;
+	if (!ReadWord(group, "entity group"))
+		return false;
+
+	SceneEntity entity;
+	if (group == "shape") entity.group = SceneGroup::Shape;
+	else if (group == "level") entity.group = SceneGroup::Level;
+	else return Error("unknown entity group ", group.c_str());
+
+	if (!ReadName(meshNames, "mesh", entity.mesh) || !ReadName(materialNames, "material", entity.material))
+		return false;
+
+	entity.transform.position = XMFLOAT3(0, 0, 0);
+	entity.transform.rotation = XMFLOAT3(0, 0, 0);
+	entity.transform.scale = XMFLOAT3(1, 1, 1);
+	while (!AtEnd())
+	{
+		bool matched;
+		if (!ParseTransformValue(entity.transform, matched))
+			return false;
+		if (!matched)
+			return Error("unexpected ", PeekWord().c_str());
+	}
+
+	scene.entities.push_back(entity);
+	return true;
+}
+
+// route <name> <mesh> <material> [scale s], the mesh and material draw its waypoints
+bool SceneParser::ParseRoute()
+{
+	std::string name;
+	SceneRoute route = {};
+	route.waypointScale = 1;
+	if (!ReadWord(name, "route name") ||
+		!ReadName(meshNames, "mesh", route.mesh) ||
+		!ReadName(materialNames, "material", route.material))
+		return false;
+
+	if (IsNext("scale") && !ReadFloat(route.waypointScale))
+		return false;
+
+	if (!AddName(routeNames, "route", name, (uint32_t)scene.routes.size()))
+		return false;
+
+	scene.routes.push_back(route);
+	routeWaypoints.emplace_back();
+	return true;
+}
+
+// waypoint <route> x y z
+bool SceneParser::ParseWaypoint()
+{
+	uint32_t route;
+	XMFLOAT3 position;
+	if (!ReadName(routeNames, "route", route) || !ReadFloat3(position))
+		return false;
+
+	routeWaypoints[route].push_back(position);
+	return true;
+}
+
+// ghost <name> <mesh> <material> <route> [position x y z] [rotation pitch yaw roll] [scale x y z | scale s]
+bool SceneParser::ParseGhost()
+{
+	std::string name;
+	SceneGhost ghost;
+	if (!ReadWord(name, "ghost name") ||
+		!ReadName(meshNames, "mesh", ghost.mesh) ||
+		!ReadName(materialNames, "material", ghost.material) ||
+		!ReadName(routeNames, "route", ghost.route))
+		return false;
+
+	ghost.transform.position = XMFLOAT3(0, 0, 0);
+	ghost.transform.rotation = XMFLOAT3(0, 0, 0);
+	ghost.transform.scale = XMFLOAT3(1, 1, 1);
+	while (!AtEnd())
+	{
+		bool matched;
+		if (!ParseTransformValue(ghost.transform, matched))
+			return false;
+		if (!matched)
+			return Error("unexpected ", PeekWord().c_str());
+	}
+
+	if (!AddName(ghostNames, "ghost", name, (uint32_t)scene.ghosts.size()))
+		return false;
+
+	scene.ghosts.push_back(ghost);
+	return true;
+}
+
+// light <directional | point | spot | ambient> [color r g b] [intensity i] [range r]
+//       [direction x y z] [position x y z] [falloff f] [follow <ghost> x y z]
+bool SceneParser::ParseLight()
+{
+	std::string type;
+	if (!ReadWord(type, "light type"))
+		return false;
+
+	Light light = {};
+	light.color = XMFLOAT3(1, 1, 1);
+	light.intensity = 1;
+
+	if (type == "directional") light.type = LIGHT_TYPE_DIR;
+	else if (type == "point") light.type = LIGHT_TYPE_POINT;
+	else if (type == "spot") light.type = LIGHT_TYPE_SPOT;
+	else if (type == "ambient") light.type = LIGHT_TYPE_AMBIENT;
+	else return Error("unknown light type ", type.c_str());
+
+	while (!AtEnd())
+	{
+		bool read;
+		if (IsNext("color")) read = ReadFloat3(light.color);
+		else if (IsNext("intensity")) read = ReadFloat(light.intensity);
+		else if (IsNext("range")) read = ReadFloat(light.range);
+		else if (IsNext("direction")) read = ReadFloat3(light.direction);
+		else if (IsNext("position")) read = ReadFloat3(light.position);
+		else if (IsNext("falloff")) read = ReadFloat(light.spotFalloff);
+		else if (IsNext("follow"))
+		{
+			SceneLightLink link;
+			link.light = (uint32_t)scene.lights.size();
+			read = ReadName(ghostNames, "ghost", link.ghost) && ReadFloat3(link.offset);
+			scene.lightLinks.push_back(link);
+		}
+		else return Error("unexpected ", PeekWord().c_str());
+
+		if (!read)
+			return false;
+	}
+
+	scene.lights.push_back(light);
+	return true;
+}
+
+bool SceneParser::ParseTransformValue(SceneTransform& transform, bool& matched)
+{
+	matched = true;
+	if (IsNext("position"))
+		return ReadFloat3(transform.position);
+	if (IsNext("rotation"))
+		return ReadFloat3(transform.rotation);
+	if (IsNext("scale"))
+	{
+		// One value scales evenly
+		if (!ReadFloat(transform.scale.x))
+			return false;
+		if (!IsNextNumber())
+		{
+			transform.scale.y = transform.scale.z = transform.scale.x;
+			return true;
+		}
+		return ReadFloat(transform.scale.y) && ReadFloat(transform.scale.z);
+	}
+
+	matched = false;
+	return true;
+}
+
+bool SceneParser::Error(const char* message, const char* detail)
+{
+	error = std::string(fileName) + ":" + std::to_string(lineNumber) + ": " + message + detail;
+	return false;
+}
+
+std::string SceneParser::PeekWord() const
+{
+	return AtEnd() ? std::string() : std::string(tokens[next], lengths[next]);
+}
+
+bool SceneParser::IsNext(const char* word)
+{
+	if (AtEnd() || strlen(word) != lengths[next] || memcmp(word, tokens[next], lengths[next]) != 0)
+		return false;
+
+	next++;
+	return true;
+}
+
+bool SceneParser::IsNextNumber() const
+{
+	if (AtEnd())
+		return false;
+
+	char c = tokens[next][0];
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+bool SceneParser::ReadWord(std::string& out, const char* what)
+{
+	if (AtEnd())
+		return Error("missing ", what);
+
+	out.assign(tokens[next], lengths[next]);
+	next++;
+	return true;
+}
+
+bool SceneParser::ReadFloat(float& out)
+{
+	if (AtEnd())
+		return Error("missing a number");
+
+	// The mapped file isn't null terminated, so the word is copied out first
+	char buffer[64];
+	size_t length = lengths[next];
+	if (length >= sizeof(buffer))
+		return Error("not a number ", PeekWord().c_str());
+
+	memcpy(buffer, tokens[next], length);
+	buffer[length] = '\0';
+
+	char* numberEnd = nullptr;
+	out = strtof(buffer, &numberEnd);
+	if (numberEnd != buffer + length)
+		return Error("not a number ", buffer);
+
+	next++;
+	return true;
+}
+
+bool SceneParser::ReadFloat3(XMFLOAT3& out)
+{
+	return ReadFloat(out.x) && ReadFloat(out.y) && ReadFloat(out.z);
+}
+
+bool SceneParser::ReadName(const std::unordered_map<std::string, uint32_t>& names, const char* kind, uint32_t& out)
+{
+	std::string name;
+	if (!ReadWord(name, kind))
+		return false;
+
+	auto found = names.find(name);
+	if (found == names.end())
+	{
+		std::string detail = std::string(kind) + " " + name;
+		return Error("undeclared ", detail.c_str());
+	}
+
+	out = found->second;
+	return true;
+}
+
+bool SceneParser::AddName(std::unordered_map<std::string, uint32_t>& names, const char* kind, const std::string& name, uint32_t index)
+{
+	if (!names.emplace(name, index).second)
+	{
+		std::string detail = std::string(kind) + " " + name;
+		return Error("redeclared ", detail.c_str());
+	}
+	return true;
+}
+
+uint32_t SceneParser::AddString(const std::string& text)
+{
+	uint32_t offset = (uint32_t)scene.strings.size();
+	scene.strings.insert(scene.strings.end(), text.begin(), text.end());
+	scene.strings.push_back('\0');
+	return offset;
+}
+
+// --------------------------------------------------------
+// Checks that every index and path offset points inside its
+// array, so nothing using the scene has to
+// --------------------------------------------------------
+static bool ValidateScene(const SceneData& scene)
+{
+	if (scene.strings.empty() || scene.strings.back() != '\0')
+		return false;
+
+	uint32_t stringBytes = (uint32_t)scene.strings.size();
+	for (const SceneMesh& mesh : scene.meshes)
+	{
+		if (mesh.path >= stringBytes)
+			return false;
+	}
+
+	for (const SceneTexture& texture : scene.textures)
+	{
+		if (texture.path >= stringBytes || (uint32_t)texture.usage > (uint32_t)TextureUsage::NormalMap)
+			return false;
+	}
+
+	uint32_t textureCount = (uint32_t)scene.textures.size();
+	for (const SceneMaterial& material : scene.materials)
+	{
+		if ((uint32_t)material.shader > (uint32_t)SceneShader::Instanced ||
+			(material.diffuse != SCENE_NONE && material.diffuse >= textureCount) ||
+			(material.normal != SCENE_NONE && material.normal >= textureCount))
+			return false;
+	}
+
+	uint32_t meshCount = (uint32_t)scene.meshes.size();
+	uint32_t materialCount = (uint32_t)scene.materials.size();
+	for (const SceneEntity& entity : scene.entities)
+	{
+		if (entity.mesh >= meshCount || entity.material >= materialCount || (uint32_t)entity.group > (uint32_t)SceneGroup::Level)
+			return false;
+	}
+
+	for (const SceneRoute& route : scene.routes)
+	{
+		if (route.mesh >= meshCount || route.material >= materialCount ||
+			(uint64_t)route.firstWaypoint + route.waypointCount > scene.waypoints.size())
+			return false;
+	}
+
+	for (const SceneGhost& ghost : scene.ghosts)
+	{
+		if (ghost.mesh >= meshCount || ghost.material >= materialCount || ghost.route >= scene.routes.size())
+			return false;
+	}
+
+	for (const SceneLightLink& link : scene.lightLinks)
+	{
+		if (link.light >= scene.lights.size() || link.ghost >= scene.ghosts.size())
+			return false;
+	}
+
+	return true;
+}
+
+static SSceneHeader MakeSceneHeader(const SceneData& scene, uint64_t sourceHash)
+{
+	SSceneHeader header = {};
+	header.magic = SSCENE_MAGIC;
+	header.version = SSCENE_VERSION;
+	header.sourceHash = sourceHash;
+	header.meshCount = (uint32_t)scene.meshes.size();
+	header.textureCount = (uint32_t)scene.textures.size();
+	header.materialCount = (uint32_t)scene.materials.size();
+	header.entityCount = (uint32_t)scene.entities.size();
+	header.ghostCount = (uint32_t)scene.ghosts.size();
+	header.routeCount = (uint32_t)scene.routes.size();
+	header.waypointCount = (uint32_t)scene.waypoints.size();
+	header.lightCount = (uint32_t)scene.lights.size();
+	header.lightLinkCount = (uint32_t)scene.lightLinks.size();
+	header.stringBytes = (uint32_t)scene.strings.size();
+	header.player = scene.player;
+	return header;
+}
+
+// Bytes of the whole compiled file the header describes
+static size_t GetCompiledSceneSize(const SSceneHeader& header)
+{
+	return sizeof(SSceneHeader) +
+		(size_t)header.meshCount * sizeof(SceneMesh) +
+		(size_t)header.textureCount * sizeof(SceneTexture) +
+		(size_t)header.materialCount * sizeof(SceneMaterial) +
+		(size_t)header.entityCount * sizeof(SceneEntity) +
+		(size_t)header.ghostCount * sizeof(SceneGhost) +
+		(size_t)header.routeCount * sizeof(SceneRoute) +
+		(size_t)header.waypointCount * sizeof(XMFLOAT3) +
+		(size_t)header.lightCount * sizeof(Light) +
+		(size_t)header.lightLinkCount * sizeof(SceneLightLink) +
+		header.stringBytes;
+}
+
+// Copies count items out of the file in one go, returns where the next array starts
+template<typename T>
+static const char* ReadSceneArray(const char* cursor, uint32_t count, std::vector<T>& out)
+{
+	const T* items = (const T*)cursor;
+	out.assign(items, items + count);
+	return cursor + (size_t)count * sizeof(T);
+}
+
+// Whether the file is a compiled scene of this version with all of its arrays there
+static bool IsValidSceneHeader(const MappedFile& file)
+{
+	if (file.GetSize() < sizeof(SSceneHeader))
+		return false;
+
+	const SSceneHeader* header = (const SSceneHeader*)file.GetData();
+	return header->magic == SSCENE_MAGIC &&
+		header->version == SSCENE_VERSION &&
+		file.GetSize() == GetCompiledSceneSize(*header);
+}
+
+// Copies the arrays out of a compiled scene that passed IsValidSceneHeader
+static bool ReadCompiledScene(const MappedFile& file, const char* cacheFileName, SceneData& outScene)
+{
+	const SSceneHeader* header = (const SSceneHeader*)file.GetData();
+
+	// One allocation and copy per array
+	outScene = SceneData();
+	outScene.directory = GetDirectory(cacheFileName);
+	outScene.player = header->player;
+
+	const char* cursor = file.GetData() + sizeof(SSceneHeader);
+	cursor = ReadSceneArray(cursor, header->meshCount, outScene.meshes);
+	cursor = ReadSceneArray(cursor, header->textureCount, outScene.textures);
+	cursor = ReadSceneArray(cursor, header->materialCount, outScene.materials);
+	cursor = ReadSceneArray(cursor, header->entityCount, outScene.entities);
+	cursor = ReadSceneArray(cursor, header->ghostCount, outScene.ghosts);
+	cursor = ReadSceneArray(cursor, header->routeCount, outScene.routes);
+	cursor = ReadSceneArray(cursor, header->waypointCount, outScene.waypoints);
+	cursor = ReadSceneArray(cursor, header->lightCount, outScene.lights);
+	cursor = ReadSceneArray(cursor, header->lightLinkCount, outScene.lightLinks);
+	ReadSceneArray(cursor, header->stringBytes, outScene.strings);
+
+	return ValidateScene(outScene);
+}
+
+bool LoadScene(const char* fileName, SceneData& outScene, SceneLoadStats* outStats)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	std::string cachePath = GetSceneCachePath(fileName);
+
+	SceneLoadStats stats;
+	bool loaded = false;
+
+	MappedFile source;
+	if (!source.Open(fileName))
+	{
+		// Shipped without the text, so whatever was compiled is the scene
+		loaded = LoadCompiledScene(cachePath.c_str(), 0, outScene);
+		stats.fromCache = true;
+		if (!loaded)
+			stats.error = std::string(fileName) + ": could not open it or a valid " + cachePath;
+	}
+	else
+	{
+		// The same size and write time as when it was compiled means the text
+		// wasn't touched, only hash it to tell if the compiled version is stale
+		MappedFile cache;
+		const SSceneHeader* header = nullptr;
+		if (cache.Open(cachePath.c_str()) && IsValidSceneHeader(cache))
+			header = (const SSceneHeader*)cache.GetData();
+
+		bool stamped = header && source.GetWriteTime() != 0 &&
+			header->sourceSize == source.GetSize() && header->sourceWriteTime == source.GetWriteTime();
+		uint64_t sourceHash = stamped ? header->sourceHash : HashBytes(source.GetData(), source.GetSize());
+
+		if (header && header->sourceHash == sourceHash && ReadCompiledScene(cache, cachePath.c_str(), outScene))
+		{
+			loaded = true;
+			stats.fromCache = true;
+
+			// Same text with a new write time, i.e. a fresh checkout, stamp it so the next launch skips the hash
+			cache.Close();
+			if (!stamped && source.GetWriteTime() != 0)
+				SaveCompiledScene(cachePath.c_str(), sourceHash, outScene, source.GetSize(), source.GetWriteTime());
+		}
+		else
+		{
+			cache.Close();
+			if (stamped)
+				sourceHash = HashBytes(source.GetData(), source.GetSize());
+
+			SceneParser parser(fileName, outScene);
+			loaded = parser.Parse(source.GetData(), source.GetSize());
+			stats.fileBytes = source.GetSize();
+			stats.error = parser.GetError();
+
+			// Compile it so the next launch skips all of the parsing
+			if (loaded && !SaveCompiledScene(cachePath.c_str(), sourceHash, outScene, source.GetSize(), source.GetWriteTime()))
+			{
+#if defined(DEBUG) || defined(_DEBUG)
+				printf("Scene %s: could not write %s\n", fileName, cachePath.c_str());
+#endif
+			}
+		}
+	}
+
+	if (!loaded)
+	{
+		if (outStats)
+			*outStats = stats;
+		return false;
+	}
+
+	if (stats.fromCache)
+		stats.fileBytes = GetCompiledSceneSize(MakeSceneHeader(outScene, 0));
+	stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Scene %s: %s %u entities, %u ghosts and %u lights from %.1f KB in %.2f ms\n",
+		fileName, stats.fromCache ? "loaded compiled" : "compiled", (unsigned int)outScene.entities.size(),
+		(unsigned int)outScene.ghosts.size(), (unsigned int)outScene.lights.size(), stats.fileBytes / 1024.0, stats.seconds * 1000.0);
+#endif
+
+	if (outStats)
+		*outStats = stats;
+	return true;
+}
+
+bool ParseScene(const char* fileName, SceneData& outScene, std::string* outError)
+{
+	MappedFile source;
+	if (!source.Open(fileName))
+	{
+		if (outError)
+			*outError = std::string(fileName) + ": could not open it";
+		return false;
+	}
+
+	SceneParser parser(fileName, outScene);
+	bool parsed = parser.Parse(source.GetData(), source.GetSize());
+	if (outError)
+		*outError = parser.GetError();
+	return parsed;
+}
+
+bool LoadCompiledScene(const char* cacheFileName, uint64_t expectedSourceHash, SceneData& outScene)
+{
+	MappedFile file;
+	if (!file.Open(cacheFileName) || !IsValidSceneHeader(file))
+		return false;
+
+	const SSceneHeader* header = (const SSceneHeader*)file.GetData();
+	if (expectedSourceHash != 0 && header->sourceHash != expectedSourceHash)
+		return false;
+
+	return ReadCompiledScene(file, cacheFileName, outScene);
+}
+
+template<typename T>
+static void WriteSceneArray(std::ofstream& out, const std::vector<T>& items)
+{
+	out.write((const char*)items.data(), items.size() * sizeof(T));
+}
+
+bool SaveCompiledScene(const char* cacheFileName, uint64_t sourceHash, const SceneData& scene,
+	uint64_t sourceSize, uint64_t sourceWriteTime)
+{
+	SSceneHeader header = MakeSceneHeader(scene, sourceHash);
+	header.sourceSize = sourceSize;
+	header.sourceWriteTime = sourceWriteTime;
+
+	// Write to a temporary file first so a crash mid-write
+	// never leaves a half compiled scene behind
+	std::string tempFileName = std::string(cacheFileName) + ".tmp";
+	{
+		std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		WriteSceneArray(out, scene.meshes);
+		WriteSceneArray(out, scene.textures);
+		WriteSceneArray(out, scene.materials);
+		WriteSceneArray(out, scene.entities);
+		WriteSceneArray(out, scene.ghosts);
+		WriteSceneArray(out, scene.routes);
+		WriteSceneArray(out, scene.waypoints);
+		WriteSceneArray(out, scene.lights);
+		WriteSceneArray(out, scene.lightLinks);
+		WriteSceneArray(out, scene.strings);
+		if (!out.good())
+		{
+			out.close();
+			std::remove(tempFileName.c_str());
+			return false;
+		}
+	}
+
+	std::remove(cacheFileName);
+	return std::rename(tempFileName.c_str(), cacheFileName) == 0;
+}
+
+std::string GetSceneCachePath(const char* sourceFileName)
+{
+	std::string path(sourceFileName);
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+
+	return path + ".sscene";
+}
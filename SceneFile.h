@@ -0,0 +1,190 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Lights.h"
+#include "TextureCache.h"
+
+// --------------------------------------------------------
+// Layout of a compiled scene (.sscene) file:
+//  - SSceneHeader
+//  - meshCount SceneMesh, textureCount SceneTexture,
+//    materialCount SceneMaterial, entityCount SceneEntity,
+//    ghostCount SceneGhost, routeCount SceneRoute,
+//    waypointCount XMFLOAT3, lightCount Light and
+//    lightLinkCount SceneLightLink structs
+//  - stringBytes of null terminated file paths
+//
+// Bump SSCENE_VERSION whenever the layout of the file or of
+// any of those structs changes, so stale scenes get recompiled
+// --------------------------------------------------------
+#define SSCENE_MAGIC 0x4E435353 // "SSCN"
+#define SSCENE_VERSION 2
+
+// An index that refers to nothing, like a material without a normal map
+#define SCENE_NONE UINT32_MAX
+
+// Which shaders a material draws with
+enum class SceneShader : uint32_t
+{
+	Lit,			// Diffuse texture
+	NormalMapped,	// Diffuse texture and normal map
+	Instanced		// Tint only, drawn through the instanced renderer
+};
+
+// What the simulation does with an entity
+enum class SceneGroup : uint32_t
+{
+	Shape,	// The demo shapes that bob and spin
+	Level	// The rooms and their props, baked into the nav mesh
+};
+
+// Where something starts, the rotation is pitch, yaw and roll in radians
+struct SceneTransform
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 rotation;
+	DirectX::XMFLOAT3 scale;
+};
+
+struct SceneMesh
+{
+	uint32_t path;	// Offset into the strings
+};
+
+struct SceneTexture
+{
+	uint32_t path;
+	TextureUsage usage;
+};
+
+struct SceneMaterial
+{
+	DirectX::XMFLOAT4 tint;
+	float shininess;
+	SceneShader shader;
+	uint32_t diffuse;	// Texture index or SCENE_NONE
+	uint32_t normal;
+};
+
+struct SceneEntity
+{
+	uint32_t mesh;
+	uint32_t material;
+	SceneGroup group;
+	SceneTransform transform;
+};
+
+struct SceneGhost
+{
+	uint32_t mesh;
+	uint32_t material;
+	uint32_t route;		// Patrols this route's waypoints
+	SceneTransform transform;
+};
+
+// The waypoints of a route are drawn with its mesh and material
+struct SceneRoute
+{
+	uint32_t mesh;
+	uint32_t material;
+	uint32_t firstWaypoint;
+	uint32_t waypointCount;
+	float waypointScale;
+};
+
+// A light that follows a ghost around, offset is in the ghost's space
+struct SceneLightLink
+{
+	uint32_t light;
+	uint32_t ghost;
+	DirectX::XMFLOAT3 offset;
+};
+
+struct SSceneHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;	// Hash of the text it was compiled from
+	uint64_t sourceSize;	// Size of that text
+	uint64_t sourceWriteTime;	// Its write time, while both match the text isn't hashed again
+	uint32_t meshCount;
+	uint32_t textureCount;
+	uint32_t materialCount;
+	uint32_t entityCount;
+	uint32_t ghostCount;
+	uint32_t routeCount;
+	uint32_t waypointCount;
+	uint32_t lightCount;
+	uint32_t lightLinkCount;
+	uint32_t stringBytes;
+	SceneTransform player;
+	uint32_t reserved;
+};
+
+// --------------------------------------------------------
+// Everything a level starts out as, each kind in one
+// contiguous array. Items refer to each other by index,
+// file paths are offsets into the strings and relative to
+// the scene file.
+// --------------------------------------------------------
+struct SceneData
+{
+	std::string directory;	// Folder of the scene file, ends with a separator
+	std::vector<char> strings;
+
+	SceneTransform player;
+	std::vector<SceneMesh> meshes;
+	std::vector<SceneTexture> textures;
+	std::vector<SceneMaterial> materials;
+	std::vector<SceneEntity> entities;
+	std::vector<SceneGhost> ghosts;
+	std::vector<SceneRoute> routes;
+	std::vector<DirectX::XMFLOAT3> waypoints;
+	std::vector<Light> lights;
+	std::vector<SceneLightLink> lightLinks;
+
+	// A path from the strings, ready to open
+	inline std::string GetPath(uint32_t path) const { return directory + (strings.data() + path); }
+};
+
+// --------------------------------------------------------
+// Timing and size information for a single load
+// --------------------------------------------------------
+struct SceneLoadStats
+{
+	size_t fileBytes = 0;		// Size of whichever file was read
+	double seconds = 0;			// Time spent reading, parsing and validating
+	bool fromCache = false;
+	std::string error;			// Why the load failed, with the line for text errors
+};
+
+// --------------------------------------------------------
+// Loads a scene written in the text format, see
+// Assets/Scenes/Level.scene for what it looks like
+//
+// - An up to date compiled .sscene next to it is read with
+//   one bulk copy per array instead of parsing the text,
+//   and a stale or missing one is compiled and saved
+// - The text is only hashed when its size or write time
+//   differ from what the compiled scene was made from
+// - Without the text, a compiled scene is loaded as is
+// - Returns false if neither can be read or the text has
+//   errors, the stats say why in every build
+// --------------------------------------------------------
+bool LoadScene(const char* fileName, SceneData& outScene, SceneLoadStats* outStats = nullptr);
+
+// Parses the text format, resolving every name to an index. outError gets the first error.
+bool ParseScene(const char* fileName, SceneData& outScene, std::string* outError = nullptr);
+
+// Reads a compiled scene, checking every index. An expected hash of 0 takes any source.
+bool LoadCompiledScene(const char* cacheFileName, uint64_t expectedSourceHash, SceneData& outScene);
+
+// Writes the arrays of a scene to a compiled file, with the size and write time of the text if there is one
+bool SaveCompiledScene(const char* cacheFileName, uint64_t sourceHash, const SceneData& scene,
+	uint64_t sourceSize = 0, uint64_t sourceWriteTime = 0);
+
+// The compiled file used for a given scene, i.e. "Scenes/Level.scene" -> "Scenes/Level.sscene"
+std::string GetSceneCachePath(const char* sourceFileName);
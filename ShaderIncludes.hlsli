@@ -9,6 +9,11 @@
 #define LIGHT_TYPE_SPOT 2
 #define LIGHT_TYPE_AMBIENT 3
 
+// Clustered lighting grid, must match LightClusters.h
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+
 struct Light 
 {
 	float3 color;
@@ -64,6 +69,11 @@ struct V2P_NormalMap
 	float3 tangent		: TANGENT;
 };
 
+// Light lists built on the CPU by LightClusters, the first
+// globalLightCount indices are lights that apply everywhere
+StructuredBuffer<uint2> clusterLightRanges	: register(t4); // offset, count
+StructuredBuffer<uint> clusterLightIndices	: register(t5);
+
 // HELPER FUNCTIONS
 
 float3 NormalizedDirToLight(float3 lightDir)
@@ -144,6 +154,30 @@ float3 SpotLight(PixelData pixelData, float3 cameraPosition, Light light)
 	return PointLight(pixelData, cameraPosition, light) * penumbra;
 }
 
+// Which cluster a pixel falls in, from its SV_POSITION and view space depth
+uint GetClusterIndex(float2 pixelPosition, float viewDepth, float2 tileScale, float sliceScale, float sliceBias)
+{
+	uint2 tile = min(uint2(pixelPosition * tileScale), uint2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+	uint slice = (uint)clamp(floor(log(max(viewDepth, 0.0001f)) * sliceScale + sliceBias), 0, CLUSTER_SLICES - 1);
+	return (slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x;
+}
+
+float3 AccumulateLight(PixelData pixelData, float3 cameraPosition, Light light)
+{
+	switch (light.type)
+	{
+	case LIGHT_TYPE_POINT:
+		return PointLight(pixelData, cameraPosition, light);
+	case LIGHT_TYPE_DIR:
+		return DirectionLight(pixelData, cameraPosition, light);
+	case LIGHT_TYPE_SPOT:
+		return SpotLight(pixelData, cameraPosition, light);
+	case LIGHT_TYPE_AMBIENT:
+		return AmbientLight(light);
+	}
+	return float3(0, 0, 0);
+}
+
 /*
  * Deprecated Function
  * Use only for testing
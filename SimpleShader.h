@@ -21,6 +21,20 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// A shader variable resolved ahead of time, so setting it
+// skips the name lookup. Only valid for the shader that
+// created it.
+// --------------------------------------------------------
+struct SimpleShaderVariableHandle
+{
+	unsigned int ConstantBufferIndex = (unsigned int)-1;
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;
+
+	bool IsValid() const { return ConstantBufferIndex != (unsigned int)-1; }
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -34,6 +48,18 @@ struct SimpleConstantBuffer
 	ID3D11Buffer* ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+	bool Dirty = true; // Local data changed since the last upload
+};
+
+// --------------------------------------------------------
+// Counts constant buffer uploads, so the effect of
+// splitting buffers by update frequency can be measured
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	unsigned long long UploadedBytes = 0;
+	unsigned int Uploads = 0;
+	unsigned int SkippedUploads = 0; // Copies asked for on buffers that hadn't changed
 };
 
 // --------------------------------------------------------
@@ -67,31 +93,52 @@ public:
 	bool IsShaderValid() { return shaderValid; }
 
 	// Activating the shader and copying data
+	// Copies only upload buffers whose data changed since their last upload
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
 	void CopyBufferData(std::string bufferName);
 
+	// Upload counters for this shader and for all shaders together
+	const SimpleShaderUploadStats& GetUploadStats() { return uploadStats; }
+	void ResetUploadStats() { uploadStats = SimpleShaderUploadStats(); }
+	static const SimpleShaderUploadStats& GetTotalUploadStats() { return totalUploadStats; }
+	static void ResetTotalUploadStats() { totalUploadStats = SimpleShaderUploadStats(); }
+
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(const std::string& name, const void* data, unsigned int size);
+
+	bool SetInt(const std::string& name, int data);
+	bool SetFloat(const std::string& name, float data);
+	bool SetFloat2(const std::string& name, const float data[2]);
+	bool SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(const std::string& name, const float data[3]);
+	bool SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const std::string& name, const float data[4]);
+	bool SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const std::string& name, const float data[16]);
+	bool SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data);
+
+	// Resolves a variable name once, the returned handle is invalid if
+	// the variable doesn't exist. Setting through a handle does no
+	// hashing or allocation.
+	SimpleShaderVariableHandle GetVariableHandle(const std::string& name);
+
+	bool SetData(const SimpleShaderVariableHandle& handle, const void* data, unsigned int size);
+
+	bool SetInt(const SimpleShaderVariableHandle& handle, int data);
+	bool SetFloat(const SimpleShaderVariableHandle& handle, float data);
+	bool SetFloat2(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT4X4& data);
 
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
 	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(const std::string& name);
 	
 	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
@@ -129,8 +176,16 @@ protected:
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
+	// Upload tracking
+	SimpleShaderUploadStats uploadStats;
+	static SimpleShaderUploadStats totalUploadStats;
+
 	// Initialization method
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadShaderBlob(ID3DBlob* compiledShader);
+
+	// Uploads a buffer's local data if it's dirty
+	void UploadBuffer(SimpleConstantBuffer* cb);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
@@ -139,7 +194,7 @@ protected:
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
+	SimpleShaderVariable* FindVariable(const std::string& name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
 };
 
@@ -176,6 +231,7 @@ class SimplePixelShader : public ISimpleShader
 {
 public:
 	SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context, LPCWSTR shaderFile);
+	SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3DBlob* compiledShader);
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
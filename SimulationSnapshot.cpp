@@ -0,0 +1,79 @@
+#include "SimulationSnapshot.h"
+#include <cstring>
+#include <utility>
+
+using namespace DirectX;
+
+void SnapshotBuffer::Publish()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::swap(back, pending);
+	pendingIsNew = true;
+}
+
+bool SnapshotBuffer::Acquire()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!pendingIsNew)
+		return false;
+
+	std::swap(previous, current);
+	std::swap(current, pending);
+	pendingIsNew = false;
+	return true;
+}
+
+float SnapshotBuffer::GetBlend(double renderTime) const
+{
+	if (previous.time < 0 || current.time <= previous.time)
+		return 1.f;
+
+	double blend = (renderTime - previous.time) / (current.time - previous.time);
+	return (float)(blend < 0 ? 0 : (blend > 1 ? 1 : blend));
+}
+
+void SnapshotBuffer::InterpolateMatrices(float blend, std::vector<XMFLOAT4X4>& matrices) const
+{
+	const std::vector<XMFLOAT4X4>& from = previous.worldMatrices;
+	const std::vector<XMFLOAT4X4>& to = current.worldMatrices;
+	matrices.resize(to.size());
+
+	for (size_t i = 0; i < to.size(); i++)
+	{
+		if (blend >= 1.f || i >= from.size() || memcmp(&from[i], &to[i], sizeof(XMFLOAT4X4)) == 0)
+		{
+			matrices[i] = to[i];
+			continue;
+		}
+
+		XMVECTOR fromScale, fromRotation, fromPosition;
+		XMVECTOR toScale, toRotation, toPosition;
+		if (!XMMatrixDecompose(&fromScale, &fromRotation, &fromPosition, XMLoadFloat4x4(&from[i])) ||
+			!XMMatrixDecompose(&toScale, &toRotation, &toPosition, XMLoadFloat4x4(&to[i])))
+		{
+			matrices[i] = to[i];
+			continue;
+		}
+
+		// Same layout the TransformSystem builds, scaled rotation rows and the position last
+		XMVECTOR scale = XMVectorLerp(fromScale, toScale, blend);
+		XMMATRIX world = XMMatrixRotationQuaternion(XMQuaternionSlerp(fromRotation, toRotation, blend));
+		world.r[0] = XMVectorScale(world.r[0], XMVectorGetX(scale));
+		world.r[1] = XMVectorScale(world.r[1], XMVectorGetY(scale));
+		world.r[2] = XMVectorScale(world.r[2], XMVectorGetZ(scale));
+		world.r[3] = XMVectorSetW(XMVectorLerp(fromPosition, toPosition, blend), 1);
+		XMStoreFloat4x4(&matrices[i], world);
+	}
+}
+
+void SnapshotBuffer::InterpolateLights(float blend, std::vector<Light>& lights) const
+{
+	lights = current.lights;
+	if (blend >= 1.f || previous.lights.size() != lights.size())
+		return;
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		XMStoreFloat3(&lights[i].position, XMVectorLerp(XMLoadFloat3(&previous.lights[i].position), XMLoadFloat3(&lights[i].position), blend));
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "Lights.h"
+#include "PostProcessData.h"
+
+// --------------------------------------------------------
+// Everything the renderer needs from one simulation tick
+// --------------------------------------------------------
+struct SimulationSnapshot
+{
+	double time = -1;	// Negative until a tick is written
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;	// Indexed by transform slot
+	std::vector<Light> lights;
+	VignetteData vignette = {};
+	std::vector<uint8_t> agentStates;	// AI_State of every ghost
+};
+
+// --------------------------------------------------------
+// Hands snapshots from the simulation to the renderer
+//
+// - The simulation fills in its back snapshot and publishes
+//   it, which swaps it with the pending one. Only the swap
+//   is locked, so neither side waits on the other's work.
+// - The renderer picks up the pending snapshot when there's
+//   a new one, and keeps the one before it so it can blend
+//   the two. Ticks published in between are skipped.
+// - Swapping instead of copying keeps every vector's
+//   memory around for reuse
+// --------------------------------------------------------
+class SnapshotBuffer
+{
+public:
+	// Simulation side
+	inline SimulationSnapshot& GetBack() { return back; }
+	void Publish();
+
+	// Renderer side, returns whether there was a new snapshot
+	bool Acquire();
+
+	// How far renderTime is from the previous snapshot to the current one, 0 to 1
+	float GetBlend(double renderTime) const;
+
+	// Moving slots get their scale and position lerped and rotation slerped,
+	// slots that didn't move or are new since the previous snapshot are copied
+	void InterpolateMatrices(float blend, std::vector<DirectX::XMFLOAT4X4>& matrices) const;
+
+	// The current lights with their positions blended
+	void InterpolateLights(float blend, std::vector<Light>& lights) const;
+
+	inline const SimulationSnapshot& GetCurrent() const { return current; }
+	inline const SimulationSnapshot& GetPrevious() const { return previous; }
+
+private:
+	SimulationSnapshot back;		// Being written by the simulation
+	SimulationSnapshot pending;		// Published and not picked up yet
+	bool pendingIsNew = false;
+	std::mutex mutex;
+
+	SimulationSnapshot previous;	// The renderer's pair
+	SimulationSnapshot current;
+};
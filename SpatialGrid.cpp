@@ -0,0 +1,147 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Anything covering more cells than this goes in the oversized list, pick
+// a cell size around the typical radius so only outliers end up there
+#define SPATIAL_GRID_MAX_ITEM_CELLS 512
+
+SpatialGrid::SpatialGrid(float cellSize, uint32_t minBucketCount)
+{
+	this->cellSize = cellSize;
+	this->minBucketCount = minBucketCount;
+	inverseCellSize = 1.f / cellSize;
+
+	bucketStarts.resize(2, 0);
+}
+
+void SpatialGrid::Clear()
+{
+	entries.clear();
+	oversized.clear();
+	stats = SpatialGridStats();
+}
+
+void SpatialGrid::Insert(uint32_t id, const XMFLOAT3& center, float radius)
+{
+	stats.items++;
+
+	// Checked before the cell math so huge radii can't overflow the coordinates
+	if (!(radius * inverseCellSize < SPATIAL_GRID_MAX_ITEM_CELLS))
+	{
+		oversized.push_back(id);
+		stats.oversizedItems++;
+		return;
+	}
+
+	int minX = CellCoordinate(center.x - radius);
+	int minY = CellCoordinate(center.y - radius);
+	int minZ = CellCoordinate(center.z - radius);
+	int maxX = CellCoordinate(center.x + radius);
+	int maxY = CellCoordinate(center.y + radius);
+	int maxZ = CellCoordinate(center.z + radius);
+
+	int64_t cells = (int64_t)(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+	if (cells > SPATIAL_GRID_MAX_ITEM_CELLS)
+	{
+		oversized.push_back(id);
+		stats.oversizedItems++;
+		return;
+	}
+
+	for (int z = minZ; z <= maxZ; z++)
+	{
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				Entry entry;
+				entry.x = x;
+				entry.y = y;
+				entry.z = z;
+				entry.id = id;
+				entries.push_back(entry);
+			}
+		}
+	}
+}
+
+void SpatialGrid::Build()
+{
+	stats.cellEntries = (unsigned int)entries.size();
+
+	// Twice as many buckets as entries keeps collisions rare, rounded
+	// up to a power of two so the hash can be masked
+	uint32_t buckets = 1;
+	while (buckets < minBucketCount || buckets < entries.size() * 2)
+	{
+		buckets <<= 1;
+	}
+	bucketMask = buckets - 1;
+
+	// Counting sort by bucket
+	bucketHashes.resize(entries.size());
+	bucketStarts.assign(buckets + 1, 0);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		bucketHashes[i] = HashCell(entries[i].x, entries[i].y, entries[i].z);
+		bucketStarts[bucketHashes[i] + 1]++;
+	}
+	for (size_t b = 1; b < bucketStarts.size(); b++)
+	{
+		bucketStarts[b] += bucketStarts[b - 1];
+	}
+
+	bucketIds.resize(entries.size());
+	std::vector<uint32_t> next(bucketStarts.begin(), bucketStarts.end() - 1);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		bucketIds[next[bucketHashes[i]]++] = entries[i].id;
+	}
+
+	std::sort(oversized.begin(), oversized.end());
+}
+
+void SpatialGrid::Query(const XMFLOAT3& center, float radius, std::vector<uint32_t>& results)
+{
+	results.assign(oversized.begin(), oversized.end());
+
+	int minX = CellCoordinate(center.x - radius);
+	int minY = CellCoordinate(center.y - radius);
+	int minZ = CellCoordinate(center.z - radius);
+	int maxX = CellCoordinate(center.x + radius);
+	int maxY = CellCoordinate(center.y + radius);
+	int maxZ = CellCoordinate(center.z + radius);
+
+	for (int z = minZ; z <= maxZ; z++)
+	{
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				uint32_t bucket = HashCell(x, y, z);
+				results.insert(results.end(), bucketIds.begin() + bucketStarts[bucket], bucketIds.begin() + bucketStarts[bucket + 1]);
+			}
+		}
+	}
+
+	// Items spanning several cells, and cells sharing a bucket, show up more than once
+	std::sort(results.begin(), results.end());
+	results.erase(std::unique(results.begin(), results.end()), results.end());
+
+	stats.queries++;
+	stats.candidates += (unsigned int)results.size();
+}
+
+int SpatialGrid::CellCoordinate(float position) const
+{
+	return (int)std::floor(position * inverseCellSize);
+}
+
+uint32_t SpatialGrid::HashCell(int x, int y, int z) const
+{
+	// Large primes, the usual spatial hash
+	return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u) & bucketMask;
+}
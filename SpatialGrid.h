@@ -0,0 +1,74 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Counts from the last SpatialGrid::Build() and the
+// queries since then
+// --------------------------------------------------------
+struct SpatialGridStats
+{
+	unsigned int items = 0;
+	unsigned int cellEntries = 0;		// Items are in every cell their bounds touch
+	unsigned int oversizedItems = 0;	// Too big to bin, returned by every query
+	unsigned int queries = 0;
+	unsigned int candidates = 0;		// Ids handed back by the queries
+};
+
+// --------------------------------------------------------
+// Spatial hash over a uniform grid, for radius queries
+// against lights, agents or anything else with an id
+//
+// - Insert() everything, then Build() once per frame. The
+//   build is a counting sort into a bucket table sized to
+//   the entries, so it's linear in the number of entries
+// - Cells are hashed into the buckets, so the grid has no
+//   bounds but unrelated cells can share a bucket. Queries
+//   return candidates, callers still do the exact test.
+// - Query results are sorted by id with no duplicates, so
+//   "first match" scans behave like a loop over the ids
+// --------------------------------------------------------
+class SpatialGrid
+{
+public:
+	SpatialGrid(float cellSize = 4.f, uint32_t minBucketCount = 256);
+
+	void Clear();
+
+	// Points are just a zero radius
+	void Insert(uint32_t id, const DirectX::XMFLOAT3& center, float radius);
+	void Build();
+
+	// Ids of everything whose cells touch the sphere, replaces the contents of results
+	void Query(const DirectX::XMFLOAT3& center, float radius, std::vector<uint32_t>& results);
+
+	inline float GetCellSize() const { return cellSize; }
+	inline const SpatialGridStats& GetStats() const { return stats; }
+
+private:
+	struct Entry
+	{
+		int x, y, z;
+		uint32_t id;
+	};
+
+	int CellCoordinate(float position) const;
+	uint32_t HashCell(int x, int y, int z) const;
+
+	float cellSize;
+	float inverseCellSize;
+	uint32_t minBucketCount;
+	uint32_t bucketMask = 0;
+
+	std::vector<Entry> entries;
+	std::vector<uint32_t> oversized;
+
+	// Bucket b holds bucketIds[bucketStarts[b]] up to bucketIds[bucketStarts[b + 1]]
+	std::vector<uint32_t> bucketStarts;
+	std::vector<uint32_t> bucketIds;
+	std::vector<uint32_t> bucketHashes;	// Scratch for Build(), one per entry
+
+	SpatialGridStats stats;
+};
@@ -0,0 +1,140 @@
+// --------------------------------------------------------
+// Ticks 10k and 100k patrolling agents in the AISystem and
+// in a stand in for the old SimpleAI, one heap object and
+// virtual call per ghost
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o aibench Tests/AISystemBench.cpp AISystem.cpp PathScheduler.cpp NavMesh.cpp NavMeshQuery.cpp SpatialGrid.cpp MappedFile.cpp Transform.cpp TransformSystem.cpp JobSystem.cpp -lpthread
+//  ./aibench
+// --------------------------------------------------------
+#include "AISystem.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// What SimpleAI did per ghost, minus the transform and material it poked
+	class Ghost
+	{
+	public:
+		Ghost(const std::vector<XMFLOAT3>* route, XMFLOAT3 position) : route(route), position(position) {}
+		virtual ~Ghost() = default;
+
+		virtual void Update(const XMFLOAT3& player, bool inLight, float deltaTime)
+		{
+			float range = inLight ? 9.f * 9.f : 6.f * 6.f;
+			state = DistanceSquared(player) < range ? AI_State::ATTACK_PLAYER : AI_State::PATROL_PATH;
+
+			if (state == AI_State::ATTACK_PLAYER)
+			{
+				MoveTowards(player, deltaTime);
+			}
+			else if (DistanceSquared((*route)[activeRoute]) > 1.001f)
+			{
+				MoveTowards((*route)[activeRoute], deltaTime);
+			}
+			else
+			{
+				activeRoute = activeRoute + 1 < route->size() ? activeRoute + 1 : 0;
+			}
+		}
+
+	private:
+		float DistanceSquared(const XMFLOAT3& target) const
+		{
+			float distance;
+			XMStoreFloat(&distance, XMVector3LengthSq(XMLoadFloat3(&target) - XMLoadFloat3(&position)));
+			return distance;
+		}
+
+		void MoveTowards(const XMFLOAT3& target, float deltaTime)
+		{
+			XMFLOAT3 step;
+			XMStoreFloat3(&step, XMVector3Normalize(XMLoadFloat3(&target) - XMLoadFloat3(&position)) * deltaTime * 3.f);
+			position.x += step.x;
+			position.z += step.z;
+		}
+
+		const std::vector<XMFLOAT3>* route;
+		XMFLOAT3 position;
+		size_t activeRoute = 0;
+		AI_State state = AI_State::PATROL_PATH;
+	};
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	JobSystem::Get().Start(JobSystem::GetDefaultWorkerCount());
+
+	// Eight five point routes spread over the maze's footprint
+	std::mt19937 random(15);
+	std::uniform_real_distribution<float> x(-20.f, 20.f);
+	std::uniform_real_distribution<float> z(-40.f, 0.f);
+	std::vector<std::vector<XMFLOAT3>> routes(8);
+	for (std::vector<XMFLOAT3>& route : routes)
+	{
+		for (int point = 0; point < 5; point++)
+			route.push_back(XMFLOAT3(x(random), 1.5f, z(random)));
+	}
+
+	const int frames = 100;
+	printf("%u workers\n", JobSystem::Get().GetWorkerCount());
+	printf("%8s %10s %10s %10s %10s %12s %10s\n", "agents", "system ms", "tick ms", "grid ms", "ticked", "ns per tick", "ghosts ms");
+	for (uint32_t agentCount : { 10000u, 100000u })
+	{
+		AISystem system;
+		for (std::vector<XMFLOAT3>& route : routes)
+			system.AddRoute(route.data(), (uint32_t)route.size());
+
+		std::vector<std::unique_ptr<Ghost>> ghosts;
+		for (uint32_t i = 0; i < agentCount; i++)
+		{
+			XMFLOAT3 position(x(random), .5f, z(random));
+			system.AddAgent(nullptr, i % routes.size(), position);
+			ghosts.emplace_back(new Ghost(&routes[i % routes.size()], position));
+		}
+
+		double systemSeconds = 0;
+		double tickSeconds = 0;
+		double gridSeconds = 0;
+		double ghostSeconds = 0;
+		uint64_t ticked = 0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			// The player circles through the middle of the crowd
+			XMFLOAT3 player(sinf(frame * .1f) * 15, 2.1f, -20 + cosf(frame * .1f) * 15);
+
+			Clock::time_point start = Clock::now();
+			system.Update(player, false, 1 / 60.f);
+			systemSeconds += Seconds(start);
+			ticked += system.GetStats().agentsTicked;
+			tickSeconds += system.GetStats().tickSeconds;
+			gridSeconds += system.GetStats().indexSeconds;
+
+			start = Clock::now();
+			for (std::unique_ptr<Ghost>& ghost : ghosts)
+				ghost->Update(player, false, 1 / 60.f);
+			ghostSeconds += Seconds(start);
+		}
+
+		// Far groups tick less often, so also compare per agent tick
+		printf("%8u %10.3f %10.3f %10.3f %10.0f %12.1f %10.3f\n", agentCount, systemSeconds * 1000 / frames, tickSeconds * 1000 / frames,
+			gridSeconds * 1000 / frames, (double)ticked / frames, tickSeconds * 1e9 / (std::max)(ticked, (uint64_t)1), ghostSeconds * 1000 / frames);
+	}
+
+	JobSystem::Get().Stop();
+	return 0;
+}
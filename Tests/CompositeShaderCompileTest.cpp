@@ -0,0 +1,81 @@
+// --------------------------------------------------------
+// Compiles all 16 permutations of the composite shader with
+// the same D3DCompile call the game makes, and checks each
+// one's constant buffer against CompositeData. Needs the D3D
+// compiler, so this one only builds on Windows, from a Visual
+// Studio developer command prompt:
+//
+//  cl /O2 /EHsc /I. Tests\CompositeShaderCompileTest.cpp CompositeShader.cpp d3dcompiler.lib dxguid.lib
+//  CompositeShaderCompileTest.exe
+//
+// No device is created, so it runs without a GPU.
+// --------------------------------------------------------
+#include "CompositeShader.h"
+#include "TestCheck.h"
+#include <d3dcompiler.h>
+#include <d3d11shader.h>
+#include <cstddef>
+
+#pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "dxguid.lib")
+
+namespace
+{
+	// Where a member of the compositeData struct starts in the buffer, or -1
+	int GetMemberOffset(ID3D11ShaderReflectionType* type, const char* name)
+	{
+		D3D11_SHADER_TYPE_DESC desc;
+		ID3D11ShaderReflectionType* member = type->GetMemberTypeByName(name);
+		if (!member || FAILED(member->GetDesc(&desc)))
+			return -1;
+		return (int)desc.Offset;
+	}
+}
+
+int main()
+{
+	for (uint32_t features = 0; features < COMPOSITE_PERMUTATION_COUNT; features++)
+	{
+		std::string source = GenerateCompositeShader(features);
+
+		ID3DBlob* compiledShader = 0;
+		ID3DBlob* errors = 0;
+		HRESULT hr = D3DCompile(source.c_str(), source.size(), "CompositePS", 0, 0, "main", "ps_5_0",
+			D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &compiledShader, &errors);
+		if (errors)
+		{
+			printf("%s:\n%s\n", GetCompositeFeatureNames(features).c_str(), (const char*)errors->GetBufferPointer());
+			errors->Release();
+		}
+		CHECK(SUCCEEDED(hr));
+		if (FAILED(hr))
+			continue;
+
+		ID3D11ShaderReflection* reflection = 0;
+		hr = D3DReflect(compiledShader->GetBufferPointer(), compiledShader->GetBufferSize(), IID_ID3D11ShaderReflection, (void**)&reflection);
+		CHECK(SUCCEEDED(hr));
+
+		// With nothing on the buffer isn't read, so the compiler drops it
+		D3D11_SHADER_VARIABLE_DESC variableDesc;
+		ID3D11ShaderReflectionVariable* variable = SUCCEEDED(hr) ? reflection->GetVariableByName("compositeData") : 0;
+		if (variable && SUCCEEDED(variable->GetDesc(&variableDesc)))
+		{
+			ID3D11ShaderReflectionType* type = variable->GetType();
+			CHECK(variableDesc.Size == sizeof(CompositeData));
+			CHECK(GetMemberOffset(type, "contrast") == (int)offsetof(CompositeData, contrast));
+			CHECK(GetMemberOffset(type, "inverseGamma") == (int)offsetof(CompositeData, inverseGamma));
+			CHECK(GetMemberOffset(type, "colorFilter") == (int)offsetof(CompositeData, colorFilter));
+			CHECK(GetMemberOffset(type, "pixelSize") == (int)offsetof(CompositeData, pixelSize));
+		}
+		else
+			CHECK(features == 0);
+
+		printf("%2u %-50s %6zu bytes of bytecode\n", features, GetCompositeFeatureNames(features).c_str(), compiledShader->GetBufferSize());
+
+		if (reflection)
+			reflection->Release();
+		compiledShader->Release();
+	}
+
+	return TestResult("CompositeShaderCompileTest");
+}
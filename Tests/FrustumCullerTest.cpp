@@ -0,0 +1,119 @@
+// --------------------------------------------------------
+// Headless test scene for the frustum culler: a field of
+// boxes around a camera, checked against clip space so
+// nothing on screen is ever dropped
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o culltest Tests/FrustumCullerTest.cpp FrustumCuller.cpp Camera.cpp Transform.cpp TransformSystem.cpp JobSystem.cpp -lpthread
+//  ./culltest
+// --------------------------------------------------------
+#include "FrustumCuller.h"
+#include "Camera.h"
+#include "TestCheck.h"
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Stand in for an entity, only what the culler reads
+	struct SceneObject
+	{
+		BoundingBox box;
+		BoundingSphere sphere;
+
+		const BoundingBox& GetWorldBoundingBox() const { return box; }
+		const BoundingSphere& GetWorldBoundingSphere() const { return sphere; }
+	};
+
+	// True when any sampled point of the box is inside clip space
+	bool AnyPointOnScreen(const BoundingBox& box, FXMMATRIX viewProj, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.f, 1.f);
+		for (int sample = 0; sample < 200; sample++)
+		{
+			XMVECTOR point = XMVectorSet(
+				box.Center.x + unit(random) * box.Extents.x,
+				box.Center.y + unit(random) * box.Extents.y,
+				box.Center.z + unit(random) * box.Extents.z, 1);
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector4Transform(point, viewProj));
+			// A hair inside the far plane, where float error can't decide it
+			if (clip.w > 0 && fabsf(clip.x) <= clip.w && fabsf(clip.y) <= clip.w && clip.z >= 0 && clip.z <= clip.w * .9999f)
+				return true;
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	// Boxes of different sizes scattered all around the camera, like the maze's walls and waypoints
+	std::mt19937 random(10);
+	std::uniform_real_distribution<float> position(-120.f, 120.f);
+	std::uniform_real_distribution<float> size(.1f, 5.f);
+	std::vector<SceneObject> scene(20000);
+	for (SceneObject& object : scene)
+	{
+		object.box = BoundingBox(XMFLOAT3(position(random), position(random) * .1f, position(random)), XMFLOAT3(size(random), size(random), size(random)));
+		BoundingSphere::CreateFromBoundingBox(object.sphere, object.box);
+	}
+
+	Camera camera(XMFLOAT3(1, 2, 3), XMFLOAT3(0, .3f, 0), 16.f / 9);
+
+	// The view follows the published matrices, hand them over like a tick does
+	std::vector<XMFLOAT4X4> published;
+	TransformSystem::Get().UpdateWorldMatrices();
+	TransformSystem::Get().CopyWorldMatrices(published);
+	TransformSystem::Get().SwapRenderMatrices(published);
+	camera.UpdateViewMatrix();
+	XMFLOAT4X4 view = camera.GetViewMatrix();
+	XMFLOAT4X4 proj = camera.GetProjectionMatrix();
+	XMMATRIX viewProj = XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj);
+
+	FrustumCuller culler;
+	culler.Update(view, proj);
+
+	unsigned int visible = 0;
+	unsigned int wronglyCulled = 0;
+	unsigned int behindCamera = 0;
+	unsigned int behindCulled = 0;
+	// The view matrix is a rotation and a translation, so the camera's axes are its columns
+	XMVECTOR forward = XMVectorSet(view._13, view._23, view._33, 0);
+	XMVECTOR cameraPosition = XMVectorSet(
+		-(view._41 * view._11 + view._42 * view._12 + view._43 * view._13),
+		-(view._41 * view._21 + view._42 * view._22 + view._43 * view._23),
+		-(view._41 * view._31 + view._42 * view._32 + view._43 * view._33), 0);
+	for (SceneObject& object : scene)
+	{
+		bool isVisible = culler.IsVisible(&object);
+		visible += isVisible ? 1 : 0;
+
+		if (!isVisible && AnyPointOnScreen(object.box, viewProj, random))
+			wronglyCulled++;
+
+		// Anything entirely behind the camera has to go
+		XMVECTOR toCenter = XMLoadFloat3(&object.sphere.Center) - cameraPosition;
+		if (XMVectorGetX(XMVector3Dot(toCenter, forward)) < -object.sphere.Radius)
+		{
+			behindCamera++;
+			behindCulled += isVisible ? 0 : 1;
+		}
+	}
+
+	const FrustumCullStats& stats = culler.GetStats();
+	printf("tested %u, culled %u, drew %u\n", stats.tested, stats.culled, visible);
+	CHECK(stats.tested == scene.size());
+	CHECK(stats.culled + visible == scene.size());
+	CHECK(stats.culled > scene.size() / 2);
+	CHECK(wronglyCulled == 0);
+	CHECK(behindCamera > 0);
+	CHECK(behindCulled == behindCamera);
+
+	// A new frame starts the counts over
+	culler.Update(view, proj);
+	CHECK(culler.GetStats().tested == 0);
+	CHECK(culler.GetStats().culled == 0);
+
+	return TestResult("FrustumCullerTest");
+}
@@ -0,0 +1,105 @@
+// --------------------------------------------------------
+// Scaling of the work Game::Update fans out on the job
+// system, light binning and the transform sweep, from the
+// single thread mode up to 8 workers
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o jobbench Tests/JobSystemBench.cpp JobSystem.cpp LightClusters.cpp Transform.cpp TransformSystem.cpp -lpthread
+//  ./jobbench
+// --------------------------------------------------------
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "Transform.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	JobSystem& jobs = JobSystem::Get();
+	const int repeats = 20;
+
+	// 500 lights in front of the camera
+	std::mt19937 random(14);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	std::vector<Light> lights(500);
+	for (Light& light : lights)
+	{
+		light = Light();
+		light.type = LIGHT_TYPE_POINT;
+		light.position = XMFLOAT3(unit(random) * 30, unit(random) * 5, 30 + unit(random) * 30);
+		light.range = 2 + (unit(random) + 1) * 2;
+	}
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&view, XMMatrixIdentity());
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9, .1f, 100.f));
+
+	// 100k transforms, all but the first thousand parented to one of those
+	const int transformCount = 100000;
+	std::unique_ptr<Transform[]> transforms(new Transform[transformCount]);
+	for (int i = 1000; i < transformCount; i++)
+	{
+		transforms[i].SetParent(&transforms[i % 1000]);
+	}
+
+	printf("%d cores, %u workers by default\n", (int)std::thread::hardware_concurrency(), JobSystem::GetDefaultWorkerCount());
+	printf("%8s %12s %12s %10s %10s\n", "workers", "clusters ms", "sweep ms", "jobs run", "stolen");
+
+	double singleClusters = 0;
+	double singleSweep = 0;
+	for (unsigned int workers : { 0u, 1u, 2u, 4u, 8u })
+	{
+		jobs.Start(workers);
+		jobs.ResetStats();
+
+		LightClusters clusters;
+		Clock::time_point start = Clock::now();
+		for (int repeat = 0; repeat < repeats; repeat++)
+		{
+			clusters.Build(lights.data(), (int)lights.size(), view, proj);
+		}
+		double clusterSeconds = Seconds(start) / repeats;
+
+		// Moving the parents dirties every transform
+		double sweepSeconds = 0;
+		for (int repeat = 0; repeat < repeats; repeat++)
+		{
+			for (int i = 0; i < 1000; i++)
+			{
+				transforms[i].MoveAbsolute(.001f, 0, 0);
+			}
+			start = Clock::now();
+			TransformSystem::Get().UpdateWorldMatrices();
+			sweepSeconds += Seconds(start);
+		}
+		sweepSeconds /= repeats;
+
+		JobSystemStats stats = jobs.GetStats();
+		jobs.Stop();
+
+		if (workers == 0)
+		{
+			singleClusters = clusterSeconds;
+			singleSweep = sweepSeconds;
+		}
+		printf("%8u %7.3f %3.1fx %7.3f %3.1fx %10u %10u\n", workers,
+			clusterSeconds * 1000, singleClusters / clusterSeconds,
+			sweepSeconds * 1000, singleSweep / sweepSeconds,
+			stats.jobsRun, stats.jobsStolen);
+	}
+	return 0;
+}
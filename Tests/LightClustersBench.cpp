@@ -0,0 +1,73 @@
+// --------------------------------------------------------
+// Times LightClusters::Build for a few light counts, single
+// threaded and on the job system
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o clusterbench Tests/LightClustersBench.cpp LightClusters.cpp JobSystem.cpp -lpthread
+//  ./clusterbench
+// --------------------------------------------------------
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Best of a few builds so a cold first pass doesn't count
+	double TimeBuild(LightClusters& clusters, const std::vector<Light>& lights, const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+	{
+		double best = 1e9;
+		for (int repeat = 0; repeat < 20; repeat++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			clusters.Build(lights.data(), (int)lights.size(), view, proj);
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			best = (std::min)(best, seconds);
+		}
+		return best;
+	}
+}
+
+int main()
+{
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 2, -5, 0), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9, .01f, 100.f));
+
+	const int lightCounts[] = { 12, 128, 1024 };
+	std::vector<unsigned int> workerCounts = { 0, 2, 4 };
+	if (JobSystem::GetDefaultWorkerCount() > 4)
+		workerCounts.push_back(JobSystem::GetDefaultWorkerCount());
+
+	printf("%8s %8s %10s %14s %12s\n", "lights", "workers", "build ms", "pairs/cluster", "max/cluster");
+	for (int lightCount : lightCounts)
+	{
+		std::mt19937 random(lightCount);
+		std::uniform_real_distribution<float> unit(-1.f, 1.f);
+		std::vector<Light> lights(lightCount);
+		for (Light& light : lights)
+		{
+			light = Light();
+			light.type = LIGHT_TYPE_POINT;
+			light.position = XMFLOAT3(unit(random) * 40, unit(random) * 5, 45 + unit(random) * 45);
+			light.range = 2 + (unit(random) + 1) * 3;
+		}
+
+		for (unsigned int workers : workerCounts)
+		{
+			JobSystem::Get().Start(workers);
+			LightClusters clusters;
+			double seconds = TimeBuild(clusters, lights, view, proj);
+			JobSystem::Get().Stop();
+
+			const LightClusterStats& stats = clusters.GetStats();
+			printf("%8d %8u %10.3f %14.2f %12u\n", lightCount, workers, seconds * 1000,
+				(double)stats.lightClusterPairs / CLUSTER_COUNT, stats.maxLightsInCluster);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,120 @@
+// --------------------------------------------------------
+// Checks the CPU light binning: every point inside a light's
+// range lands in a cluster that lists the light, and the
+// lists don't depend on how many threads built them
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o clustertest Tests/LightClustersTest.cpp LightClusters.cpp JobSystem.cpp -lpthread
+//  ./clustertest
+// --------------------------------------------------------
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Screen the shaders see, only used to turn positions into tiles
+	const float screenWidth = 1280;
+	const float screenHeight = 720;
+
+	// Finds a view space point's cluster the way ShaderIncludes.hlsli does, or -1 if it's off screen
+	int FindCluster(const LightClusters& clusters, const XMFLOAT4X4& proj, XMFLOAT3 viewPosition)
+	{
+		if (viewPosition.z < 0.01f || viewPosition.z > 100.f)
+			return -1;
+
+		float ndcX = viewPosition.x * proj._11 / viewPosition.z;
+		float ndcY = viewPosition.y * proj._22 / viewPosition.z;
+		if (fabsf(ndcX) >= 1 || fabsf(ndcY) >= 1)
+			return -1;
+
+		float pixelX = (ndcX + 1) * .5f * screenWidth;
+		float pixelY = (1 - ndcY) * .5f * screenHeight;
+		int tileX = (int)(pixelX * CLUSTER_TILES_X / screenWidth);
+		int tileY = (int)(pixelY * CLUSTER_TILES_Y / screenHeight);
+
+		int slice = (int)floorf(logf(viewPosition.z) * clusters.GetSliceScale() + clusters.GetSliceBias());
+		slice = (std::min)((std::max)(slice, 0), CLUSTER_SLICES - 1);
+		return clusters.GetClusterIndex(tileX, tileY, slice);
+	}
+}
+
+int main()
+{
+	// Scattered point and spot lights in front of the camera, every tenth one ambient
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	std::vector<Light> lights(120);
+	unsigned int globalLights = 0;
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		lights[i] = Light();
+		lights[i].type = i % 10 == 0 ? LIGHT_TYPE_AMBIENT : (i % 3 ? LIGHT_TYPE_POINT : LIGHT_TYPE_SPOT);
+		lights[i].position = XMFLOAT3(unit(random) * 30, unit(random) * 5, unit(random) * 40);
+		lights[i].range = 1 + (unit(random) + 1) * 4;
+		globalLights += lights[i].type == LIGHT_TYPE_AMBIENT ? 1 : 0;
+	}
+
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(-5, 2, 5, 0), XMVectorSet(.3f, -.1f, -1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9, .01f, 100.f));
+
+	LightClusters clusters;
+	clusters.Build(lights.data(), (int)lights.size(), view, proj);
+	const LightClusterStats& stats = clusters.GetStats();
+
+	CHECK(stats.globalLights == globalLights);
+	CHECK(stats.droppedPairs == 0);
+	CHECK(clusters.GetClusterRanges().size() == CLUSTER_COUNT);
+	for (const ClusterLightRange& range : clusters.GetClusterRanges())
+	{
+		CHECK(range.offset + range.count <= clusters.GetLightIndices().size());
+	}
+
+	// Points well inside each light's sphere have to find it in their cluster
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+	int samples = 0;
+	int misses = 0;
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].type == LIGHT_TYPE_AMBIENT)
+			continue;
+
+		for (int sample = 0; sample < 400; sample++)
+		{
+			float reach = lights[i].range * .57f;
+			XMFLOAT3 point(lights[i].position.x + unit(random) * reach, lights[i].position.y + unit(random) * reach, lights[i].position.z + unit(random) * reach);
+			XMFLOAT3 viewPoint;
+			XMStoreFloat3(&viewPoint, XMVector3TransformCoord(XMLoadFloat3(&point), viewMatrix));
+
+			int cluster = FindCluster(clusters, proj, viewPoint);
+			if (cluster < 0)
+				continue;
+
+			const ClusterLightRange& range = clusters.GetClusterRanges()[cluster];
+			const unsigned int* first = clusters.GetLightIndices().data() + range.offset;
+			samples++;
+			misses += std::find(first, first + range.count, (unsigned int)i) == first + range.count ? 1 : 0;
+		}
+	}
+	printf("%d samples inside lights, %d missing from their cluster\n", samples, misses);
+	CHECK(samples > 0);
+	CHECK(misses == 0);
+
+	// The same lists come out of a threaded build
+	JobSystem::Get().Start(4);
+	LightClusters threaded;
+	threaded.Build(lights.data(), (int)lights.size(), view, proj);
+	JobSystem::Get().Stop();
+	CHECK(threaded.GetLightIndices() == clusters.GetLightIndices());
+
+	printf("%u lights in %u cluster entries, %.2f per cluster on average instead of %zu\n", stats.binnedLights, stats.lightClusterPairs,
+		(double)stats.lightClusterPairs / CLUSTER_COUNT, lights.size());
+	return TestResult("LightClustersTest");
+}
@@ -0,0 +1,161 @@
+// --------------------------------------------------------
+// Builds the nav mesh from the level in Level.scene and
+// reports path throughput, for single A* searches and for
+// a crowd going through the budgeted PathScheduler
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o navbench Tests/NavMeshBench.cpp NavMesh.cpp NavMeshQuery.cpp PathScheduler.cpp SceneFile.cpp MeshCache.cpp ObjLoader.cpp MappedFile.cpp
+//  ./navbench [--scene Assets/Scenes/Level.scene] [--budget microseconds]
+// --------------------------------------------------------
+#include "NavMesh.h"
+#include "NavMeshQuery.h"
+#include "PathScheduler.h"
+#include "SceneFile.h"
+#include "ObjLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// The same world matrix a Transform builds from the scene's values
+	XMMATRIX WorldMatrix(const SceneTransform& transform)
+	{
+		return XMMatrixScaling(transform.scale.x, transform.scale.y, transform.scale.z) *
+			XMMatrixRotationRollPitchYaw(transform.rotation.x, transform.rotation.y, transform.rotation.z) *
+			XMMatrixTranslation(transform.position.x, transform.position.y, transform.position.z);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* sceneFile = "Assets/Scenes/Level.scene";
+	double budgetMicroseconds = 500;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+			sceneFile = argv[++i];
+		else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+			budgetMicroseconds = atof(argv[++i]);
+	}
+
+	SceneData scene;
+	std::string error;
+	if (!ParseScene(sceneFile, scene, &error))
+	{
+		printf("Couldn't read the scene %s\n", error.c_str());
+		return 1;
+	}
+
+	// World space triangles of the rooms and props, like GameSimulation::BuildNavMesh()
+	std::vector<XMFLOAT3> triangles;
+	for (const SceneEntity& entity : scene.entities)
+	{
+		if (entity.group != SceneGroup::Level)
+			continue;
+
+		MeshData mesh;
+		std::string path = scene.GetPath(scene.meshes[entity.mesh].path);
+		if (!LoadObj(path.c_str(), mesh))
+		{
+			printf("Couldn't load %s\n", path.c_str());
+			continue;
+		}
+
+		XMMATRIX world = WorldMatrix(entity.transform);
+		for (unsigned int index : mesh.indices)
+		{
+			XMFLOAT3 corner;
+			XMStoreFloat3(&corner, XMVector3TransformCoord(XMLoadFloat3(&mesh.vertices[index].Position), world));
+			triangles.push_back(corner);
+		}
+	}
+
+	NavMesh navMesh;
+	Clock::time_point start = Clock::now();
+	navMesh.Build(triangles.data(), triangles.size() / 3, NavMeshSettings());
+	printf("Built a %dx%d nav mesh, %d walkable cells, from %zu triangles in %.2f ms\n",
+		navMesh.GetWidth(), navMesh.GetDepth(), navMesh.GetWalkableCellCount(), triangles.size() / 3, Seconds(start) * 1000);
+
+	std::vector<int> walkableCells;
+	for (int cell = 0; cell < navMesh.GetCellCount(); cell++)
+	{
+		if (navMesh.IsWalkable(cell))
+			walkableCells.push_back(cell);
+	}
+	if (walkableCells.empty())
+		return 1;
+
+	// Whole searches between random walkable cells
+	{
+		std::mt19937 random(17);
+		std::uniform_int_distribution<size_t> pick(0, walkableCells.size() - 1);
+		NavMeshQuery query(&navMesh);
+		std::vector<XMFLOAT3> corners;
+		const int searchCount = 5000;
+		int found = 0;
+		size_t expansions = 0;
+		start = Clock::now();
+		for (int i = 0; i < searchCount; i++)
+		{
+			if (query.FindPath(walkableCells[pick(random)], walkableCells[pick(random)]) == NavQueryStatus::Found)
+			{
+				query.GetCorners(corners);
+				found++;
+			}
+			expansions += query.GetExpansions();
+		}
+		double seconds = Seconds(start);
+		printf("A*: %.0f paths/s over %d random pairs, %d found, %.0f cells expanded on average\n",
+			searchCount / seconds, searchCount, found, (double)expansions / searchCount);
+	}
+
+	// A crowd of ghosts all asking at once, each between two of the level's waypoints,
+	// served a frame at a time within the budget
+	{
+		std::mt19937 random(18);
+		std::uniform_int_distribution<size_t> pick(0, scene.waypoints.size() - 1);
+		PathScheduler scheduler(&navMesh);
+		const uint32_t ghostCount = scene.waypoints.empty() ? 0 : 2000;
+		for (uint32_t ghost = 0; ghost < ghostCount; ghost++)
+		{
+			scheduler.Request(ghost, scene.waypoints[pick(random)], scene.waypoints[pick(random)]);
+		}
+
+		std::vector<PathResult> results;
+		unsigned int frames = 0;
+		unsigned int completed = 0;
+		unsigned int cacheHits = 0;
+		double worstFrame = 0;
+		double totalSeconds = 0;
+		while (scheduler.GetQueuedCount() > 0)
+		{
+			results.clear();
+			start = Clock::now();
+			scheduler.Process(budgetMicroseconds / 1e6, results);
+			double frameSeconds = Seconds(start);
+
+			worstFrame = (std::max)(worstFrame, frameSeconds);
+			totalSeconds += frameSeconds;
+			completed += scheduler.GetStats().completed + scheduler.GetStats().failed;
+			cacheHits += scheduler.GetStats().cacheHits;
+			frames++;
+		}
+		printf("Scheduler: %u requests over %u frames of %.0f us, %.0f paths/s, %u cache hits, worst frame %.1f us\n",
+			completed, frames, budgetMicroseconds, completed / (std::max)(totalSeconds, 1e-9), cacheHits, worstFrame * 1e6);
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+// --------------------------------------------------------
+// Loads every OBJ file under Assets/Models and reports how
+// fast the loader reads and parses each one
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o objbench Tests/ObjLoaderBench.cpp ObjLoader.cpp MappedFile.cpp
+//  ./objbench [--root <dir>] [--repeat <n>]
+//
+//  --root <dir>     Folder holding Assets/, default "."
+//  --repeat <n>     Loads of each file, the fastest counts, default 10
+// --------------------------------------------------------
+#include "ObjLoader.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	std::string root = ".";
+	int repeat = 10;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "--root")) root = argv[i + 1];
+		else if (!strcmp(argv[i], "--repeat")) repeat = (std::max)(1, atoi(argv[i + 1]));
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::vector<std::string> files;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(root + "/Assets/Models", error))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".obj")
+			files.push_back(entry.path().string());
+	}
+	std::sort(files.begin(), files.end());
+
+	if (files.empty())
+	{
+		printf("No OBJ files under %s/Assets/Models\n", root.c_str());
+		return 2;
+	}
+
+	size_t totalBytes = 0;
+	double totalSeconds = 0;
+	printf("%-48s %10s %8s %8s %9s %8s\n", "file", "bytes", "corners", "verts", "ms", "MB/s");
+
+	for (const std::string& file : files)
+	{
+		ObjLoadStats best;
+		size_t vertexCount = 0;
+		for (int run = 0; run < repeat; run++)
+		{
+			MeshData data;
+			ObjLoadStats stats;
+			if (!LoadObj(file.c_str(), data, &stats))
+			{
+				printf("Couldn't load %s\n", file.c_str());
+				return 1;
+			}
+
+			if (run == 0 || stats.parseSeconds < best.parseSeconds)
+				best = stats;
+			vertexCount = data.vertices.size();
+		}
+
+		printf("%-48s %10zu %8zu %8zu %9.3f %8.1f\n", file.c_str(), best.fileBytes, best.cornerCount, vertexCount,
+			best.parseSeconds * 1000.0, best.MegabytesPerSecond());
+		totalBytes += best.fileBytes;
+		totalSeconds += best.parseSeconds;
+	}
+
+	printf("%zu files, %.2f MB in %.3f ms, %.1f MB/s\n", files.size(), totalBytes / (1024.0 * 1024.0), totalSeconds * 1000.0,
+		totalSeconds > 0 ? totalBytes / (1024.0 * 1024.0) / totalSeconds : 0);
+	return 0;
+}
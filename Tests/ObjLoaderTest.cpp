@@ -0,0 +1,83 @@
+// --------------------------------------------------------
+// Checks the OBJ loader's vertex deduplication and that
+// tangents stay finite around triangles with degenerate uvs
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o objtest Tests/ObjLoaderTest.cpp ObjLoader.cpp MappedFile.cpp
+//  ./objtest
+// --------------------------------------------------------
+#include "ObjLoader.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	bool IsUnitTangent(const Vertex& vertex)
+	{
+		const DirectX::XMFLOAT3& t = vertex.Tangent;
+		const DirectX::XMFLOAT3& n = vertex.Normal;
+		float length = sqrtf(t.x * t.x + t.y * t.y + t.z * t.z);
+		float along = t.x * n.x + t.y * n.y + t.z * n.z;
+		return std::isfinite(length) && fabsf(length - 1.f) < 1e-3f && fabsf(along) < 1e-3f;
+	}
+}
+
+int main()
+{
+	// Two triangles sharing an edge, the second with all its uvs on one line
+	const char* fileName = "ObjLoaderTest.obj";
+	FILE* file = fopen(fileName, "w");
+	fputs(
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 0 1\n"
+		"vn 0 0 1\n"
+		"f 1/1/1 2/2/1 3/3/1\n"
+		"f 2/2/1 4/2/1 3/3/1\n", file);
+	fclose(file);
+
+	MeshData mesh;
+	ObjLoadStats stats;
+	CHECK(LoadObj(fileName, mesh, &stats));
+	remove(fileName);
+
+	// The shared edge's corners are only stored once
+	CHECK(stats.cornerCount == 6);
+	CHECK(mesh.vertices.size() == 4);
+	CHECK(mesh.indices.size() == 6);
+
+	if (!mesh.vertices.empty())
+	{
+		CalculateTangents(&mesh.vertices[0], (int)mesh.vertices.size(), &mesh.indices[0], (int)mesh.indices.size());
+		for (const Vertex& vertex : mesh.vertices)
+		{
+			CHECK(IsUnitTangent(vertex));
+		}
+	}
+
+	// The shipped meshes reuse vertices and have usable tangents everywhere
+	const char* models[] = { "Assets/Models/cube.obj", "Assets/Models/sphere.obj", "Assets/Models/helix.obj" };
+	for (const char* model : models)
+	{
+		MeshData data;
+		ObjLoadStats modelStats;
+		if (!LoadObj(model, data, &modelStats))
+		{
+			printf("%s: couldn't load, run from the repository's root\n", model);
+			CHECK(false);
+			continue;
+		}
+
+		CalculateTangents(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size());
+		size_t badTangents = 0;
+		for (const Vertex& vertex : data.vertices)
+		{
+			badTangents += IsUnitTangent(vertex) ? 0 : 1;
+		}
+
+		printf("%s: %zu corners -> %zu vertices, %zu bad tangents\n", model, modelStats.cornerCount, data.vertices.size(), badTangents);
+		CHECK(data.vertices.size() < modelStats.cornerCount);
+		CHECK(badTangents == 0);
+	}
+
+	return TestResult("ObjLoaderTest");
+}
@@ -0,0 +1,190 @@
+// --------------------------------------------------------
+// Compiles the game's post processing chain for every mix
+// of settings and checks the schedule and the pooling, then
+// the pooling of longer chains and passes that get refused
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o ppgraphtest Tests/PostProcessGraphTest.cpp PostProcessGraph.cpp
+//  ./ppgraphtest
+// --------------------------------------------------------
+#include "PostProcessGraph.h"
+#include "TestCheck.h"
+#include <vector>
+
+namespace
+{
+	// The passes the chain should end up running for these settings, in order
+	std::vector<PostProcessEffect> GetExpectedEffects(const PostProcessSettings& settings)
+	{
+		std::vector<PostProcessEffect> effects = { PostProcessEffect::Scene };
+		if (settings.bloom && settings.tonemap)
+		{
+			effects.push_back(PostProcessEffect::BloomExtract);
+			effects.push_back(PostProcessEffect::BloomBlurX);
+			effects.push_back(PostProcessEffect::BloomBlurY);
+		}
+		if (settings.tonemap)
+			effects.push_back(PostProcessEffect::Tonemap);
+		if (GetCompositeFeatures(settings) != 0)
+			effects.push_back(PostProcessEffect::Composite);
+		if (settings.fxaa)
+			effects.push_back(PostProcessEffect::Fxaa);
+		if (effects.size() == 1 || effects.back() == PostProcessEffect::BloomBlurY)
+			effects.push_back(PostProcessEffect::Copy);
+		return effects;
+	}
+
+	void CheckCompiledGraph(const PostProcessGraph& graph, uint32_t backBuffer)
+	{
+		const std::vector<PostProcessPass>& passes = graph.GetPasses();
+		const std::vector<PostProcessResource>& resources = graph.GetResources();
+		const std::vector<uint32_t>& schedule = graph.GetSchedule();
+
+		// Everything scheduled runs, in order, and nothing else does
+		RecordingPostProcessBackend backend;
+		graph.Execute(backend);
+		CHECK(backend.passes == schedule);
+		for (uint32_t pass = 0; pass < (uint32_t)passes.size(); pass++)
+		{
+			bool scheduled = false;
+			for (uint32_t step : schedule)
+				scheduled = scheduled || step == pass;
+			CHECK(scheduled != passes[pass].culled);
+		}
+
+		// Every input was written earlier in the schedule, and the frame ends in the back buffer
+		std::vector<bool> written(resources.size(), false);
+		for (uint32_t step : schedule)
+		{
+			const PostProcessPass& pass = passes[step];
+			for (uint32_t i = 0; i < pass.inputCount; i++)
+				CHECK(written[pass.inputs[i]] || resources[pass.inputs[i]].imported);
+			written[pass.output] = true;
+		}
+		CHECK(!schedule.empty() && passes[schedule.back()].output == backBuffer);
+
+		for (size_t a = 0; a < resources.size(); a++)
+		{
+			if (resources[a].target == POSTPROCESS_INVALID)
+				continue;
+
+			// Pooled targets are the kind their resources asked for
+			CHECK(resources[a].target < graph.GetTargets().size());
+			CHECK(graph.GetTargets()[resources[a].target] == resources[a].desc);
+
+			// Resources sharing a target are never alive at the same time
+			for (size_t b = a + 1; b < resources.size(); b++)
+			{
+				if (resources[a].target == resources[b].target)
+					CHECK(resources[a].lastUse < resources[b].firstUse || resources[b].lastUse < resources[a].firstUse);
+			}
+		}
+
+		// A pass never reads the target it draws into
+		for (uint32_t step : schedule)
+		{
+			const PostProcessPass& pass = passes[step];
+			uint32_t outputTarget = resources[pass.output].target;
+			for (uint32_t i = 0; i < pass.inputCount; i++)
+				CHECK(outputTarget == POSTPROCESS_INVALID || resources[pass.inputs[i]].target != outputTarget);
+		}
+	}
+}
+
+int main()
+{
+	// Every mix of the settings the chain looks at, 7 switches
+	unsigned int combinations = 0;
+	for (uint32_t mask = 0; mask < (1u << 7); mask++)
+	{
+		PostProcessSettings settings;
+		settings.bloom = (mask & 1) != 0;
+		settings.tonemap = (mask & 2) != 0;
+		settings.fxaa = (mask & 4) != 0;
+		settings.colorGrading = (mask & 8) != 0;
+		settings.vignette = (mask & 16) != 0;
+		settings.filmGrain = (mask & 32) != 0;
+		settings.gamma = (mask & 64) != 0;
+
+		PostProcessGraph graph;
+		uint32_t backBuffer = POSTPROCESS_INVALID;
+		BuildPostProcessChain(graph, settings, &backBuffer);
+		graph.Compile();
+		CheckCompiledGraph(graph, backBuffer);
+
+		std::vector<PostProcessEffect> effects;
+		for (uint32_t step : graph.GetSchedule())
+			effects.push_back(graph.GetPasses()[step].effect);
+		CHECK(effects == GetExpectedEffects(settings));
+
+		// The bloom is only added back when the tonemapper runs
+		for (uint32_t step : graph.GetSchedule())
+		{
+			const PostProcessPass& pass = graph.GetPasses()[step];
+			if (pass.effect == PostProcessEffect::Tonemap)
+				CHECK(pass.inputCount == (settings.bloom ? 2u : 1u));
+		}
+
+		PostProcessGraphStats stats = graph.GetStats(1920, 1080);
+		CHECK(stats.passes == graph.GetPasses().size());
+		CHECK(stats.passes - stats.culledPasses == graph.GetSchedule().size());
+		CHECK(stats.targets <= stats.transients);
+		CHECK(stats.targetBytes <= stats.transientBytes);
+		combinations++;
+	}
+	printf("Compiled the chain for %u combinations of settings\n", combinations);
+
+	// A chain of full screen passes ping-pongs between two targets however long it gets
+	for (int length : { 2, 4, 8, 16, 32 })
+	{
+		PostProcessGraph graph;
+		PostProcessTargetDesc desc;
+		uint32_t backBuffer = graph.ImportTarget("back buffer", true);
+		uint32_t current = graph.CreateTarget("scene", desc);
+		graph.AddPass(PostProcessEffect::Scene, {}, current);
+		for (int i = 0; i < length; i++)
+		{
+			uint32_t next = graph.CreateTarget("step", desc);
+			CHECK(graph.AddPass(PostProcessEffect::Composite, { current }, next) != POSTPROCESS_INVALID);
+			current = next;
+		}
+		graph.AddPass(PostProcessEffect::Copy, { current }, backBuffer);
+
+		// Nothing reads this one, so it goes
+		uint32_t unused = graph.CreateTarget("unused", desc);
+		graph.AddPass(PostProcessEffect::Fxaa, { current }, unused);
+
+		graph.Compile();
+		CheckCompiledGraph(graph, backBuffer);
+
+		PostProcessGraphStats stats = graph.GetStats(1920, 1080);
+		CHECK(stats.transients == (unsigned int)length + 1);
+		CHECK(stats.targets == 2);
+		CHECK(stats.culledPasses == 1);
+		CHECK(graph.GetResources()[unused].target == POSTPROCESS_INVALID);
+		printf("Chain of %2d passes: %u transients in %u targets, %.1f MB instead of %.1f MB\n",
+			length, stats.transients, stats.targets, stats.targetBytes / 1048576.0, stats.transientBytes / 1048576.0);
+	}
+
+	// Passes that would break the graph are refused
+	{
+		PostProcessGraph graph;
+		PostProcessTargetDesc desc;
+		uint32_t backBuffer = graph.ImportTarget("back buffer", true);
+		uint32_t scene = graph.CreateTarget("scene", desc);
+		uint32_t other = graph.CreateTarget("other", desc);
+
+		CHECK(graph.AddPass(PostProcessEffect::Copy, { scene }, scene) == POSTPROCESS_INVALID);	// Reads its own output
+		CHECK(graph.AddPass(PostProcessEffect::Copy, { other }, backBuffer) == POSTPROCESS_INVALID);	// Input isn't written yet
+		CHECK(graph.AddPass(PostProcessEffect::Scene, {}, scene) != POSTPROCESS_INVALID);
+		CHECK(graph.AddPass(PostProcessEffect::Scene, {}, scene) == POSTPROCESS_INVALID);			// Written twice
+		CHECK(graph.AddPass(PostProcessEffect::Copy, { scene, scene, scene, scene, scene }, other) == POSTPROCESS_INVALID);	// Too many inputs
+		CHECK(graph.AddPass(PostProcessEffect::Copy, { scene }, POSTPROCESS_INVALID) == POSTPROCESS_INVALID);
+		CHECK(graph.AddPass(PostProcessEffect::Copy, { scene }, backBuffer) != POSTPROCESS_INVALID);
+
+		graph.Compile();
+		CheckCompiledGraph(graph, backBuffer);
+		CHECK(graph.GetSchedule().size() == 2);
+	}
+
+	return TestResult("PostProcessGraphTest");
+}
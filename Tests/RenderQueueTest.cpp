@@ -0,0 +1,188 @@
+// --------------------------------------------------------
+// Submits draws sharing a few shaders, materials and meshes
+// in shuffled order, and checks what the sorted queue binds
+// through the CountingRenderBackend against an unsorted walk.
+// The entities need the engine's D3D11 headers, so this one
+// only builds on Windows, from a Visual Studio developer
+// command prompt:
+//
+//  cl /O2 /EHsc /I. Tests\RenderQueueTest.cpp RenderQueue.cpp Entity.cpp Material.cpp Mesh.cpp MeshCache.cpp ObjLoader.cpp
+//     MappedFile.cpp SimpleShader.cpp Camera.cpp Transform.cpp TransformSystem.cpp JobSystem.cpp TextureRegistry.cpp
+//     TextureStreamer.cpp TextureCache.cpp AssetLoader.cpp BlockCompression.cpp PngDecoder.cpp
+//     d3d11.lib d3dcompiler.lib dxguid.lib ole32.lib windowscodecs.lib
+//  RenderQueueTest.exe
+//
+// No device is created: the shaders are left unloaded and
+// the meshes empty, the queue only compares their pointers.
+// --------------------------------------------------------
+#include "RenderQueue.h"
+#include "Entity.h"
+#include "Camera.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "SimpleShader.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace DirectX;
+
+#define SHADER_COUNT 3
+#define MATERIALS_PER_SHADER 2
+#define MESH_COUNT 4
+#define OPAQUE_DRAWS 600
+#define TRANSPARENT_DRAWS 60
+
+namespace
+{
+	// Counts like the CountingRenderBackend and keeps the order of the draws
+	class RecordingRenderBackend : public CountingRenderBackend
+	{
+	public:
+		void BeginPass(RenderPass pass) override
+		{
+			CountingRenderBackend::BeginPass(pass);
+			currentPass = pass;
+		}
+
+		void DrawEntity(Entity* entity) override
+		{
+			CountingRenderBackend::DrawEntity(entity);
+			drawn.push_back(entity);
+			passes.push_back(currentPass);
+		}
+
+		std::vector<Entity*> drawn;
+		std::vector<RenderPass> passes;
+		RenderPass currentPass = RenderPass::Opaque;
+	};
+
+	float GetDistance(Entity* entity, Camera& camera)
+	{
+		XMFLOAT3 eye = camera.GetTransform()->GetRenderPosition();
+		XMFLOAT3 position = entity->GetTransform()->GetRenderPosition();
+		return XMVectorGetX(XMVector3Length(XMLoadFloat3(&position) - XMLoadFloat3(&eye)));
+	}
+}
+
+int main()
+{
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> offset(-40.f, 40.f);
+	std::uniform_real_distribution<float> distance(1.f, 200.f);
+
+	std::vector<std::unique_ptr<SimpleVertexShader>> vertexShaders;
+	std::vector<std::unique_ptr<SimplePixelShader>> pixelShaders;
+	std::vector<std::unique_ptr<Material>> materials;
+	for (int i = 0; i < SHADER_COUNT; i++)
+	{
+		vertexShaders.emplace_back(new SimpleVertexShader(nullptr, nullptr, L"Missing.cso"));
+		pixelShaders.emplace_back(new SimplePixelShader(nullptr, nullptr, L"Missing.cso"));
+		for (int m = 0; m < MATERIALS_PER_SHADER; m++)
+			materials.emplace_back(new Material(XMFLOAT4(1, 1, 1, 1), 1.f, vertexShaders[i].get(), pixelShaders[i].get()));
+	}
+
+	MeshSource emptySource;
+	std::vector<std::unique_ptr<Mesh>> meshes;
+	for (int i = 0; i < MESH_COUNT; i++)
+		meshes.emplace_back(new Mesh(emptySource, nullptr));
+
+	// Every material with every mesh, shuffled and spread along the view
+	std::vector<std::unique_ptr<Entity>> entities;
+	for (int i = 0; i < OPAQUE_DRAWS + TRANSPARENT_DRAWS; i++)
+	{
+		Entity* entity = new Entity(meshes[random() % MESH_COUNT].get(), materials[random() % materials.size()].get());
+		entity->GetTransform()->SetPosition(offset(random), offset(random), distance(random));
+		entities.emplace_back(entity);
+	}
+
+	// Positions are read from the published matrices, hand them over like a tick does
+	Camera camera;
+	std::vector<XMFLOAT4X4> published;
+	TransformSystem::Get().UpdateWorldMatrices();
+	TransformSystem::Get().CopyWorldMatrices(published);
+	TransformSystem::Get().SwapRenderMatrices(published);
+
+	RenderQueue queue;
+	for (int i = 0; i < (int)entities.size(); i++)
+		queue.Submit(entities[i].get(), &camera, i < OPAQUE_DRAWS ? RenderPass::Opaque : RenderPass::Transparent);
+	queue.Sort();
+
+	RecordingRenderBackend backend;
+	queue.Execute(backend);
+	const RenderQueueStats& stats = queue.GetStats();
+
+	// Every draw comes out once, opaque ones first
+	CHECK(backend.draws == entities.size());
+	CHECK(stats.draws == entities.size());
+	CHECK(std::set<Entity*>(backend.drawn.begin(), backend.drawn.end()).size() == entities.size());
+	CHECK(std::is_sorted(backend.passes.begin(), backend.passes.end()));
+	CHECK(backend.passChanges == 2);
+
+	// The stats agree with what reached the backend, and every draw either binds or skips
+	CHECK(stats.shaderBinds == backend.shaderBinds);
+	CHECK(stats.materialBinds == backend.materialBinds);
+	CHECK(stats.meshBinds == backend.meshBinds);
+	CHECK(stats.shaderBinds + stats.skippedShaderBinds == stats.draws);
+	CHECK(stats.materialBinds + stats.skippedMaterialBinds == stats.draws);
+	CHECK(stats.meshBinds + stats.skippedMeshBinds == stats.draws);
+
+	// The opaque draws bind each shader and material once, and each material's draws of a mesh come together
+	std::set<std::pair<Material*, Mesh*>> opaqueGroups;
+	for (int i = 0; i < OPAQUE_DRAWS; i++)
+		opaqueGroups.emplace(entities[i]->GetMaterial(), entities[i]->GetMesh());
+
+	unsigned int opaqueShaderBinds = 0;
+	unsigned int opaqueMaterialBinds = 0;
+	unsigned int opaqueMeshBinds = 0;
+	unsigned int opaqueGroupRuns = 0;
+	unsigned int unsortedShaderBinds = 0;
+	unsigned int unsortedMaterialBinds = 0;
+	unsigned int unsortedMeshBinds = 0;
+	for (int i = 0; i < OPAQUE_DRAWS; i++)
+	{
+		Entity* drawn = backend.drawn[i];
+		Entity* previous = i > 0 ? backend.drawn[i - 1] : nullptr;
+		bool shaderChanged = !previous || previous->GetMaterial()->GetPixelShader() != drawn->GetMaterial()->GetPixelShader();
+		bool materialChanged = !previous || previous->GetMaterial() != drawn->GetMaterial();
+		opaqueShaderBinds += shaderChanged;
+		opaqueMaterialBinds += materialChanged;
+		opaqueMeshBinds += !previous || previous->GetMesh() != drawn->GetMesh();
+		bool groupChanged = materialChanged || previous->GetMesh() != drawn->GetMesh();
+		opaqueGroupRuns += groupChanged;
+
+		// Within a group of the same state, near to far
+		if (!groupChanged)
+			CHECK(GetDistance(previous, camera) <= GetDistance(drawn, camera) * 1.001f);
+
+		// The same walk in submission order, what drawing each entity as it comes would bind
+		Entity* submitted = entities[i].get();
+		Entity* previousSubmitted = i > 0 ? entities[i - 1].get() : nullptr;
+		bool submittedShaderChanged = !previousSubmitted || previousSubmitted->GetMaterial()->GetPixelShader() != submitted->GetMaterial()->GetPixelShader();
+		bool submittedMaterialChanged = submittedShaderChanged || previousSubmitted->GetMaterial() != submitted->GetMaterial();
+		unsortedShaderBinds += submittedShaderChanged;
+		unsortedMaterialBinds += submittedMaterialChanged;
+		unsortedMeshBinds += !previousSubmitted || previousSubmitted->GetMesh() != submitted->GetMesh();
+	}
+	CHECK(opaqueShaderBinds == SHADER_COUNT);
+	CHECK(opaqueMaterialBinds == materials.size());
+	CHECK(opaqueGroupRuns == opaqueGroups.size());
+	CHECK(opaqueMeshBinds <= opaqueGroups.size());
+
+	// The transparent draws go far to near whatever their state
+	for (int i = OPAQUE_DRAWS + 1; i < (int)backend.drawn.size(); i++)
+		CHECK(GetDistance(backend.drawn[i - 1], camera) * 1.001f >= GetDistance(backend.drawn[i], camera));
+
+	printf("%u draws, %u opaque in %u state groups\n", stats.draws, OPAQUE_DRAWS, (unsigned int)opaqueGroups.size());
+	printf("%-10s %10s %10s\n", "opaque", "sorted", "unsorted");
+	printf("%-10s %10u %10u\n", "shaders", opaqueShaderBinds, unsortedShaderBinds);
+	printf("%-10s %10u %10u\n", "materials", opaqueMaterialBinds, unsortedMaterialBinds);
+	printf("%-10s %10u %10u\n", "meshes", opaqueMeshBinds, unsortedMeshBinds);
+	queue.PrintStats();
+
+	return TestResult("RenderQueueTest");
+}
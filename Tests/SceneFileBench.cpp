@@ -0,0 +1,146 @@
+// --------------------------------------------------------
+// Loads a generated 100k entity scene both ways, parsing
+// the text and reading the compiled .sscene, and checks
+// that the two give the same arrays
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o scenebench Tests/SceneFileBench.cpp SceneFile.cpp MeshCache.cpp ObjLoader.cpp MappedFile.cpp
+//  ./scenebench [entity count]
+// --------------------------------------------------------
+#include "SceneFile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Milliseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// A level sized like a big open map: a few shared meshes and materials, lots of placements
+	bool WriteScene(const std::string& fileName, unsigned int entityCount)
+	{
+		FILE* file = fopen(fileName.c_str(), "w");
+		if (!file)
+			return false;
+
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> position(-500, 500);
+		std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+		std::uniform_real_distribution<float> scale(.5f, 2);
+
+		fprintf(file, "player position 0 2 0\n");
+		for (int i = 0; i < 16; i++)
+			fprintf(file, "mesh mesh%d ../Models/mesh%d.obj\n", i, i);
+		for (int i = 0; i < 16; i++)
+			fprintf(file, "texture texture%d ../Textures/texture%d.png color\n", i, i);
+		for (int i = 0; i < 32; i++)
+			fprintf(file, "material material%d lit tint %.3f %.3f %.3f 1 shininess %.2f diffuse texture%d\n",
+				i, scale(rng) / 2, scale(rng) / 2, scale(rng) / 2, scale(rng), i % 16);
+		fprintf(file, "material glass instanced tint .1 .1 1 .5\n");
+
+		for (unsigned int i = 0; i < entityCount; i++)
+			fprintf(file, "entity %s mesh%u material%u position %.3f %.3f %.3f rotation %.4f %.4f %.4f scale %.3f\n",
+				i % 10 ? "level" : "shape", (unsigned int)(rng() % 16), (unsigned int)(rng() % 32),
+				position(rng), position(rng) / 50, position(rng), angle(rng), angle(rng), angle(rng), scale(rng));
+
+		for (int i = 0; i < 100; i++)
+		{
+			fprintf(file, "route route%d mesh0 glass scale .25\n", i);
+			for (int w = 0; w < 8; w++)
+				fprintf(file, "waypoint route%d %.2f 1.5 %.2f\n", i, position(rng), position(rng));
+			fprintf(file, "ghost ghost%d mesh1 glass route%d position %.2f .5 %.2f\n", i, i, position(rng), position(rng));
+		}
+		for (int i = 0; i < 1000; i++)
+		{
+			fprintf(file, "light point color 1 .9 .8 range %.2f intensity 1 position %.2f 3 %.2f",
+				scale(rng) * 3, position(rng), position(rng));
+			if (i < 100)
+				fprintf(file, " follow ghost%d 0 1 0", i);
+			fprintf(file, "\n");
+		}
+
+		return fclose(file) == 0;
+	}
+
+	template<typename T>
+	bool SameArray(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	bool SameScene(const SceneData& a, const SceneData& b)
+	{
+		return SameArray(a.meshes, b.meshes) && SameArray(a.textures, b.textures) &&
+			SameArray(a.materials, b.materials) && SameArray(a.entities, b.entities) &&
+			SameArray(a.ghosts, b.ghosts) && SameArray(a.routes, b.routes) &&
+			SameArray(a.waypoints, b.waypoints) && SameArray(a.lights, b.lights) &&
+			SameArray(a.lightLinks, b.lightLinks) && a.strings == b.strings;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int entityCount = argc > 1 ? (unsigned int)atoi(argv[1]) : 100000;
+	const int runs = 5;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "scene_file_bench";
+	std::filesystem::create_directories(directory);
+	std::string sceneFile = (directory / "Big.scene").string();
+	std::string cacheFile = GetSceneCachePath(sceneFile.c_str());
+
+	if (!WriteScene(sceneFile, entityCount))
+	{
+		printf("Couldn't write %s\n", sceneFile.c_str());
+		return 1;
+	}
+
+	printf("%u entities, text %.2f MB\n", entityCount, std::filesystem::file_size(sceneFile) / 1048576.0);
+	printf("%4s %10s %10s %12s %13s %10s\n", "run", "parse ms", "save ms", "compiled ms", "LoadScene ms", "arrays");
+
+	bool allSame = true;
+	for (int run = 0; run < runs; run++)
+	{
+		SceneData parsed, compiled, cached;
+		std::string error;
+
+		Clock::time_point start = Clock::now();
+		if (!ParseScene(sceneFile.c_str(), parsed, &error))
+		{
+			printf("Couldn't parse the scene %s\n", error.c_str());
+			return 1;
+		}
+		double parseMs = Milliseconds(start);
+
+		start = Clock::now();
+		bool saved = SaveCompiledScene(cacheFile.c_str(), 0, parsed);
+		double saveMs = Milliseconds(start);
+
+		start = Clock::now();
+		bool loaded = LoadCompiledScene(cacheFile.c_str(), 0, compiled);
+		double compiledMs = Milliseconds(start);
+
+		// LoadScene itself, reading the cache its first call wrote over the one saved
+		// above, which matched no source. The text's size and write time still match
+		// it, so the second call doesn't hash the text.
+		SceneLoadStats stats;
+		LoadScene(sceneFile.c_str(), cached, &stats);
+		start = Clock::now();
+		bool fromCache = LoadScene(sceneFile.c_str(), cached, &stats) && stats.fromCache;
+		double cachedMs = Milliseconds(start);
+
+		bool same = saved && loaded && fromCache && SameScene(parsed, compiled) && SameScene(parsed, cached);
+		allSame = allSame && same;
+		printf("%4d %10.1f %10.1f %12.2f %13.2f %10s\n", run, parseMs, saveMs, compiledMs, cachedMs, same ? "same" : "DIFFERENT");
+	}
+
+	std::filesystem::remove_all(directory);
+	return allSame ? 0 : 1;
+}
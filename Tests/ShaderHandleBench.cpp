@@ -0,0 +1,140 @@
+// --------------------------------------------------------
+// Compares setting shader variables by name with setting
+// them through handles resolved once, with the same six
+// values Entity::Draw used to set by name for every entity.
+// Needs a D3D11 device, so this one only builds on Windows,
+// from a Visual Studio developer command prompt:
+//
+//  cl /O2 /EHsc /I. Tests\ShaderHandleBench.cpp SimpleShader.cpp d3d11.lib d3dcompiler.lib dxguid.lib
+//  ShaderHandleBench.exe [--iterations <n>]
+//
+// The shader is compiled from source at startup, so no .cso
+// files are needed. Falls back to the WARP software device
+// without a GPU.
+// --------------------------------------------------------
+#include "SimpleShader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#pragma comment(lib, "d3d11.lib")
+
+using namespace DirectX;
+
+namespace
+{
+	// Every variable is used, or the compiler would strip it from the buffer
+	const char* benchShader =
+		"cbuffer perObject : register(b0)\n"
+		"{\n"
+		"	matrix world;\n"
+		"	matrix view;\n"
+		"	matrix proj;\n"
+		"	float4 colorTint;\n"
+		"	float3 cameraPosition;\n"
+		"	float shininess;\n"
+		"}\n"
+		"float4 main(float4 position : SV_POSITION) : SV_TARGET\n"
+		"{\n"
+		"	float4 p = mul(mul(mul(position, world), view), proj);\n"
+		"	return p * colorTint + float4(cameraPosition, shininess);\n"
+		"}\n";
+
+	double SecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = 1000000;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "--iterations")) iterations = atoi(argv[i + 1]);
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	ID3D11Device* device = nullptr;
+	ID3D11DeviceContext* context = nullptr;
+	HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION, &device, nullptr, &context);
+	if (FAILED(hr))
+		hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION, &device, nullptr, &context);
+	if (FAILED(hr))
+	{
+		printf("Couldn't create a D3D11 device\n");
+		return 2;
+	}
+
+	ID3DBlob* compiled = nullptr;
+	ID3DBlob* errors = nullptr;
+	hr = D3DCompile(benchShader, strlen(benchShader), "ShaderHandleBench", 0, 0, "main", "ps_5_0", 0, 0, &compiled, &errors);
+	if (FAILED(hr))
+	{
+		printf("Couldn't compile the shader:\n%s\n", errors ? (const char*)errors->GetBufferPointer() : "");
+		return 2;
+	}
+
+	{
+		SimplePixelShader shader(device, context, compiled);
+
+		XMFLOAT4X4 matrix;
+		XMStoreFloat4x4(&matrix, XMMatrixIdentity());
+		XMFLOAT4 tint(1, 1, 1, 1);
+		XMFLOAT3 camera(0, 0, 0);
+
+		// By name, the way every setter was called before handles
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			matrix._41 = (float)i;
+			shader.SetMatrix4x4("world", matrix);
+			shader.SetMatrix4x4("view", matrix);
+			shader.SetMatrix4x4("proj", matrix);
+			shader.SetFloat4("colorTint", tint);
+			shader.SetFloat3("cameraPosition", camera);
+			shader.SetFloat("shininess", (float)i);
+		}
+		double nameSeconds = SecondsSince(start);
+
+		// Resolved once, like Material does when it's built
+		SimpleShaderVariableHandle world = shader.GetVariableHandle("world");
+		SimpleShaderVariableHandle view = shader.GetVariableHandle("view");
+		SimpleShaderVariableHandle proj = shader.GetVariableHandle("proj");
+		SimpleShaderVariableHandle colorTint = shader.GetVariableHandle("colorTint");
+		SimpleShaderVariableHandle cameraPosition = shader.GetVariableHandle("cameraPosition");
+		SimpleShaderVariableHandle shininess = shader.GetVariableHandle("shininess");
+		if (!world.IsValid() || !view.IsValid() || !proj.IsValid() || !colorTint.IsValid() || !cameraPosition.IsValid() || !shininess.IsValid())
+		{
+			printf("A variable is missing from the compiled shader\n");
+			return 1;
+		}
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			matrix._41 = (float)i;
+			shader.SetMatrix4x4(world, matrix);
+			shader.SetMatrix4x4(view, matrix);
+			shader.SetMatrix4x4(proj, matrix);
+			shader.SetFloat4(colorTint, tint);
+			shader.SetFloat3(cameraPosition, camera);
+			shader.SetFloat(shininess, (float)i);
+		}
+		double handleSeconds = SecondsSince(start);
+
+		double sets = iterations * 6.0;
+		printf("%d iterations of 6 sets\n", iterations);
+		printf("  by name:   %8.2f ns a set\n", nameSeconds * 1e9 / sets);
+		printf("  by handle: %8.2f ns a set (%.1fx)\n", handleSeconds * 1e9 / sets, handleSeconds > 0 ? nameSeconds / handleSeconds : 0);
+	}
+
+	context->Release();
+	device->Release();
+	return 0;
+}
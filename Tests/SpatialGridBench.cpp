@@ -0,0 +1,165 @@
+// --------------------------------------------------------
+// Query throughput of the spatial grid against a linear
+// scan, for the player-in-light lookup and for radius
+// queries over a crowd of agents
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o gridbench Tests/SpatialGridBench.cpp SpatialGrid.cpp
+//  ./gridbench
+// --------------------------------------------------------
+#include "SpatialGrid.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct LightSphere
+	{
+		XMFLOAT3 position;
+		float range;
+	};
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	bool Inside(const XMFLOAT3& point, const XMFLOAT3& center, float radius)
+	{
+		float x = point.x - center.x;
+		float y = point.y - center.y;
+		float z = point.z - center.z;
+		return x * x + y * y + z * z < radius * radius;
+	}
+}
+
+int main()
+{
+	// First light containing the point, what GameSimulation::PlayerInLight() answers
+	printf("%8s %10s %14s %14s %12s %10s\n", "lights", "build us", "grid Mq/s", "linear Mq/s", "candidates", "mismatches");
+	for (int lightCount : { 16, 1000, 10000 })
+	{
+		std::mt19937 random(16);
+		float extent = lightCount < 100 ? 40.f : 400.f;
+		std::uniform_real_distribution<float> position(-extent, extent);
+		std::uniform_real_distribution<float> range(2.f, 15.f);
+		std::vector<LightSphere> lights(lightCount);
+		for (LightSphere& light : lights)
+			light = { XMFLOAT3(position(random), position(random) * .02f, position(random)), range(random) };
+
+		SpatialGrid grid(8.f);
+		const int builds = 100;
+		Clock::time_point start = Clock::now();
+		for (int build = 0; build < builds; build++)
+		{
+			grid.Clear();
+			for (int i = 0; i < lightCount; i++)
+				grid.Insert(i, lights[i].position, lights[i].range);
+			grid.Build();
+		}
+		double buildSeconds = Seconds(start) / builds;
+
+		const int queryCount = 200000;
+		std::vector<XMFLOAT3> queries(queryCount);
+		for (XMFLOAT3& query : queries)
+			query = XMFLOAT3(position(random), 0, position(random));
+
+		std::vector<int> gridHits(queryCount, -1);
+		std::vector<uint32_t> nearby;
+		start = Clock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			grid.Query(queries[q], 0, nearby);
+			for (uint32_t i : nearby)
+			{
+				if (Inside(queries[q], lights[i].position, lights[i].range))
+				{
+					gridHits[q] = (int)i;
+					break;
+				}
+			}
+		}
+		double gridSeconds = Seconds(start);
+
+		std::vector<int> linearHits(queryCount, -1);
+		start = Clock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			for (int i = 0; i < lightCount; i++)
+			{
+				if (Inside(queries[q], lights[i].position, lights[i].range))
+				{
+					linearHits[q] = i;
+					break;
+				}
+			}
+		}
+		double linearSeconds = Seconds(start);
+
+		// The grid has to pick the same light the scan does
+		int mismatches = 0;
+		for (int q = 0; q < queryCount; q++)
+			mismatches += gridHits[q] != linearHits[q] ? 1 : 0;
+
+		const SpatialGridStats& stats = grid.GetStats();
+		printf("%8d %10.1f %14.2f %14.2f %12.1f %10d\n", lightCount, buildSeconds * 1e6, queryCount / gridSeconds / 1e6, queryCount / linearSeconds / 1e6,
+			(double)stats.candidates / stats.queries, mismatches);
+	}
+
+	// Everything within a ghost's sight range, over a crowd
+	{
+		const int agentCount = 100000;
+		const float radius = 9.f;
+		std::mt19937 random(17);
+		std::uniform_real_distribution<float> position(-500.f, 500.f);
+		std::vector<XMFLOAT3> agents(agentCount);
+		for (XMFLOAT3& agent : agents)
+			agent = XMFLOAT3(position(random), 0, position(random));
+
+		SpatialGrid grid(6.f);
+		for (int i = 0; i < agentCount; i++)
+			grid.Insert(i, agents[i], 0);
+		grid.Build();
+
+		// The linear scan is slow enough that it gets fewer queries
+		const int queryCount = 20000;
+		const int linearQueryCount = 500;
+		std::vector<XMFLOAT3> queries(queryCount);
+		for (XMFLOAT3& query : queries)
+			query = XMFLOAT3(position(random), 0, position(random));
+
+		std::vector<uint32_t> nearby;
+		long long gridFound = 0;
+		long long gridFoundForLinear = 0;
+		Clock::time_point start = Clock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			grid.Query(queries[q], radius, nearby);
+			for (uint32_t i : nearby)
+			{
+				int found = Inside(agents[i], queries[q], radius) ? 1 : 0;
+				gridFound += found;
+				gridFoundForLinear += q < linearQueryCount ? found : 0;
+			}
+		}
+		double gridSeconds = Seconds(start);
+
+		long long linearFound = 0;
+		start = Clock::now();
+		for (int q = 0; q < linearQueryCount; q++)
+		{
+			for (int i = 0; i < agentCount; i++)
+				linearFound += Inside(agents[i], queries[q], radius) ? 1 : 0;
+		}
+		double linearSeconds = Seconds(start);
+
+		printf("%d agents, radius %.0f: grid %.0f queries/s, linear %.0f queries/s, %lld found (%lld of %lld in the linear subset)\n",
+			agentCount, radius, queryCount / gridSeconds, linearQueryCount / linearSeconds, gridFound, gridFoundForLinear, linearFound);
+	}
+	return 0;
+}
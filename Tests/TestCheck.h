@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+
+// --------------------------------------------------------
+// The little the test mains under Tests/ share. Each is a
+// standalone program built and run from the repository's
+// root, see the README, that prints what it checked and
+// returns non zero if anything failed.
+// --------------------------------------------------------
+inline int& GetTestFailureCount()
+{
+	static int failures = 0;
+	return failures;
+}
+
+// Reports a failed condition and keeps going, so one run shows every failure
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+			GetTestFailureCount()++; \
+		} \
+	} while (0)
+
+// What a test's main returns
+inline int TestResult(const char* testName)
+{
+	if (GetTestFailureCount() == 0)
+		printf("%s passed\n", testName);
+	else
+		printf("%s failed %d check(s)\n", testName, GetTestFailureCount());
+	return GetTestFailureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+// --------------------------------------------------------
+// Checks the texture baking path that has to run on any
+// platform: PNG decoding, block compression, the baked DDS
+// container and reading it back
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o texturetest Tests/TextureCacheTest.cpp TextureCache.cpp BlockCompression.cpp PngDecoder.cpp MappedFile.cpp MeshCache.cpp ObjLoader.cpp JobSystem.cpp -lpthread
+//  ./texturetest [--root <repository>]
+// --------------------------------------------------------
+#include "TextureCache.h"
+#include "MeshCache.h"
+#include "JobSystem.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace
+{
+	// Smooth gradients with a bit of noise, hard enough that no format is lossless on it
+	DecodedImage MakeImage(unsigned int width, unsigned int height)
+	{
+		DecodedImage image;
+		image.width = width;
+		image.height = height;
+		image.pixels.resize((size_t)width * height * 4);
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned char* pixel = &image.pixels[((size_t)y * width + x) * 4];
+				unsigned int noise = (x * 7919 + y * 104729) % 9;
+				pixel[0] = (unsigned char)(x * 255 / width);
+				pixel[1] = (unsigned char)(y * 255 / height);
+				pixel[2] = (unsigned char)((x + y) * 127 / (width + height) + noise);
+				pixel[3] = 255;
+			}
+		}
+		return image;
+	}
+
+	// Peak signal to noise over the channels the format keeps
+	double Psnr(const DecodedImage& image, const std::vector<unsigned char>& unpacked, int channels)
+	{
+		double squaredError = 0;
+		for (size_t i = 0; i < image.pixels.size(); i += 4)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				double difference = (double)image.pixels[i + c] - unpacked[i + c];
+				squaredError += difference * difference;
+			}
+		}
+		double meanError = squaredError / ((double)image.width * image.height * channels);
+		return meanError > 0 ? 10 * log10(255.0 * 255.0 / meanError) : 100;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string root = ".";
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--root") == 0)
+			root = argv[++i];
+	}
+
+	JobSystem::Get().Start(0);
+
+	// Every format survives a round trip at a reasonable quality
+	{
+		DecodedImage image = MakeImage(64, 48);
+		struct { BlockFormat format; const char* name; int channels; double minPsnr; } formats[] =
+		{
+			{ BlockFormat::BC1, "BC1", 3, 32 },
+			{ BlockFormat::BC5, "BC5", 2, 45 },
+			{ BlockFormat::BC7, "BC7", 4, 36 }
+		};
+		for (const auto& entry : formats)
+		{
+			std::vector<unsigned char> blocks(GetCompressedSize(entry.format, image.width, image.height));
+			CHECK(blocks.size() == (64 / 4) * (48 / 4) * GetBlockBytes(entry.format));
+			CompressImage(entry.format, image.pixels.data(), image.width, image.height, blocks.data());
+
+			std::vector<unsigned char> unpacked(image.pixels.size());
+			CHECK(DecompressImage(entry.format, blocks.data(), image.width, image.height, unpacked.data()));
+			double psnr = Psnr(image, unpacked, entry.channels);
+			printf("%s: %.1f dB\n", entry.name, psnr);
+			CHECK(psnr > entry.minPsnr);
+		}
+	}
+
+	// A baked odd sized texture reads back with a full chain of mips
+	{
+		DecodedImage image = MakeImage(100, 60);
+		std::vector<unsigned char> file;
+		TextureBakeStats stats;
+		BakeTexture(image, TextureUsage::Color, 0x1234567890abcdefull, file, &stats);
+		CHECK(stats.bakedBytes == file.size());
+
+		std::vector<unsigned char> truncated(file.begin(), file.end() - 1);
+		std::vector<unsigned char> wrongMagic = file;
+		wrongMagic[0] = 'X';
+
+		TextureCacheView view;
+		CHECK(view.Open(std::move(file)));
+		CHECK(view.GetWidth() == 100 && view.GetHeight() == 60);
+		CHECK(view.GetMipCount() == 7);
+		CHECK(view.GetFormat() == BlockFormat::BC7);
+		CHECK(view.GetDxgiFormat() == TEXTURE_DXGI_BC7_UNORM);
+		CHECK(view.GetSourceHash() == 0x1234567890abcdefull);
+
+		size_t total = 0;
+		for (unsigned int mip = 0; mip < view.GetMipCount(); mip++)
+		{
+			CHECK(view.GetMipSize(mip) == GetCompressedSize(BlockFormat::BC7, view.GetMipWidth(mip), view.GetMipHeight(mip)));
+			total += view.GetMipSize(mip);
+		}
+		CHECK(view.GetMipWidth(6) == 1 && view.GetMipHeight(6) == 1);
+		CHECK(view.GetMipTailSize(0) == total);
+
+		// Files cut short or that aren't DDS are turned away
+		TextureCacheView broken;
+		CHECK(!broken.Open(std::move(truncated)));
+		CHECK(!broken.Open(std::move(wrongMagic)));
+	}
+
+	// Normal maps are baked to two channels, their mips stay unit length
+	{
+		DecodedImage flat;
+		flat.width = flat.height = 16;
+		flat.pixels.resize(16 * 16 * 4);
+		for (size_t i = 0; i < flat.pixels.size(); i += 4)
+		{
+			// Alternating tilts that average out to straight up
+			bool left = (i / 4) % 2 == 0;
+			flat.pixels[i + 0] = left ? 37 : 218;
+			flat.pixels[i + 1] = 128;
+			flat.pixels[i + 2] = 218;
+			flat.pixels[i + 3] = 255;
+		}
+
+		std::vector<DecodedImage> mips;
+		GenerateMips(flat, TextureUsage::NormalMap, mips);
+		CHECK(mips.size() == 4);
+		const unsigned char* top = mips[0].pixels.data();
+		float x = top[0] / 127.5f - 1;
+		float y = top[1] / 127.5f - 1;
+		float z = top[2] / 127.5f - 1;
+		CHECK(fabsf(x) < .02f);
+		CHECK(fabsf(sqrtf(x * x + y * y + z * z) - 1) < .02f);
+
+		std::vector<unsigned char> file;
+		BakeTexture(flat, TextureUsage::NormalMap, 1, file);
+		TextureCacheView view;
+		CHECK(view.Open(std::move(file)));
+		CHECK(view.GetFormat() == BlockFormat::BC5);
+	}
+
+	// A real texture from the repository, baked next to a copy of it and then read from the bake
+	{
+		std::filesystem::path source = std::filesystem::path(root) / "Assets" / "Textures" / "prototype_512x512_orange.png";
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "texture_cache_test";
+		std::filesystem::create_directories(directory);
+		std::filesystem::path copy = directory / "orange.png";
+		std::error_code error;
+		std::filesystem::copy_file(source, copy, std::filesystem::copy_options::overwrite_existing, error);
+		CHECK(!error);
+
+		MappedFile png;
+		CHECK(png.Open(copy.string().c_str()));
+		DecodedImage decoded;
+		CHECK(png.IsOpen() && DecodePng((const unsigned char*)png.GetData(), png.GetSize(), decoded));
+		CHECK(decoded.width == 512 && decoded.height == 512);
+		CHECK(decoded.pixels.size() == 512 * 512 * 4);
+		png.Close();
+
+		// The sources keep their bakes mapped, so each one is closed before the bake is replaced
+		std::filesystem::remove(GetTextureCachePath(copy.string().c_str()));
+		{
+			TextureSource baked;
+			CHECK(baked.Load(copy.string().c_str(), TextureUsage::FlatColor));
+			CHECK(!baked.IsFromCache());
+			CHECK(baked.GetView().GetMipCount() == 10);
+			CHECK(baked.GetView().GetSourceHash() == HashFile(copy.string().c_str()));
+
+			TextureSource cached;
+			CHECK(cached.Load(copy.string().c_str(), TextureUsage::FlatColor));
+			CHECK(cached.IsFromCache());
+			CHECK(cached.GetView().GetFormat() == BlockFormat::BC1);
+			CHECK(cached.GetView().GetMipSize(0) == baked.GetView().GetMipSize(0));
+			CHECK(memcmp(cached.GetView().GetMipData(0), baked.GetView().GetMipData(0), baked.GetView().GetMipSize(0)) == 0);
+		}
+
+		// Asking for another usage redoes the bake
+		{
+			TextureSource rebaked;
+			CHECK(rebaked.Load(copy.string().c_str(), TextureUsage::Color));
+			CHECK(!rebaked.IsFromCache());
+			CHECK(rebaked.GetView().GetFormat() == BlockFormat::BC7);
+		}
+		std::filesystem::remove_all(directory);
+	}
+
+	JobSystem::Get().Stop();
+	return TestResult("TextureCacheTest");
+}
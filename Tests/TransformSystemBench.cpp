@@ -0,0 +1,129 @@
+// --------------------------------------------------------
+// Compares a frame of transform updates in the
+// TransformSystem against the old layout, where every
+// entity did `new Transform()` and rebuilt its own matrix
+//
+//  g++ -O2 -std=c++17 -I. -I<DirectXMath headers> -o transformbench Tests/TransformSystemBench.cpp Transform.cpp TransformSystem.cpp JobSystem.cpp -lpthread
+//  ./transformbench
+// --------------------------------------------------------
+#include "Transform.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The transform as it was before the TransformSystem, one heap allocation each
+	class HeapTransform
+	{
+	public:
+		void SetPosition(float x, float y, float z) { position = XMFLOAT3(x, y, z); isDirty = true; }
+		void SetRotation(float pitch, float yaw, float roll) { rotation = XMFLOAT3(pitch, yaw, roll); isDirty = true; }
+		void SetScale(float x, float y, float z) { scale = XMFLOAT3(x, y, z); isDirty = true; }
+		void MoveAbsolute(float x, float y, float z) { position.x += x; position.y += y; position.z += z; isDirty = true; }
+		void Rotate(float pitch, float yaw, float roll) { rotation.x += pitch; rotation.y += yaw; rotation.z += roll; isDirty = true; }
+
+		XMFLOAT4X4 GetWorldMatrix()
+		{
+			if (isDirty)
+			{
+				XMMATRIX translationMatrix = XMMatrixTranslation(position.x, position.y, position.z);
+				XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+				XMMATRIX scaleMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
+				XMStoreFloat4x4(&worldMatrix, scaleMatrix * rotationMatrix * translationMatrix);
+				isDirty = false;
+			}
+			return worldMatrix;
+		}
+
+	private:
+		bool isDirty = true;
+		XMFLOAT4X4 worldMatrix;
+		XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 scale = XMFLOAT3(1, 1, 1);
+		XMFLOAT3 rotation = XMFLOAT3(0, 0, 0);
+		XMFLOAT4 quaternionRotation = XMFLOAT4(0, 0, 0, 1);	// Unused, but the old class carried it
+	};
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	const int frames = 50;
+	float sink = 0;
+
+	printf("%8s %8s %12s %12s %10s\n", "count", "moving", "old ms", "system ms", "max error");
+	for (int count : { 10000, 100000 })
+	{
+		// Spread across the heap like entities created over a level's load
+		std::vector<std::unique_ptr<HeapTransform>> heapTransforms;
+		std::unique_ptr<Transform[]> transforms(new Transform[count]);
+		for (int i = 0; i < count; i++)
+		{
+			heapTransforms.emplace_back(new HeapTransform());
+			heapTransforms[i]->SetPosition((float)i, 0, 1);
+			heapTransforms[i]->SetRotation(i * .01f, i * .02f, 0);
+			heapTransforms[i]->SetScale(1, 2, 3);
+			transforms[i].SetPosition((float)i, 0, 1);
+			transforms[i].SetRotation(i * .01f, i * .02f, 0);
+			transforms[i].SetScale(1, 2, 3);
+		}
+
+		// Everything moving, like a crowd, and one in ten, like the maze where most things are still
+		for (int stride : { 1, 10 })
+		{
+			double heapSeconds = 0;
+			double systemSeconds = 0;
+			for (int frame = 0; frame < frames; frame++)
+			{
+				Clock::time_point start = Clock::now();
+				for (int i = 0; i < count; i += stride)
+				{
+					heapTransforms[i]->MoveAbsolute(.01f, 0, 0);
+					heapTransforms[i]->Rotate(0, .01f, 0);
+				}
+				for (int i = 0; i < count; i++)
+					sink += heapTransforms[i]->GetWorldMatrix()._41;
+				heapSeconds += Seconds(start);
+
+				start = Clock::now();
+				for (int i = 0; i < count; i += stride)
+				{
+					transforms[i].MoveAbsolute(.01f, 0, 0);
+					transforms[i].Rotate(0, .01f, 0);
+				}
+				TransformSystem::Get().UpdateWorldMatrices();
+				for (int i = 0; i < count; i++)
+					sink += transforms[i].GetWorldMatrix()._41;
+				systemSeconds += Seconds(start);
+			}
+
+			// Both layouts have to agree on where everything ended up
+			float maxError = 0;
+			for (int i = 0; i < count; i++)
+			{
+				XMFLOAT4X4 expected = heapTransforms[i]->GetWorldMatrix();
+				XMFLOAT4X4 actual = transforms[i].GetWorldMatrix();
+				for (int row = 0; row < 4; row++)
+					for (int column = 0; column < 4; column++)
+						maxError = (std::max)(maxError, fabsf(expected.m[row][column] - actual.m[row][column]));
+			}
+
+			printf("%8d %8d %12.3f %12.3f %10g\n", count, count / stride, heapSeconds * 1000 / frames, systemSeconds * 1000 / frames, maxError);
+		}
+	}
+
+	// Keeps the reads from being optimized away
+	return sink == 12345.f ? 1 : 0;
+}
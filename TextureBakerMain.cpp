@@ -0,0 +1,158 @@
+// --------------------------------------------------------
+// Bakes PNG textures to the block compressed DDS files the
+// game streams, ahead of time and on any platform. The game
+// bakes any missing or stale texture itself on load, this
+// just moves that work out of the first launch. Not part of
+// the Windows project, see the README for building it.
+//
+//  --color       Following files are color textures (BC7)
+//  --flat        Following files are flat color textures (BC1)
+//  --normal      Following files are normal maps (BC5)
+//  --check       Also unpacks the top mip and prints its PSNR
+//  --threads <n> Job system workers, default one per core
+//
+// Without a usage flag, files ending in "_normals" are normal
+// maps and everything else is color.
+// --------------------------------------------------------
+#include "TextureCache.h"
+#include "MeshCache.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	TextureUsage GuessUsage(const std::string& fileName)
+	{
+		return fileName.find("_normals.") != std::string::npos ? TextureUsage::NormalMap : TextureUsage::Color;
+	}
+
+	const char* GetUsageName(TextureUsage usage)
+	{
+		switch (usage)
+		{
+		case TextureUsage::FlatColor: return "BC1";
+		case TextureUsage::NormalMap: return "BC5";
+		default: return "BC7";
+		}
+	}
+
+	// Peak signal to noise ratio of the top mip over the channels the format keeps
+	double GetTopMipPsnr(const DecodedImage& image, const TextureCacheView& view)
+	{
+		std::vector<unsigned char> unpacked(image.pixels.size());
+		if (!DecompressImage(view.GetFormat(), view.GetMipData(0), view.GetWidth(), view.GetHeight(), unpacked.data()))
+			return 0;
+
+		int channels = view.GetFormat() == BlockFormat::BC5 ? 2 : (view.GetFormat() == BlockFormat::BC1 ? 3 : 4);
+		double squaredError = 0;
+		for (size_t i = 0; i < unpacked.size(); i += 4)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				double difference = (double)unpacked[i + c] - image.pixels[i + c];
+				squaredError += difference * difference;
+			}
+		}
+
+		double meanSquaredError = squaredError / ((double)image.width * image.height * channels);
+		return meanSquaredError > 0 ? 10 * log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int threads = JobSystem::GetDefaultWorkerCount();
+	bool check = false;
+	bool usageSet = false;
+	TextureUsage usage = TextureUsage::Color;
+
+	std::vector<std::pair<std::string, TextureUsage>> files;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--color")) { usage = TextureUsage::Color; usageSet = true; }
+		else if (!strcmp(argv[i], "--flat")) { usage = TextureUsage::FlatColor; usageSet = true; }
+		else if (!strcmp(argv[i], "--normal")) { usage = TextureUsage::NormalMap; usageSet = true; }
+		else if (!strcmp(argv[i], "--check")) check = true;
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = (unsigned int)atoi(argv[++i]);
+		else if (argv[i][0] == '-')
+		{
+			printf("Unknown option %s\n", argv[i]);
+			return 2;
+		}
+		else
+			files.emplace_back(argv[i], usageSet ? usage : GuessUsage(argv[i]));
+	}
+
+	if (files.empty())
+	{
+		printf("Usage: texbaker [--color|--flat|--normal] [--check] [--threads n] file.png ...\n");
+		return 2;
+	}
+
+	JobSystem::Get().Start(threads);
+
+	int failures = 0;
+	size_t totalSource = 0;
+	size_t totalUncompressed = 0;
+	size_t totalBaked = 0;
+	for (const std::pair<std::string, TextureUsage>& entry : files)
+	{
+		const char* fileName = entry.first.c_str();
+
+		MappedFile source;
+		DecodedImage image;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if (!source.Open(fileName) || !DecodePng((const unsigned char*)source.GetData(), source.GetSize(), image))
+		{
+			printf("%s: couldn't decode\n", fileName);
+			failures++;
+			continue;
+		}
+		double decodeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		std::vector<unsigned char> baked;
+		TextureBakeStats stats;
+		BakeTexture(image, entry.second, HashBytes(source.GetData(), source.GetSize()), baked, &stats);
+
+		std::string cachePath = GetTextureCachePath(fileName);
+		if (!SaveTextureCache(cachePath.c_str(), baked))
+		{
+			printf("%s: couldn't write %s\n", fileName, cachePath.c_str());
+			failures++;
+			continue;
+		}
+
+		// Read it back the way the game will
+		TextureCacheView view;
+		if (!view.Open(cachePath.c_str()))
+		{
+			printf("%s: %s doesn't read back\n", fileName, cachePath.c_str());
+			failures++;
+			continue;
+		}
+
+		printf("%s: %ux%u %s, %u mips, %.1f KB png -> %.1f KB rgba -> %.1f KB, decode %.1f ms, mips %.1f ms, compress %.1f ms",
+			fileName, image.width, image.height, GetUsageName(entry.second), view.GetMipCount(),
+			source.GetSize() / 1024.0, stats.uncompressedBytes / 1024.0, stats.bakedBytes / 1024.0,
+			decodeSeconds * 1000.0, stats.mipSeconds * 1000.0, stats.compressSeconds * 1000.0);
+		if (check)
+			printf(", PSNR %.2f dB", GetTopMipPsnr(image, view));
+		printf("\n");
+
+		totalSource += source.GetSize();
+		totalUncompressed += stats.uncompressedBytes;
+		totalBaked += stats.bakedBytes;
+	}
+
+	printf("%u textures: %.2f MB png, %.2f MB rgba with mips, %.2f MB baked\n",
+		(unsigned int)(files.size() - failures), totalSource / 1048576.0, totalUncompressed / 1048576.0, totalBaked / 1048576.0);
+
+	JobSystem::Get().Stop();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,434 @@
+#include "TextureCache.h"
+#include "MeshCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// DDS header flags
+#define DDSD_CAPS 0x1
+#define DDSD_HEIGHT 0x2
+#define DDSD_WIDTH 0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE 0x80000
+#define DDPF_FOURCC 0x4
+#define DDSCAPS_COMPLEX 0x8
+#define DDSCAPS_TEXTURE 0x1000
+#define DDSCAPS_MIPMAP 0x400000
+#define DDS_DIMENSION_TEXTURE2D 3
+
+typedef std::chrono::high_resolution_clock BakeClock;
+
+BlockFormat GetBakeFormat(TextureUsage usage)
+{
+	switch (usage)
+	{
+	case TextureUsage::FlatColor: return BlockFormat::BC1;
+	case TextureUsage::NormalMap: return BlockFormat::BC5;
+	default: return BlockFormat::BC7;
+	}
+}
+
+bool TextureCacheView::Open(const char* fileName)
+{
+	Close();
+	if (!file.Open(fileName))
+		return false;
+
+	if (!Parse((const unsigned char*)file.GetData(), file.GetSize()))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool TextureCacheView::Open(std::vector<unsigned char>&& fileBytes)
+{
+	Close();
+	memory = std::move(fileBytes);
+	if (!Parse(memory.data(), memory.size()))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void TextureCacheView::Close()
+{
+	file.Close();
+	memory.clear();
+	data = nullptr;
+	width = 0;
+	height = 0;
+	mipCount = 0;
+	sourceHash = 0;
+}
+
+uint32_t TextureCacheView::GetDxgiFormat() const
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return TEXTURE_DXGI_BC1_UNORM;
+	case BlockFormat::BC5: return TEXTURE_DXGI_BC5_UNORM;
+	default: return TEXTURE_DXGI_BC7_UNORM;
+	}
+}
+
+size_t TextureCacheView::GetMipRowPitch(unsigned int mip) const
+{
+	return (size_t)(std::max)(1u, (GetMipWidth(mip) + 3) / 4) * GetBlockBytes(format);
+}
+
+bool TextureCacheView::Parse(const unsigned char* bytes, size_t size)
+{
+	if (size < 4 + sizeof(DDSHeader))
+		return false;
+
+	uint32_t magic;
+	memcpy(&magic, bytes, 4);
+	const DDSHeader* header = (const DDSHeader*)(bytes + 4);
+	if (magic != DDS_MAGIC || header->size != sizeof(DDSHeader) || header->pixelFormat.size != sizeof(DDSPixelFormat))
+		return false;
+
+	size_t dataOffset = 4 + sizeof(DDSHeader);
+	if (!(header->pixelFormat.flags & DDPF_FOURCC))
+		return false;
+
+	switch (header->pixelFormat.fourCC)
+	{
+	case DDS_FOURCC_DXT1:
+		format = BlockFormat::BC1;
+		break;
+	case DDS_FOURCC_ATI2:
+	case DDS_FOURCC_BC5U:
+		format = BlockFormat::BC5;
+		break;
+	case DDS_FOURCC_DX10:
+	{
+		if (size < dataOffset + sizeof(DDSHeaderDX10))
+			return false;
+
+		const DDSHeaderDX10* extension = (const DDSHeaderDX10*)(bytes + dataOffset);
+		dataOffset += sizeof(DDSHeaderDX10);
+		if (extension->resourceDimension != DDS_DIMENSION_TEXTURE2D || extension->arraySize > 1 || extension->miscFlag != 0)
+			return false;
+
+		// The typeless and sRGB variants sit either side of the UNORM one
+		if (extension->dxgiFormat >= TEXTURE_DXGI_BC1_UNORM - 1 && extension->dxgiFormat <= TEXTURE_DXGI_BC1_UNORM + 1)
+			format = BlockFormat::BC1;
+		else if (extension->dxgiFormat >= TEXTURE_DXGI_BC5_UNORM - 1 && extension->dxgiFormat <= TEXTURE_DXGI_BC5_UNORM + 1)
+			format = BlockFormat::BC5;
+		else if (extension->dxgiFormat >= TEXTURE_DXGI_BC7_UNORM - 1 && extension->dxgiFormat <= TEXTURE_DXGI_BC7_UNORM + 1)
+			format = BlockFormat::BC7;
+		else
+			return false;
+		break;
+	}
+	default:
+		return false;
+	}
+
+	if (header->width == 0 || header->height == 0 || header->width > 32768 || header->height > 32768)
+		return false;
+
+	width = header->width;
+	height = header->height;
+	mipCount = (header->flags & DDSD_MIPMAPCOUNT) && header->mipMapCount > 0 ? header->mipMapCount : 1;
+	if (mipCount > TEXTURE_MAX_MIPS)
+		return false;
+
+	// Mips past 1x1 don't exist
+	unsigned int largest = (std::max)(width, height);
+	unsigned int fullChain = 1;
+	while (largest > 1)
+	{
+		largest >>= 1;
+		fullChain++;
+	}
+	if (mipCount > fullChain)
+		return false;
+
+	mipOffsets[0] = 0;
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+		mipOffsets[mip + 1] = mipOffsets[mip] + GetCompressedSize(format, GetMipWidth(mip), GetMipHeight(mip));
+
+	if (size < dataOffset + mipOffsets[mipCount])
+		return false;
+
+	sourceHash = 0;
+	if (header->reserved1[0] == TEXTURE_BAKE_MAGIC && header->reserved1[1] == TEXTURE_BAKE_VERSION)
+		sourceHash = (uint64_t)header->reserved1[2] | ((uint64_t)header->reserved1[3] << 32);
+
+	data = bytes + dataOffset;
+	return true;
+}
+
+bool TextureSource::Load(const char* fileName, TextureUsage usage)
+{
+	fromCache = false;
+	view.Close();
+
+	// Hash the source so we can tell if the baked version is stale
+	MappedFile source;
+	if (!source.Open(fileName))
+		return false;
+	uint64_t sourceHash = HashBytes(source.GetData(), source.GetSize());
+
+	// Use the bake if it's from this source and for this usage,
+	// which skips the decoding, the mips and the compression
+	std::string cachePath = GetTextureCachePath(fileName);
+	if (view.Open(cachePath.c_str()) && view.GetSourceHash() == sourceHash && view.GetFormat() == GetBakeFormat(usage))
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Texture %s: loaded baked %s (%ux%u, %u mips)\n",
+			fileName, cachePath.c_str(), view.GetWidth(), view.GetHeight(), view.GetMipCount());
+#endif
+		fromCache = true;
+		return true;
+	}
+	view.Close();
+
+	DecodedImage image;
+	if (!DecodePng((const unsigned char*)source.GetData(), source.GetSize(), image))
+		return false;
+	source.Close();
+
+	std::vector<unsigned char> baked;
+	TextureBakeStats stats;
+	BakeTexture(image, usage, sourceHash, baked, &stats);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Texture %s: %ux%u baked to %.1f KB in %.2f ms (mips %.2f ms)\n",
+		fileName, image.width, image.height, stats.bakedBytes / 1024.0,
+		(stats.mipSeconds + stats.compressSeconds) * 1000.0, stats.mipSeconds * 1000.0);
+#endif
+
+	// Save the bake so the next launch can map it directly
+	if (!SaveTextureCache(cachePath.c_str(), baked))
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Texture %s: could not write %s\n", fileName, cachePath.c_str());
+#endif
+	}
+
+	return view.Open(std::move(baked));
+}
+
+namespace
+{
+	// sRGB encoded byte to linear light
+	const float* GetLinearTable()
+	{
+		static float table[256];
+		static bool built = []()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float value = i / 255.f;
+				table[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+			}
+			return true;
+		}();
+		(void)built;
+		return table;
+	}
+
+	inline unsigned char ToSrgbByte(float linear)
+	{
+		linear = linear < 0 ? 0 : (linear > 1 ? 1 : linear);
+		float value = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.f / 2.4f) - 0.055f;
+		return (unsigned char)(value * 255.f + .5f);
+	}
+
+	inline unsigned char ToByte(float value)
+	{
+		value = value < 0 ? 0 : (value > 1 ? 1 : value);
+		return (unsigned char)(value * 255.f + .5f);
+	}
+}
+
+void GenerateMips(const DecodedImage& image, TextureUsage usage, std::vector<DecodedImage>& outMips)
+{
+	outMips.clear();
+	if (image.width == 0 || image.height == 0)
+		return;
+
+	// Every level is filtered from the one above it at full float precision:
+	// color in linear light, normals as unit vectors
+	const float* linear = GetLinearTable();
+	bool normals = usage == TextureUsage::NormalMap;
+
+	unsigned int width = image.width;
+	unsigned int height = image.height;
+	std::vector<float> level((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		const unsigned char* pixel = &image.pixels[i * 4];
+		for (int c = 0; c < 3; c++)
+			level[i * 4 + c] = normals ? pixel[c] / 127.5f - 1.f : linear[pixel[c]];
+		level[i * 4 + 3] = pixel[3] / 255.f;
+	}
+
+	std::vector<float> next;
+	while (width > 1 || height > 1)
+	{
+		unsigned int nextWidth = (std::max)(1u, width / 2);
+		unsigned int nextHeight = (std::max)(1u, height / 2);
+		next.assign((size_t)nextWidth * nextHeight * 4, 0.f);
+
+		DecodedImage mip;
+		mip.width = nextWidth;
+		mip.height = nextHeight;
+		mip.pixels.resize((size_t)nextWidth * nextHeight * 4);
+
+		for (unsigned int y = 0; y < nextHeight; y++)
+		{
+			unsigned int y0 = (std::min)(y * 2, height - 1);
+			unsigned int y1 = (std::min)(y * 2 + 1, height - 1);
+			for (unsigned int x = 0; x < nextWidth; x++)
+			{
+				unsigned int x0 = (std::min)(x * 2, width - 1);
+				unsigned int x1 = (std::min)(x * 2 + 1, width - 1);
+
+				float* out = &next[((size_t)y * nextWidth + x) * 4];
+				for (int c = 0; c < 4; c++)
+				{
+					out[c] = (level[((size_t)y0 * width + x0) * 4 + c] + level[((size_t)y0 * width + x1) * 4 + c] +
+						level[((size_t)y1 * width + x0) * 4 + c] + level[((size_t)y1 * width + x1) * 4 + c]) * .25f;
+				}
+
+				unsigned char* pixel = &mip.pixels[((size_t)y * nextWidth + x) * 4];
+				if (normals)
+				{
+					float length = sqrtf(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+					if (length > 1e-6f)
+					{
+						for (int c = 0; c < 3; c++)
+							out[c] /= length;
+					}
+					for (int c = 0; c < 3; c++)
+						pixel[c] = ToByte(out[c] * .5f + .5f);
+				}
+				else
+				{
+					for (int c = 0; c < 3; c++)
+						pixel[c] = ToSrgbByte(out[c]);
+				}
+				pixel[3] = ToByte(out[3]);
+			}
+		}
+
+		outMips.push_back(std::move(mip));
+		level.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+void BakeTexture(const DecodedImage& image, TextureUsage usage, uint64_t sourceHash, std::vector<unsigned char>& outFile, TextureBakeStats* outStats)
+{
+	BlockFormat format = GetBakeFormat(usage);
+
+	BakeClock::time_point start = BakeClock::now();
+	std::vector<DecodedImage> mips;
+	GenerateMips(image, usage, mips);
+	if (mips.size() + 1 > TEXTURE_MAX_MIPS)
+		mips.resize(TEXTURE_MAX_MIPS - 1);
+	double mipSeconds = std::chrono::duration<double>(BakeClock::now() - start).count();
+
+	unsigned int mipCount = (unsigned int)mips.size() + 1;
+	size_t dataOffset = 4 + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+	size_t dataSize = GetCompressedSize(format, image.width, image.height);
+	size_t uncompressedBytes = image.pixels.size();
+	for (const DecodedImage& mip : mips)
+	{
+		dataSize += GetCompressedSize(format, mip.width, mip.height);
+		uncompressedBytes += mip.pixels.size();
+	}
+
+	outFile.assign(dataOffset + dataSize, 0);
+
+	uint32_t magic = DDS_MAGIC;
+	memcpy(outFile.data(), &magic, 4);
+
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.height = image.height;
+	header.width = image.width;
+	header.pitchOrLinearSize = (uint32_t)GetCompressedSize(format, image.width, image.height);
+	header.mipMapCount = mipCount;
+	header.reserved1[0] = TEXTURE_BAKE_MAGIC;
+	header.reserved1[1] = TEXTURE_BAKE_VERSION;
+	header.reserved1[2] = (uint32_t)(sourceHash & 0xFFFFFFFF);
+	header.reserved1[3] = (uint32_t)(sourceHash >> 32);
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = DDPF_FOURCC;
+	header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+	header.caps = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	memcpy(outFile.data() + 4, &header, sizeof(header));
+
+	DDSHeaderDX10 extension = {};
+	extension.dxgiFormat = format == BlockFormat::BC1 ? TEXTURE_DXGI_BC1_UNORM : (format == BlockFormat::BC5 ? TEXTURE_DXGI_BC5_UNORM : TEXTURE_DXGI_BC7_UNORM);
+	extension.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+	extension.arraySize = 1;
+	memcpy(outFile.data() + 4 + sizeof(DDSHeader), &extension, sizeof(extension));
+
+	// Largest mip first, like every DDS
+	start = BakeClock::now();
+	unsigned char* blocks = outFile.data() + dataOffset;
+	CompressImage(format, image.pixels.data(), image.width, image.height, blocks);
+	blocks += GetCompressedSize(format, image.width, image.height);
+	for (const DecodedImage& mip : mips)
+	{
+		CompressImage(format, mip.pixels.data(), mip.width, mip.height, blocks);
+		blocks += GetCompressedSize(format, mip.width, mip.height);
+	}
+
+	if (outStats)
+	{
+		outStats->mipSeconds = mipSeconds;
+		outStats->compressSeconds = std::chrono::duration<double>(BakeClock::now() - start).count();
+		outStats->uncompressedBytes = uncompressedBytes;
+		outStats->bakedBytes = outFile.size();
+	}
+}
+
+bool SaveTextureCache(const char* cacheFileName, const std::vector<unsigned char>& file)
+{
+	// Write to a temporary file first so a crash mid-write
+	// never leaves a half baked texture behind
+	std::string tempFileName = std::string(cacheFileName) + ".tmp";
+	{
+		std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)file.data(), file.size());
+		if (!out.good())
+		{
+			out.close();
+			std::remove(tempFileName.c_str());
+			return false;
+		}
+	}
+
+	std::remove(cacheFileName);
+	return std::rename(tempFileName.c_str(), cacheFileName) == 0;
+}
+
+std::string GetTextureCachePath(const char* sourceFileName)
+{
+	std::string path(sourceFileName);
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+
+	return path + ".dds";
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// Layout of a baked texture, a standard DDS file so any
+// viewer can open it:
+//  - DDS_MAGIC
+//  - DDSHeader, with the bake's marker in reserved1
+//  - DDSHeaderDX10
+//  - Every mip, largest first, in rows of 4x4 blocks
+//
+// Bump TEXTURE_BAKE_VERSION whenever the mips or the
+// compression change, so stale bakes get redone
+// --------------------------------------------------------
+#define DDS_MAGIC 0x20534444 // "DDS "
+#define DDS_FOURCC_DX10 0x30315844 // "DX10"
+#define DDS_FOURCC_DXT1 0x31545844 // "DXT1"
+#define DDS_FOURCC_ATI2 0x32495441 // "ATI2"
+#define DDS_FOURCC_BC5U 0x55354342 // "BC5U"
+
+#define TEXTURE_BAKE_MAGIC 0x4B414253 // "SBAK"
+#define TEXTURE_BAKE_VERSION 1
+
+// The DXGI_FORMAT values of the baked formats
+#define TEXTURE_DXGI_BC1_UNORM 71
+#define TEXTURE_DXGI_BC5_UNORM 83
+#define TEXTURE_DXGI_BC7_UNORM 98
+
+// Enough for a 32768 wide texture
+#define TEXTURE_MAX_MIPS 16
+
+struct DDSPixelFormat
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t rBitMask;
+	uint32_t gBitMask;
+	uint32_t bBitMask;
+	uint32_t aBitMask;
+};
+
+struct DDSHeader
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];	// [0] TEXTURE_BAKE_MAGIC, [1] version, [2] and [3] the source hash
+	DDSPixelFormat pixelFormat;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+// --------------------------------------------------------
+// What a texture is used for decides how it's baked
+//
+// - Color: BC7, mips averaged in linear light
+// - FlatColor: BC1 at half the size of BC7, for textures
+//   of flat colors and lines
+// - NormalMap: BC5 holding x and y, mips averaged as
+//   vectors and renormalized
+// --------------------------------------------------------
+enum class TextureUsage
+{
+	Color,
+	FlatColor,
+	NormalMap
+};
+
+BlockFormat GetBakeFormat(TextureUsage usage);
+
+// --------------------------------------------------------
+// A view of a block compressed 2D DDS file, either mapped
+// from disk or held in memory. Reads the DX10 header and
+// the older DXT1 and ATI2 ones. The mip pointers point
+// straight into the data, so they're only valid while the
+// view is open.
+// --------------------------------------------------------
+class TextureCacheView
+{
+public:
+	// Returns false if the file is missing, isn't a 2D BC1, BC5 or BC7 texture or is cut short
+	bool Open(const char* fileName);
+
+	// Same for a file already in memory, the view keeps the bytes
+	bool Open(std::vector<unsigned char>&& fileBytes);
+
+	void Close();
+
+	inline bool IsOpen() const { return data != nullptr; }
+	inline unsigned int GetWidth() const { return width; }
+	inline unsigned int GetHeight() const { return height; }
+	inline unsigned int GetMipCount() const { return mipCount; }
+	inline BlockFormat GetFormat() const { return format; }
+	uint32_t GetDxgiFormat() const;
+
+	// Hash of the source the texture was baked from, 0 if it wasn't baked here
+	inline uint64_t GetSourceHash() const { return sourceHash; }
+
+	inline const unsigned char* GetMipData(unsigned int mip) const { return data + mipOffsets[mip]; }
+	inline size_t GetMipSize(unsigned int mip) const { return mipOffsets[mip + 1] - mipOffsets[mip]; }
+	inline unsigned int GetMipWidth(unsigned int mip) const { return width >> mip ? width >> mip : 1; }
+	inline unsigned int GetMipHeight(unsigned int mip) const { return height >> mip ? height >> mip : 1; }
+	size_t GetMipRowPitch(unsigned int mip) const;
+
+	// Bytes of mips from the given one down to the smallest
+	inline size_t GetMipTailSize(unsigned int mip) const { return mipOffsets[mipCount] - mipOffsets[mip]; }
+
+private:
+	bool Parse(const unsigned char* bytes, size_t size);
+
+	MappedFile file;
+	std::vector<unsigned char> memory;
+
+	const unsigned char* data = nullptr;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int mipCount = 0;
+	BlockFormat format = BlockFormat::BC1;
+	uint64_t sourceHash = 0;
+	size_t mipOffsets[TEXTURE_MAX_MIPS + 1] = {};	// From the start of data, the last is the end
+};
+
+// --------------------------------------------------------
+// Timing and size information for a single bake
+// --------------------------------------------------------
+struct TextureBakeStats
+{
+	double mipSeconds = 0;		// Building the mip chain
+	double compressSeconds = 0;	// Block compressing every mip
+	size_t uncompressedBytes = 0;	// The mip chain as RGBA
+	size_t bakedBytes = 0;		// The whole DDS file
+};
+
+// --------------------------------------------------------
+// The CPU side of loading a texture file: either opens an
+// up to date bake, or decodes the PNG, builds the mips,
+// compresses them and bakes a new DDS next to the source.
+// Touches no D3D objects, so it's safe to run on any thread.
+// --------------------------------------------------------
+class TextureSource
+{
+public:
+	bool Load(const char* fileName, TextureUsage usage);
+
+	inline const TextureCacheView& GetView() const { return view; }
+	inline bool IsFromCache() const { return fromCache; }
+
+private:
+	TextureCacheView view;
+	bool fromCache = false;
+};
+
+// Every mip below the image, from half its size down to 1x1
+void GenerateMips(const DecodedImage& image, TextureUsage usage, std::vector<DecodedImage>& outMips);
+
+// The whole DDS file for the image and its mips, compressed for the usage
+void BakeTexture(const DecodedImage& image, TextureUsage usage, uint64_t sourceHash, std::vector<unsigned char>& outFile, TextureBakeStats* outStats = nullptr);
+
+// Writes a baked file next to its source, through a temporary file
+bool SaveTextureCache(const char* cacheFileName, const std::vector<unsigned char>& file);
+
+// The cache file used for a given source file, i.e. "Textures/brick.png" -> "Textures/brick.dds"
+std::string GetTextureCachePath(const char* sourceFileName);
@@ -0,0 +1,358 @@
+#include "TextureRegistry.h"
+#include "AssetLoader.h"
+#include <algorithm>
+#include <cstdio>
+
+TextureRegistry::TextureRegistry(size_t streamingBudget)
+{
+	if (streamingBudget > 0)
+		streamer.reset(new TextureStreamer(streamingBudget));
+}
+
+TextureRegistry::~TextureRegistry()
+{
+	// The streamer writes into the entries, so it goes first
+	streamer.reset();
+
+	for (const auto& entry : entries)
+	{
+		if (entry->view)
+			entry->view->Release();
+	}
+}
+
+TextureHandle TextureRegistry::Load(AssetLoader& loader, const std::string& fileName, TextureUsage usage)
+{
+	std::string key = GetKey(fileName, usage);
+
+	TextureHandle handle;
+	auto found = pathLookup.find(key);
+	if (found != pathLookup.end())
+	{
+		handle.index = found->second;
+		handle.generation = entries[handle.index]->generation;
+		pathHits++;
+		return handle;
+	}
+
+	if (!freeSlots.empty())
+	{
+		handle.index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		handle.index = (uint32_t)entries.size();
+		entries.emplace_back(new TextureEntry());
+	}
+
+	TextureEntry& entry = *entries[handle.index];
+	entry.path = fileName;
+	entry.usage = usage;
+	entry.refCount = 0;
+	entry.alive = true;
+	entry.loading = true;
+	entry.view = nullptr;
+	entry.sourceHash = 0;
+	entry.sharedWith = UINT32_MAX;
+	handle.generation = entry.generation;
+
+	pathLookup[key] = handle.index;
+	loader.QueueTexture(fileName, usage, &entry.view, &entry.sourceHash);
+	loads++;
+	return handle;
+}
+
+void TextureRegistry::Update(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	// The entries are the streamer's targets, so the swaps are already in place
+	if (streamer)
+		streamer->Update(device, context);
+}
+
+void TextureRegistry::FinishLoads()
+{
+	// Contents and usage of every loaded texture, to spot the same texture under another name
+	std::unordered_map<uint64_t, uint32_t> loadedContents;
+	for (uint32_t i = 0; i < (uint32_t)entries.size(); i++)
+	{
+		const TextureEntry& entry = *entries[i];
+		if (entry.alive && !entry.loading && entry.view && entry.sourceHash != 0)
+			loadedContents.emplace(entry.sourceHash ^ (uint64_t)entry.usage, i);
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)entries.size(); i++)
+	{
+		TextureEntry& entry = *entries[i];
+		if (!entry.alive || !entry.loading)
+			continue;
+
+		entry.loading = false;
+		if (!entry.view)
+		{
+#if defined(DEBUG) || defined(_DEBUG)
+			printf("Texture %s failed to load\n", entry.path.c_str());
+#endif
+			continue;
+		}
+
+		// Files baked here know the hash of their contents, WIC loaded ones don't
+		if (entry.sourceHash == 0)
+			continue;
+
+		auto inserted = loadedContents.emplace(entry.sourceHash ^ (uint64_t)entry.usage, i);
+		if (inserted.second)
+			continue;
+
+		// Same contents as a texture already loaded, so drop this copy and share that one
+		uint32_t shared = inserted.first->second;
+		entries[shared]->refCount++;
+		entry.sharedWith = shared;
+
+		if (streamer)
+			streamer->Remove(&entry.view);
+		entry.view->Release();
+		entry.view = nullptr;
+		contentHits++;
+	}
+}
+
+bool TextureRegistry::IsAlive(TextureHandle handle) const
+{
+	return handle.index < entries.size() && entries[handle.index]->alive && entries[handle.index]->generation == handle.generation;
+}
+
+void TextureRegistry::AddRef(TextureHandle handle)
+{
+	if (IsAlive(handle))
+		entries[handle.index]->refCount++;
+}
+
+void TextureRegistry::Release(TextureHandle handle)
+{
+	if (IsAlive(handle))
+		ReleaseSlot(handle.index);
+}
+
+ID3D11ShaderResourceView* TextureRegistry::GetView(TextureHandle handle) const
+{
+	const TextureEntry* entry = Resolve(handle);
+	return entry ? entry->view : nullptr;
+}
+
+size_t TextureRegistry::GetGpuBytes(TextureHandle handle) const
+{
+	if (!IsAlive(handle) || !entries[handle.index]->view)
+		return 0;
+
+	ID3D11Resource* resource = nullptr;
+	entries[handle.index]->view->GetResource(&resource);
+
+	// Only 2D textures are counted, the desc of anything else has another layout
+	size_t bytes = 0;
+	D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+	resource->GetType(&dimension);
+	if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+		bytes = GetTextureBytes(desc);
+	}
+	resource->Release();
+
+	return bytes;
+}
+
+size_t TextureRegistry::EvictUnreferenced()
+{
+	size_t freedBytes = 0;
+
+	// Evicting a texture that shared another's can leave that one unreferenced, so go until nothing changes
+	bool evicted = true;
+	while (evicted)
+	{
+		evicted = false;
+		for (uint32_t i = 0; i < (uint32_t)entries.size(); i++)
+		{
+			TextureEntry& entry = *entries[i];
+			if (!entry.alive || entry.loading || entry.refCount > 0)
+				continue;
+
+			TextureHandle handle;
+			handle.index = i;
+			handle.generation = entry.generation;
+			freedBytes += GetGpuBytes(handle);
+
+			if (entry.view)
+			{
+				if (streamer)
+					streamer->Remove(&entry.view);
+				entry.view->Release();
+				entry.view = nullptr;
+			}
+
+			if (entry.sharedWith != UINT32_MAX)
+				ReleaseSlot(entry.sharedWith);
+
+			pathLookup.erase(GetKey(entry.path, entry.usage));
+			entry.path.clear();
+			entry.alive = false;
+			entry.generation++;
+			freeSlots.push_back(i);
+
+			evictions++;
+			evicted = true;
+		}
+	}
+
+	return freedBytes;
+}
+
+TextureRegistryStats TextureRegistry::GetStats() const
+{
+	TextureRegistryStats stats;
+	stats.loads = loads;
+	stats.pathHits = pathHits;
+	stats.contentHits = contentHits;
+	stats.evictions = evictions;
+
+	for (uint32_t i = 0; i < (uint32_t)entries.size(); i++)
+	{
+		const TextureEntry& entry = *entries[i];
+		if (!entry.alive)
+			continue;
+
+		stats.textures++;
+		if (entry.refCount > 0)
+			stats.referencedTextures++;
+		if (!entry.loading && !entry.view && entry.sharedWith == UINT32_MAX)
+			stats.failedLoads++;
+
+		TextureHandle handle;
+		handle.index = i;
+		handle.generation = entry.generation;
+		stats.gpuBytes += GetGpuBytes(handle);
+	}
+	return stats;
+}
+
+void TextureRegistry::PrintStats() const
+{
+	TextureRegistryStats stats = GetStats();
+	printf("Texture registry: %u textures (%u referenced), %.2f MB, %u loads, %u path hits, %u shared contents, %u failed, %u evicted\n",
+		stats.textures, stats.referencedTextures, stats.gpuBytes / 1048576.0, stats.loads, stats.pathHits,
+		stats.contentHits, stats.failedLoads, stats.evictions);
+
+	for (uint32_t i = 0; i < (uint32_t)entries.size(); i++)
+	{
+		const TextureEntry& entry = *entries[i];
+		if (!entry.alive)
+			continue;
+
+		TextureHandle handle;
+		handle.index = i;
+		handle.generation = entry.generation;
+		printf("  %8.1f KB  %2u refs  %s%s\n", GetGpuBytes(handle) / 1024.0, entry.refCount, entry.path.c_str(),
+			entry.sharedWith != UINT32_MAX ? " (shared)" : "");
+	}
+}
+
+const TextureRegistry::TextureEntry* TextureRegistry::Resolve(TextureHandle handle) const
+{
+	if (!IsAlive(handle))
+		return nullptr;
+
+	const TextureEntry* entry = entries[handle.index].get();
+	if (entry->sharedWith != UINT32_MAX)
+		entry = entries[entry->sharedWith].get();
+	return entry;
+}
+
+void TextureRegistry::ReleaseSlot(uint32_t index)
+{
+	if (entries[index]->refCount > 0)
+		entries[index]->refCount--;
+}
+
+std::string TextureRegistry::GetKey(const std::string& fileName, TextureUsage usage) const
+{
+	// One separator and no "." or ".." parts, so different spellings of a path match
+	std::vector<std::string> parts;
+	size_t start = 0;
+	while (start <= fileName.size())
+	{
+		size_t end = fileName.find_first_of("/\\", start);
+		if (end == std::string::npos)
+			end = fileName.size();
+
+		std::string part = fileName.substr(start, end - start);
+		if (part == ".." && !parts.empty() && parts.back() != ".." && !parts.back().empty())
+			parts.pop_back();
+		else if (part != "." && !(part.empty() && !parts.empty()))
+			parts.push_back(part);
+
+		start = end + 1;
+	}
+
+	std::string key;
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		if (i > 0)
+			key += '/';
+		key += parts[i];
+	}
+
+	return key + '|' + std::to_string((int)usage);
+}
+
+size_t GetTextureBytes(const D3D11_TEXTURE2D_DESC& desc)
+{
+	// Bytes per 4x4 block for block compressed formats, per pixel for the rest
+	size_t blockBytes = 0;
+	size_t pixelBytes = 4;
+	switch (desc.Format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		blockBytes = 8;
+		break;
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		blockBytes = 16;
+		break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		pixelBytes = 8;
+		break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		pixelBytes = 16;
+		break;
+	default:
+		break;
+	}
+
+	size_t bytes = 0;
+	for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+	{
+		size_t width = (std::max)(1u, desc.Width >> mip);
+		size_t height = (std::max)(1u, desc.Height >> mip);
+		if (blockBytes)
+			bytes += ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+		else
+			bytes += width * height * pixelBytes;
+	}
+	return bytes * (std::max)(1u, desc.ArraySize);
+}
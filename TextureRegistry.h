@@ -0,0 +1,130 @@
+#pragma once
+
+#include <d3d11.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+
+class AssetLoader;
+
+// --------------------------------------------------------
+// Slot in a TextureRegistry. The generation changes when a
+// slot is evicted, so stale handles can be caught.
+// --------------------------------------------------------
+struct TextureHandle
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	inline bool IsValid() const { return index != UINT32_MAX; }
+};
+
+// --------------------------------------------------------
+// Totals over every texture in a TextureRegistry
+// --------------------------------------------------------
+struct TextureRegistryStats
+{
+	unsigned int textures = 0;
+	unsigned int referencedTextures = 0;
+	unsigned int loads = 0;				// Files actually loaded
+	unsigned int pathHits = 0;			// Loads that found the file already registered
+	unsigned int contentHits = 0;		// Different files with the same contents, sharing one texture
+	unsigned int failedLoads = 0;
+	unsigned int evictions = 0;
+	size_t gpuBytes = 0;
+};
+
+// --------------------------------------------------------
+// Owns every texture the game loads
+//
+// - Loading the same file twice returns the same handle,
+//   and files whose contents hash the same share a texture
+//   once they're loaded
+// - Handles are counted references. Anything that keeps
+//   one, like a Material, calls AddRef() and Release(), and
+//   EvictUnreferenced() frees textures nobody holds.
+// - Textures stream in through the registry's own
+//   TextureStreamer, and a handle always gives the most
+//   detailed mips loaded so far
+// - Only use from the device thread
+// --------------------------------------------------------
+class TextureRegistry
+{
+public:
+	// A budget of 0 turns streaming off, every mip is uploaded on load
+	TextureRegistry(size_t streamingBudget = TEXTURE_STREAM_DEFAULT_BUDGET);
+	~TextureRegistry();
+
+	TextureRegistry(const TextureRegistry&) = delete;
+	TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+	// Queues the file on the loader unless it's already registered. The
+	// handle starts without references, the view is there after
+	// loader.LoadAll() and FinishLoads().
+	TextureHandle Load(AssetLoader& loader, const std::string& fileName, TextureUsage usage);
+
+	// Call after loader.LoadAll(), counts failures and merges textures with the same contents
+	void FinishLoads();
+
+	// Hand this to loader.LoadAll(), null when streaming is off
+	inline TextureStreamer* GetStreamer() const { return streamer.get(); }
+
+	// Streams in mips, call once a frame
+	void Update(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	bool IsAlive(TextureHandle handle) const;
+	void AddRef(TextureHandle handle);
+	void Release(TextureHandle handle);
+
+	// Null for dead handles and textures that didn't load
+	ID3D11ShaderResourceView* GetView(TextureHandle handle) const;
+
+	// GPU memory of the texture's resident mips, 0 for a texture sharing another's
+	size_t GetGpuBytes(TextureHandle handle) const;
+
+	// Frees every texture without references, returns the bytes freed
+	size_t EvictUnreferenced();
+
+	TextureRegistryStats GetStats() const;
+	void PrintStats() const;
+
+private:
+	struct TextureEntry
+	{
+		std::string path;
+		TextureUsage usage = TextureUsage::Color;
+		uint32_t generation = 0;
+		uint32_t refCount = 0;
+		bool alive = false;
+		bool loading = false;
+
+		// The loader and the streamer write the view here, so the entry never moves
+		ID3D11ShaderResourceView* view = nullptr;
+		uint64_t sourceHash = 0;
+
+		// Slot holding the texture when the contents matched another file's, which this references
+		uint32_t sharedWith = UINT32_MAX;
+	};
+
+	const TextureEntry* Resolve(TextureHandle handle) const;
+	void ReleaseSlot(uint32_t index);
+	std::string GetKey(const std::string& fileName, TextureUsage usage) const;
+
+	std::unique_ptr<TextureStreamer> streamer;
+
+	std::vector<std::unique_ptr<TextureEntry>> entries;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<std::string, uint32_t> pathLookup;
+
+	unsigned int loads = 0;
+	unsigned int pathHits = 0;
+	unsigned int contentHits = 0;
+	unsigned int evictions = 0;
+};
+
+// Bytes of a texture's mips, from its description
+size_t GetTextureBytes(const D3D11_TEXTURE2D_DESC& desc);
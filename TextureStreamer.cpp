@@ -0,0 +1,277 @@
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using Microsoft::WRL::ComPtr;
+
+TextureStreamer::TextureStreamer(size_t budgetBytes)
+	: budget(budgetBytes)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Reads copy into the entries, so they have to finish first
+	for (const auto& entry : textures)
+		JobSystem::Get().Wait(&entry->readCounter);
+}
+
+HRESULT TextureStreamer::Add(ID3D11Device* device, std::unique_ptr<TextureSource> source, ID3D11ShaderResourceView** target)
+{
+	const TextureCacheView& view = source->GetView();
+	if (!view.IsOpen())
+		return E_INVALIDARG;
+
+	// Start at the largest mip that fits in the start size. Block
+	// compressed textures need a top mip that's whole blocks wide.
+	unsigned int startMip = 0;
+	while (startMip + 1 < view.GetMipCount() && (std::max)(view.GetMipWidth(startMip), view.GetMipHeight(startMip)) > TEXTURE_STREAM_START_SIZE)
+		startMip++;
+	while (startMip > 0 && (view.GetMipWidth(startMip) % 4 || view.GetMipHeight(startMip) % 4))
+		startMip--;
+
+	if (view.GetMipWidth(startMip) % 4 || view.GetMipHeight(startMip) % 4)
+		return E_INVALIDARG;
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = view.GetMipWidth(startMip);
+	textureDesc.Height = view.GetMipHeight(startMip);
+	textureDesc.MipLevels = view.GetMipCount() - startMip;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = (DXGI_FORMAT)view.GetDxgiFormat();
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initialData[TEXTURE_MAX_MIPS] = {};
+	for (unsigned int mip = startMip; mip < view.GetMipCount(); mip++)
+	{
+		initialData[mip - startMip].pSysMem = view.GetMipData(mip);
+		initialData[mip - startMip].SysMemPitch = (UINT)view.GetMipRowPitch(mip);
+	}
+
+	std::unique_ptr<StreamedTexture> entry(new StreamedTexture());
+	HRESULT hr = device->CreateTexture2D(&textureDesc, initialData, entry->texture.GetAddressOf());
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(entry->texture.Get(), nullptr, entry->view.GetAddressOf());
+	if (FAILED(hr))
+		return hr;
+
+	entry->target = target;
+	entry->residentMip = startMip;
+	entry->lowestMip = startMip;
+	residentBytes += view.GetMipTailSize(startMip);
+
+	*target = entry->view.Get();
+	(*target)->AddRef();
+
+	entry->source = std::move(source);
+	textures.push_back(std::move(entry));
+	return S_OK;
+}
+
+void TextureStreamer::Remove(ID3D11ShaderResourceView** target)
+{
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		StreamedTexture& entry = *textures[i];
+		if (entry.target != target)
+			continue;
+
+		// A read still copies into the entry
+		JobSystem::Get().Wait(&entry.readCounter);
+		if (entry.reading)
+			readingBytes -= entry.mipBytes.size();
+
+		residentBytes -= entry.source->GetView().GetMipTailSize(entry.residentMip);
+		textures.erase(textures.begin() + i);
+		return;
+	}
+}
+
+const std::vector<TextureSwap>& TextureStreamer::Update(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	// Nothing still points at the views swapped out last time
+	swaps.clear();
+	retiredViews.clear();
+
+	// Upload the reads that are done, oldest textures first
+	unsigned int uploads = 0;
+	for (const auto& entry : textures)
+	{
+		if (uploads >= TEXTURE_STREAM_UPLOADS_PER_FRAME)
+			break;
+		if (!entry->reading || !entry->readCounter.IsDone())
+			continue;
+
+		entry->reading = false;
+		readingBytes -= entry->mipBytes.size();
+
+		size_t mipSize = entry->mipBytes.size();
+		if (residentBytes + mipSize <= budget &&
+			SUCCEEDED(Rebuild(device, context, *entry, entry->residentMip - 1, entry->mipBytes.data())))
+		{
+			mipsStreamed++;
+			uploads++;
+		}
+
+		entry->mipBytes.clear();
+		entry->mipBytes.shrink_to_fit();
+	}
+
+	TrimToBudget(device, context);
+	StartReads();
+	return swaps;
+}
+
+void TextureStreamer::SetBudget(size_t budgetBytes)
+{
+	budget = budgetBytes;
+}
+
+bool TextureStreamer::IsIdle() const
+{
+	for (const auto& entry : textures)
+	{
+		if (entry->reading)
+			return false;
+	}
+
+	for (const auto& entry : textures)
+	{
+		if (entry->residentMip > 0 && residentBytes + entry->source->GetView().GetMipSize(entry->residentMip - 1) <= budget)
+			return false;
+	}
+	return true;
+}
+
+void TextureStreamer::PrintStats() const
+{
+	printf("Texture streaming: %zu textures, %.2f of %.2f MB resident, %u mips streamed in, %u dropped\n",
+		textures.size(), residentBytes / 1048576.0, budget / 1048576.0, mipsStreamed, mipsDropped);
+	for (const auto& entry : textures)
+	{
+		const TextureCacheView& view = entry->source->GetView();
+		printf("  %4ux%-4u of %4ux%-4u %s\n",
+			view.GetMipWidth(entry->residentMip), view.GetMipHeight(entry->residentMip),
+			view.GetWidth(), view.GetHeight(), entry->reading ? "(reading)" : "");
+	}
+}
+
+HRESULT TextureStreamer::Rebuild(ID3D11Device* device, ID3D11DeviceContext* context, StreamedTexture& entry, unsigned int newTopMip, const unsigned char* newMipBytes)
+{
+	const TextureCacheView& view = entry.source->GetView();
+
+	D3D11_TEXTURE2D_DESC textureDesc;
+	entry.texture->GetDesc(&textureDesc);
+	textureDesc.Width = view.GetMipWidth(newTopMip);
+	textureDesc.Height = view.GetMipHeight(newTopMip);
+	textureDesc.MipLevels = view.GetMipCount() - newTopMip;
+
+	ComPtr<ID3D11Texture2D> texture;
+	ComPtr<ID3D11ShaderResourceView> newView;
+	HRESULT hr = device->CreateTexture2D(&textureDesc, nullptr, texture.GetAddressOf());
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(texture.Get(), nullptr, newView.GetAddressOf());
+	if (FAILED(hr))
+		return hr;
+
+	// Mips both textures share are copied on the GPU, only a new top mip comes from memory
+	unsigned int firstShared = (std::max)(newTopMip, entry.residentMip);
+	for (unsigned int mip = firstShared; mip < view.GetMipCount(); mip++)
+		context->CopySubresourceRegion(texture.Get(), mip - newTopMip, 0, 0, 0, entry.texture.Get(), mip - entry.residentMip, nullptr);
+
+	if (newTopMip < entry.residentMip)
+		context->UpdateSubresource(texture.Get(), 0, nullptr, newMipBytes, (UINT)view.GetMipRowPitch(newTopMip), 0);
+
+	residentBytes -= view.GetMipTailSize(entry.residentMip);
+	residentBytes += view.GetMipTailSize(newTopMip);
+	entry.residentMip = newTopMip;
+
+	// Hand the target's reference over to the new view
+	TextureSwap swap;
+	swap.oldView = entry.view.Get();
+	swap.newView = newView.Get();
+	swaps.push_back(swap);
+
+	newView->AddRef();
+	(*entry.target)->Release();
+	*entry.target = newView.Get();
+
+	retiredViews.push_back(entry.view);
+	entry.view = newView;
+	entry.texture = texture;
+	return S_OK;
+}
+
+void TextureStreamer::StartReads()
+{
+	unsigned int reads = 0;
+	for (const auto& entry : textures)
+	{
+		if (entry->reading)
+			reads++;
+	}
+
+	while (reads < TEXTURE_STREAM_MAX_REQUESTS)
+	{
+		// The coarsest texture whose next mip still fits goes first, the cheaper one of equals
+		StreamedTexture* next = nullptr;
+		size_t nextSize = 0;
+		for (const auto& entry : textures)
+		{
+			if (entry->reading || entry->residentMip == 0)
+				continue;
+
+			const TextureCacheView& view = entry->source->GetView();
+			size_t size = view.GetMipSize(entry->residentMip - 1);
+			if (residentBytes + readingBytes + size > budget)
+				continue;
+
+			if (!next || entry->residentMip > next->residentMip || (entry->residentMip == next->residentMip && size < nextSize))
+			{
+				next = entry.get();
+				nextSize = size;
+			}
+		}
+		if (!next)
+			break;
+
+		// The copy is what pages the mip in from the mapped file, so it stays off this thread
+		next->reading = true;
+		next->mipBytes.resize(nextSize);
+		readingBytes += nextSize;
+		reads++;
+
+		StreamedTexture* entry = next;
+		JobSystem::Get().Run([entry]()
+		{
+			const TextureCacheView& view = entry->source->GetView();
+			memcpy(entry->mipBytes.data(), view.GetMipData(entry->residentMip - 1), entry->mipBytes.size());
+		}, &entry->readCounter);
+	}
+}
+
+void TextureStreamer::TrimToBudget(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	// Drop the top mip of the most detailed texture until everything fits
+	while (residentBytes > budget)
+	{
+		StreamedTexture* largest = nullptr;
+		for (const auto& entry : textures)
+		{
+			if (entry->reading || entry->residentMip >= entry->lowestMip)
+				continue;
+
+			if (!largest || entry->residentMip < largest->residentMip)
+				largest = entry.get();
+		}
+
+		if (!largest || FAILED(Rebuild(device, context, *largest, largest->residentMip + 1, nullptr)))
+			break;
+
+		mipsDropped++;
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "JobSystem.h"
+
+class TextureSource;
+
+// Textures start out with the mips up to this size, the rest stream in
+#define TEXTURE_STREAM_START_SIZE 64
+
+// Default budget for every streamed texture's resident mips
+#define TEXTURE_STREAM_DEFAULT_BUDGET (32 * 1024 * 1024)
+
+// Mip reads in flight at once, and uploads done in a single Update()
+#define TEXTURE_STREAM_MAX_REQUESTS 4
+#define TEXTURE_STREAM_UPLOADS_PER_FRAME 2
+
+// --------------------------------------------------------
+// A view that Update() replaced, anything holding oldView
+// should switch to newView. oldView stays alive until the
+// next Update().
+// --------------------------------------------------------
+struct TextureSwap
+{
+	ID3D11ShaderResourceView* oldView;
+	ID3D11ShaderResourceView* newView;
+};
+
+// --------------------------------------------------------
+// Streams the mips of baked textures onto the GPU
+//
+// - Add() creates a texture holding only the small mips,
+//   so a texture is usable right after loading
+// - Each Update() reads the next larger mip of a few
+//   textures on the JobSystem, then uploads the ones that
+//   are ready into a new texture one mip larger, copying
+//   the old mips over on the GPU
+// - The coarsest textures refine first, so detail grows
+//   evenly across the scene, and nothing streams in past
+//   the memory budget. Lowering the budget drops the top
+//   mips of the most detailed textures.
+//
+// Every texture writes its view to the target given to
+// Add(). The target owns one reference, which moves to the
+// new view on every swap, so whoever owns the target still
+// releases it. Only use from the device thread.
+// --------------------------------------------------------
+class TextureStreamer
+{
+public:
+	TextureStreamer(size_t budgetBytes = TEXTURE_STREAM_DEFAULT_BUDGET);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Takes over a loaded source and creates its texture from the small mips
+	HRESULT Add(ID3D11Device* device, std::unique_ptr<TextureSource> source, ID3D11ShaderResourceView** target);
+
+	// Stops streaming the texture written to target, the target keeps its view
+	void Remove(ID3D11ShaderResourceView** target);
+
+	// Uploads finished mips, starts new reads and returns the views swapped this call
+	const std::vector<TextureSwap>& Update(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	void SetBudget(size_t budgetBytes);
+	inline size_t GetBudget() const { return budget; }
+	inline size_t GetResidentBytes() const { return residentBytes; }
+
+	// True once every texture is fully resident or held back by the budget
+	bool IsIdle() const;
+
+	void PrintStats() const;
+
+private:
+	struct StreamedTexture
+	{
+		std::unique_ptr<TextureSource> source;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+		ID3D11ShaderResourceView** target = nullptr;
+
+		unsigned int residentMip = 0;	// Most detailed mip on the GPU
+		unsigned int lowestMip = 0;	// The mip it started at, never dropped below
+		bool reading = false;
+		std::vector<unsigned char> mipBytes;	// The next mip once the read is done
+		JobCounter readCounter;
+	};
+
+	// Rebuilds a texture's resource to start at newTopMip, newMipBytes is the new top mip if it's larger
+	HRESULT Rebuild(ID3D11Device* device, ID3D11DeviceContext* context, StreamedTexture& entry, unsigned int newTopMip, const unsigned char* newMipBytes);
+
+	void StartReads();
+	void TrimToBudget(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	std::vector<std::unique_ptr<StreamedTexture>> textures;
+	std::vector<TextureSwap> swaps;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> retiredViews;
+
+	size_t budget;
+	size_t residentBytes = 0;
+	size_t readingBytes = 0;
+	unsigned int mipsStreamed = 0;
+	unsigned int mipsDropped = 0;
+};
@@ -0,0 +1,30 @@
+cbuffer externalData : register(b0)
+{
+	float exposure;
+	float bloomIntensity;	// 0 when there's no bloom
+}
+
+// Defines the input to this pixel shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+Texture2D pixels			: register(t0);
+Texture2D bloom				: register(t1);
+SamplerState samplerOptions	: register(s0);
+
+// Narkowicz's fit of the ACES filmic curve
+float3 ACESFilm(float3 x)
+{
+	return saturate((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f));
+}
+
+// Adds the bloom back in and maps the HDR scene to the 0-1 range
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float3 color = pixels.Sample(samplerOptions, input.uv).rgb;
+	color += bloom.Sample(samplerOptions, input.uv).rgb * bloomIntensity;
+	return float4(ACESFilm(color * exposure), 1.0f);
+}
@@ -1,63 +1,118 @@
 #include "Transform.h"
+#include <cassert>
+#include <cmath>
+#include <algorithm>
 
 
 using namespace DirectX;
 
-Transform::Transform()
+Transform::Transform(TransformSystem& system)
 {
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	localScale = XMFLOAT3(1,1,1);
-	worldPosition = XMFLOAT3(0,0,0);
-	rotation = XMFLOAT3(0,0,0);
-	quaternionRotation = XMFLOAT4(0,0,0,1);
+	this->system = &system;
+	handle = system.Create();
+}
+
+Transform::~Transform()
+{
+	system->Destroy(handle);
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
-	worldPosition = XMFLOAT3(x, y, z);
+	system->Position(handle) = XMFLOAT3(x, y, z);
 	MarkAsDirty();
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
-	rotation = XMFLOAT3(pitch, yaw, roll);
-	XMStoreFloat4(&quaternionRotation, XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
-	MarkAsDirty();
+	StoreRotation(XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+}
+
+void Transform::SetRotationQuaternion(const DirectX::XMFLOAT4& quaternion)
+{
+	StoreRotation(XMLoadFloat4(&quaternion));
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	localScale = XMFLOAT3(x, y, z);
+	system->Scale(handle) = XMFLOAT3(x, y, z);
 	MarkAsDirty();
 }
 
 DirectX::XMFLOAT3 Transform::GetPosition() const
 {
-	return worldPosition;
+	return system->Position(handle);
 }
 
 DirectX::XMFLOAT3 Transform::GetPitchYawRoll() const
 {
-	return rotation;
+	// Pull the angles back out of the rotation matrix,
+	// the forward row is (sin y cos p, -sin p, cos y cos p)
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixRotationQuaternion(XMLoadFloat4(&system->Rotation(handle))));
+
+	float pitch = asinf(-(std::max)(-1.f, (std::min)(1.f, m._32)));
+	float yaw = atan2f(m._31, m._33);
+	float roll = atan2f(m._12, m._22);
+	return XMFLOAT3(pitch, yaw, roll);
+}
+
+DirectX::XMFLOAT4 Transform::GetRotationQuaternion() const
+{
+	return system->Rotation(handle);
+}
+
+DirectX::XMFLOAT3 Transform::GetForward()
+{
+	return system->GetForward(handle);
+}
+
+DirectX::XMFLOAT3 Transform::GetRight()
+{
+	return system->GetRight(handle);
+}
+
+DirectX::XMFLOAT3 Transform::GetUp()
+{
+	return system->GetUp(handle);
 }
 
 DirectX::XMFLOAT3 Transform::GetScale() const
 {
-	return localScale;
+	return system->Scale(handle);
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	if(isDirty) 
-	{
-		CalculateWorldMatrix();
-		isDirty = false;
-	}
-	return worldMatrix;
+	return system->GetWorldMatrix(handle);
+}
+
+DirectX::XMFLOAT3 Transform::GetWorldPosition()
+{
+	const XMFLOAT4X4& world = system->GetWorldMatrix(handle);
+	return XMFLOAT3(world._41, world._42, world._43);
+}
+
+DirectX::XMFLOAT4X4 Transform::GetRenderMatrix()
+{
+	return system->GetRenderMatrix(handle);
+}
+
+DirectX::XMFLOAT3 Transform::GetRenderPosition()
+{
+	const XMFLOAT4X4& world = system->GetRenderMatrix(handle);
+	return XMFLOAT3(world._41, world._42, world._43);
+}
+
+void Transform::SetParent(Transform* parent)
+{
+	assert(parent == nullptr || parent->system == system);
+	system->SetParent(handle, parent ? parent->handle : TransformHandle());
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
+	XMFLOAT3& worldPosition = system->Position(handle);
 	worldPosition.x += x;
 	worldPosition.y += y;
 	worldPosition.z += z;
@@ -67,11 +122,12 @@ void Transform::MoveAbsolute(float x, float y, float z)
 
 void Transform::MoveRelative(float x, float y, float z)
 {
-	// rotate the direction by the orientation of the object
-	DirectX::XMVECTOR translation = DirectX::XMVectorSet(x, y, z, 0);
-	DirectX::XMVECTOR rot = DirectX::XMQuaternionRotationRollPitchYawFromVector(DirectX::XMLoadFloat3(&rotation));
-	
-	DirectX::XMVECTOR dir = DirectX::XMVector3Rotate(translation, rot);
+	XMFLOAT3& worldPosition = system->Position(handle);
+
+	// move along the cached axes of the object
+	DirectX::XMVECTOR dir = XMVectorScale(XMLoadFloat3(&system->GetRight(handle)), x);
+	dir = XMVectorMultiplyAdd(XMLoadFloat3(&system->GetUp(handle)), XMVectorReplicate(y), dir);
+	dir = XMVectorMultiplyAdd(XMLoadFloat3(&system->GetForward(handle)), XMVectorReplicate(z), dir);
 
 	XMStoreFloat3(&worldPosition, XMLoadFloat3(&worldPosition) + dir);
 
@@ -80,15 +136,27 @@ void Transform::MoveRelative(float x, float y, float z)
 
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
-	rotation.x += pitch;
-	rotation.y += yaw;
-	rotation.z += roll;
+	// roll and pitch go before the current rotation, yaw after it
+	XMVECTOR local = XMQuaternionRotationRollPitchYaw(pitch, 0, roll);
+	XMVECTOR world = XMQuaternionRotationRollPitchYaw(0, yaw, 0);
+	XMVECTOR current = XMLoadFloat4(&system->Rotation(handle));
 
-	MarkAsDirty();
+	StoreRotation(XMQuaternionMultiply(XMQuaternionMultiply(local, current), world));
+}
+
+void Transform::RotateLocal(const DirectX::XMFLOAT4& quaternion)
+{
+	StoreRotation(XMQuaternionMultiply(XMLoadFloat4(&quaternion), XMLoadFloat4(&system->Rotation(handle))));
+}
+
+void Transform::RotateWorld(const DirectX::XMFLOAT4& quaternion)
+{
+	StoreRotation(XMQuaternionMultiply(XMLoadFloat4(&system->Rotation(handle)), XMLoadFloat4(&quaternion)));
 }
 
 void Transform::Scale(float x, float y, float z)
 {
+	XMFLOAT3& localScale = system->Scale(handle);
 	localScale.x *= x;
 	localScale.y *= y;
 	localScale.z *= z;
@@ -96,28 +164,19 @@ void Transform::Scale(float x, float y, float z)
 	MarkAsDirty();
 }
 
+void Transform::StoreRotation(DirectX::FXMVECTOR quaternion)
+{
+	// renormalized every time so small errors don't build up over many rotations
+	XMStoreFloat4(&system->Rotation(handle), XMQuaternionNormalize(quaternion));
+	system->MarkRotationDirty(handle);
+}
+
 float Transform::DistanceSquaredTo(DirectX::XMFLOAT3 position)
 {
 	DirectX::XMVECTOR vec1 = DirectX::XMLoadFloat3(&position);
-	DirectX::XMVECTOR vec2 = DirectX::XMLoadFloat3(&this->worldPosition);
+	DirectX::XMVECTOR vec2 = DirectX::XMLoadFloat3(&system->Position(handle));
 	DirectX::XMVECTOR vec3 = DirectX::XMVectorSubtract(vec1, vec2);
 	float distSqrd;
 	DirectX::XMStoreFloat(&distSqrd, DirectX::XMVector3LengthSq(vec3));
 	return distSqrd;
 }
-
-void Transform::CalculateWorldMatrix()
-{
-	//create the translation matrix
-	DirectX::XMMATRIX tranM = DirectX::XMMatrixTranslation(worldPosition.x, worldPosition.y, worldPosition.z);
-
-	// create the rotation matrix
-	DirectX::XMMATRIX rotM = DirectX::XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-
-	//create the scale matrix
-	DirectX::XMMATRIX scaleM = DirectX::XMMatrixScaling(localScale.x, localScale.y, localScale.z);
-
-	DirectX::XMMATRIX world = scaleM * rotM * tranM; // is this in simd?
-
-	XMStoreFloat4x4(&worldMatrix, world);
-}
@@ -1,42 +1,72 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include "TransformSystem.h"
 
+// --------------------------------------------------------
+// Proxy for one slot in a TransformSystem, the data itself
+// lives in the system's arrays. Frees its slot when
+// destroyed, so it can't be copied.
+// --------------------------------------------------------
 class Transform 
 {
 public:
-	Transform();
-	~Transform() = default;
+	Transform(TransformSystem& system = TransformSystem::Get());
+	~Transform();
+
+	Transform(const Transform&) = delete;
+	Transform& operator=(const Transform&) = delete;
 
 	void SetPosition(float x, float y, float z);
 	void SetRotation(float pitch, float yaw, float roll);
+	void SetRotationQuaternion(const DirectX::XMFLOAT4& quaternion);
 	void SetScale(float x, float y, float z);
 
+	// Position, rotation and scale are relative to the parent, if there is one
 	DirectX::XMFLOAT3 GetPosition() const;
-	DirectX::XMFLOAT3 GetPitchYawRoll() const;
+	DirectX::XMFLOAT3 GetPitchYawRoll() const;		// Derived from the quaternion, prefer the basis vectors
+	DirectX::XMFLOAT4 GetRotationQuaternion() const;
 	DirectX::XMFLOAT3 GetScale() const;
 
+	// Local axes, cached until the rotation changes
+	DirectX::XMFLOAT3 GetForward();
+	DirectX::XMFLOAT3 GetRight();
+	DirectX::XMFLOAT3 GetUp();
+
 	// will recalculate the world matrix if is dirty
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
+	DirectX::XMFLOAT3 GetWorldPosition();
+
+	// Where the renderer shows this, blended between the last two ticks
+	DirectX::XMFLOAT4X4 GetRenderMatrix();
+	DirectX::XMFLOAT3 GetRenderPosition();
+
+	// Makes this a child of parent, nullptr makes it a root again.
+	// The local values are kept, so the world matrix changes.
+	void SetParent(Transform* parent);
 
 	void MoveAbsolute(float x, float y, float z);
 	void MoveRelative(float x,float y,float z);
+	// Pitch and roll turn around the local axes and yaw around world up,
+	// the same as adding to the euler angles while there's no roll
 	void Rotate(float pitch, float yaw, float roll);
+	void RotateLocal(const DirectX::XMFLOAT4& quaternion);
+	void RotateWorld(const DirectX::XMFLOAT4& quaternion);
 	void Scale(float x, float y, float z);
 
 	float DistanceSquaredTo(DirectX::XMFLOAT3 position);
 
-private:
+	// Goes up every time the transform changes, lets anything derived
+	// from the world matrix tell when it needs rebuilding
+	inline unsigned int GetRevision() const { return system->GetRevision(handle); }
 
-	void MarkAsDirty(){isDirty=true;}
-	void CalculateWorldMatrix();
+	inline TransformHandle GetHandle() const { return handle; }
 
-	bool isDirty = false;
+private:
 
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT3 worldPosition;
-	DirectX::XMFLOAT3 localScale;
+	void MarkAsDirty(){system->MarkDirty(handle);}
+	void StoreRotation(DirectX::FXMVECTOR quaternion);
 
-	DirectX::XMFLOAT3 rotation;
-	DirectX::XMFLOAT4 quaternionRotation;
-};
\ No newline at end of file
+	TransformSystem* system;
+	TransformHandle handle;
+};
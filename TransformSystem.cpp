@@ -0,0 +1,382 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <cassert>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Slots per task when a level of the sweep is split across threads
+#define TRANSFORM_SWEEP_CHUNK 4096
+
+TransformSystem& TransformSystem::Get()
+{
+	static TransformSystem system;
+	return system;
+}
+
+TransformHandle TransformSystem::Create()
+{
+	std::lock_guard<std::mutex> lock(slotMutex);
+
+	TransformHandle handle;
+	if (!freeSlots.empty())
+	{
+		handle.index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		handle.index = (uint32_t)positions.size();
+		positions.emplace_back();
+		rotations.emplace_back();
+		scales.emplace_back();
+		worldMatrices.emplace_back();
+		forwards.emplace_back();
+		rights.emplace_back();
+		ups.emplace_back();
+		parents.push_back(TRANSFORM_NO_PARENT);
+		childCounts.push_back(0);
+		dirty.push_back(0);
+		basisDirty.push_back(0);
+		updated.push_back(0);
+		alive.push_back(0);
+		revisions.push_back(0);
+		generations.push_back(0);
+	}
+	handle.generation = generations[handle.index];
+
+	positions[handle.index] = XMFLOAT3(0, 0, 0);
+	rotations[handle.index] = XMFLOAT4(0, 0, 0, 1);
+	scales[handle.index] = XMFLOAT3(1, 1, 1);
+	XMStoreFloat4x4(&worldMatrices[handle.index], XMMatrixIdentity());
+	forwards[handle.index] = XMFLOAT3(0, 0, 1);
+	rights[handle.index] = XMFLOAT3(1, 0, 0);
+	ups[handle.index] = XMFLOAT3(0, 1, 0);
+	basisDirty[handle.index] = 0;
+	parents[handle.index] = TRANSFORM_NO_PARENT;
+	childCounts[handle.index] = 0;
+	dirty[handle.index] = 0;
+	updated[handle.index] = 0;
+	alive[handle.index] = 1;
+
+	orderChanged = true;
+	return handle;
+}
+
+void TransformSystem::Destroy(TransformHandle handle)
+{
+	std::lock_guard<std::mutex> lock(slotMutex);
+
+	assert(handle.IsValid() && generations[handle.index] == handle.generation);
+	uint32_t index = handle.index;
+
+	// Orphans become roots, keeping their local values
+	if (childCounts[index] > 0)
+	{
+		for (uint32_t i = 0; i < (uint32_t)parents.size(); i++)
+		{
+			if (parents[i] == index)
+			{
+				parents[i] = TRANSFORM_NO_PARENT;
+				dirty[i] = 1;
+				revisions[i]++;
+			}
+		}
+	}
+
+	if (parents[index] != TRANSFORM_NO_PARENT)
+	{
+		childCounts[parents[index]]--;
+	}
+
+	generations[index]++;
+	parents[index] = TRANSFORM_NO_PARENT;
+	childCounts[index] = 0;
+	dirty[index] = 0;
+	alive[index] = 0;
+	freeSlots.push_back(index);
+
+	orderChanged = true;
+}
+
+bool TransformSystem::IsAlive(TransformHandle handle) const
+{
+	return handle.index < generations.size() && generations[handle.index] == handle.generation;
+}
+
+void TransformSystem::SetParent(TransformHandle child, TransformHandle parent)
+{
+	assert(IsAlive(child) && (!parent.IsValid() || IsAlive(parent)));
+
+	uint32_t newParent = parent.IsValid() ? parent.index : TRANSFORM_NO_PARENT;
+	uint32_t oldParent = parents[child.index];
+	if (newParent == oldParent)
+		return;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// A transform can't end up below itself
+	for (uint32_t i = newParent; i != TRANSFORM_NO_PARENT; i = parents[i])
+	{
+		assert(i != child.index);
+	}
+#endif
+
+	if (oldParent != TRANSFORM_NO_PARENT)
+	{
+		childCounts[oldParent]--;
+	}
+	if (newParent != TRANSFORM_NO_PARENT)
+	{
+		childCounts[newParent]++;
+	}
+
+	parents[child.index] = newParent;
+	MarkDirty(child);
+	orderChanged = true;
+}
+
+TransformHandle TransformSystem::GetParent(TransformHandle handle) const
+{
+	TransformHandle parent;
+	uint32_t index = parents[handle.index];
+	if (index != TRANSFORM_NO_PARENT)
+	{
+		parent.index = index;
+		parent.generation = generations[index];
+	}
+	return parent;
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldMatrix(TransformHandle handle)
+{
+	// Everything from the highest dirty ancestor down is stale
+	bool stale = false;
+	uint32_t staleHeight = 0;
+	uint32_t height = 0;
+	for (uint32_t i = handle.index; i != TRANSFORM_NO_PARENT; i = parents[i], height++)
+	{
+		if (dirty[i])
+		{
+			stale = true;
+			staleHeight = height;
+		}
+	}
+
+	if (stale)
+	{
+		// Top down along the chain. The dirty bits are left for the
+		// sweep, so the rest of the stale subtrees still get updated.
+		for (uint32_t h = staleHeight + 1; h-- > 0;)
+		{
+			uint32_t i = handle.index;
+			for (uint32_t up = 0; up < h; up++)
+			{
+				i = parents[i];
+			}
+			CalculateWorldMatrix(i);
+		}
+	}
+
+	return worldMatrices[handle.index];
+}
+
+void TransformSystem::CopyWorldMatrices(std::vector<XMFLOAT4X4>& matrices) const
+{
+	matrices.assign(worldMatrices.begin(), worldMatrices.end());
+}
+
+void TransformSystem::SwapRenderMatrices(std::vector<XMFLOAT4X4>& matrices)
+{
+	renderMatrices.swap(matrices);
+}
+
+const XMFLOAT4X4& TransformSystem::GetRenderMatrix(TransformHandle handle) const
+{
+	// Never the live matrix, the simulation thread may be writing it
+	static const XMFLOAT4X4 identity(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+	if (handle.index < renderMatrices.size())
+		return renderMatrices[handle.index];
+	return identity;
+}
+
+const XMFLOAT3& TransformSystem::GetForward(TransformHandle handle)
+{
+	UpdateBasis(handle.index);
+	return forwards[handle.index];
+}
+
+const XMFLOAT3& TransformSystem::GetRight(TransformHandle handle)
+{
+	UpdateBasis(handle.index);
+	return rights[handle.index];
+}
+
+const XMFLOAT3& TransformSystem::GetUp(TransformHandle handle)
+{
+	UpdateBasis(handle.index);
+	return ups[handle.index];
+}
+
+void TransformSystem::UpdateBasis(uint32_t index)
+{
+	if (!basisDirty[index])
+		return;
+
+	// The rows of the rotation matrix are the rotated axes
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[index]));
+	XMStoreFloat3(&rights[index], rotation.r[0]);
+	XMStoreFloat3(&ups[index], rotation.r[1]);
+	XMStoreFloat3(&forwards[index], rotation.r[2]);
+
+	basisDirty[index] = 0;
+}
+
+void TransformSystem::UpdateWorldMatrices()
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	stats = TransformSystemStats();
+
+	if (orderChanged)
+	{
+		RebuildOrder();
+		orderChanged = false;
+	}
+
+	// Levels have to run in order, but the slots within one don't depend on each other
+	uint32_t levels = (uint32_t)levelStarts.size() - 1;
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		uint32_t levelBegin = levelStarts[level];
+		uint32_t levelEnd = levelStarts[level + 1];
+
+		if (levelEnd - levelBegin <= TRANSFORM_SWEEP_CHUNK)
+		{
+			UpdateRange(levelBegin, levelEnd, stats);
+			continue;
+		}
+
+		// Each task owns its chunk, the stats are only summed up afterwards
+		uint32_t chunks = (levelEnd - levelBegin + TRANSFORM_SWEEP_CHUNK - 1) / TRANSFORM_SWEEP_CHUNK;
+		std::vector<TransformSystemStats> chunkStats(chunks);
+
+		JobCounter levelJobs;
+		JobSystem::Get().ParallelFor(levelEnd - levelBegin, TRANSFORM_SWEEP_CHUNK, [&](uint32_t begin, uint32_t end)
+		{
+			UpdateRange(levelBegin + begin, levelBegin + end, chunkStats[begin / TRANSFORM_SWEEP_CHUNK]);
+		}, &levelJobs);
+		JobSystem::Get().Wait(&levelJobs);
+
+		for (const TransformSystemStats& local : chunkStats)
+		{
+			stats.matricesUpdated += local.matricesUpdated;
+			stats.inheritedUpdates += local.inheritedUpdates;
+			stats.dirtyRuns += local.dirtyRuns;
+		}
+	}
+
+	stats.hierarchyDepth = levels;
+	stats.sweepSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void TransformSystem::RebuildOrder()
+{
+	uint32_t count = (uint32_t)positions.size();
+	std::vector<uint32_t> depths(count, 0);
+	std::vector<uint32_t> levelCounts;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!alive[i])
+			continue;
+
+		uint32_t depth = 0;
+		for (uint32_t p = parents[i]; p != TRANSFORM_NO_PARENT; p = parents[p])
+		{
+			depth++;
+		}
+
+		depths[i] = depth;
+		if (depth >= levelCounts.size())
+		{
+			levelCounts.resize(depth + 1, 0);
+		}
+		levelCounts[depth]++;
+	}
+
+	// Counting sort by depth, slots stay in index order within a level
+	levelStarts.assign(levelCounts.size() + 1, 0);
+	for (size_t d = 0; d < levelCounts.size(); d++)
+	{
+		levelStarts[d + 1] = levelStarts[d] + levelCounts[d];
+	}
+
+	order.resize(levelStarts.back());
+	std::vector<uint32_t> next(levelStarts.begin(), levelStarts.end() - 1);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (alive[i])
+		{
+			order[next[depths[i]]++] = i;
+		}
+	}
+}
+
+void TransformSystem::UpdateRange(uint32_t begin, uint32_t end, TransformSystemStats& rangeStats)
+{
+	bool inRun = false;
+	for (uint32_t k = begin; k < end; k++)
+	{
+		uint32_t i = order[k];
+		uint32_t parent = parents[i];
+
+		// Parents are a level up, so they were finished before this level started
+		bool inherited = parent != TRANSFORM_NO_PARENT && updated[parent];
+		if (!dirty[i] && !inherited)
+		{
+			updated[i] = 0;
+			inRun = false;
+			continue;
+		}
+
+		CalculateWorldMatrix(i);
+
+		if (!dirty[i])
+		{
+			// Moved with its parent, anything caching the world matrix needs to know
+			revisions[i]++;
+			rangeStats.inheritedUpdates++;
+		}
+		dirty[i] = 0;
+		updated[i] = 1;
+
+		rangeStats.matricesUpdated++;
+		if (!inRun)
+		{
+			rangeStats.dirtyRuns++;
+			inRun = true;
+		}
+	}
+}
+
+void TransformSystem::CalculateWorldMatrix(uint32_t index)
+{
+	const XMFLOAT3& scale = scales[index];
+
+	// scale * rotation * translation without the two full matrix multiplies,
+	// scaling the rotation's rows and dropping the position into the last row
+	XMMATRIX world = XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[index]));
+	world.r[0] = XMVectorScale(world.r[0], scale.x);
+	world.r[1] = XMVectorScale(world.r[1], scale.y);
+	world.r[2] = XMVectorScale(world.r[2], scale.z);
+	world.r[3] = XMVectorSetW(XMLoadFloat3(&positions[index]), 1);
+
+	uint32_t parent = parents[index];
+	if (parent != TRANSFORM_NO_PARENT)
+	{
+		world = XMMatrixMultiply(world, XMLoadFloat4x4(&worldMatrices[parent]));
+	}
+
+	XMStoreFloat4x4(&worldMatrices[index], world);
+}
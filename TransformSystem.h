@@ -0,0 +1,155 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+// Parent index of a root transform
+#define TRANSFORM_NO_PARENT UINT32_MAX
+
+// --------------------------------------------------------
+// Slot in a TransformSystem. The generation changes when a
+// slot is freed, so stale handles can be caught.
+// --------------------------------------------------------
+struct TransformHandle
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	inline bool IsValid() const { return index != UINT32_MAX; }
+};
+
+// --------------------------------------------------------
+// Counts from the last TransformSystem::UpdateWorldMatrices()
+// --------------------------------------------------------
+struct TransformSystemStats
+{
+	unsigned int matricesUpdated = 0;
+	unsigned int inheritedUpdates = 0;	// Updated only because an ancestor changed
+	unsigned int dirtyRuns = 0;			// Contiguous runs of updated slots in the sweep order
+	unsigned int hierarchyDepth = 0;
+	double sweepSeconds = 0;
+};
+
+// --------------------------------------------------------
+// Stores every transform's position, rotation, scale, world
+// matrix, parent and dirty bit in parallel arrays
+//
+// - Transform is a thin proxy holding a handle into this
+// - Position, rotation and scale are relative to the parent,
+//   world = local * parent world
+// - Rotations are stored as quaternions, so building a world
+//   matrix or a basis vector needs no trig
+// - Changes only set a dirty byte. The sweep walks the slots
+//   sorted by depth, so parents are always done before their
+//   children and a changed node's whole subtree is updated
+//   in the same linear pass, no recursion. Each depth level
+//   is split across the JobSystem when it's big enough.
+// - Reading a dirty world matrix before the sweep still
+//   rebuilds it and its stale ancestors, so results never
+//   go stale
+// - Creating and destroying slots is locked, so entities
+//   can be deleted from a parallel_for. Creating may grow
+//   the arrays, so don't create while other threads are
+//   reading or writing transforms.
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	// The system every Transform uses unless it's given another
+	static TransformSystem& Get();
+
+	TransformHandle Create();
+	void Destroy(TransformHandle handle);
+	bool IsAlive(TransformHandle handle) const;
+
+	// Attaches child under parent, keeping its local values. Pass
+	// an invalid handle to make it a root again.
+	void SetParent(TransformHandle child, TransformHandle parent);
+	TransformHandle GetParent(TransformHandle handle) const;
+
+	// Rebuilds the world matrix of every dirty slot and everything below it
+	void UpdateWorldMatrices();
+
+	// Raw access to a slot's local values, call MarkDirty() after writing
+	inline DirectX::XMFLOAT3& Position(TransformHandle handle) { return positions[handle.index]; }
+	inline DirectX::XMFLOAT4& Rotation(TransformHandle handle) { return rotations[handle.index]; }
+	inline DirectX::XMFLOAT3& Scale(TransformHandle handle) { return scales[handle.index]; }
+
+	inline void MarkDirty(TransformHandle handle)
+	{
+		dirty[handle.index] = 1;
+		revisions[handle.index]++;
+	}
+
+	// Also throws away the cached basis vectors
+	inline void MarkRotationDirty(TransformHandle handle)
+	{
+		MarkDirty(handle);
+		basisDirty[handle.index] = 1;
+	}
+
+	// Local axes of the slot's rotation, rebuilt only after the rotation changes
+	const DirectX::XMFLOAT3& GetForward(TransformHandle handle);
+	const DirectX::XMFLOAT3& GetRight(TransformHandle handle);
+	const DirectX::XMFLOAT3& GetUp(TransformHandle handle);
+
+	// Rebuilds the matrix first if the slot or one of its ancestors is dirty
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(TransformHandle handle);
+
+	// Copies every slot's world matrix, for handing a tick's state to the renderer.
+	// Call after UpdateWorldMatrices(), dirty slots are copied as they are.
+	void CopyWorldMatrices(std::vector<DirectX::XMFLOAT4X4>& matrices) const;
+
+	// The renderer's own copy of the world matrices, indexed by slot. Only
+	// the renderer touches these, so it can draw while another thread is
+	// moving the transforms.
+	void SwapRenderMatrices(std::vector<DirectX::XMFLOAT4X4>& matrices);
+
+	// Slots created since the last swap are the identity until the next one
+	const DirectX::XMFLOAT4X4& GetRenderMatrix(TransformHandle handle) const;
+
+	// Goes up when the slot changes or the sweep moves it with its parent
+	inline uint32_t GetRevision(TransformHandle handle) const { return revisions[handle.index]; }
+	inline size_t GetAliveCount() const { return positions.size() - freeSlots.size(); }
+	inline const TransformSystemStats& GetStats() const { return stats; }
+
+private:
+	void RebuildOrder();
+	void UpdateRange(uint32_t begin, uint32_t end, TransformSystemStats& rangeStats);
+	void CalculateWorldMatrix(uint32_t index);
+	void UpdateBasis(uint32_t index);
+
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT4> rotations;	// Normalized quaternions
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> renderMatrices;
+
+	std::vector<DirectX::XMFLOAT3> forwards;
+	std::vector<DirectX::XMFLOAT3> rights;
+	std::vector<DirectX::XMFLOAT3> ups;
+
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> childCounts;
+
+	// Bytes instead of vector<bool>, so different threads
+	// can write different slots without sharing a word
+	std::vector<uint8_t> dirty;
+	std::vector<uint8_t> basisDirty;
+	std::vector<uint8_t> updated;		// Set by the sweep, read by the children
+	std::vector<uint8_t> alive;
+	std::vector<uint32_t> revisions;
+	std::vector<uint32_t> generations;
+
+	// Alive slots sorted by depth, level d is order[levelStarts[d]] up to order[levelStarts[d + 1]]
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> levelStarts = { 0 };
+	bool orderChanged = false;
+
+	std::vector<uint32_t> freeSlots;
+	std::mutex slotMutex;
+
+	TransformSystemStats stats;
+};
@@ -1,13 +1,23 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer ExternalData : register(b0)    
-{ 
-	float4 colorTint;
-	matrix world;
+// Buffers are split by how often they change, so
+// each one is only uploaded when its own data changes
+cbuffer PerFrame : register(b0)
+{
 	matrix view;
 	matrix proj;
 }
 
+cbuffer PerMaterial : register(b1)
+{
+	float4 colorTint;
+}
+
+cbuffer PerObject : register(b2)
+{
+	matrix world;
+}
+
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // 